@@ -0,0 +1,121 @@
+/**
+ * @file bench.cpp
+ * Entrypoint and shared helpers for the tvp_bench executable
+ */
+
+#include "bench.h"
+#include "cartridge/utils.h"
+#include "util/log.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace bench {
+
+std::string rom_path = "";
+
+std::vector<uint8_t> make_rom(const std::vector<uint8_t> &program) {
+	auto rom = std::vector<uint8_t>(0x8000, 0x00);
+
+	auto jump = std::vector<uint8_t>{0xC3, 0x50, 0x01}; // JP $0150
+	std::copy(jump.begin(), jump.end(), rom.begin() + 0x0000);
+	std::copy(jump.begin(), jump.end(), rom.begin() + 0x0100);
+
+	std::copy(nintendo_logo.begin(), nintendo_logo.end(),
+	          rom.begin() + nintendo_logo_start_address);
+
+	auto title = std::string("TVP BENCH");
+	std::copy(title.begin(), title.end(), rom.begin() + 0x0134);
+
+	// Header checksum, verified by the boot ROM
+	uint8_t checksum = 0;
+	for (auto i = 0x0134; i <= 0x014C; ++i) {
+		checksum = checksum - rom[i] - 1;
+	}
+	rom[0x014D] = checksum;
+
+	std::copy(program.begin(), program.end(), rom.begin() + 0x0150);
+	return rom;
+}
+
+std::vector<uint8_t> make_synthetic_rom() {
+	// Main loop: fill and sum a block of work RAM forever
+	// clang-format off
+	return make_rom({
+	    0x21, 0x00, 0xC0, // $0150: LD HL, $C000
+	    0x06, 0x00,       //        LD B, $00
+	    0x78,             // $0155: LD A, B
+	    0x22,             //        LD (HL+), A
+	    0x81,             //        ADD A, C
+	    0x4F,             //        LD C, A
+	    0xCB, 0x11,       //        RL C
+	    0x05,             //        DEC B
+	    0x20, 0xF7,       //        JR NZ, $0155
+	    0x7D,             //        LD A, L
+	    0xE6, 0x0F,       //        AND $0F
+	    0xCD, 0x70, 0x01, //        CALL $0170
+	    0xC3, 0x50, 0x01, //        JP $0150
+	    0x00, 0x00, 0x00, 0x00, 0x00,
+	    0x00, 0x00, 0x00, 0x00,
+	    0xC5,             // $0170: PUSH BC
+	    0xD5,             //        PUSH DE
+	    0x11, 0x34, 0x12, //        LD DE, $1234
+	    0x19,             //        ADD HL, DE
+	    0xD1,             //        POP DE
+	    0xC1,             //        POP BC
+	    0xC9,             //        RET
+	});
+	// clang-format on
+}
+
+std::vector<uint8_t> make_vram_rom() {
+	// Main loop: fill the first 256 bytes of tile data, then scroll by one
+	// clang-format off
+	return make_rom({
+	    0x21, 0x00, 0x80, // $0150: LD HL, $8000
+	    0x06, 0x00,       //        LD B, $00
+	    0x78,             // $0155: LD A, B
+	    0x81,             //        ADD A, C
+	    0x22,             //        LD (HL+), A
+	    0x05,             //        DEC B
+	    0x20, 0xFA,       //        JR NZ, $0155
+	    0x0C,             //        INC C
+	    0x79,             //        LD A, C
+	    0xE0, 0x43,       //        LDH (SCX), A
+	    0xC3, 0x50, 0x01, //        JP $0150
+	});
+	// clang-format on
+}
+
+std::unique_ptr<cartridge::Cartridge> load_rom_cartridge() {
+	if (rom_path.empty()) {
+		return nullptr;
+	}
+	return std::make_unique<cartridge::Cartridge>(rom_path);
+}
+
+} // namespace bench
+
+int main(int argc, char *argv[]) {
+	// Pull out our own --rom argument before handing over to the library
+	auto remaining = std::vector<char *>{argv[0]};
+	for (auto i = 1; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--rom") == 0 && i + 1 < argc) {
+			bench::rom_path = argv[++i];
+		} else if (std::strncmp(argv[i], "--rom=", 6) == 0) {
+			bench::rom_path = argv[i] + 6;
+		} else {
+			remaining.push_back(argv[i]);
+		}
+	}
+	auto remaining_argc = static_cast<int>(remaining.size());
+
+	// The emulator logs unimplemented hardware accesses very often
+	Log::set_level(LogLevel::ERROR);
+
+	benchmark::Initialize(&remaining_argc, remaining.data());
+	benchmark::RunSpecifiedBenchmarks();
+	return 0;
+}
@@ -0,0 +1,47 @@
+/**
+ * @file bench.h
+ * Declares helpers shared by all benchmarks
+ */
+
+#pragma once
+
+#include "cartridge/cartridge.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+/**
+ * Path to a real ROM passed with --rom, or empty if none was given
+ */
+extern std::string rom_path;
+
+/**
+ * Build a 32KB ROM with a valid header, so that the boot ROM runs to
+ * completion and hands over to the cartridge. The given program is placed at
+ * $0150, and both $0000 (for when the boot ROM is skipped) and $0100 jump to
+ * it.
+ */
+std::vector<uint8_t> make_rom(const std::vector<uint8_t> &program);
+
+/**
+ * Build a ROM whose code is a small arithmetic and memory loop that never
+ * exits
+ */
+std::vector<uint8_t> make_synthetic_rom();
+
+/**
+ * Build a ROM whose code keeps rewriting the tile data in VRAM and scrolling
+ * the background, so that every frame draws something different
+ */
+std::vector<uint8_t> make_vram_rom();
+
+/**
+ * Load the cartridge given by --rom, or nullptr if there is none
+ */
+std::unique_ptr<cartridge::Cartridge> load_rom_cartridge();
+
+} // namespace bench
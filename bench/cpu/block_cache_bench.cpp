@@ -0,0 +1,97 @@
+/**
+ * @file block_cache_bench.cpp
+ * Compares the plain interpreter against cached block execution
+ */
+
+#include "bench.h"
+#include "gameboy/gameboy.h"
+
+#include <benchmark/benchmark.h>
+
+#include <map>
+#include <string>
+
+using namespace cpu;
+using namespace gameboy;
+
+namespace {
+
+/**
+ * Labels for each execution mode in the benchmark output
+ */
+const std::map<ExecutionMode, std::string> execution_mode_names = {
+    {ExecutionMode::INTERPRETER, "interpreter"},
+    {ExecutionMode::BLOCK_CACHE, "block"},
+    {ExecutionMode::JIT, "jit"},
+};
+
+/**
+ * Number of frames emulated in each benchmark iteration
+ */
+const uint64_t FRAMES_PER_RUN = 60;
+
+/**
+ * Run the given Gameboy until FRAMES_PER_RUN more frames have been drawn
+ *
+ * @return Number of CPU ticks it took
+ */
+uint64_t run_frames(Gameboy *gb) {
+	auto target_frame = gb->gpu->get_frame_count() + FRAMES_PER_RUN;
+	uint64_t ticks = 0;
+	while (gb->gpu->get_frame_count() < target_frame) {
+		gb->tick();
+		++ticks;
+	}
+	return ticks;
+}
+
+/**
+ * Emulate frames from power-on with the given cartridge data, so that the boot
+ * ROM and then the cartridge code run
+ */
+void run_cartridge(benchmark::State &state,
+                   std::function<std::unique_ptr<Cartridge>()> make_cartridge) {
+	auto mode = static_cast<ExecutionMode>(state.range(0));
+	uint64_t frames = 0;
+
+	for (auto _ : state) {
+		state.PauseTiming();
+		auto gb = std::make_unique<Gameboy>(make_cartridge(), true);
+		gb->cpu->set_execution_mode(mode);
+		state.ResumeTiming();
+
+		benchmark::DoNotOptimize(run_frames(gb.get()));
+		frames += FRAMES_PER_RUN;
+	}
+
+	state.counters["fps"] = benchmark::Counter(static_cast<double>(frames),
+	                                           benchmark::Counter::kIsRate);
+	state.SetLabel(execution_mode_names.at(mode));
+}
+
+void BM_BootRom(benchmark::State &state) {
+	auto rom = bench::make_synthetic_rom();
+	run_cartridge(state, [&rom]() { return std::make_unique<Cartridge>(rom); });
+}
+
+void BM_Rom(benchmark::State &state) {
+	if (bench::rom_path.empty()) {
+		state.SkipWithError("No ROM given, pass --rom <path>");
+		return;
+	}
+	run_cartridge(state, bench::load_rom_cartridge);
+}
+
+} // namespace
+
+BENCHMARK(BM_BootRom)
+    ->Arg(static_cast<int>(ExecutionMode::INTERPRETER))
+    ->Arg(static_cast<int>(ExecutionMode::BLOCK_CACHE))
+    ->Arg(static_cast<int>(ExecutionMode::JIT))
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_Rom)
+    ->Arg(static_cast<int>(ExecutionMode::INTERPRETER))
+    ->Arg(static_cast<int>(ExecutionMode::BLOCK_CACHE))
+    ->Arg(static_cast<int>(ExecutionMode::JIT))
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,65 @@
+/**
+ * @file lockstep_bench.cpp
+ * Measures the lockstep core over lane counts, with and without the
+ * vectorized kernels
+ */
+
+#include "bench.h"
+#include "cpu/lockstep.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace cpu;
+
+namespace {
+
+/**
+ * Number of steps per iteration
+ */
+const uint64_t STEPS = 10000;
+
+/**
+ * Args are the lane count, and 1 if the vectorized kernels are enabled
+ */
+void BM_Lockstep(benchmark::State &state) {
+	auto lanes = static_cast<size_t>(state.range(0));
+	auto lockstep = Lockstep(
+	    std::make_shared<std::vector<uint8_t>>(bench::make_synthetic_rom()),
+	    lanes);
+	lockstep.set_vector_enabled(state.range(1) != 0);
+	for (size_t lane = 0; lane < lanes; ++lane) {
+		lockstep.set_buttons(lane, static_cast<uint8_t>(lane));
+	}
+
+	for (auto _ : state) {
+		for (uint64_t i = 0; i < STEPS; ++i) {
+			lockstep.step();
+		}
+	}
+
+	auto &stats = lockstep.get_stats();
+	state.counters["instructions"] = benchmark::Counter(
+	    static_cast<double>(stats.vector_instructions +
+	                        stats.scalar_instructions),
+	    benchmark::Counter::kIsRate);
+	state.counters["vector_share"] =
+	    static_cast<double>(stats.vector_instructions) /
+	    std::max<uint64_t>(1, stats.vector_instructions +
+	                              stats.scalar_instructions);
+}
+
+/**
+ * Lane counts from 1 to 256, each with the vectorized kernels off and on
+ */
+void lane_counts(benchmark::internal::Benchmark *benchmark) {
+	for (auto lanes : {1, 8, 64, 256}) {
+		benchmark->Args({lanes, 0});
+		benchmark->Args({lanes, 1});
+	}
+}
+
+} // namespace
+
+BENCHMARK(BM_Lockstep)
+    ->Apply(lane_counts)
+    ->Unit(benchmark::kMillisecond);
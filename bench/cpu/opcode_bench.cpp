@@ -0,0 +1,103 @@
+/**
+ * @file opcode_bench.cpp
+ * Measures the interpreter on straight line code of each class of opcode
+ */
+
+#include "bench.h"
+#include "gameboy/gameboy.h"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+using namespace cpu;
+using namespace gameboy;
+
+namespace {
+
+/**
+ * A class of opcodes, and a short sequence of them that is repeated to fill
+ * the loop body
+ */
+struct OpcodeClass {
+	std::string name;
+	std::vector<uint8_t> pattern;
+};
+
+// clang-format off
+const std::vector<OpcodeClass> opcode_classes = {
+    {"nop",    {0x00}},                         // NOP
+    {"load",   {0x41, 0x53, 0x78, 0x6F}},       // LD B,C / LD D,E / LD A,B / LD L,A
+    {"alu",    {0x80, 0xA9, 0x14, 0xBB}},       // ADD A,B / XOR C / INC D / CP E
+    {"memory", {0x7E, 0x77, 0x34, 0x0A}},       // LD A,(HL) / LD (HL),A / INC (HL) / LD A,(BC)
+    {"stack",  {0xC5, 0xD1}},                   // PUSH BC / POP DE
+    {"cb",     {0xCB, 0x11, 0xCB, 0x5F,
+                0xCB, 0x30}},                   // RL C / BIT 3,A / SWAP B
+    {"branch", {0x18, 0x00, 0x20, 0x00}},       // JR +0 / JR NZ,+0
+};
+// clang-format on
+
+/**
+ * Number of instructions run in each benchmark iteration
+ */
+const uint32_t TICKS_PER_RUN = 1000;
+
+/**
+ * Size of the repeated loop body in bytes
+ */
+const size_t LOOP_BODY_SIZE = 240;
+
+/**
+ * Build a ROM that points HL and BC at work RAM, then loops over the given
+ * pattern forever
+ */
+std::vector<uint8_t> make_opcode_rom(const std::vector<uint8_t> &pattern) {
+	// clang-format off
+	auto program = std::vector<uint8_t>{
+	    0x31, 0xFE, 0xFF, // $0150: LD SP, $FFFE
+	    0x21, 0x00, 0xC0, //        LD HL, $C000
+	    0x01, 0x80, 0xC0, //        LD BC, $C080
+	};
+	// clang-format on
+	auto loop_start = static_cast<Address>(0x0150 + program.size());
+
+	while (program.size() + pattern.size() <= LOOP_BODY_SIZE) {
+		program.insert(program.end(), pattern.begin(), pattern.end());
+	}
+
+	// JP back to the start of the loop
+	program.push_back(0xC3);
+	program.push_back(static_cast<uint8_t>(loop_start & 0xFF));
+	program.push_back(static_cast<uint8_t>(loop_start >> 8));
+
+	return bench::make_rom(program);
+}
+
+void BM_Opcode(benchmark::State &state) {
+	const auto &opcode_class = opcode_classes.at(state.range(0));
+
+	// Skip the boot ROM, and only tick the CPU. Superinstructions are turned
+	// off so that each opcode runs on its own.
+	auto gb = std::make_unique<Gameboy>(
+	    std::make_unique<Cartridge>(make_opcode_rom(opcode_class.pattern)),
+	    true);
+	gb->memory->write(0xFF50, 1);
+	gb->cpu->set_superinstructions_enabled(false);
+
+	ClockCycles cycles = 0;
+	for (auto _ : state) {
+		for (uint32_t i = 0; i < TICKS_PER_RUN; ++i) {
+			cycles += gb->cpu->tick();
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * TICKS_PER_RUN);
+	state.counters["cycles"] = benchmark::Counter(
+	    static_cast<double>(cycles), benchmark::Counter::kIsRate);
+	state.SetLabel(opcode_class.name);
+}
+
+} // namespace
+
+BENCHMARK(BM_Opcode)->DenseRange(0, 6);
@@ -0,0 +1,59 @@
+/**
+ * @file batch_bench.cpp
+ * Measures how a batch of headless instances scales with the thread count
+ */
+
+#include "bench.h"
+#include "gameboy/batch.h"
+
+#include <benchmark/benchmark.h>
+
+#include <thread>
+
+using namespace gameboy;
+
+namespace {
+
+/**
+ * Number of frames each instance runs for
+ */
+const uint64_t FRAMES_PER_INSTANCE = 30;
+
+/**
+ * Number of instances per thread, so that every thread count has the same
+ * amount of work per thread
+ */
+const uint64_t INSTANCES_PER_THREAD = 4;
+
+void BM_Batch(benchmark::State &state) {
+	auto threads = static_cast<size_t>(state.range(0));
+	auto instances = threads * INSTANCES_PER_THREAD;
+	auto batch = Batch(std::make_shared<std::vector<uint8_t>>(
+	    bench::make_synthetic_rom()));
+
+	uint64_t frames = 0;
+	for (auto _ : state) {
+		frames += batch.run(instances, FRAMES_PER_INSTANCE, threads).frames;
+	}
+
+	state.counters["fps"] = benchmark::Counter(static_cast<double>(frames),
+	                                           benchmark::Counter::kIsRate);
+}
+
+/**
+ * Thread counts from 1 up to the number of cores, doubling each time
+ */
+void thread_counts(benchmark::internal::Benchmark *benchmark) {
+	auto cores = std::max(1u, std::thread::hardware_concurrency());
+	for (auto threads = 1u; threads < cores; threads *= 2) {
+		benchmark->Arg(threads);
+	}
+	benchmark->Arg(cores);
+}
+
+} // namespace
+
+BENCHMARK(BM_Batch)
+    ->Apply(thread_counts)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
@@ -0,0 +1,77 @@
+/**
+ * @file clone_bench.cpp
+ * Measures the cost of forking a running Gameboy
+ */
+
+#include "bench.h"
+#include "gameboy/gameboy.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace gameboy;
+
+namespace {
+
+/**
+ * Get a Gameboy that has run the synthetic ROM for a few frames, so that its
+ * memory is in use
+ */
+std::unique_ptr<Gameboy> make_running_gameboy() {
+	auto gb = std::make_unique<Gameboy>(
+	    std::make_unique<Cartridge>(bench::make_synthetic_rom()), true);
+	while (gb->gpu->get_frame_count() < 5) {
+		gb->tick();
+	}
+	return gb;
+}
+
+/**
+ * Create a new instance for every fork
+ */
+void BM_Clone(benchmark::State &state) {
+	auto gb = make_running_gameboy();
+	for (auto _ : state) {
+		auto child = gb->clone();
+		benchmark::DoNotOptimize(child.get());
+	}
+}
+
+/**
+ * Fork into an existing instance, with a reused snapshot
+ */
+void BM_ForkState(benchmark::State &state) {
+	auto gb = make_running_gameboy();
+	auto child = gb->clone();
+	auto snapshot = std::make_unique<GameboyState>();
+
+	for (auto _ : state) {
+		gb->save_state(snapshot.get());
+		child->load_state(*snapshot);
+		benchmark::DoNotOptimize(child.get());
+	}
+}
+
+/**
+ * Fork into an existing instance and run one frame, which copies the pages
+ * that the frame writes to
+ */
+void BM_ForkFrame(benchmark::State &state) {
+	auto gb = make_running_gameboy();
+	auto child = gb->clone();
+	auto snapshot = std::make_unique<GameboyState>();
+
+	for (auto _ : state) {
+		gb->save_state(snapshot.get());
+		child->load_state(*snapshot);
+		auto target = child->gpu->get_frame_count() + 1;
+		while (child->gpu->get_frame_count() < target) {
+			child->tick();
+		}
+	}
+}
+
+} // namespace
+
+BENCHMARK(BM_Clone)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ForkState)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_ForkFrame)->Unit(benchmark::kMicrosecond);
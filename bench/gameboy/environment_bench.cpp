@@ -0,0 +1,59 @@
+/**
+ * @file environment_bench.cpp
+ * Measures the step and reset rates of the Environment interface
+ */
+
+#include "bench.h"
+#include "gameboy/environment.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace gameboy;
+
+namespace {
+
+/**
+ * Frames run before the reset state is saved, to get past the boot ROM
+ */
+const uint64_t BOOT_FRAMES = 100;
+
+/**
+ * Arg is the number of frames per step
+ */
+void BM_EnvironmentStep(benchmark::State &state) {
+	auto env = Environment(
+	    std::make_shared<std::vector<uint8_t>>(bench::make_synthetic_rom()),
+	    {0xC000, 0xC001}, BOOT_FRAMES);
+	auto frames = static_cast<uint64_t>(state.range(0));
+
+	uint8_t buttons = 0;
+	for (auto _ : state) {
+		auto &obs = env.step(buttons++, frames);
+		benchmark::DoNotOptimize(obs.ram[0]);
+	}
+
+	state.counters["steps"] = benchmark::Counter(
+	    static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+}
+
+void BM_EnvironmentReset(benchmark::State &state) {
+	auto env = Environment(
+	    std::make_shared<std::vector<uint8_t>>(bench::make_synthetic_rom()),
+	    {0xC000, 0xC001}, BOOT_FRAMES);
+
+	for (auto _ : state) {
+		state.PauseTiming();
+		env.step(0, 1);
+		state.ResumeTiming();
+
+		auto &obs = env.reset();
+		benchmark::DoNotOptimize(obs.ram[0]);
+	}
+}
+
+} // namespace
+
+BENCHMARK(BM_EnvironmentStep)->Arg(1)->Arg(4)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_EnvironmentReset)
+    ->Unit(benchmark::kMicrosecond)
+    ->Iterations(200);
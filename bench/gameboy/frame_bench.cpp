@@ -0,0 +1,111 @@
+/**
+ * @file frame_bench.cpp
+ * Runs whole ROMs headless from power on, for a fixed number of frames
+ */
+
+#include "bench.h"
+#include "gameboy/gameboy.h"
+
+#include <benchmark/benchmark.h>
+
+#include <functional>
+
+using namespace gameboy;
+
+namespace {
+
+/**
+ * Emulate the number of frames given by the first benchmark argument,
+ * starting from power on with the given ROM and GPU render mode. Every run is
+ * identical, since nothing depends on host time or input.
+ */
+void run_frames(benchmark::State &state, const std::vector<uint8_t> &rom,
+                RenderMode render_mode) {
+	auto frames_per_run = static_cast<uint64_t>(state.range(0));
+	uint64_t frames = 0;
+
+	for (auto _ : state) {
+		state.PauseTiming();
+		auto gb = std::make_unique<Gameboy>(std::make_unique<Cartridge>(rom),
+		                                    true);
+		gb->gpu->set_render_mode(render_mode);
+		state.ResumeTiming();
+
+		while (gb->gpu->get_frame_count() < frames_per_run) {
+			gb->tick();
+		}
+		frames += frames_per_run;
+	}
+
+	// Every frame is a fixed number of emulated clocks
+	auto clocks = static_cast<double>(frames * CLOCKS_FRAME);
+	state.counters["fps"] = benchmark::Counter(static_cast<double>(frames),
+	                                           benchmark::Counter::kIsRate);
+	state.counters["MHz"] =
+	    benchmark::Counter(clocks / 1e6, benchmark::Counter::kIsRate);
+}
+
+void BM_Frames(benchmark::State &state,
+               std::function<std::vector<uint8_t>()> make_rom) {
+	run_frames(state, make_rom(), RenderMode::SCANLINE);
+}
+
+/**
+ * Like BM_Frames, with the GPU render mode given by the second argument, to
+ * weigh the cost of the pixel FIFO against the scanline renderer
+ */
+void BM_RenderMode(benchmark::State &state,
+                   std::function<std::vector<uint8_t>()> make_rom) {
+	auto render_mode = static_cast<RenderMode>(state.range(1));
+	run_frames(state, make_rom(), render_mode);
+	state.SetLabel(render_mode == RenderMode::SCANLINE ? "scanline" : "fifo");
+}
+
+/**
+ * The boot ROM scrolls the logo for about 150 frames, then hands over to a
+ * cartridge that spins forever
+ */
+std::vector<uint8_t> make_boot_rom() { return bench::make_rom({0x18, 0xFE}); }
+
+/**
+ * Like the boot ROM run, but the cartridge turns the LCD off before it spins,
+ * like a game loading VRAM
+ */
+std::vector<uint8_t> make_lcd_off_rom() {
+	// clang-format off
+	return bench::make_rom({
+	    0xAF,       // XOR A
+	    0xE0, 0x40, // LDH ($40), A
+	    0x18, 0xFE, // JR -2
+	});
+	// clang-format on
+}
+
+} // namespace
+
+BENCHMARK_CAPTURE(BM_Frames, boot, make_boot_rom)
+    ->Arg(60)
+    ->Arg(300)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_CAPTURE(BM_Frames, alu, bench::make_synthetic_rom)
+    ->Arg(300)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_CAPTURE(BM_Frames, vram, bench::make_vram_rom)
+    ->Arg(300)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_CAPTURE(BM_Frames, lcd_off, make_lcd_off_rom)
+    ->Arg(300)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_CAPTURE(BM_RenderMode, boot, make_boot_rom)
+    ->Args({300, static_cast<int>(RenderMode::SCANLINE)})
+    ->Args({300, static_cast<int>(RenderMode::PIXEL_FIFO)})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_CAPTURE(BM_RenderMode, vram, bench::make_vram_rom)
+    ->Args({300, static_cast<int>(RenderMode::SCANLINE)})
+    ->Args({300, static_cast<int>(RenderMode::PIXEL_FIFO)})
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,148 @@
+/**
+ * @file gpu_bench.cpp
+ * Measures the GPU's scanline and tile rendering
+ */
+
+#include "bench.h"
+#include "gameboy/gameboy.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace gameboy;
+
+namespace bench {
+
+/**
+ * Gives benchmarks access to the private rendering methods of the GPU
+ */
+class GPUAccess {
+  public:
+	static void write_bg_line(GameboyGPU *gpu) {
+		gpu->write_bg_line(gpu->get_line_state());
+	}
+
+	static void write_sprites(GameboyGPU *gpu) { gpu->write_sprites(); }
+
+	/**
+	 * Run the pixel FIFO through the whole pixel transfer of a line
+	 */
+	static void transfer_fifo_line(GameboyGPU *gpu, uint8_t line) {
+		gpu->fifo.start_line(line, &gpu->v_buffer[line * SCREEN_WIDTH]);
+		while (!gpu->fifo.step()) {
+		}
+	}
+
+	static Tile get_tile_from_memory(GameboyGPU *gpu, uint8_t tile_number,
+	                                 bool sprite) {
+		return gpu->get_tile_from_memory(tile_number, sprite);
+	}
+};
+
+} // namespace bench
+
+namespace {
+
+/**
+ * Create a Gameboy with VRAM filled with a pattern, so that every tile and
+ * tile map entry is different
+ */
+std::unique_ptr<Gameboy> make_gameboy() {
+	auto gb = std::make_unique<Gameboy>(
+	    std::make_unique<Cartridge>(bench::make_synthetic_rom()), true);
+	gb->memory->write(0xFF50, 1);
+
+	for (uint32_t addr = 0x8000; addr <= 0x9FFF; ++addr) {
+		gb->memory->write(addr, static_cast<uint8_t>(addr * 7 + (addr >> 8)));
+	}
+	gb->memory->get_io()->set(memory::io::LCDC, 0x91);
+	gb->memory->get_io()->set(memory::io::BGP, 0xE4);
+	return gb;
+}
+
+void BM_WriteBgLine(benchmark::State &state) {
+	auto gb = make_gameboy();
+	auto io = gb->memory->get_io();
+	io->set(memory::io::SCX, static_cast<uint8_t>(state.range(0)));
+	io->set(memory::io::LCDC, static_cast<uint8_t>(state.range(1)));
+
+	for (auto _ : state) {
+		for (uint8_t line = 0; line < SCREEN_HEIGHT; ++line) {
+			io->set(memory::io::LY, line);
+			bench::GPUAccess::write_bg_line(gb->gpu.get());
+		}
+		benchmark::ClobberMemory();
+	}
+
+	state.SetItemsProcessed(state.iterations() * SCREEN_HEIGHT);
+}
+
+void BM_PixelFifoLine(benchmark::State &state) {
+	auto gb = make_gameboy();
+	auto io = gb->memory->get_io();
+	io->set(memory::io::SCX, static_cast<uint8_t>(state.range(0)));
+
+	for (auto _ : state) {
+		for (uint8_t line = 0; line < SCREEN_HEIGHT; ++line) {
+			bench::GPUAccess::transfer_fifo_line(gb->gpu.get(), line);
+		}
+		benchmark::ClobberMemory();
+	}
+
+	state.SetItemsProcessed(state.iterations() * SCREEN_HEIGHT);
+}
+
+void BM_WriteSprites(benchmark::State &state) {
+	auto gb = make_gameboy();
+	auto io = gb->memory->get_io();
+	io->set(memory::io::LCDC, static_cast<uint8_t>(state.range(0)));
+
+	// Spread all 40 sprites over the screen, with every flip and palette
+	for (uint8_t i = 0; i < 40; ++i) {
+		auto entry = static_cast<Address>(0xFE00 + i * 4);
+		gb->memory->write(entry, static_cast<uint8_t>(16 + (i % 8) * 16));
+		gb->memory->write(entry + 1, static_cast<uint8_t>(8 + (i / 8) * 32));
+		gb->memory->write(entry + 2, static_cast<uint8_t>(i * 3));
+		gb->memory->write(entry + 3, static_cast<uint8_t>((i % 8) << 4));
+	}
+
+	for (auto _ : state) {
+		bench::GPUAccess::write_sprites(gb->gpu.get());
+		benchmark::ClobberMemory();
+	}
+
+	state.SetItemsProcessed(state.iterations() * 40);
+}
+
+void BM_GetTileFromMemory(benchmark::State &state) {
+	auto gb = make_gameboy();
+	auto sprite = state.range(0) != 0;
+
+	for (auto _ : state) {
+		for (uint32_t tile_number = 0; tile_number < 256; ++tile_number) {
+			auto tile = bench::GPUAccess::get_tile_from_memory(
+			    gb->gpu.get(), static_cast<uint8_t>(tile_number), sprite);
+			benchmark::DoNotOptimize(tile.data.data());
+		}
+	}
+
+	state.SetItemsProcessed(state.iterations() * 256);
+	state.SetLabel(sprite ? "sprite" : "background");
+}
+
+} // namespace
+
+// Aligned and unaligned horizontal scroll, then the other tile data and tile
+// map selections of LCDC
+BENCHMARK(BM_WriteBgLine)
+    ->Args({0, 0x91})
+    ->Args({3, 0x91})
+    ->Args({0, 0x81})
+    ->Args({0, 0x99});
+
+// The same lines as BM_WriteBgLine, a dot at a time
+BENCHMARK(BM_PixelFifoLine)->Arg(0)->Arg(3);
+
+// 8x8 and 8x16 sprites
+BENCHMARK(BM_WriteSprites)->Arg(0x93)->Arg(0x97);
+
+BENCHMARK(BM_GetTileFromMemory)->Arg(0)->Arg(1);
@@ -0,0 +1,66 @@
+/**
+ * @file memory_bench.cpp
+ * Measures single byte reads and writes to each region of memory
+ */
+
+#include "bench.h"
+#include "gameboy/gameboy.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace gameboy;
+
+namespace {
+
+/**
+ * Number of consecutive addresses accessed in each benchmark iteration
+ */
+const uint32_t ACCESSES_PER_RUN = 256;
+
+/**
+ * Create a Gameboy that has handed over from the boot ROM to the cartridge
+ */
+std::unique_ptr<Gameboy> make_gameboy() {
+	auto gb = std::make_unique<Gameboy>(
+	    std::make_unique<Cartridge>(bench::make_synthetic_rom()), true);
+	gb->memory->write(0xFF50, 1);
+	return gb;
+}
+
+void BM_MemoryRead(benchmark::State &state) {
+	auto gb = make_gameboy();
+	auto start = static_cast<Address>(state.range(0));
+
+	for (auto _ : state) {
+		uint32_t sum = 0;
+		for (uint32_t i = 0; i < ACCESSES_PER_RUN; ++i) {
+			sum += gb->memory->read(start + i);
+		}
+		benchmark::DoNotOptimize(sum);
+	}
+
+	state.SetItemsProcessed(state.iterations() * ACCESSES_PER_RUN);
+}
+
+void BM_MemoryWrite(benchmark::State &state) {
+	auto gb = make_gameboy();
+	auto start = static_cast<Address>(state.range(0));
+
+	for (auto _ : state) {
+		for (uint32_t i = 0; i < ACCESSES_PER_RUN; ++i) {
+			gb->memory->write(start + i, static_cast<uint8_t>(i));
+		}
+		benchmark::ClobberMemory();
+	}
+
+	state.SetItemsProcessed(state.iterations() * ACCESSES_PER_RUN);
+}
+
+} // namespace
+
+// Fixed ROM bank, switchable ROM bank, VRAM and work RAM. The I/O registers
+// log on every access to an unmapped address, and are left out.
+BENCHMARK(BM_MemoryRead)->Arg(0x0150)->Arg(0x4000)->Arg(0x8000)->Arg(0xC000);
+
+// Cartridge ROM writes go to the memory bank controller, and are left out
+BENCHMARK(BM_MemoryWrite)->Arg(0x8000)->Arg(0xC000);
@@ -0,0 +1,36 @@
+/**
+ * @file video_bench.cpp
+ * Measures the conversion of the video buffer into window pixels
+ */
+
+#include "bench.h"
+#include "video/video.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace gpu;
+using namespace video;
+
+namespace {
+
+void BM_FillImage(benchmark::State &state) {
+	// A repeating pattern of all four shades
+	auto v_buffer = VideoBuffer{};
+	for (unsigned int i = 0; i < PIXEL_COUNT; ++i) {
+		v_buffer[i] = static_cast<Pixel>((i + i / SCREEN_WIDTH) % 4);
+	}
+
+	auto image = sf::Image();
+	image.create(SCREEN_WIDTH * MULT, SCREEN_HEIGHT * MULT);
+
+	for (auto _ : state) {
+		Video::fill_image(v_buffer, &image);
+		benchmark::DoNotOptimize(image.getPixelsPtr());
+	}
+
+	state.SetItemsProcessed(state.iterations() * PIXEL_COUNT);
+}
+
+} // namespace
+
+BENCHMARK(BM_FillImage);
@@ -8,6 +8,7 @@
 
 #include "debugger/debugger.fwd.h"
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -17,21 +18,60 @@
 
 namespace cartridge {
 
+/**
+ * Snapshot of the data of a Cartridge. The data is shared with the cartridge
+ * until either of them is written to, so taking a snapshot is cheap.
+ */
+struct CartridgeState {
+	std::shared_ptr<std::vector<uint8_t>> data;
+};
+
 class Cartridge {
   private:
 	/**
-	 * The Data stored in this cartridge
+	 * The Data stored in this cartridge. This may be shared with other
+	 * cartridges loaded from the same ROM, and is copied on the first write.
 	 */
-	std::vector<uint8_t> data;
+	std::shared_ptr<std::vector<uint8_t>> data;
 
 	/**
 	 * Holds game related metadata extracted from this cartridge
 	 */
 	std::unique_ptr<CartridgeMetadata> metadata;
 
+	/**
+	 * Parse the metadata of the loaded ROM data and verify the logo
+	 */
+	void load_metadata();
+
   public:
 	Cartridge(std::string filepath);
 
+	/**
+	 * Construct a cartridge from ROM data already in memory. The metadata is
+	 * parsed, but not displayed.
+	 *
+	 * @param rom_data Complete contents of the ROM
+	 */
+	Cartridge(std::vector<uint8_t> rom_data);
+
+	/**
+	 * Construct a cartridge from ROM data that is shared with other
+	 * cartridges, so that many instances of one ROM only hold one copy of it.
+	 * The data is copied if this cartridge is ever written to.
+	 *
+	 * @param rom_data Complete contents of the ROM
+	 */
+	Cartridge(std::shared_ptr<std::vector<uint8_t>> rom_data);
+
+	/**
+	 * Read the complete contents of a ROM file. Exits if the file cannot be
+	 * read.
+	 *
+	 * @param filepath Path to the ROM file
+	 */
+	static std::vector<uint8_t> read_file(std::string filepath);
+
 	/**
 	 * Read a value from the given address in the cartridge
 	 *
@@ -40,6 +80,24 @@ class Cartridge {
 	 */
 	uint8_t read(Address address);
 
+	/**
+	 * Read a little-endian 16-bit value from the given address
+	 *
+	 * @param address Address of the low byte
+	 * @return uint16_t
+	 */
+	uint16_t read16(Address address);
+
+	/**
+	 * Copy a block of bytes out of the cartridge, starting at the given
+	 * address
+	 *
+	 * @param address Address of the first byte
+	 * @param destination Where to copy the bytes to
+	 * @param length Number of bytes
+	 */
+	void read_block(Address address, uint8_t *destination, size_t length);
+
 	/**
 	 * Write data to the given address in the cartridge
 	 *
@@ -58,6 +116,16 @@ class Cartridge {
 	 */
 	CartridgeMetadata *get_metadata();
 
+	/**
+	 * Get a snapshot of the cartridge data
+	 */
+	CartridgeState get_state() const;
+
+	/**
+	 * Load the cartridge data from a snapshot
+	 */
+	void set_state(const CartridgeState &state);
+
 	/**
 	 * Debugger may read private members of this class
 	 */
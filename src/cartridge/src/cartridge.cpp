@@ -7,6 +7,7 @@
 #include "util/helpers.h"
 #include "util/log.h"
 
+#include <cstring>
 #include <fstream>
 #include <vector>
 
@@ -15,7 +16,26 @@
 
 namespace cartridge {
 
-Cartridge::Cartridge(std::string rom_path) {
+Cartridge::Cartridge(std::string rom_path)
+    : data(std::make_shared<std::vector<uint8_t>>(read_file(rom_path))) {
+	// Parse the Meta Data of the Cartridge
+	load_metadata();
+
+	// Display the Meta Data of the Cartridge
+	display_metadata();
+}
+
+Cartridge::Cartridge(std::vector<uint8_t> rom_data)
+    : data(std::make_shared<std::vector<uint8_t>>(std::move(rom_data))) {
+	load_metadata();
+}
+
+Cartridge::Cartridge(std::shared_ptr<std::vector<uint8_t>> rom_data)
+    : data(std::move(rom_data)) {
+	load_metadata();
+}
+
+std::vector<uint8_t> Cartridge::read_file(std::string rom_path) {
 	try {
 		// Open the file
 		auto rom_file =
@@ -31,18 +51,7 @@ Cartridge::Cartridge(std::string rom_path) {
 		auto byte_input = std::vector<char>();
 		byte_input = std::vector<char>(rom_file_size, '\0');
 		rom_file.read(&byte_input[0], rom_file_size);
-		data = std::vector<uint8_t>(byte_input.begin(), byte_input.end());
-
-		// Parse the Meta Data of the Cartridge
-		metadata = std::make_unique<CartridgeMetadata>(data);
-		if (metadata->is_logo_valid) {
-			Log::verbose("ROM Verification Done!");
-		} else {
-			Log::error("ROM Verification Failed!");
-		}
-
-		// Display the Meta Data of the Cartridge
-		display_metadata();
+		return std::vector<uint8_t>(byte_input.begin(), byte_input.end());
 
 	} catch (std::exception &e) {
 		std::cerr << "Error Opening the ROM file! Exiting TVP." << std::endl;
@@ -50,16 +59,50 @@ Cartridge::Cartridge(std::string rom_path) {
 	}
 }
 
+void Cartridge::load_metadata() {
+	metadata = std::make_unique<CartridgeMetadata>(*data);
+	if (metadata->is_logo_valid) {
+		Log::verbose("ROM Verification Done!");
+	} else {
+		Log::error("ROM Verification Failed!");
+	}
+}
+
 CartridgeMetadata *Cartridge::get_metadata() { return metadata.get(); }
 
+CartridgeState Cartridge::get_state() const {
+	auto state = CartridgeState{};
+	state.data = data;
+	return state;
+}
+
+void Cartridge::set_state(const CartridgeState &state) { data = state.data; }
+
 uint8_t Cartridge::read(Address address) {
 	// Get data
-	return data[address];
+	return (*data)[address];
+}
+
+uint16_t Cartridge::read16(Address address) {
+	auto &bytes = *data;
+	return static_cast<uint16_t>(bytes[address] | (bytes[address + 1] << 8));
+}
+
+void Cartridge::read_block(Address address, uint8_t *destination,
+                           size_t length) {
+	std::memcpy(destination, data->data() + address, length);
 }
 
 void Cartridge::write(Address address, uint8_t byte) {
+	// Take a private copy of shared data before changing it. Nothing else can
+	// take a new reference while this is the only one, so a count of one
+	// can't go stale.
+	if (data.use_count() > 1) {
+		data = std::make_shared<std::vector<uint8_t>>(*data);
+	}
+
 	// Put data
-	data[address] = byte;
+	(*data)[address] = byte;
 }
 
 // Helper to display cartridge metadata
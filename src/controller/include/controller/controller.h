@@ -14,6 +14,15 @@
 
 namespace controller {
 
+/**
+ * Snapshot of the button states and joypad register selection of a Controller
+ */
+struct ControllerState {
+	std::array<bool, 8> buttons;
+	bool button_flag;
+	bool direction_flag;
+};
+
 /**
  * Class representing the game joypad and buttons
  */
@@ -80,6 +89,26 @@ class Controller : public ControllerInterface {
 	 * @see ControllerInterface#release_button
 	 */
 	void release_button(Button button) override;
+
+	/**
+	 * Get the pressed buttons, one bit per Button, set if pressed
+	 */
+	uint8_t get_buttons() const;
+
+	/**
+	 * Press and release buttons to match the given bits, one per Button
+	 */
+	void set_buttons(uint8_t pressed);
+
+	/**
+	 * Get a snapshot of the button states
+	 */
+	ControllerState get_state() const;
+
+	/**
+	 * Load the button states from a snapshot
+	 */
+	void set_state(const ControllerState &state);
 };
 
 } // namespace controller
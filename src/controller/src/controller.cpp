@@ -10,7 +10,9 @@
 
 namespace controller {
 
-Controller::Controller() : buttons(std::array<bool, 8>{}) {}
+Controller::Controller()
+    : buttons(std::array<bool, 8>{}), button_flag(false),
+      direction_flag(false) {}
 
 int Controller::button_index(Button button) {
 	// Return the corresponding index
@@ -74,4 +76,34 @@ void Controller::press_button(Button button) { set_button(button, true); }
 
 void Controller::release_button(Button button) { set_button(button, false); }
 
+uint8_t Controller::get_buttons() const {
+	uint8_t pressed = 0;
+	for (size_t i = 0; i < buttons.size(); ++i) {
+		if (buttons[i]) {
+			pressed |= 1 << i;
+		}
+	}
+	return pressed;
+}
+
+void Controller::set_buttons(uint8_t pressed) {
+	for (size_t i = 0; i < buttons.size(); ++i) {
+		buttons[i] = pressed & (1 << i);
+	}
+}
+
+ControllerState Controller::get_state() const {
+	auto state = ControllerState{};
+	state.buttons = buttons;
+	state.button_flag = button_flag;
+	state.direction_flag = direction_flag;
+	return state;
+}
+
+void Controller::set_state(const ControllerState &state) {
+	buttons = state.buttons;
+	button_flag = state.button_flag;
+	direction_flag = state.direction_flag;
+}
+
 } // namespace controller
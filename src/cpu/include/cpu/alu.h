@@ -0,0 +1,148 @@
+/**
+ * @file alu.h
+ * Declares the 8-bit ALU operations, shared by the CPU and the lockstep core
+ */
+
+#pragma once
+
+#include "cpu/utils.h"
+
+#include <cstdint>
+
+namespace cpu {
+
+/**
+ * Pure functions for the 8-bit arithmetic and logic instructions. Each one
+ * takes the operands and the current value of the flag register, and returns
+ * the result with the flag bits it changes updated in place. They have no
+ * branches on the operands, so that loops over many instances vectorize.
+ */
+namespace alu {
+
+/**
+ * Set a single bit of the flag register to the given value
+ */
+inline uint8_t set_flag(uint8_t flags, flag::FlagBits bit, bool value) {
+	return static_cast<uint8_t>((flags & ~(1u << bit)) |
+	                            (static_cast<uint8_t>(value) << bit));
+}
+
+/**
+ * Get a single bit of the flag register
+ */
+inline uint8_t get_flag(uint8_t flags, flag::FlagBits bit) {
+	return (flags >> bit) & 1;
+}
+
+inline uint8_t add(uint8_t a, uint8_t val, uint8_t &flags) {
+	auto result = a + val;
+	auto result_byte = static_cast<uint8_t>(result);
+
+	flags = set_flag(flags, flag::ZERO, result_byte == 0);
+	flags = set_flag(flags, flag::SUBTRACT, 0);
+	flags = set_flag(flags, flag::HALFCARRY, (0xf & val) + (0xf & a) > 0xf);
+	flags = set_flag(flags, flag::CARRY, (0x100 & result) != 0);
+	return result_byte;
+}
+
+inline uint8_t adc(uint8_t a, uint8_t val, uint8_t &flags) {
+	auto carry_to_add = get_flag(flags, flag::CARRY);
+	auto result = a + val + carry_to_add;
+	auto result_byte = static_cast<uint8_t>(result);
+
+	flags = set_flag(flags, flag::ZERO, result_byte == 0);
+	flags = set_flag(flags, flag::SUBTRACT, 0);
+	flags = set_flag(flags, flag::HALFCARRY,
+	                 (0xf & val) + (0xf & a) + carry_to_add > 0xf);
+	flags = set_flag(flags, flag::CARRY, (0x100 & result) != 0);
+	return result_byte;
+}
+
+inline uint8_t sub(uint8_t a, uint8_t val, uint8_t &flags) {
+	auto result_byte = static_cast<uint8_t>(a - val);
+
+	flags = set_flag(flags, flag::ZERO, result_byte == 0);
+	flags = set_flag(flags, flag::SUBTRACT, 1);
+	flags = set_flag(flags, flag::HALFCARRY, (0xf & a) < (0xf & val));
+	flags = set_flag(flags, flag::CARRY, a < val);
+	return result_byte;
+}
+
+inline uint8_t sbc(uint8_t a, uint8_t val, uint8_t &flags) {
+	auto carry_to_sub = get_flag(flags, flag::CARRY);
+	auto result = a - val - carry_to_sub;
+	auto result_byte = static_cast<uint8_t>(result);
+
+	flags = set_flag(flags, flag::ZERO, result_byte == 0);
+	flags = set_flag(flags, flag::SUBTRACT, 1);
+	flags = set_flag(flags, flag::HALFCARRY,
+	                 (0xf & a) - (0xf & val) - carry_to_sub < 0);
+	flags = set_flag(flags, flag::CARRY, result < 0);
+	return result_byte;
+}
+
+inline uint8_t and_(uint8_t a, uint8_t val, uint8_t &flags) {
+	auto result_byte = static_cast<uint8_t>(a & val);
+
+	flags = set_flag(flags, flag::ZERO, result_byte == 0);
+	flags = set_flag(flags, flag::SUBTRACT, 0);
+	flags = set_flag(flags, flag::HALFCARRY, 1);
+	flags = set_flag(flags, flag::CARRY, 0);
+	return result_byte;
+}
+
+inline uint8_t xor_(uint8_t a, uint8_t val, uint8_t &flags) {
+	auto result_byte = static_cast<uint8_t>(a ^ val);
+
+	flags = set_flag(flags, flag::ZERO, result_byte == 0);
+	flags = set_flag(flags, flag::SUBTRACT, 0);
+	flags = set_flag(flags, flag::HALFCARRY, 0);
+	flags = set_flag(flags, flag::CARRY, 0);
+	return result_byte;
+}
+
+inline uint8_t or_(uint8_t a, uint8_t val, uint8_t &flags) {
+	auto result_byte = static_cast<uint8_t>(a | val);
+
+	flags = set_flag(flags, flag::ZERO, result_byte == 0);
+	flags = set_flag(flags, flag::SUBTRACT, 0);
+	flags = set_flag(flags, flag::HALFCARRY, 0);
+	flags = set_flag(flags, flag::CARRY, 0);
+	return result_byte;
+}
+
+/**
+ * Compare - sets the flags like sub, and returns A unchanged
+ */
+inline uint8_t cp(uint8_t a, uint8_t val, uint8_t &flags) {
+	sub(a, val, flags);
+	return a;
+}
+
+/**
+ * Increment. The carry flag is left alone.
+ */
+inline uint8_t inc(uint8_t val, uint8_t &flags) {
+	auto result_byte = static_cast<uint8_t>(val + 1);
+
+	flags = set_flag(flags, flag::ZERO, result_byte == 0);
+	flags = set_flag(flags, flag::SUBTRACT, 0);
+	flags = set_flag(flags, flag::HALFCARRY, (result_byte & 0x0F) == 0);
+	return result_byte;
+}
+
+/**
+ * Decrement. The carry flag is left alone.
+ */
+inline uint8_t dec(uint8_t val, uint8_t &flags) {
+	auto result_byte = static_cast<uint8_t>(val - 1);
+
+	flags = set_flag(flags, flag::ZERO, result_byte == 0);
+	flags = set_flag(flags, flag::SUBTRACT, 1);
+	flags = set_flag(flags, flag::HALFCARRY, (result_byte & 0x0F) == 0x0F);
+	return result_byte;
+}
+
+} // namespace alu
+
+} // namespace cpu
@@ -0,0 +1,226 @@
+/**
+ * @file block_cache.h
+ * Declares the BlockCache class, which holds pre-decoded runs of ROM code
+ */
+
+#pragma once
+
+#include "cpu/utils.h"
+#include "memory/utils.h"
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace cpu {
+
+/**
+ * Code is only cached from the cartridge ROM area ($0000 - $7FFF). Code
+ * running from RAM is always interpreted.
+ */
+const Address CACHEABLE_END = 0x8000;
+
+/**
+ * Maximum number of instructions decoded into a single block. This keeps the
+ * number of cycles handed to the GPU in one go close to the interpreter's.
+ */
+const uint8_t MAX_BLOCK_INSTRUCTIONS = 16;
+
+/**
+ * Maximum number of bytes a single block can span
+ */
+constexpr uint8_t MAX_BLOCK_BYTES = MAX_BLOCK_INSTRUCTIONS * 3;
+
+/**
+ * Number of invalidations after which code at an address is considered
+ * self-modifying
+ */
+const uint8_t MAX_INVALIDATIONS = 4;
+
+/**
+ * Number of addresses covered by each page of the block table
+ */
+const size_t BLOCK_PAGE_SIZE = 0x100;
+
+/**
+ * Native code for a block, generated by the JIT. Takes the CPU that runs it
+ * and returns the number of cycles taken.
+ */
+using JitFunction = ClockCycles (*)(void *context);
+
+/**
+ * Register pair that an instruction reads or writes memory through
+ */
+enum class PointerRegister : uint8_t { NONE, BC, DE, HL };
+
+/**
+ * A single instruction, decoded ahead of time
+ */
+struct DecodedInstruction {
+	/**
+	 * Address of the instruction
+	 */
+	Address address;
+
+	/**
+	 * Opcode, or the second byte for 0xCB prefixed instructions
+	 */
+	OpCode opcode;
+	bool prefixed;
+
+	/**
+	 * Register pair the instruction accesses memory through. Whether that is
+	 * I/O is only known when it runs.
+	 */
+	PointerRegister pointer;
+
+	/**
+	 * Action function for this opcode, from the CPU's opcode maps
+	 */
+	const std::function<void()> *handler;
+
+	/**
+	 * Immediate operand bytes, in the order they appear in memory
+	 */
+	std::array<uint8_t, 2> operands;
+
+	/**
+	 * Address of the instruction following this one. The PC is set to this
+	 * value before the handler runs, as if the instruction had been fetched.
+	 */
+	Address next_pc;
+
+	/**
+	 * Number of cycles taken, if the instruction did or did not branch
+	 */
+	ClockCycles cycles;
+	ClockCycles cycles_branched;
+};
+
+/**
+ * A straight-line run of instructions, ending at a branch, an I/O access at a
+ * fixed address or an instruction that changes the interrupt state. Running a
+ * block also stops after an access to I/O through a register pair.
+ */
+struct Block {
+	/**
+	 * Address of the first and last byte covered by this block
+	 */
+	Address start;
+	Address end;
+
+	/**
+	 * Cleared when a write lands inside this block while it is executing
+	 */
+	bool valid;
+
+	/**
+	 * Number of times this block has run, used to find hot blocks
+	 */
+	uint32_t hits;
+
+	/**
+	 * Compiled version of this block, or nullptr if it has not been compiled
+	 */
+	JitFunction native;
+
+	/**
+	 * Instructions in this block, in execution order
+	 */
+	std::vector<DecodedInstruction> instructions;
+};
+
+/**
+ * Holds decoded blocks keyed by their start address, and drops them when the
+ * code underneath them changes
+ */
+class BlockCache {
+  private:
+	/**
+	 * Blocks starting in one page of ROM
+	 */
+	struct BlockPage {
+		/**
+		 * Decoded blocks, indexed by their offset in the page
+		 */
+		std::array<std::unique_ptr<Block>, BLOCK_PAGE_SIZE> blocks;
+
+		/**
+		 * Number of times a block starting at each offset was invalidated
+		 */
+		std::array<uint8_t, BLOCK_PAGE_SIZE> invalidations;
+	};
+
+	/**
+	 * Pages of decoded blocks, indexed by start address / BLOCK_PAGE_SIZE.
+	 * A page is only allocated once a block starts in it, so that a new CPU,
+	 * like the one in every Gameboy::clone(), does not pay for a table of
+	 * the whole ROM.
+	 */
+	std::array<std::unique_ptr<BlockPage>, CACHEABLE_END / BLOCK_PAGE_SIZE>
+	    pages;
+
+	/**
+	 * Blocks that were invalidated, but may still be executing. These are
+	 * freed on the next lookup.
+	 */
+	std::vector<std::unique_ptr<Block>> retired;
+
+  public:
+	BlockCache();
+
+	/**
+	 * Check if code at the given address may be cached
+	 */
+	static bool is_cacheable(Address pc);
+
+	/**
+	 * Check if the given instruction must be the last one in its block
+	 *
+	 * @param opcode Instruction opcode
+	 * @param immediate 16-bit immediate operand, if the instruction has one
+	 */
+	static bool ends_block(OpCode opcode, Address immediate);
+
+	/**
+	 * Get the register pair the given instruction accesses memory through
+	 *
+	 * @param opcode Instruction opcode, or the second byte if prefixed
+	 * @param prefixed Whether the instruction is 0xCB prefixed
+	 */
+	static PointerRegister get_pointer(OpCode opcode, bool prefixed);
+
+	/**
+	 * Get the block starting at the given address
+	 *
+	 * @return Pointer to the block, or nullptr if it has not been decoded
+	 */
+	Block *find(Address pc);
+
+	/**
+	 * Take ownership of a newly decoded block
+	 *
+	 * @return Pointer to the stored block
+	 */
+	Block *insert(std::unique_ptr<Block> block);
+
+	/**
+	 * Drop all blocks that overlap the given address range (inclusive)
+	 */
+	void invalidate(Address start, Address end);
+
+	/**
+	 * Drop all blocks
+	 */
+	void clear();
+
+	/**
+	 * Check if the code at the given address keeps getting overwritten, in
+	 * which case it should not be compiled
+	 */
+	bool is_volatile(Address pc) const;
+};
+
+} // namespace cpu
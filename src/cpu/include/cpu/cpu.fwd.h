@@ -7,6 +7,6 @@
 
 namespace cpu {
 
-class CPU;
+template <typename Bus> class CPU;
 
 } // namespace cpu
@@ -5,24 +5,38 @@
 
 #pragma once
 
+#include "cpu/block_cache.h"
 #include "cpu/cpu_interface.h"
+#include "cpu/interrupts.h"
+#include "cpu/jit.h"
+#include "cpu/profiler.h"
 #include "cpu/register/register_interface.h"
+#include "cpu/superinstruction.h"
+#include "cpu/trace.h"
 #include "cpu/utils.h"
-#include "memory/memory_interface.h"
 
 #include "debugger/debugger.fwd.h"
 
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <ostream>
 #include <vector>
 
 namespace cpu {
 
 /**
  * The CPU class, which runs machine opcodes
+ *
+ * The CPU is a template over the type of its memory bus, so that reads and
+ * writes are direct calls that can be inlined into the opcode handlers. The
+ * definitions are in cpu_impl.h, and each bus type is explicitly instantiated
+ * once: memory::Memory in cpu.cpp, LaneMemory in lockstep.cpp, and the
+ * MemoryMock in the tests.
+ *
+ * @tparam Bus Memory the CPU reads and writes, like memory::Memory
  */
-class CPU : public CPUInterface {
+template <typename Bus> class CPU final : public CPUInterface {
   private:
 	/**
 	 * Ticks
@@ -82,7 +96,7 @@ class CPU : public CPUInterface {
 	/**
 	 * Memory instance, for performing all reads and writes to main memory
 	 */
-	memory::MemoryInterface *memory;
+	Bus *memory;
 
 	/**
 	 * Specifies whether the CPU is currently in the halted state
@@ -90,33 +104,196 @@ class CPU : public CPUInterface {
 	bool halted;
 
 	/**
-	 * Specifies whether interrupts are currently enabled
+	 * Interrupt Flag and Enable registers, mapped to 0xFF0F and 0xFFFF, and
+	 * the interrupt master enable
 	 */
-	bool interrupt_enabled;
+	InterruptController interrupts;
 
 	/**
-	 * Interrupt Enable register, which controls which interrupts are active.
-	 * Mapped to memory location 0xFFFF
+	 * Specifies whether the previous condition checked branch, jumped or not.
+	 * This is used to calculate CPU cycles for jump instructions, which have
+	 * varying cycle lengths based on the condition
 	 */
-	std::unique_ptr<IReg> interrupt_enable;
+	bool branch_taken;
 
 	/**
-	 * Interrupt Flag register, which details which interrupts have currently
-	 * been fired. Mapped to memory location 0xFF0F
+	 * Selects between plain interpretation and cached block execution
 	 */
-	std::unique_ptr<IReg> interrupt_flag;
+	ExecutionMode execution_mode;
 
 	/**
-	 * Specifies whether the previous condition checked branch, jumped or not.
-	 * This is used to calculate CPU cycles for jump instructions, which have
-	 * varying cycle lengths based on the condition
+	 * Pre-decoded blocks of ROM code, used in ExecutionMode::BLOCK_CACHE
 	 */
-	bool branch_taken;
+	BlockCache block_cache;
+
+	/**
+	 * Native code generator for hot blocks, used in ExecutionMode::JIT
+	 */
+	Jit jit;
+
+	/**
+	 * Immediate operands of the cached instruction currently executing. When
+	 * set, instruction bytes are read from here instead of from memory.
+	 */
+	mutable const uint8_t *inst_operands;
+
+	/**
+	 * Fused handlers for common opcode sequences, indexed by the first opcode
+	 * of the sequence
+	 */
+	std::array<std::vector<Superinstruction>, 256> superinstructions;
+
+	/**
+	 * Specifies whether the interpreter dispatches superinstructions
+	 */
+	bool superinstructions_enabled;
+
+	/**
+	 * Set when an instruction in a cached block accesses I/O through a
+	 * register pair. The block stops after it, the same way decoding ends
+	 * blocks after I/O at a fixed address, so the GPU catches up.
+	 */
+	bool indirect_io;
+
+	/**
+	 * Specifies whether dispatching an interrupt is a tick of its own, rather
+	 * than running the first instruction of the handler in the same tick
+	 */
+	bool dispatch_alone;
+
+	/**
+	 * Number of cycles until the GPU next changes mode, and so may raise an
+	 * interrupt. Sequences that run longer than this are not fused.
+	 */
+	ClockCycles event_horizon;
+
+	/**
+	 * Set while an OAM DMA holds the bus. Instructions are then fetched
+	 * through the bus one at a time, instead of from cached blocks or fused
+	 * sequences, which read ROM ahead of time.
+	 */
+	bool bus_locked;
+
+	/**
+	 * Number of times each pair of opcodes was executed back to back, indexed
+	 * by (previous << 8) | current. Empty unless profiling is enabled.
+	 */
+	std::vector<uint64_t> opcode_pair_counts;
+
+	/**
+	 * Previously executed opcode, for the pair profile. 0xCB for all prefixed
+	 * instructions.
+	 */
+	OpCode last_opcode;
+
+	/**
+	 * Instruction level profiler. Only fed in builds with TVP_PROFILER on,
+	 * and nullptr unless enabled.
+	 */
+	std::unique_ptr<Profiler> profiler;
+
+	/**
+	 * Instruction trace being recorded, or nullptr
+	 */
+	std::unique_ptr<TraceWriter> tracer;
+
+	/**
+	 * Handle interrupts that are currently set and fired, and count down a
+	 * pending EI. Only called when the interrupt controller has something
+	 * pending.
+	 *
+	 * @param dispatched Set if an interrupt handler was jumped to
+	 * @return true if the next instruction is the one that follows an EI,
+	 * and must run on its own
+	 */
+	bool handle_interrupts(bool *dispatched);
+
+	/**
+	 * Decode the straight-line run of code starting at the given address and
+	 * store it in the block cache
+	 *
+	 * @return Pointer to the new block, or nullptr if nothing could be decoded
+	 */
+	Block *decode_block(Address start);
+
+	/**
+	 * Run all instructions in a cached block
+	 *
+	 * @return Number of cycles taken by the executed instructions
+	 */
+	ClockCycles execute_block(Block *block);
+
+	/**
+	 * Run a single pre-decoded instruction
+	 *
+	 * @return Number of cycles taken by the instruction
+	 */
+	ClockCycles execute_instruction(const DecodedInstruction &inst);
+
+	/**
+	 * Entry point for compiled code to run a single instruction
+	 *
+	 * @param context The CPU instance running the compiled block
+	 * @param inst Instruction to run
+	 */
+	static ClockCycles jit_step(void *context, const DecodedInstruction *inst);
+
+	/**
+	 * Entry points for compiled code to read and write the bus
+	 *
+	 * @param context The CPU instance running the compiled block
+	 */
+	static uint8_t jit_read(void *context, Address addr);
+	static void jit_write(void *context, Address addr, uint8_t value);
 
 	/**
-	 * Handle interrupts that are currently set and fired
+	 * Compile the given block, if it is safe and worthwhile to do so. Only
+	 * CPUs whose registers all keep their value in memory are compiled for.
 	 */
-	void handle_interrupts();
+	void compile_block(Block *block);
+
+	/**
+	 * Fill the superinstruction table. Defined in superinstructions_impl.h
+	 */
+	void init_superinstructions();
+
+	/**
+	 * Add a fused handler for the given opcode sequence
+	 */
+	void add_superinstruction(std::vector<OpCode> opcodes,
+	                          std::function<void()> handler);
+
+	/**
+	 * Find a superinstruction starting with the given, just fetched, opcode
+	 *
+	 * @param opcode First opcode of the sequence
+	 * @param horizon Cycles until the GPU next changes mode
+	 * @return Matching superinstruction, or nullptr if none match
+	 */
+	const Superinstruction *match_superinstruction(OpCode opcode,
+	                                               ClockCycles horizon) const;
+
+	/**
+	 * Step the program counter over an opcode that was already matched
+	 */
+	void skip_opcode();
+
+	/**
+	 * Count an executed opcode in the pair profile
+	 */
+	void profile_opcode(OpCode opcode);
+
+	/**
+	 * Record a single executed instruction in the profiler
+	 */
+	void profile_instruction(Address inst_pc, OpCode opcode, bool prefixed,
+	                         ClockCycles inst_cycles);
+
+	/**
+	 * Get the registers for a trace record of the instruction at the given
+	 * address
+	 */
+	TraceRecord get_trace_record(Address inst_pc) const;
 
 	/**
 	 * Get another byte of instructions and increment the program counter
@@ -133,7 +310,7 @@ class CPU : public CPUInterface {
 	/// Each of these methods perform an operation with the given parameters and
 	/// in some cases one other register (usually A, sometimes HL). Each action
 	/// function in the opcode map calls one of these functions to perform the
-	/// opcode. The implementations are located in opcodes.cpp
+	/// opcode. The implementations are located in opcodes_impl.h
 	///
 	/// Additionally, some of these opcodes also make changes to the 4 flags of
 	/// the F register. For a complete reference on operations and flags, refer
@@ -257,24 +434,122 @@ class CPU : public CPUInterface {
 	    std::unique_ptr<IDblReg> af, std::unique_ptr<IDblReg> bc,
 	    std::unique_ptr<IDblReg> de, std::unique_ptr<IDblReg> hl,
 	    std::unique_ptr<IDblReg> pc, std::unique_ptr<IDblReg> sp,
-	    std::unique_ptr<IReg> interrupt_flag,
-	    std::unique_ptr<IReg> interrupt_enable,
-	    memory::MemoryInterface *memory);
+	    Bus *memory);
 
 	/**
-	 * Getter for the Interrupt Enable register
+	 * @see CPUInterface#get_interrupts. Defined here, so that the GPU can
+	 * inline it when raising interrupts.
 	 */
-	IReg *get_interrupt_enable() override;
+	InterruptController *get_interrupts() override { return &interrupts; }
 
 	/**
-	 * Getter for the Interrupt Flag Register
+	 * @see CPUInterface#tick
 	 */
-	IReg *get_interrupt_flag() override;
+	ClockCycles tick() override;
 
 	/**
-	 * @see CPUInterface#tick
+	 * @see CPUInterface#invalidate_code
 	 */
-	ClockCycles tick() override;
+	void invalidate_code(Address start, Address end) override;
+
+	/**
+	 * Switch between the plain interpreter, cached block execution and the
+	 * JIT. Falls back to cached blocks if the JIT is not supported.
+	 */
+	void set_execution_mode(ExecutionMode mode);
+
+	/**
+	 * Get the current execution mode
+	 */
+	ExecutionMode get_execution_mode() const;
+
+	/**
+	 * Enable or disable fused dispatch of common opcode sequences in the
+	 * interpreter
+	 */
+	void set_superinstructions_enabled(bool enabled);
+
+	/**
+	 * Make dispatching an interrupt a tick of its own, that takes no cycles.
+	 * The next tick then starts at the interrupt vector, where a debugger can
+	 * stop before the handler runs.
+	 */
+	void set_dispatch_alone(bool enabled);
+
+	/**
+	 * Set the number of cycles until the GPU next changes mode. This only
+	 * applies to the next tick, so it must be set before every tick for
+	 * superinstructions to be used.
+	 */
+	void set_event_horizon(ClockCycles cycles);
+
+	/**
+	 * Set whether an OAM DMA holds the bus. Defined here, so that the Gameboy
+	 * can inline it when setting it before every tick.
+	 */
+	void set_bus_locked(bool locked) { bus_locked = locked; }
+
+	/**
+	 * Start or stop counting executed opcode pairs. Superinstructions are not
+	 * dispatched while profiling, so that every instruction is counted.
+	 */
+	void set_opcode_profiling(bool enabled);
+
+	/**
+	 * Write the most frequently executed opcode pairs to the given stream
+	 *
+	 * @param out Stream to write to
+	 * @param count Number of pairs to write
+	 */
+	void dump_opcode_profile(std::ostream &out, size_t count) const;
+
+	/**
+	 * Start or stop the instruction level profiler. Stopping discards all
+	 * collected statistics.
+	 *
+	 * @return false if the profiler is not built in, in which case nothing
+	 * changes
+	 */
+	bool set_profiler_enabled(bool enabled);
+
+	/**
+	 * Get the profiler, or nullptr if it is not enabled
+	 */
+	Profiler *get_profiler();
+
+	/**
+	 * Start recording every executed instruction to a trace file, replacing
+	 * any trace in progress. Superinstructions are not dispatched while
+	 * tracing, so that every instruction is recorded.
+	 *
+	 * @param path Path of the trace file
+	 * @param capacity Number of most recent instructions to keep
+	 * @return false if the file could not be opened
+	 */
+	bool start_trace(const std::string &path, uint64_t capacity);
+
+	/**
+	 * Stop tracing, and write out the rest of the trace file
+	 */
+	void stop_trace();
+
+	/**
+	 * Get a snapshot of the registers and CPU flags
+	 */
+	RegisterState get_register_state() const;
+
+	/**
+	 * Load the registers and CPU flags from a snapshot
+	 */
+	void set_register_state(const RegisterState &state);
+
+	/**
+	 * Get the number of cycles an unprefixed instruction takes
+	 *
+	 * @param opcode Opcode of the instruction
+	 * @param branched Whether a conditional branch was taken
+	 */
+	ClockCycles get_opcode_cycles(OpCode opcode, bool branched) const;
 
 	/**
 	 * Allow debugger to view private members of this class
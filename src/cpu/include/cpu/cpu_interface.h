@@ -3,6 +3,7 @@
  * Declares the interface for a CPU
  */
 
+#include "cpu/interrupts.h"
 #include "cpu/register/register_interface.h"
 #include "cpu/utils.h"
 #include <cstdint>
@@ -29,14 +30,16 @@ class CPUInterface {
 	virtual ClockCycles tick() = 0;
 
 	/**
-	 * Getter for the Interrupt Enable register
+	 * Get the interrupt controller, which holds the Interrupt Flag and
+	 * Interrupt Enable registers
 	 */
-	virtual IReg *get_interrupt_enable() = 0;
+	virtual InterruptController *get_interrupts() = 0;
 
 	/**
-	 * Getter for the Interrupt Flag Register
+	 * Notify the CPU that the code in the given address range (inclusive) has
+	 * changed, so that any decoded copies of it are dropped
 	 */
-	virtual IReg *get_interrupt_flag() = 0;
+	virtual void invalidate_code(Address start, Address end) = 0;
 };
 
 } // namespace cpu
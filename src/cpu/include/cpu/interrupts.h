@@ -0,0 +1,146 @@
+/**
+ * @file interrupts.h
+ * Declares the InterruptController class, which holds the interrupt flag,
+ * interrupt enable and master enable state of the CPU
+ */
+
+#pragma once
+
+#include "cpu/utils.h"
+
+#include <cstdint>
+
+namespace cpu {
+
+/**
+ * Holds IF ($FF0F), IE ($FFFF) and the IME flag, and keeps the interrupts
+ * that the CPU must act on in one precomputed byte. The byte only changes
+ * when one of those changes, so the CPU checks it with a single branch
+ * before every instruction instead of reading and masking both registers.
+ *
+ * EI only sets IME after the instruction that follows it has run. While that
+ * is pending, the precomputed byte has DELAYED_ENABLE set, so that the CPU
+ * takes the slow path and counts the delay down.
+ */
+class InterruptController {
+  public:
+	/**
+	 * Bits of the five interrupts, in IF and IE
+	 */
+	static constexpr uint8_t INTERRUPT_MASK = 0x1F;
+
+	/**
+	 * Set in the pending byte while an EI has not taken effect yet
+	 */
+	static constexpr uint8_t DELAYED_ENABLE = 0x80;
+
+  private:
+	uint8_t flag;
+	uint8_t enable;
+
+	/**
+	 * Interrupt master enable, set by EI and RETI and cleared by DI
+	 */
+	bool master_enable;
+
+	/**
+	 * Instruction boundaries left until a pending EI sets IME, or 0
+	 */
+	uint8_t enable_delay;
+
+	/**
+	 * Interrupts that are requested, enabled, and allowed by IME, along with
+	 * DELAYED_ENABLE
+	 */
+	uint8_t pending;
+
+	void update() {
+		auto requested = master_enable ? flag & enable & INTERRUPT_MASK : 0;
+		pending = static_cast<uint8_t>(requested |
+		                               (enable_delay ? DELAYED_ENABLE : 0));
+	}
+
+  public:
+	/**
+	 * Interrupts start out enabled, with nothing requested
+	 */
+	InterruptController()
+	    : flag(0), enable(0), master_enable(true), enable_delay(0),
+	      pending(0) {}
+
+	/**
+	 * Get the byte that the CPU checks before every instruction. Zero when
+	 * there is nothing to do.
+	 */
+	uint8_t get_pending() const { return pending; }
+
+	uint8_t get_flag() const { return flag; }
+	void set_flag(uint8_t value) {
+		flag = value;
+		update();
+	}
+
+	uint8_t get_enable() const { return enable; }
+	void set_enable(uint8_t value) {
+		enable = value;
+		update();
+	}
+
+	/**
+	 * Request an interrupt, by setting its bit in IF
+	 */
+	void request(Interrupt interrupt) {
+		flag = static_cast<uint8_t>(flag | (1 << static_cast<int>(interrupt)));
+		update();
+	}
+
+	/**
+	 * Clear the IF bit of an interrupt that is being serviced
+	 */
+	void acknowledge(uint8_t bit) {
+		flag = static_cast<uint8_t>(flag & ~(1 << bit));
+		update();
+	}
+
+	bool get_master_enable() const { return master_enable; }
+
+	/**
+	 * Set or clear IME straight away, cancelling any pending EI
+	 */
+	void set_master_enable(bool value) {
+		master_enable = value;
+		enable_delay = 0;
+		update();
+	}
+
+	/**
+	 * Set IME once the next instruction has run, for EI
+	 */
+	void enable_after_next() {
+		if (!master_enable) {
+			enable_delay = 2;
+			update();
+		}
+	}
+
+	/**
+	 * Count down a pending EI at an instruction boundary
+	 *
+	 * @return true if the EI is still waiting for its next instruction
+	 */
+	bool step_delay() {
+		if (enable_delay && --enable_delay == 0) {
+			master_enable = true;
+		}
+		update();
+		return enable_delay != 0;
+	}
+
+	uint8_t get_enable_delay() const { return enable_delay; }
+	void set_enable_delay(uint8_t value) {
+		enable_delay = value;
+		update();
+	}
+};
+
+} // namespace cpu
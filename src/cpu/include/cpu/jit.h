@@ -0,0 +1,152 @@
+/**
+ * @file jit.h
+ * Declares the Jit class, which compiles cached blocks into x86-64 code
+ */
+
+#pragma once
+
+#include "cpu/block_cache.h"
+#include "cpu/utils.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cpu {
+
+/**
+ * Number of times a block must run before it is compiled
+ */
+const uint32_t JIT_THRESHOLD = 32;
+
+/**
+ * Blocks with fewer instructions than this are not worth compiling. These are
+ * mostly single I/O polling instructions, which are left to the block cache.
+ */
+const uint8_t JIT_MIN_INSTRUCTIONS = 2;
+
+/**
+ * Size of the executable code arena, in bytes. The arena is flushed when full.
+ */
+const size_t JIT_ARENA_SIZE = 1 << 20;
+
+/**
+ * Runs a single decoded instruction on behalf of compiled code
+ *
+ * @param context Opaque pointer handed to the compiled function
+ * @param inst Instruction to run
+ * @return Number of cycles taken by the instruction
+ */
+using JitStep = ClockCycles (*)(void *context, const DecodedInstruction *inst);
+
+/**
+ * Reads a byte from the bus on behalf of compiled code
+ */
+using JitRead = uint8_t (*)(void *context, Address addr);
+
+/**
+ * Writes a byte to the bus on behalf of compiled code
+ */
+using JitWrite = void (*)(void *context, Address addr, uint8_t value);
+
+/**
+ * Where the CPU stores each register. Compiled code reads and writes them in
+ * place, so that they are always up to date for the step function.
+ */
+struct JitRegisters {
+	uint8_t *a, *f, *b, *c, *d, *e, *h, *l;
+	uint16_t *sp, *pc;
+};
+
+/**
+ * Functions that compiled code calls back into the CPU through. Each receives
+ * the context pointer that the compiled function is called with.
+ */
+struct JitCallbacks {
+	JitStep step;
+	JitRead read;
+	JitWrite write;
+};
+
+/**
+ * Generates native code for decoded blocks in an executable memory arena.
+ *
+ * Loads, 8-bit ALU operations, increments and decrements, bit operations and
+ * jumps are translated into x86-64 code that works on the register storage
+ * directly. The flags come from the host's own, which match the SM83 ones for
+ * these operations. Memory is accessed through the read and write callbacks,
+ * and every other instruction calls the step function with its operands baked
+ * in. Cycle counts are summed in a host register, and the block's valid flag
+ * is checked after every instruction that may write memory, so that
+ * self-modifying code bails out to the CPU straight away. Instructions that
+ * access memory through a register pair also bail out if that reached I/O.
+ *
+ * Only built on x86-64 POSIX hosts with the TVP_JIT option on. Elsewhere,
+ * is_supported() returns false and nothing is ever compiled.
+ */
+class Jit {
+  private:
+	/**
+	 * Start of the mapped arena
+	 */
+	uint8_t *arena;
+
+	/**
+	 * Number of bytes of the arena currently in use
+	 */
+	size_t arena_used;
+
+	/**
+	 * Copy the given code into the arena, switching its protection from
+	 * writable to executable around the copy
+	 *
+	 * @return Pointer to the copied code, or nullptr if the arena is full or
+	 * its protection could not be changed
+	 */
+	JitFunction install(const std::vector<uint8_t> &code);
+
+	/**
+	 * Unmap the arena for good, after its protection could not be changed
+	 */
+	void release();
+
+  public:
+	Jit();
+	~Jit();
+
+	Jit(const Jit &) = delete;
+	Jit &operator=(const Jit &) = delete;
+
+	/**
+	 * Check if the JIT was built for this host
+	 */
+	static bool is_supported();
+
+	/**
+	 * Check if the arena can take more code. False if it could not be mapped,
+	 * or was released.
+	 */
+	bool is_available() const { return arena != nullptr; }
+
+	/**
+	 * Compile the given block
+	 *
+	 * @param block Block to compile. Must outlive the generated code.
+	 * @param registers Storage of the registers of the CPU running the block
+	 * @param callbacks Functions that run an instruction, and access the bus
+	 * @param indirect_io Flag that is set when an instruction accessed I/O
+	 * through a register pair
+	 * @return Compiled function, or nullptr if the arena is full or not
+	 * available. Functions compiled before are invalid once it is not.
+	 */
+	JitFunction compile(const Block *block, const JitRegisters &registers,
+	                    const JitCallbacks &callbacks, bool *indirect_io);
+
+	/**
+	 * Discard all generated code. Every function returned by compile becomes
+	 * invalid.
+	 */
+	void flush();
+};
+
+} // namespace cpu
@@ -0,0 +1,266 @@
+/**
+ * @file lockstep.h
+ * Declares the Lockstep class, an experimental core that runs many instances
+ * of one ROM side by side
+ */
+
+#pragma once
+
+#include "cpu/cpu.h"
+#include "cpu/utils.h"
+#include "memory/memory_interface.h"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace cpu {
+
+class Lockstep;
+
+/**
+ * Memory of a single lane of a Lockstep core, as seen by the scalar CPU
+ */
+class LaneMemory final : public memory::MemoryInterface {
+  private:
+	/**
+	 * Core that owns the memory
+	 */
+	Lockstep *core;
+
+  public:
+	/**
+	 * Lane that reads and writes go to
+	 */
+	size_t lane;
+
+	explicit LaneMemory(Lockstep *core);
+
+	uint8_t read(Address address) const override;
+	void write(Address address, uint8_t data) override;
+
+	/// Nothing caches what it reads from lane memory
+	uint32_t get_write_count(Address, Address) const override { return 0; }
+
+	/// There are no devices behind lane memory
+	void set_cpu(CPUInterface *) override {}
+	void set_gpu(gpu::GPUInterface *) override {}
+};
+
+/**
+ * Counts of how instructions were dispatched by a Lockstep core
+ */
+struct LockstepStats {
+	/// Number of calls to step()
+	uint64_t steps;
+
+	/// Number of groups of lanes sharing a PC, over all steps
+	uint64_t groups;
+
+	/// Instructions run by the vectorized kernels, over all lanes
+	uint64_t vector_instructions;
+
+	/// Instructions run one lane at a time by the scalar CPU
+	uint64_t scalar_instructions;
+};
+
+/**
+ * Experimental core that runs many instances (lanes) of one ROM in lockstep.
+ *
+ * State is stored as a structure of arrays: each register, and each address
+ * of RAM, is one contiguous array with an entry per lane. Every step runs one
+ * instruction on every lane. Lanes that share a PC are grouped, and if the
+ * instruction is a simple register operation or jump, it runs for the whole
+ * group in one loop over the arrays, which the compiler vectorizes. Everything
+ * else, and lanes that are halted or about to take an interrupt, runs one lane
+ * at a time on a regular CPU.
+ *
+ * This only emulates the CPU. There is no GPU or timer, the cartridge has no
+ * memory bank controller, and I/O registers read back what was last written,
+ * except for the joypad, which reads the buttons given to set_buttons. Lanes
+ * start in the state the boot ROM leaves behind.
+ */
+class Lockstep {
+  private:
+	/**
+	 * Number of instances
+	 */
+	size_t lanes;
+
+	/**
+	 * ROM data shared by every lane
+	 */
+	std::shared_ptr<std::vector<uint8_t>> rom_data;
+
+	/**
+	 * Registers of every lane, one array per register. Indexed like the
+	 * register field of opcodes - B, C, D, E, H, L, F and A. F takes the slot
+	 * that (HL) has in opcodes.
+	 */
+	std::array<std::vector<uint8_t>, 8> regs;
+
+	/**
+	 * 16-bit registers of every lane
+	 */
+	std::vector<uint16_t> pc, sp;
+
+	/**
+	 * CPU flags of every lane, and the countdown of a pending EI
+	 */
+	std::vector<uint8_t> halted, interrupt_enabled, interrupt_enable_delay;
+
+	/**
+	 * Cycles run by every lane since startup
+	 */
+	std::vector<ClockCycles> cycles;
+
+	/**
+	 * Pressed buttons of every lane, one bit per controller::Button
+	 */
+	std::vector<uint8_t> buttons;
+
+	/**
+	 * $8000-$FFFF of every lane. The lanes are interleaved, so that one
+	 * address of every lane is contiguous.
+	 */
+	std::vector<uint8_t> ram;
+
+	/**
+	 * Lanes that have already run in the current step
+	 */
+	std::vector<uint8_t> done;
+
+	/**
+	 * Lanes in the group currently being run
+	 */
+	std::vector<uint8_t> mask;
+
+	/**
+	 * Regular CPU that runs single lanes, over a view of their memory
+	 */
+	std::unique_ptr<LaneMemory> scalar_memory;
+	std::unique_ptr<CPU<LaneMemory>> scalar_cpu;
+
+	/**
+	 * If false, every instruction runs on the scalar CPU
+	 */
+	bool vector_enabled;
+
+	LockstepStats stats;
+
+	/**
+	 * Get the RAM byte for the given lane and address ($8000-$FFFF)
+	 */
+	uint8_t &ram_at(size_t lane, Address address);
+	const uint8_t &ram_at(size_t lane, Address address) const;
+
+	/**
+	 * Read a byte of ROM, which is the same for every lane
+	 */
+	uint8_t read_rom(Address address) const;
+
+	/**
+	 * Check if the lane can run in a vectorized group. Halted lanes and lanes
+	 * with an interrupt to take are left to the scalar CPU.
+	 */
+	bool is_ready(size_t lane) const;
+
+	/**
+	 * Run the instruction at the given ROM address on every lane in the
+	 * mask, from the first lane onwards
+	 *
+	 * @return false if the instruction has no vectorized kernel
+	 */
+	bool run_vector(Address group_pc, size_t first);
+
+	/**
+	 * Run one instruction on a single lane, on the scalar CPU
+	 */
+	void run_scalar(size_t lane);
+
+	/**
+	 * Run an 8-bit ALU operation on A and the given operand, for the lanes
+	 * in the mask
+	 */
+	template <typename Operand>
+	void run_alu(uint8_t alu_op, size_t first, Operand operand);
+
+	/**
+	 * Move the PC forward and add cycles, for the lanes in the mask
+	 */
+	void advance(size_t first, uint8_t length, ClockCycles cycle_count);
+
+	/**
+	 * Jump to the target if the condition holds, for the lanes in the mask
+	 *
+	 * @param condition Condition field of the opcode, or -1 for none
+	 */
+	void branch(size_t first, OpCode opcode, int condition, uint8_t length,
+	            Address target);
+
+	friend class LaneMemory;
+
+  public:
+	/**
+	 * @param rom_data Complete contents of the ROM, at most 32KB is used
+	 * @param lanes Number of instances to run
+	 */
+	Lockstep(std::shared_ptr<std::vector<uint8_t>> rom_data, size_t lanes);
+
+	/**
+	 * Run one instruction on every lane
+	 */
+	void step();
+
+	/**
+	 * Turn the vectorized kernels on or off. With them off, every lane runs
+	 * on the scalar CPU, for comparing results.
+	 */
+	void set_vector_enabled(bool enabled);
+
+	/**
+	 * Set the pressed buttons for one lane
+	 *
+	 * @param lane Lane to set
+	 * @param pressed One bit per controller::Button, set if pressed
+	 */
+	void set_buttons(size_t lane, uint8_t pressed);
+
+	/**
+	 * Read a byte of memory as the given lane sees it
+	 */
+	uint8_t read(size_t lane, Address address) const;
+
+	/**
+	 * Write a byte of memory for the given lane. Writes to ROM are dropped.
+	 */
+	void write(size_t lane, Address address, uint8_t value);
+
+	/**
+	 * Get a snapshot of the registers and CPU flags of one lane
+	 */
+	RegisterState get_register_state(size_t lane) const;
+
+	/**
+	 * Load the registers and CPU flags of one lane from a snapshot
+	 */
+	void set_register_state(size_t lane, const RegisterState &state);
+
+	/**
+	 * Get the number of cycles the lane has run since startup
+	 */
+	ClockCycles get_cycles(size_t lane) const;
+
+	/**
+	 * Get the number of lanes
+	 */
+	size_t get_lane_count() const;
+
+	/**
+	 * Get counts of how instructions were dispatched
+	 */
+	const LockstepStats &get_stats() const;
+};
+
+} // namespace cpu
@@ -1,8 +1,11 @@
 /**
- * @file opcodes.cpp
+ * @file opcodes_impl.h
  * Contains implementations for all the CPU base opcode functions
  */
 
+#pragma once
+
+#include "cpu/alu.h"
 #include "cpu/cpu.h"
 #include "cpu/register/register.h"
 
@@ -15,180 +18,106 @@ namespace cpu {
 
 /// 8-bit Arithmetic
 
-void CPU::op_add(uint8_t val) {
-	// Add and set the result
-	auto a_val = a->get();
-	auto result = static_cast<int16_t>(a_val + val);
-	a->set(static_cast<uint8_t>(result));
-
-	// Set flag bits
-	f->set_bit(flag::ZERO, a->get() == 0);
-	f->set_bit(flag::SUBTRACT, 0);
-
-	auto halfcarry = (0xf & val) + (0xf & a_val) > 0xf;
-	f->set_bit(flag::HALFCARRY, halfcarry);
-	auto carry = (0x100 & result) != 0;
-	f->set_bit(flag::CARRY, carry);
+template <typename Bus>
+void CPU<Bus>::op_add(uint8_t val) {
+	// Add and set the result, along with the flag bits
+	auto flags = f->get();
+	a->set(alu::add(a->get(), val, flags));
+	f->set(flags);
 }
 
-void CPU::op_adc(uint8_t val) {
+template <typename Bus>
+void CPU<Bus>::op_adc(uint8_t val) {
 	// Add the value and current carry to A
-	auto carry_to_add = f->get_bit(flag::CARRY);
-	auto a_val = a->get();
-	auto result = static_cast<int16_t>(a_val + val + carry_to_add);
-	a->set(result);
-
-	// Set flag bits
-	f->set_bit(flag::ZERO, a->get() == 0);
-	f->set_bit(flag::SUBTRACT, 0);
-
-	auto halfcarry = ((0xf & val) + (0xf & a_val) + carry_to_add) > 0xf;
-	f->set_bit(flag::HALFCARRY, halfcarry);
-	auto carry = (result & 0x100) != 0;
-	f->set_bit(flag::CARRY, carry);
+	auto flags = f->get();
+	a->set(alu::adc(a->get(), val, flags));
+	f->set(flags);
 }
 
-void CPU::op_and(uint8_t val) {
+template <typename Bus>
+void CPU<Bus>::op_and(uint8_t val) {
 	// AND the value to A
-	auto result = a->get() & val;
-	a->set(static_cast<uint8_t>(result));
-
-	// Set the flags
-	f->set_bit(flag::ZERO, a->get() == 0);
-	f->set_bit(flag::SUBTRACT, 0);
-	f->set_bit(flag::HALFCARRY, 1);
-	f->set_bit(flag::CARRY, 0);
+	auto flags = f->get();
+	a->set(alu::and_(a->get(), val, flags));
+	f->set(flags);
 }
 
-void CPU::op_or(uint8_t val) {
+template <typename Bus>
+void CPU<Bus>::op_or(uint8_t val) {
 	// OR the value to A
-	auto result = a->get() | val;
-	a->set(static_cast<uint8_t>(result));
-
-	// Set the flags
-	f->set_bit(flag::ZERO, a->get() == 0);
-	f->set_bit(flag::SUBTRACT, 0);
-	f->set_bit(flag::HALFCARRY, 0);
-	f->set_bit(flag::CARRY, 0);
+	auto flags = f->get();
+	a->set(alu::or_(a->get(), val, flags));
+	f->set(flags);
 }
 
-void CPU::op_xor(uint8_t val) {
-	// OR the value to A
-	auto result = a->get() ^ val;
-	a->set(static_cast<uint8_t>(result));
-
-	// Set the flags
-	f->set_bit(flag::ZERO, a->get() == 0);
-	f->set_bit(flag::SUBTRACT, 0);
-	f->set_bit(flag::HALFCARRY, 0);
-	f->set_bit(flag::CARRY, 0);
+template <typename Bus>
+void CPU<Bus>::op_xor(uint8_t val) {
+	// XOR the value to A
+	auto flags = f->get();
+	a->set(alu::xor_(a->get(), val, flags));
+	f->set(flags);
 }
 
-void CPU::op_cp(uint8_t val) {
+template <typename Bus>
+void CPU<Bus>::op_cp(uint8_t val) {
 	// Compare. Essentially performs subtract without setting result
-	auto result = static_cast<uint8_t>(a->get() - val);
-
-	// Set flag bits
-	f->set_bit(flag::ZERO, result == 0);
-	f->set_bit(flag::SUBTRACT, 1);
-
-	auto halfcarry = (0xf & a->get()) - (0xf & val) < 0;
-	f->set_bit(flag::HALFCARRY, halfcarry);
-	auto carry = a->get() < val;
-	f->set_bit(flag::CARRY, carry);
+	auto flags = f->get();
+	alu::cp(a->get(), val, flags);
+	f->set(flags);
 }
 
-void CPU::op_sub(uint8_t val) {
+template <typename Bus>
+void CPU<Bus>::op_sub(uint8_t val) {
 	// Subtract and set the result
-	auto a_val = a->get();
-	a->set(a_val - val);
-
-	// Set flag bits
-	f->set_bit(flag::ZERO, a->get() == 0);
-	f->set_bit(flag::SUBTRACT, 1);
-
-	auto halfcarry = (0xf & a_val) - (0xf & val) < 0;
-	f->set_bit(flag::HALFCARRY, halfcarry);
-	auto carry = a_val < val;
-	f->set_bit(flag::CARRY, carry);
+	auto flags = f->get();
+	a->set(alu::sub(a->get(), val, flags));
+	f->set(flags);
 }
 
-void CPU::op_sbc(uint8_t val) {
+template <typename Bus>
+void CPU<Bus>::op_sbc(uint8_t val) {
 	// Subtract the value and current carry from A
-	auto carry_to_sub = f->get_bit(flag::CARRY);
-	auto a_val = a->get();
-	auto result = static_cast<int16_t>(a_val - val - carry_to_sub);
-	a->set(static_cast<uint8_t>(result));
-
-	// Set flag bits
-	f->set_bit(flag::ZERO, a->get() == 0);
-	f->set_bit(flag::SUBTRACT, 1);
-
-	auto halfcarry = ((0xf & a_val) - (0xf & val) - carry_to_sub) < 0;
-	f->set_bit(flag::HALFCARRY, halfcarry);
-	auto carry = result < 0;
-	f->set_bit(flag::CARRY, carry);
+	auto flags = f->get();
+	a->set(alu::sbc(a->get(), val, flags));
+	f->set(flags);
 }
 
-void CPU::op_inc(IReg *reg) {
+template <typename Bus>
+void CPU<Bus>::op_inc(IReg *reg) {
 	// Increment the given Register
-	(*reg)++;
-
-	// Set flag bits
-	f->set_bit(flag::ZERO, reg->get() == 0);
-	f->set_bit(flag::SUBTRACT, 0);
-
-	// If the last 4 bits are all 0, then there was a halfcarry
-	auto halfcarry = (reg->get() & 0x0F) == 0;
-	f->set_bit(flag::HALFCARRY, halfcarry);
+	auto flags = f->get();
+	reg->set(alu::inc(reg->get(), flags));
+	f->set(flags);
 }
 
-void CPU::op_inc(Address addr) {
+template <typename Bus>
+void CPU<Bus>::op_inc(Address addr) {
 	// Increment the value at the given address
-	auto value = memory->read(addr);
-	value++;
-	memory->write(addr, value);
-
-	// Set flag bits
-	f->set_bit(flag::ZERO, value == 0);
-	f->set_bit(flag::SUBTRACT, 0);
-
-	// If the last 4 bits are all 0, then there was a halfcarry
-	auto halfcarry = (value & 0x0F) == 0;
-	f->set_bit(flag::HALFCARRY, halfcarry);
+	auto flags = f->get();
+	memory->write(addr, alu::inc(memory->read(addr), flags));
+	f->set(flags);
 }
 
-void CPU::op_dec(IReg *reg) {
+template <typename Bus>
+void CPU<Bus>::op_dec(IReg *reg) {
 	// Decrement the given Register
-	(*reg)--;
-
-	// Set flag bits
-	f->set_bit(flag::ZERO, reg->get() == 0);
-	f->set_bit(flag::SUBTRACT, 1);
-
-	// If the last 4 bits are all 0, then there was a halfcarry
-	auto halfcarry = (reg->get() & 0x0F) == 0x0F;
-	f->set_bit(flag::HALFCARRY, halfcarry);
+	auto flags = f->get();
+	reg->set(alu::dec(reg->get(), flags));
+	f->set(flags);
 }
 
-void CPU::op_dec(Address addr) {
+template <typename Bus>
+void CPU<Bus>::op_dec(Address addr) {
 	// Decrement the value at the given address
-	auto value = memory->read(addr);
-	value--;
-	memory->write(addr, value);
-
-	// Set flag bits
-	f->set_bit(flag::ZERO, value == 0);
-	f->set_bit(flag::SUBTRACT, 1);
-
-	// If the last 4 bits are all 0, then there was a halfcarry
-	auto halfcarry = (value & 0x0F) == 0x0F;
-	f->set_bit(flag::HALFCARRY, halfcarry);
+	auto flags = f->get();
+	memory->write(addr, alu::dec(memory->read(addr), flags));
+	f->set(flags);
 }
 
 /// 16-bit Arithmetic
 
-void CPU::op_add_hl(uint16_t val) {
+template <typename Bus>
+void CPU<Bus>::op_add_hl(uint16_t val) {
 	// Add the value to HL
 	auto hl_val = hl->get();
 	int result = hl_val + val;
@@ -204,7 +133,8 @@ void CPU::op_add_hl(uint16_t val) {
 	f->set_bit(flag::CARRY, carry);
 }
 
-void CPU::op_add_sp(int8_t val) {
+template <typename Bus>
+void CPU<Bus>::op_add_sp(int8_t val) {
 	// Note that the value added to the stack pointer is a SIGNED 8-BIT value.
 	// This is instruction is used to displace the Stack Pointer up or down by a
 	// number of bytes.
@@ -226,13 +156,15 @@ void CPU::op_add_sp(int8_t val) {
 	f->set_bit(flag::CARRY, carry);
 }
 
-void CPU::op_inc_dbl(IDblReg *reg) {
+template <typename Bus>
+void CPU<Bus>::op_inc_dbl(IDblReg *reg) {
 	(*reg)++;
 
 	// This instruction sets no flags
 }
 
-void CPU::op_dec_dbl(IDblReg *reg) {
+template <typename Bus>
+void CPU<Bus>::op_dec_dbl(IDblReg *reg) {
 	(*reg)--;
 
 	// This instruction sets no flags
@@ -240,58 +172,68 @@ void CPU::op_dec_dbl(IDblReg *reg) {
 
 /// 8-bit Load
 
-void CPU::op_ld(IReg *reg, uint8_t val) {
+template <typename Bus>
+void CPU<Bus>::op_ld(IReg *reg, uint8_t val) {
 	// Load the val into the register
 	reg->set(val);
 }
 
-void CPU::op_ld(Address addr, uint8_t val) {
+template <typename Bus>
+void CPU<Bus>::op_ld(Address addr, uint8_t val) {
 	// Store the val into the memory location
 	memory->write(addr, val);
 }
 
-void CPU::op_ldi_a(uint8_t val) {
+template <typename Bus>
+void CPU<Bus>::op_ldi_a(uint8_t val) {
 	// Store value in A and increment HL
 	a->set(val);
 	(*hl)++;
 }
 
-void CPU::op_ldi_addr(Address addr, uint8_t val) {
+template <typename Bus>
+void CPU<Bus>::op_ldi_addr(Address addr, uint8_t val) {
 	// Store value in memory and increment HL
 	memory->write(addr, val);
 	(*hl)++;
 }
 
-void CPU::op_ldd_a(uint8_t val) {
+template <typename Bus>
+void CPU<Bus>::op_ldd_a(uint8_t val) {
 	// Store value in A and decrement HL
 	a->set(val);
 	(*hl)--;
 }
 
-void CPU::op_ldd_addr(Address addr, uint8_t val) {
+template <typename Bus>
+void CPU<Bus>::op_ldd_addr(Address addr, uint8_t val) {
 	// Store value in memory and decrement HL
 	memory->write(addr, val);
 	(*hl)--;
 }
 
-void CPU::op_ldh_a(uint8_t val) {
+template <typename Bus>
+void CPU<Bus>::op_ldh_a(uint8_t val) {
 	// Store value in A
 	a->set(val);
 }
 
-void CPU::op_ldh_addr(Address addr, uint8_t val) {
+template <typename Bus>
+void CPU<Bus>::op_ldh_addr(Address addr, uint8_t val) {
 	// Store value in memory
 	memory->write(addr, val);
 }
 
 /// 16-bit Load
 
-void CPU::op_ld_dbl(IDblReg *reg, uint16_t val) {
+template <typename Bus>
+void CPU<Bus>::op_ld_dbl(IDblReg *reg, uint16_t val) {
 	// Store value in register
 	reg->set(val);
 }
 
-void CPU::op_ld_dbl(Address addr, uint16_t val) {
+template <typename Bus>
+void CPU<Bus>::op_ld_dbl(Address addr, uint16_t val) {
 	// Store value in memory as lower and higher bytes
 	uint8_t higher_byte = val >> 8;
 	uint8_t lower_byte = 0x00FF & val;
@@ -300,7 +242,8 @@ void CPU::op_ld_dbl(Address addr, uint16_t val) {
 	memory->write(addr + 1, higher_byte);
 }
 
-void CPU::op_ld_hl_sp_offset(int8_t offset) {
+template <typename Bus>
+void CPU<Bus>::op_ld_hl_sp_offset(int8_t offset) {
 	// This is the special case of the [LD HL,(SP+offset)] opcode
 	// Since there is an implicit addition involved, the flags will be affected
 
@@ -321,32 +264,28 @@ void CPU::op_ld_hl_sp_offset(int8_t offset) {
 	hl->set(static_cast<uint16_t>(result));
 }
 
-void CPU::op_push(IDblReg *reg) {
+template <typename Bus>
+void CPU<Bus>::op_push(IDblReg *reg) {
 	// We need to push the source register value onto the stack
-	// Now, the stack grows downwards, so we push the higher byte onto the
-	// stack, and then the lower byte. We decrement the SP twice in the process
-	auto curr_stack_pointer = sp->get();
-
-	auto high_byte = reg->get_high();
-	auto low_byte = reg->get_low();
+	// Now, the stack grows downwards, so the higher byte goes above the lower
+	// byte. We decrement the SP twice in the process
+	auto curr_stack_pointer = static_cast<uint16_t>(sp->get() - 2);
 
-	memory->write(--curr_stack_pointer, high_byte);
-	memory->write(--curr_stack_pointer, low_byte);
+	memory->write16(curr_stack_pointer, reg->get());
 
 	// Set the double decremented stack pointer back into the SP reg
 	sp->set(curr_stack_pointer);
 }
 
-void CPU::op_pop(IDblReg *reg, bool f) {
+template <typename Bus>
+void CPU<Bus>::op_pop(IDblReg *reg, bool f) {
 	// We need to pop the stack value onto the destination register
 	// Now, the stack grows downwards, so first pop the low byte and then the
 	// high byte. We increment the SP twice in the process
 	auto curr_stack_pointer = sp->get();
 
-	uint16_t low_byte = memory->read(curr_stack_pointer++);
-	uint16_t high_byte = memory->read(curr_stack_pointer++);
-
-	uint16_t value = (high_byte << 8) | low_byte;
+	auto value = memory->read16(curr_stack_pointer);
+	curr_stack_pointer = static_cast<uint16_t>(curr_stack_pointer + 2);
 
 	if (f)
 		value &= 0xFFF0;
@@ -359,7 +298,8 @@ void CPU::op_pop(IDblReg *reg, bool f) {
 
 /// Rotates and Shifts
 
-void CPU::op_rlc(IReg *reg) {
+template <typename Bus>
+void CPU<Bus>::op_rlc(IReg *reg) {
 	uint8_t value = reg->get();
 	bool msb = value & (1 << 7);
 	bool carry = value & (1 << 7);
@@ -374,7 +314,8 @@ void CPU::op_rlc(IReg *reg) {
 	reg->set(value);
 }
 
-void CPU::op_rlc(Address addr) {
+template <typename Bus>
+void CPU<Bus>::op_rlc(Address addr) {
 	auto value = memory->read(addr);
 	bool msb = value & (1 << 7);
 	bool carry = value & (1 << 7);
@@ -389,12 +330,14 @@ void CPU::op_rlc(Address addr) {
 	memory->write(addr, value);
 }
 
-void CPU::op_rlc_a() {
+template <typename Bus>
+void CPU<Bus>::op_rlc_a() {
 	op_rlc(a.get());
 	f->set_bit(flag::ZERO, 0);
 }
 
-void CPU::op_rrc(IReg *reg) {
+template <typename Bus>
+void CPU<Bus>::op_rrc(IReg *reg) {
 	auto value = reg->get();
 	auto lsb = static_cast<bool>(value & 0x01);
 
@@ -408,7 +351,8 @@ void CPU::op_rrc(IReg *reg) {
 	reg->set(value);
 }
 
-void CPU::op_rrc(Address addr) {
+template <typename Bus>
+void CPU<Bus>::op_rrc(Address addr) {
 	auto value = memory->read(addr);
 	auto lsb = static_cast<bool>(value & 0x01);
 
@@ -422,12 +366,14 @@ void CPU::op_rrc(Address addr) {
 	memory->write(addr, value);
 }
 
-void CPU::op_rrc_a() {
+template <typename Bus>
+void CPU<Bus>::op_rrc_a() {
 	op_rrc(a.get());
 	f->set_bit(flag::ZERO, 0);
 }
 
-void CPU::op_rl(IReg *reg) {
+template <typename Bus>
+void CPU<Bus>::op_rl(IReg *reg) {
 	auto value = reg->get();
 	auto msb = static_cast<bool>(value >> 7);
 	auto carry_flag = f->get_bit(flag::CARRY);
@@ -442,7 +388,8 @@ void CPU::op_rl(IReg *reg) {
 	reg->set(value);
 }
 
-void CPU::op_rl(Address addr) {
+template <typename Bus>
+void CPU<Bus>::op_rl(Address addr) {
 	auto value = memory->read(addr);
 	auto msb = static_cast<bool>(value >> 7);
 	auto carry_flag = f->get_bit(flag::CARRY);
@@ -457,12 +404,14 @@ void CPU::op_rl(Address addr) {
 	memory->write(addr, value);
 }
 
-void CPU::op_rl_a() {
+template <typename Bus>
+void CPU<Bus>::op_rl_a() {
 	op_rl(a.get());
 	f->set_bit(flag::ZERO, 0);
 }
 
-void CPU::op_rr(IReg *reg) {
+template <typename Bus>
+void CPU<Bus>::op_rr(IReg *reg) {
 	auto value = reg->get();
 	auto lsb = static_cast<bool>(value & 0x01);
 	auto carry_flag = f->get_bit(flag::CARRY);
@@ -477,7 +426,8 @@ void CPU::op_rr(IReg *reg) {
 	reg->set(value);
 }
 
-void CPU::op_rr(Address addr) {
+template <typename Bus>
+void CPU<Bus>::op_rr(Address addr) {
 	auto value = memory->read(addr);
 	auto lsb = static_cast<bool>(value & 0x01);
 	auto carry_flag = f->get_bit(flag::CARRY);
@@ -492,12 +442,14 @@ void CPU::op_rr(Address addr) {
 	memory->write(addr, value);
 }
 
-void CPU::op_rr_a() {
+template <typename Bus>
+void CPU<Bus>::op_rr_a() {
 	op_rr(a.get());
 	f->set_bit(flag::ZERO, 0);
 }
 
-void CPU::op_sla(IReg *reg) {
+template <typename Bus>
+void CPU<Bus>::op_sla(IReg *reg) {
 	auto value = reg->get();
 	auto msb = static_cast<bool>(value >> 7);
 
@@ -511,7 +463,8 @@ void CPU::op_sla(IReg *reg) {
 	reg->set(value);
 }
 
-void CPU::op_sla(Address addr) {
+template <typename Bus>
+void CPU<Bus>::op_sla(Address addr) {
 	auto value = memory->read(addr);
 	auto msb = static_cast<bool>(value >> 7);
 
@@ -525,7 +478,8 @@ void CPU::op_sla(Address addr) {
 	memory->write(addr, value);
 }
 
-void CPU::op_srl(IReg *reg) {
+template <typename Bus>
+void CPU<Bus>::op_srl(IReg *reg) {
 	auto value = reg->get();
 	auto lsb = static_cast<bool>(value & 0x01);
 
@@ -539,7 +493,8 @@ void CPU::op_srl(IReg *reg) {
 	reg->set(value);
 }
 
-void CPU::op_srl(Address addr) {
+template <typename Bus>
+void CPU<Bus>::op_srl(Address addr) {
 	auto value = memory->read(addr);
 	auto lsb = static_cast<bool>(value & 0x01);
 
@@ -553,7 +508,8 @@ void CPU::op_srl(Address addr) {
 	memory->write(addr, value);
 }
 
-void CPU::op_sra(IReg *reg) {
+template <typename Bus>
+void CPU<Bus>::op_sra(IReg *reg) {
 	auto value = reg->get();
 	auto lsb = static_cast<bool>(value & 0x01);
 	auto msb = static_cast<bool>(value >> 7);
@@ -568,7 +524,8 @@ void CPU::op_sra(IReg *reg) {
 	reg->set(value);
 }
 
-void CPU::op_sra(Address addr) {
+template <typename Bus>
+void CPU<Bus>::op_sra(Address addr) {
 	auto value = memory->read(addr);
 	auto lsb = static_cast<bool>(value & 0x01);
 	auto msb = static_cast<bool>(value >> 7);
@@ -585,31 +542,37 @@ void CPU::op_sra(Address addr) {
 
 /// Bit Manipulation
 
-void CPU::op_bit(IReg *reg, uint8_t bit) {
+template <typename Bus>
+void CPU<Bus>::op_bit(IReg *reg, uint8_t bit) {
 	auto check = reg->get_bit(bit);
 	f->set_bit(flag::ZERO, !check);
 	f->set_bit(flag::SUBTRACT, 0);
 	f->set_bit(flag::HALFCARRY, 1);
 }
 
-void CPU::op_bit(uint8_t val, uint8_t bit) {
+template <typename Bus>
+void CPU<Bus>::op_bit(uint8_t val, uint8_t bit) {
 	auto check = static_cast<bool>(val & (1 << bit));
 	f->set_bit(flag::ZERO, !check);
 	f->set_bit(flag::SUBTRACT, 0);
 	f->set_bit(flag::HALFCARRY, 1);
 }
 
-void CPU::op_set(IReg *reg, uint8_t bit) { reg->set_bit(bit, true); }
+template <typename Bus>
+void CPU<Bus>::op_set(IReg *reg, uint8_t bit) { reg->set_bit(bit, true); }
 
-void CPU::op_set(Address addr, uint8_t bit) {
+template <typename Bus>
+void CPU<Bus>::op_set(Address addr, uint8_t bit) {
 	auto value = memory->read(addr);
 	value = (value | (1 << bit));
 	memory->write(addr, value);
 }
 
-void CPU::op_res(IReg *reg, uint8_t bit) { reg->set_bit(bit, false); }
+template <typename Bus>
+void CPU<Bus>::op_res(IReg *reg, uint8_t bit) { reg->set_bit(bit, false); }
 
-void CPU::op_res(Address addr, uint8_t bit) {
+template <typename Bus>
+void CPU<Bus>::op_res(Address addr, uint8_t bit) {
 	auto value = memory->read(addr);
 	value = (value & ~(1 << bit));
 	memory->write(addr, value);
@@ -617,26 +580,30 @@ void CPU::op_res(Address addr, uint8_t bit) {
 
 /// Jump
 
-void CPU::op_jp(Address addr) {
+template <typename Bus>
+void CPU<Bus>::op_jp(Address addr) {
 	// Jump to the given instruction location
 	pc->set(addr);
 }
 
-void CPU::op_jp(bool flag, Address addr) {
+template <typename Bus>
+void CPU<Bus>::op_jp(bool flag, Address addr) {
 	// Change PC to the given address if condition is true
 	branch_taken = flag;
 	if (flag)
 		op_jp(addr);
 }
 
-void CPU::op_jr(int8_t offset) {
+template <typename Bus>
+void CPU<Bus>::op_jr(int8_t offset) {
 	// Displace the PC by the given value
 	auto curr_pc = pc->get();
 	curr_pc += offset;
 	pc->set(curr_pc);
 }
 
-void CPU::op_jr(bool flag, int8_t offset) {
+template <typename Bus>
+void CPU<Bus>::op_jr(bool flag, int8_t offset) {
 	// This is a conditional jump. Change the PC only if given bit of the flag
 	// register is set. Else, do nothing
 	branch_taken = flag;
@@ -646,7 +613,8 @@ void CPU::op_jr(bool flag, int8_t offset) {
 
 /// Calls
 
-void CPU::op_call(Address addr) {
+template <typename Bus>
+void CPU<Bus>::op_call(Address addr) {
 	// Call subroutine
 	// Push the current value of the Program Counter onto the stack, and set it
 	// to the new value. Update the stack pointer accordingly
@@ -663,7 +631,8 @@ void CPU::op_call(Address addr) {
 	sp->set(curr_stack_pointer);
 }
 
-void CPU::op_call(bool flag, Address addr) {
+template <typename Bus>
+void CPU<Bus>::op_call(bool flag, Address addr) {
 	// Conditional call, only if given bit is set
 	branch_taken = flag;
 	if (flag)
@@ -672,26 +641,32 @@ void CPU::op_call(bool flag, Address addr) {
 
 /// Returns
 
-void CPU::op_ret() {
+template <typename Bus>
+void CPU<Bus>::op_ret() {
 	// Pop the value from the stack back into the program counter
 	op_pop(pc.get());
 }
 
-void CPU::op_ret(bool flag) {
+template <typename Bus>
+void CPU<Bus>::op_ret(bool flag) {
 	// Pop stack to PC only if the bit is set
 	branch_taken = flag;
 	if (flag)
 		op_pop(pc.get());
 }
 
-void CPU::op_reti() {
+template <typename Bus>
+void CPU<Bus>::op_reti() {
 	op_pop(pc.get());
-	op_ei();
+
+	// Unlike EI, RETI enables interrupts straight away
+	interrupts.set_master_enable(true);
 }
 
 /// Restart
 
-void CPU::op_rst(uint8_t val) {
+template <typename Bus>
+void CPU<Bus>::op_rst(uint8_t val) {
 	// Push PC onto the stack, and reset value of PC to the given value
 	op_push(pc.get());
 
@@ -700,7 +675,8 @@ void CPU::op_rst(uint8_t val) {
 
 // Miscellaneous
 
-void CPU::op_swap(IReg *reg) {
+template <typename Bus>
+void CPU<Bus>::op_swap(IReg *reg) {
 	auto value = reg->get();
 	auto lower_nibble = 0x0f & value;
 	auto higher_nibble = (0xf0 & value) >> 4;
@@ -715,7 +691,8 @@ void CPU::op_swap(IReg *reg) {
 	f->set_bit(flag::CARRY, 0);
 }
 
-void CPU::op_swap(Address addr) {
+template <typename Bus>
+void CPU<Bus>::op_swap(Address addr) {
 	auto value = memory->read(addr);
 	auto lower_nibble = 0x0f & value;
 	auto higher_nibble = (0xf0 & value) >> 4;
@@ -730,7 +707,8 @@ void CPU::op_swap(Address addr) {
 	f->set_bit(flag::CARRY, 0);
 }
 
-void CPU::op_daa() {
+template <typename Bus>
+void CPU<Bus>::op_daa() {
 	uint8_t acc = a->get();
 
 	// BCD Conversion Algorithm
@@ -757,7 +735,8 @@ void CPU::op_daa() {
 	a->set(acc);
 }
 
-void CPU::op_cpl() {
+template <typename Bus>
+void CPU<Bus>::op_cpl() {
 	// Complement A
 	auto value = a->get();
 	value = ~value;
@@ -768,7 +747,8 @@ void CPU::op_cpl() {
 	f->set_bit(flag::HALFCARRY, 1);
 }
 
-void CPU::op_ccf() {
+template <typename Bus>
+void CPU<Bus>::op_ccf() {
 	// Complement Carry Flag
 	bool value = f->get_bit(flag::CARRY);
 	value = !value;
@@ -779,7 +759,8 @@ void CPU::op_ccf() {
 	f->set_bit(flag::HALFCARRY, 0);
 }
 
-void CPU::op_scf() {
+template <typename Bus>
+void CPU<Bus>::op_scf() {
 	// Set Carry Flag
 	f->set_bit(flag::CARRY, 1);
 
@@ -788,28 +769,33 @@ void CPU::op_scf() {
 	f->set_bit(flag::HALFCARRY, 0);
 }
 
-void CPU::op_nop() {
+template <typename Bus>
+void CPU<Bus>::op_nop() {
 	// Do nothing!
 }
 
-void CPU::op_halt() {
+template <typename Bus>
+void CPU<Bus>::op_halt() {
 	// Halt the CPU until there's an interrupt
 	halted = true;
 }
 
-void CPU::op_stop() {
+template <typename Bus>
+void CPU<Bus>::op_stop() {
 	// Halt the CPU indefinitely
 	halted = true;
 }
 
-void CPU::op_ei() {
-	// Enable interrupts
-	interrupt_enabled = true;
+template <typename Bus>
+void CPU<Bus>::op_ei() {
+	// Enable interrupts, once the next instruction has run
+	interrupts.enable_after_next();
 }
 
-void CPU::op_di() {
-	// Disable interrupts
-	interrupt_enabled = false;
+template <typename Bus>
+void CPU<Bus>::op_di() {
+	// Disable interrupts, including an EI that hasn't taken effect yet
+	interrupts.set_master_enable(false);
 }
 
 } // namespace cpu
@@ -0,0 +1,101 @@
+/**
+ * @file profiler.h
+ * Declares the Profiler class, which counts executed instructions
+ */
+
+#pragma once
+
+#include "cpu/utils.h"
+#include "memory/utils.h"
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace cpu {
+
+/**
+ * Collects instruction level statistics about the running program. All
+ * counters are flat arrays indexed by opcode or address, so recording is a
+ * handful of increments.
+ *
+ * The CPU only feeds the profiler in builds with the TVP_PROFILER option on.
+ */
+class Profiler {
+  private:
+	/**
+	 * Execution counts and total cycles, indexed by opcode
+	 */
+	std::array<uint64_t, 256> opcode_counts;
+	std::array<uint64_t, 256> opcode_cycles;
+
+	/**
+	 * Execution counts and total cycles, indexed by 0xCB prefixed opcode
+	 */
+	std::array<uint64_t, 256> cb_opcode_counts;
+	std::array<uint64_t, 256> cb_opcode_cycles;
+
+	/**
+	 * Number of times each conditional branch was taken or not taken,
+	 * indexed by opcode
+	 */
+	std::array<uint64_t, 256> branches_taken;
+	std::array<uint64_t, 256> branches_not_taken;
+
+	/**
+	 * Execution counts and total cycles, indexed by the address of the
+	 * instruction
+	 */
+	std::vector<uint64_t> pc_counts;
+	std::vector<uint64_t> pc_cycles;
+
+	/**
+	 * Last instruction seen at each address, for annotating hotspots. Prefixed
+	 * opcodes are stored as 0xCBxx.
+	 */
+	std::vector<uint16_t> pc_opcodes;
+
+	/**
+	 * Get addresses that executed at least once, most executed first
+	 */
+	std::vector<Address> get_hotspots() const;
+
+  public:
+	Profiler();
+
+	/**
+	 * Check if the CPU was built to feed the profiler
+	 */
+	static bool is_supported();
+
+	/**
+	 * Count a single executed instruction
+	 *
+	 * @param pc Address of the instruction
+	 * @param opcode Opcode, or the second byte for 0xCB prefixed instructions
+	 * @param prefixed Whether this is a 0xCB prefixed instruction
+	 * @param cycles Cycles taken by the instruction
+	 * @param conditional Whether this is a conditional branch
+	 * @param taken Whether the branch was taken
+	 */
+	void record(Address pc, OpCode opcode, bool prefixed, ClockCycles cycles,
+	            bool conditional, bool taken);
+
+	/**
+	 * Clear all counters
+	 */
+	void reset();
+
+	/**
+	 * Write all statistics as CSV, one row per opcode, branch or address
+	 */
+	void dump_csv(std::ostream &out) const;
+
+	/**
+	 * Write all statistics as a JSON object
+	 */
+	void dump_json(std::ostream &out) const;
+};
+
+} // namespace cpu
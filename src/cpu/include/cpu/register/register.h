@@ -66,6 +66,11 @@ class Register : public RegisterInterface {
 	 * @see RegisterInterface#operator--
 	 */
 	void operator--(int) override;
+
+	/**
+	 * @see RegisterInterface#get_storage
+	 */
+	uint8_t *get_storage() override;
 };
 
 /**
@@ -131,6 +136,11 @@ class DoubleRegister : public DoubleRegisterInterface {
 	 * @see DoubleRegisterInterface#operator--
 	 */
 	void operator--(int) override;
+
+	/**
+	 * @see DoubleRegisterInterface#get_storage
+	 */
+	uint16_t *get_storage() override;
 };
 
 /**
@@ -69,6 +69,14 @@ class RegisterInterface {
 	 * Decrement the particular register value (post-decrement)
 	 */
 	virtual void operator--(int) = 0;
+
+	/**
+	 * Get the address the value is stored at, so that compiled code can read
+	 * and write it in place
+	 *
+	 * @return Pointer to the value, or nullptr if it is not stored in memory
+	 */
+	virtual uint8_t *get_storage() { return nullptr; }
 };
 
 /**
@@ -134,6 +142,11 @@ class DoubleRegisterInterface {
 	 * @see RegisterInterface#operator--
 	 */
 	virtual void operator--(int) = 0;
+
+	/**
+	 * @see RegisterInterface#get_storage
+	 */
+	virtual uint16_t *get_storage() { return nullptr; }
 };
 
 /// Define aliases for register interface classes
@@ -0,0 +1,54 @@
+/**
+ * @file superinstruction.h
+ * Declares the Superinstruction struct, for fused runs of common opcodes
+ */
+
+#pragma once
+
+#include "cpu/utils.h"
+
+#include <functional>
+#include <vector>
+
+namespace cpu {
+
+/**
+ * A short, frequently executed sequence of instructions that is dispatched as
+ * a single fused handler.
+ *
+ * Only the last instruction of a sequence may branch, write memory or change
+ * the interrupt state. This guarantees that no new interrupt can become
+ * pending part way through, as long as the GPU does not change mode either
+ * (see CPU::set_event_horizon).
+ */
+struct Superinstruction {
+	/**
+	 * Opcodes in the sequence, in execution order
+	 */
+	std::vector<OpCode> opcodes;
+
+	/**
+	 * Total length of the sequence in bytes, including operands
+	 */
+	uint8_t length;
+
+	/**
+	 * Cycles taken by all instructions except the last
+	 */
+	ClockCycles prefix_cycles;
+
+	/**
+	 * Cycles taken by the whole sequence, if the last instruction did or did
+	 * not branch
+	 */
+	ClockCycles cycles;
+	ClockCycles cycles_branched;
+
+	/**
+	 * Runs the whole sequence. Called with the PC just past the first opcode,
+	 * like a regular handler.
+	 */
+	std::function<void()> handler;
+};
+
+} // namespace cpu
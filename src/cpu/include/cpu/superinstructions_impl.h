@@ -0,0 +1,145 @@
+/**
+ * @file superinstructions_impl.h
+ * Defines the fused handlers for common opcode sequences
+ */
+
+#pragma once
+
+#include "cpu/cpu.h"
+
+namespace cpu {
+
+template <typename Bus>
+void CPU<Bus>::init_superinstructions() {
+	// These sequences were picked from opcode pair profiles of Tetris and the
+	// boot ROM (see --profile). Opcodes of all but the first instruction are
+	// skipped over with skip_opcode(), since they were already matched.
+
+	// LD A, (HL+) ; LD (DE), A - the inner loop of most memory copies
+	add_superinstruction({0x2a, 0x12}, [&] {
+		op_ldi_a(this->memory->read(this->hl->get()));
+		skip_opcode();
+		op_ld(this->de->get(), this->a->get());
+	});
+
+	// DEC B ; JR NZ, r8 - counted loops
+	add_superinstruction({0x05, 0x20}, [&] {
+		op_dec(this->b.get());
+		skip_opcode();
+		op_jr(!this->f->get_bit(flag::ZERO), get_inst_byte());
+	});
+
+	// DEC C ; JR NZ, r8
+	add_superinstruction({0x0d, 0x20}, [&] {
+		op_dec(this->c.get());
+		skip_opcode();
+		op_jr(!this->f->get_bit(flag::ZERO), get_inst_byte());
+	});
+
+	// CP d8 ; JR Z, r8
+	add_superinstruction({0xfe, 0x28}, [&] {
+		op_cp(get_inst_byte());
+		skip_opcode();
+		op_jr(this->f->get_bit(flag::ZERO), get_inst_byte());
+	});
+
+	// CP d8 ; JR NZ, r8
+	add_superinstruction({0xfe, 0x20}, [&] {
+		op_cp(get_inst_byte());
+		skip_opcode();
+		op_jr(!this->f->get_bit(flag::ZERO), get_inst_byte());
+	});
+
+	// AND A ; JR Z, r8
+	add_superinstruction({0xa7, 0x28}, [&] {
+		op_and(this->a->get());
+		skip_opcode();
+		op_jr(this->f->get_bit(flag::ZERO), get_inst_byte());
+	});
+
+	// LD A, B ; OR C ; JR NZ, r8 - the tail of a 16-bit counted loop
+	add_superinstruction({0x78, 0xb1, 0x20}, [&] {
+		op_ld(this->a.get(), this->b->get());
+		skip_opcode();
+		op_or(this->c->get());
+		skip_opcode();
+		op_jr(!this->f->get_bit(flag::ZERO), get_inst_byte());
+	});
+
+	// LDH A, (a8) ; CP d8 ; JR NZ, r8 - waiting on an I/O register, like LY
+	add_superinstruction({0xf0, 0xfe, 0x20}, [&] {
+		op_ldh_a(this->memory->read(0xFF00 + get_inst_byte()));
+		skip_opcode();
+		op_cp(get_inst_byte());
+		skip_opcode();
+		op_jr(!this->f->get_bit(flag::ZERO), get_inst_byte());
+	});
+}
+
+template <typename Bus>
+void CPU<Bus>::add_superinstruction(std::vector<OpCode> opcodes,
+                                    std::function<void()> handler) {
+	auto fused = Superinstruction{};
+	fused.length = 0;
+	fused.prefix_cycles = 0;
+
+	for (size_t i = 0; i < opcodes.size(); ++i) {
+		auto opcode = opcodes[i];
+		fused.length += instruction_length[opcode];
+		if (i + 1 < opcodes.size()) {
+			fused.prefix_cycles += cycles[opcode];
+		}
+	}
+
+	auto last = opcodes.back();
+	fused.cycles = fused.prefix_cycles + cycles[last];
+	fused.cycles_branched = fused.prefix_cycles + cycles_branched[last];
+	fused.opcodes = std::move(opcodes);
+	fused.handler = std::move(handler);
+
+	superinstructions[fused.opcodes.front()].push_back(std::move(fused));
+}
+
+template <typename Bus>
+const Superinstruction *
+CPU<Bus>::match_superinstruction(OpCode opcode, ClockCycles horizon) const {
+	auto &candidates = superinstructions[opcode];
+	if (candidates.empty()) {
+		return nullptr;
+	}
+
+	// Only look ahead in ROM, where reads never have side effects
+	auto start = static_cast<Address>(pc->get() - 1);
+	if (!BlockCache::is_cacheable(start)) {
+		return nullptr;
+	}
+
+	for (auto &fused : candidates) {
+		// The GPU could raise an interrupt between the instructions
+		if (fused.prefix_cycles >= horizon ||
+		    start + fused.length > CACHEABLE_END) {
+			continue;
+		}
+
+		auto matched = true;
+		uint32_t addr = start + instruction_length[opcode];
+		for (size_t i = 1; i < fused.opcodes.size(); ++i) {
+			if (memory->read(addr) != fused.opcodes[i]) {
+				matched = false;
+				break;
+			}
+			addr += instruction_length[fused.opcodes[i]];
+		}
+
+		if (matched) {
+			return &fused;
+		}
+	}
+
+	return nullptr;
+}
+
+template <typename Bus>
+void CPU<Bus>::skip_opcode() { (*pc)++; }
+
+} // namespace cpu
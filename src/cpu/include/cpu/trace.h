@@ -0,0 +1,224 @@
+/**
+ * @file trace.h
+ * Declares the TraceRecord format, the TraceWriter class that records
+ * instruction traces to disk, and helpers to read and compare them
+ */
+
+#pragma once
+
+#include "cpu/utils.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace cpu {
+
+/**
+ * State of the CPU just before one instruction ran. Stored on disk as is, so
+ * the layout must not change without bumping TRACE_VERSION.
+ */
+struct TraceRecord {
+	/// Cycles run since tracing started, up to this instruction
+	uint64_t cycles;
+
+	/// Address of the instruction, and the registers before it ran
+	uint16_t pc, af, bc, de, hl, sp;
+
+	/// Opcode, or the second byte of 0xCB prefixed instructions
+	uint8_t opcode;
+
+	/// Set for 0xCB prefixed instructions
+	uint8_t prefixed;
+
+	uint8_t reserved[2];
+
+	bool operator==(const TraceRecord &other) const {
+		return cycles == other.cycles && pc == other.pc && af == other.af &&
+		       bc == other.bc && de == other.de && hl == other.hl &&
+		       sp == other.sp && opcode == other.opcode &&
+		       prefixed == other.prefixed;
+	}
+
+	bool operator!=(const TraceRecord &other) const {
+		return !(*this == other);
+	}
+};
+
+static_assert(sizeof(TraceRecord) == 24, "TraceRecord must be 24 bytes");
+
+/**
+ * Version of the trace file format
+ */
+const uint32_t TRACE_VERSION = 1;
+
+/**
+ * Instructions written to a trace file, in the order they ran
+ */
+struct Trace {
+	/// Index of the first record, counting from the start of tracing. Not 0
+	/// if older records were overwritten.
+	uint64_t first;
+
+	std::vector<TraceRecord> records;
+};
+
+/**
+ * Writes a trace of every executed instruction to a binary file.
+ *
+ * The file has a fixed capacity of records and works as a ring, so a long run
+ * keeps only its most recent instructions. The header holds the total count
+ * written, to find the oldest record. Records are in host byte order.
+ *
+ * The emulator thread only appends to an in-memory chunk. Full chunks are
+ * handed to a background thread that writes them to the file, and reused once
+ * written. The header is rewritten after every chunk, so the file can be read
+ * while tracing, or after a run that never closed the writer.
+ */
+class TraceWriter {
+  private:
+	/**
+	 * Number of records in a chunk handed to the writer thread
+	 */
+	static const size_t CHUNK_RECORDS = 4096;
+
+	std::fstream file;
+
+	/**
+	 * Maximum number of records kept in the file
+	 */
+	uint64_t capacity;
+
+	/**
+	 * Number of records recorded, and handed to the writer thread
+	 */
+	uint64_t count;
+
+	/**
+	 * Cycles run since tracing started
+	 */
+	ClockCycles cycles;
+
+	/**
+	 * Chunk being filled by the emulator thread
+	 */
+	std::vector<TraceRecord> chunk;
+
+	/**
+	 * Guards the queues below, and the stopping flag
+	 */
+	std::mutex mutex;
+	std::condition_variable chunk_ready;
+
+	/// Full chunks waiting to be written, and written chunks to reuse
+	std::vector<std::vector<TraceRecord>> full_chunks, free_chunks;
+
+	/// Set when the writer is being closed
+	bool stopping;
+
+	std::thread writer_thread;
+
+	/**
+	 * Main loop of the writer thread
+	 */
+	void run_writer();
+
+	/**
+	 * Write records to the ring, starting from the given record index
+	 */
+	void write_records(uint64_t index, const std::vector<TraceRecord> &records);
+
+	/**
+	 * Write the file header, with the given record count
+	 */
+	void write_header(uint64_t written);
+
+	/**
+	 * Hand the current chunk to the writer thread, and start a new one
+	 */
+	void flush_chunk();
+
+  public:
+	/**
+	 * Open the trace file and start the writer thread
+	 *
+	 * @param path Path of the file, replaced if it exists
+	 * @param capacity Maximum number of records kept in the file
+	 */
+	TraceWriter(const std::string &path, uint64_t capacity);
+
+	/**
+	 * Write out all recorded instructions and close the file
+	 */
+	~TraceWriter();
+
+	TraceWriter(const TraceWriter &) = delete;
+	TraceWriter &operator=(const TraceWriter &) = delete;
+
+	/**
+	 * Check if the file was opened
+	 */
+	bool is_open() const;
+
+	/**
+	 * Record one instruction, and move the cycle count past it
+	 *
+	 * @param record Registers and opcode of the instruction. The cycle count
+	 * is filled in.
+	 * @param inst_cycles Cycles taken by the instruction
+	 */
+	void record(TraceRecord record, ClockCycles inst_cycles) {
+		record.cycles = cycles;
+		cycles += inst_cycles;
+
+		chunk.push_back(record);
+		if (chunk.size() == CHUNK_RECORDS) {
+			flush_chunk();
+		}
+	}
+
+	/**
+	 * Count cycles that passed without running an instruction, while halted
+	 */
+	void skip(ClockCycles idle_cycles) { cycles += idle_cycles; }
+
+	/**
+	 * Get the number of instructions recorded
+	 */
+	uint64_t get_count() const;
+};
+
+/**
+ * Read a trace file written by a TraceWriter
+ *
+ * @return false if the file could not be read, or is not a trace
+ */
+bool read_trace(const std::string &path, Trace *trace);
+
+/**
+ * Find the first instruction that differs between two traces, counting from
+ * the start of tracing. Only records in both traces are compared, and a trace
+ * that ends early differs at its end.
+ *
+ * @return Index of the instruction, or nothing if the traces are the same
+ */
+std::optional<uint64_t> find_divergence(const Trace &a, const Trace &b);
+
+/**
+ * Format a record as one line of text, with the mnemonic of the instruction
+ *
+ * @param record Record to format
+ * @param rom ROM the trace was recorded with, or nullptr. If given, and the
+ * instruction is in ROM, it is disassembled with its operands. Addresses in
+ * $4000-$7FFF are looked up in bank 1.
+ */
+std::string format_trace_record(const TraceRecord &record,
+                                const std::vector<uint8_t> *rom = nullptr);
+
+} // namespace cpu
@@ -58,4 +58,62 @@ const std::array<Address, 5> interrupt_vector = {
     0x0060  // JOYPAD
 };
 
+/**
+ * Selects how the CPU fetches and dispatches instructions
+ * INTERPRETER -> Fetch and decode every instruction through memory
+ * BLOCK_CACHE -> Execute pre-decoded straight-line runs of ROM code
+ * JIT         -> Like BLOCK_CACHE, but hot blocks are compiled to native code
+ */
+enum class ExecutionMode { INTERPRETER, BLOCK_CACHE, JIT };
+
+/**
+ * Snapshot of the CPU's programmer-visible state
+ */
+struct RegisterState {
+	uint16_t af, bc, de, hl, sp, pc;
+	bool halted;
+	bool interrupt_enabled;
+
+	/// Instruction boundaries left until a pending EI takes effect
+	uint8_t interrupt_enable_delay;
+
+	bool operator==(const RegisterState &other) const {
+		return af == other.af && bc == other.bc && de == other.de &&
+		       hl == other.hl && sp == other.sp && pc == other.pc &&
+		       halted == other.halted &&
+		       interrupt_enabled == other.interrupt_enabled &&
+		       interrupt_enable_delay == other.interrupt_enable_delay;
+	}
+
+	bool operator!=(const RegisterState &other) const {
+		return !(*this == other);
+	}
+};
+
+/**
+ * Length in bytes of each instruction, including the opcode, indexed by
+ * opcode. 0xCB prefixed instructions are always two bytes long. Note that STOP
+ * is treated as a single byte, since op_stop does not consume its operand.
+ */
+// clang-format off
+const std::array<uint8_t, 256> instruction_length = {
+    1, 3, 1, 1, 1, 1, 2, 1, 3, 1, 1, 1, 1, 1, 2, 1,
+    1, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1,
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1,
+    2, 3, 1, 1, 1, 1, 2, 1, 2, 1, 1, 1, 1, 1, 2, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 3, 3, 3, 1, 2, 1, 1, 1, 3, 2, 3, 3, 2, 1,
+    1, 1, 3, 1, 3, 1, 2, 1, 1, 1, 3, 1, 3, 1, 2, 1,
+    2, 1, 1, 1, 1, 1, 2, 1, 2, 1, 3, 1, 1, 1, 2, 1,
+    2, 1, 1, 1, 1, 1, 2, 1, 2, 1, 3, 1, 1, 1, 2, 1
+};
+// clang-format on
+
 } // namespace cpu
@@ -0,0 +1,149 @@
+/**
+ * @file block_cache.cpp
+ * Defines the BlockCache class
+ */
+
+#include "cpu/block_cache.h"
+
+#include <algorithm>
+
+namespace cpu {
+
+BlockCache::BlockCache() : pages(), retired() {}
+
+bool BlockCache::is_cacheable(Address pc) { return pc < CACHEABLE_END; }
+
+bool BlockCache::ends_block(OpCode opcode, Address immediate) {
+	// clang-format off
+	switch (opcode) {
+	// Jumps, calls, returns and restarts
+	case 0x18: case 0x20: case 0x28: case 0x30: case 0x38:
+	case 0xc2: case 0xc3: case 0xca: case 0xd2: case 0xda: case 0xe9:
+	case 0xc4: case 0xcc: case 0xcd: case 0xd4: case 0xdc:
+	case 0xc0: case 0xc8: case 0xc9: case 0xd0: case 0xd8: case 0xd9:
+	case 0xc7: case 0xcf: case 0xd7: case 0xdf:
+	case 0xe7: case 0xef: case 0xf7: case 0xff:
+		return true;
+
+	// HALT, STOP, DI and EI change when interrupts are serviced
+	case 0x10: case 0x76: case 0xf3: case 0xfb:
+		return true;
+
+	// High page I/O accesses. The GPU must be caught up before these run.
+	case 0xe0: case 0xe2: case 0xf0: case 0xf2:
+		return true;
+
+	// Absolute stores to I/O, or to the cartridge (which changes code)
+	case 0x08: case 0xea:
+		return immediate < CACHEABLE_END || immediate >= 0xFF00;
+
+	// Absolute loads from I/O
+	case 0xfa:
+		return immediate >= 0xFF00;
+
+	default:
+		return false;
+	}
+	// clang-format on
+}
+
+PointerRegister BlockCache::get_pointer(OpCode opcode, bool prefixed) {
+	// Prefixed instructions on (HL) are the ones with register 6
+	if (prefixed) {
+		return (opcode & 0x07) == 6 ? PointerRegister::HL
+		                            : PointerRegister::NONE;
+	}
+
+	// clang-format off
+	switch (opcode) {
+	case 0x02: case 0x0a:
+		return PointerRegister::BC;
+	case 0x12: case 0x1a:
+		return PointerRegister::DE;
+	case 0x22: case 0x2a: case 0x32: case 0x3a:
+	case 0x34: case 0x35: case 0x36:
+		return PointerRegister::HL;
+	case 0x76: // HALT, in place of LD (HL), (HL)
+		return PointerRegister::NONE;
+	default:
+		break;
+	}
+	// clang-format on
+
+	// Loads to and from (HL), and the ALU ops on it
+	auto loads_hl = opcode >= 0x70 && opcode < 0x78;
+	auto reads_hl = opcode >= 0x40 && opcode < 0xc0 && (opcode & 0x07) == 6;
+	return loads_hl || reads_hl ? PointerRegister::HL : PointerRegister::NONE;
+}
+
+Block *BlockCache::find(Address pc) {
+	// Nothing can be executing at this point, so retired blocks can go
+	if (!retired.empty()) {
+		retired.clear();
+	}
+
+	auto &page = pages[pc / BLOCK_PAGE_SIZE];
+	return page ? page->blocks[pc % BLOCK_PAGE_SIZE].get() : nullptr;
+}
+
+Block *BlockCache::insert(std::unique_ptr<Block> block) {
+	auto &page = pages[block->start / BLOCK_PAGE_SIZE];
+	if (!page) {
+		page = std::make_unique<BlockPage>();
+	}
+
+	auto &slot = page->blocks[block->start % BLOCK_PAGE_SIZE];
+	slot = std::move(block);
+	return slot.get();
+}
+
+void BlockCache::invalidate(Address start, Address end) {
+	if (!is_cacheable(start)) {
+		return;
+	}
+
+	// A block overlapping the range may start up to MAX_BLOCK_BYTES before it
+	uint32_t first = start > MAX_BLOCK_BYTES ? start - MAX_BLOCK_BYTES : 0;
+	uint32_t last = std::min<uint32_t>(end, CACHEABLE_END - 1);
+
+	for (auto addr = first; addr <= last; ++addr) {
+		auto &page = pages[addr / BLOCK_PAGE_SIZE];
+		if (!page) {
+			// Skip to the start of the next page
+			addr |= BLOCK_PAGE_SIZE - 1;
+			continue;
+		}
+
+		auto offset = addr % BLOCK_PAGE_SIZE;
+		auto &block = page->blocks[offset];
+		if (block && block->end >= start) {
+			if (page->invalidations[offset] < MAX_INVALIDATIONS) {
+				page->invalidations[offset]++;
+			}
+			block->valid = false;
+			retired.push_back(std::move(block));
+		}
+	}
+}
+
+void BlockCache::clear() {
+	for (auto &page : pages) {
+		if (!page) {
+			continue;
+		}
+		for (auto &block : page->blocks) {
+			if (block) {
+				block->valid = false;
+				retired.push_back(std::move(block));
+			}
+		}
+	}
+}
+
+bool BlockCache::is_volatile(Address pc) const {
+	auto &page = pages[pc / BLOCK_PAGE_SIZE];
+	return page &&
+	       page->invalidations[pc % BLOCK_PAGE_SIZE] >= MAX_INVALIDATIONS;
+}
+
+} // namespace cpu
@@ -0,0 +1,948 @@
+/**
+ * @file jit.cpp
+ * Defines the Jit class
+ */
+
+#include "cpu/jit.h"
+#include "util/log.h"
+
+#include <array>
+#include <cstring>
+
+#ifdef TVP_JIT_ENABLED
+#include <sys/mman.h>
+#endif
+
+namespace cpu {
+
+#ifdef TVP_JIT_ENABLED
+
+namespace {
+
+/**
+ * Host registers used by the generated code, numbered as in their encoding.
+ * Only rax, rcx and rdx hold 8-bit values, since their low bytes can be
+ * addressed with or without a REX prefix. rsi holds addresses.
+ */
+enum HostRegister : uint8_t { RAX = 0, RCX = 1, RDX = 2, RSI = 6 };
+
+/**
+ * x86 ALU instructions, as the opcode of their r/m8, r8 form. Shifted right by
+ * 3, this is also the opcode extension of the r/m8, imm8 form.
+ */
+enum HostAlu : uint8_t {
+	ADD = 0x00,
+	OR = 0x08,
+	ADC = 0x10,
+	SBB = 0x18,
+	AND = 0x20,
+	SUB = 0x28,
+	XOR = 0x30,
+	CMP = 0x38
+};
+
+/**
+ * x86 condition codes, as the low nibble of the Jcc and SETcc opcodes
+ */
+enum HostCondition : uint8_t {
+	ABOVE_OR_EQUAL = 0x3,
+	EQUAL = 0x4,
+	NOT_EQUAL = 0x5
+};
+
+/**
+ * Build the table that maps the host flags, as loaded into AH by LAHF, to the
+ * SM83 zero, half carry and carry flags. Host ZF is bit 6, AF is bit 4 and CF
+ * is bit 0.
+ */
+constexpr std::array<uint8_t, 256> make_flag_table() {
+	auto table = std::array<uint8_t, 256>{};
+	for (auto i = 0; i < 256; ++i) {
+		table[i] = static_cast<uint8_t>(((i & 0x40) << 1) | ((i & 0x10) << 1) |
+		                                ((i & 0x01) << 4));
+	}
+	return table;
+}
+
+const std::array<uint8_t, 256> host_flags = make_flag_table();
+
+/**
+ * Minimal x86-64 assembler, with just the instructions the JIT needs.
+ *
+ * Register use in generated code (System V ABI) :
+ * rbx -> context pointer, passed through to the callbacks
+ * r12 -> running total of cycles for the block
+ * r13 -> address of the step function
+ * r14 -> address of the read function
+ * r15 -> address of the write function
+ * r11 -> address of the register or flag being accessed
+ * rax, rcx, rdx, rsi -> values being worked on, and the callback arguments
+ */
+class Emitter {
+  private:
+	std::vector<uint8_t> code;
+
+	void emit_bytes(std::initializer_list<uint8_t> bytes) {
+		code.insert(code.end(), bytes);
+	}
+
+	void emit_imm16(uint16_t value) {
+		emit_bytes({static_cast<uint8_t>(value),
+		            static_cast<uint8_t>(value >> 8)});
+	}
+
+	void emit_imm32(uint32_t value) {
+		for (auto i = 0; i < 4; ++i) {
+			code.push_back(static_cast<uint8_t>(value >> (i * 8)));
+		}
+	}
+
+	void emit_imm64(uint64_t value) {
+		for (auto i = 0; i < 8; ++i) {
+			code.push_back(static_cast<uint8_t>(value >> (i * 8)));
+		}
+	}
+
+	/**
+	 * Get the ModRM byte for a register to register instruction
+	 */
+	static uint8_t direct(uint8_t reg, uint8_t rm) {
+		return static_cast<uint8_t>(0xc0 | (reg << 3) | rm);
+	}
+
+	/**
+	 * Get the ModRM byte for an instruction on [r11]. REX.B must be set.
+	 */
+	static uint8_t at_r11(uint8_t reg) {
+		return static_cast<uint8_t>((reg << 3) | 0x03);
+	}
+
+	void set_address(const void *addr) {
+		emit_bytes({0x49, 0xbb}); // mov r11, imm64
+		emit_imm64(reinterpret_cast<uint64_t>(addr));
+	}
+
+	/**
+	 * Emit a rel32 jump with the given opcode bytes
+	 *
+	 * @return Offset of the rel32 field, to be patched later
+	 */
+	size_t emit_jump(std::initializer_list<uint8_t> opcode) {
+		emit_bytes(opcode);
+		auto offset = code.size();
+		emit_imm32(0);
+		return offset;
+	}
+
+  public:
+	const std::vector<uint8_t> &get_code() const { return code; }
+
+	void prologue(const JitCallbacks &callbacks) {
+		emit_bytes({0x53});             // push rbx
+		emit_bytes({0x41, 0x54});       // push r12
+		emit_bytes({0x41, 0x55});       // push r13
+		emit_bytes({0x41, 0x56});       // push r14
+		emit_bytes({0x41, 0x57});       // push r15
+		emit_bytes({0x48, 0x89, 0xfb}); // mov rbx, rdi
+		emit_bytes({0x49, 0xbd});       // mov r13, imm64
+		emit_imm64(reinterpret_cast<uint64_t>(callbacks.step));
+		emit_bytes({0x49, 0xbe}); // mov r14, imm64
+		emit_imm64(reinterpret_cast<uint64_t>(callbacks.read));
+		emit_bytes({0x49, 0xbf}); // mov r15, imm64
+		emit_imm64(reinterpret_cast<uint64_t>(callbacks.write));
+		emit_bytes({0x45, 0x31, 0xe4}); // xor r12d, r12d
+	}
+
+	void call_step(const DecodedInstruction *inst) {
+		emit_bytes({0x48, 0x89, 0xdf}); // mov rdi, rbx
+		emit_bytes({0x48, 0xbe});       // mov rsi, imm64
+		emit_imm64(reinterpret_cast<uint64_t>(inst));
+		emit_bytes({0x41, 0xff, 0xd5}); // call r13
+		emit_bytes({0x49, 0x01, 0xc4}); // add r12, rax
+	}
+
+	/**
+	 * Read the byte at the address in esi into eax
+	 */
+	void call_read() {
+		emit_bytes({0x48, 0x89, 0xdf}); // mov rdi, rbx
+		emit_bytes({0x41, 0xff, 0xd6}); // call r14
+		emit_bytes({0x0f, 0xb6, 0xc0}); // movzx eax, al
+	}
+
+	/**
+	 * Write the byte in edx to the address in esi
+	 */
+	void call_write() {
+		emit_bytes({0x48, 0x89, 0xdf}); // mov rdi, rbx
+		emit_bytes({0x41, 0xff, 0xd7}); // call r15
+	}
+
+	void add_cycles(ClockCycles cycles) {
+		emit_bytes({0x49, 0x81, 0xc4}); // add r12, imm32
+		emit_imm32(static_cast<uint32_t>(cycles));
+	}
+
+	/// Register storage
+
+	void load8(HostRegister reg, const uint8_t *addr) {
+		set_address(addr);
+		emit_bytes({0x41, 0x0f, 0xb6, at_r11(reg)}); // movzx reg, byte [r11]
+	}
+
+	void store8(uint8_t *addr, HostRegister reg) {
+		set_address(addr);
+		emit_bytes({0x41, 0x88, at_r11(reg)}); // mov byte [r11], reg
+	}
+
+	void store8(uint8_t *addr, uint8_t value) {
+		set_address(addr);
+		emit_bytes({0x41, 0xc6, 0x03, value}); // mov byte [r11], imm8
+	}
+
+	void store16(uint16_t *addr, uint16_t value) {
+		set_address(addr);
+		emit_bytes({0x66, 0x41, 0xc7, 0x03}); // mov word [r11], imm16
+		emit_imm16(value);
+	}
+
+	/**
+	 * Increment or decrement the word at the given address
+	 */
+	void step16(uint16_t *addr, bool increment) {
+		set_address(addr);
+		// inc or dec word [r11]
+		emit_bytes({0x66, 0x41, 0xff, static_cast<uint8_t>(increment ? 0x03
+		                                                             : 0x0b)});
+	}
+
+	/**
+	 * Load a register pair into the given register, through the scratch one
+	 */
+	void load_pair(HostRegister reg, HostRegister scratch, const uint8_t *high,
+	               const uint8_t *low) {
+		load8(reg, high);
+		emit_bytes({0xc1, direct(4, reg), 8}); // shl reg, 8
+		load8(scratch, low);
+		emit_bytes({0x09, direct(scratch, reg)}); // or reg, scratch
+	}
+
+	/**
+	 * Store the low 16 bits of the given register to a register pair. The
+	 * register is shifted in the process.
+	 */
+	void store_pair(uint8_t *high, uint8_t *low, HostRegister reg) {
+		store8(low, reg);
+		emit_bytes({0xc1, direct(5, reg), 8}); // shr reg, 8
+		store8(high, reg);
+	}
+
+	/// Host instructions
+
+	void mov(HostRegister dst, HostRegister src) {
+		emit_bytes({0x89, direct(src, dst)}); // mov dst, src
+	}
+
+	void mov(HostRegister reg, uint32_t value) {
+		emit_bytes({static_cast<uint8_t>(0xb8 + reg)}); // mov reg, imm32
+		emit_imm32(value);
+	}
+
+	void or32(HostRegister reg, uint32_t value) {
+		emit_bytes({0x81, direct(1, reg)}); // or reg, imm32
+		emit_imm32(value);
+	}
+
+	void cmp32(HostRegister reg, uint32_t value) {
+		emit_bytes({0x81, direct(7, reg)}); // cmp reg, imm32
+		emit_imm32(value);
+	}
+
+	void step32(HostRegister reg, bool increment) {
+		// inc or dec reg
+		emit_bytes({0xff, direct(increment ? 0 : 1, reg)});
+	}
+
+	void alu8(HostAlu op, HostRegister dst, HostRegister src) {
+		emit_bytes({op, direct(src, dst)}); // op dst8, src8
+	}
+
+	void alu8(HostAlu op, HostRegister reg, uint8_t value) {
+		emit_bytes({0x80, direct(op >> 3, reg), value}); // op reg8, imm8
+	}
+
+	void step8(HostRegister reg, bool increment) {
+		// inc or dec reg8
+		emit_bytes({0xfe, direct(increment ? 0 : 1, reg)});
+	}
+
+	void not8(HostRegister reg) {
+		emit_bytes({0xf6, direct(2, reg)}); // not reg8
+	}
+
+	void test8(HostRegister reg, uint8_t value) {
+		emit_bytes({0xf6, direct(0, reg), value}); // test reg8, imm8
+	}
+
+	void set8(HostCondition condition, HostRegister reg) {
+		// setcc reg8
+		emit_bytes({0x0f, static_cast<uint8_t>(0x90 | condition),
+		            direct(0, reg)});
+	}
+
+	void shl8(HostRegister reg, uint8_t count) {
+		emit_bytes({0xc0, direct(4, reg), count}); // shl reg8, imm8
+	}
+
+	/**
+	 * Copy the SM83 carry flag, from the flag value in the given register, to
+	 * the host carry flag
+	 */
+	void load_carry(HostRegister reg) {
+		emit_bytes({0x0f, 0xba, direct(4, reg), flag::CARRY}); // bt reg, imm8
+	}
+
+	/**
+	 * Set the byte at the given address if the condition holds on the host
+	 * flags, and clear it otherwise
+	 */
+	void set_if(HostCondition condition, bool *flag) {
+		set_address(flag);
+		// setcc byte [r11]
+		emit_bytes({0x41, 0x0f, static_cast<uint8_t>(0x90 | condition),
+		            0x03});
+	}
+
+	/**
+	 * Update the flag register from the host flags of the last instruction
+	 *
+	 * @param f Flag register
+	 * @param take SM83 flags taken from the host flags
+	 * @param set SM83 flags that are always set
+	 * @param keep SM83 flags left unchanged
+	 */
+	void update_flags(uint8_t *f, uint8_t take, uint8_t set, uint8_t keep) {
+		emit_bytes({0x9f});             // lahf
+		emit_bytes({0x0f, 0xb6, 0xd4}); // movzx edx, ah
+		set_address(host_flags.data());
+		// movzx edx, byte [r11 + rdx]
+		emit_bytes({0x41, 0x0f, 0xb6, 0x14, 0x13});
+		alu8(AND, RDX, take);
+		if (set) {
+			alu8(OR, RDX, set);
+		}
+		load8(RCX, f);
+		alu8(AND, RCX, keep);
+		alu8(OR, RDX, RCX);
+		store8(f, RDX);
+	}
+
+	/// Control flow
+
+	/**
+	 * Emit a jump to the epilogue if the byte at the given address is zero,
+	 * or if it is not
+	 *
+	 * @return Offset of the rel32 field, to be patched later
+	 */
+	size_t exit_if(const bool *flag, bool set) {
+		set_address(flag);
+		emit_bytes({0x41, 0x80, 0x3b, 0x00}); // cmp byte [r11], 0
+		return jump_if(set ? NOT_EQUAL : EQUAL);
+	}
+
+	/**
+	 * Emit a conditional jump on the host flags
+	 *
+	 * @return Offset of the rel32 field, to be patched later
+	 */
+	size_t jump_if(HostCondition condition) {
+		return emit_jump({0x0f, static_cast<uint8_t>(0x80 | condition)});
+	}
+
+	/**
+	 * Emit an unconditional jump
+	 *
+	 * @return Offset of the rel32 field, to be patched later
+	 */
+	size_t jump() { return emit_jump({0xe9}); }
+
+	/**
+	 * Test the bits of the byte at the given address against a mask
+	 */
+	void test_mem8(const uint8_t *addr, uint8_t mask) {
+		set_address(addr);
+		emit_bytes({0x41, 0xf6, 0x03, mask}); // test byte [r11], imm8
+	}
+
+	/**
+	 * Point a previously emitted rel32 jump at the current position
+	 */
+	void patch_to_here(size_t offset) {
+		auto rel = static_cast<int32_t>(code.size() - (offset + 4));
+		std::memcpy(&code[offset], &rel, sizeof(rel));
+	}
+
+	void epilogue() {
+		emit_bytes({0x4c, 0x89, 0xe0}); // mov rax, r12
+		emit_bytes({0x41, 0x5f});       // pop r15
+		emit_bytes({0x41, 0x5e});       // pop r14
+		emit_bytes({0x41, 0x5d});       // pop r13
+		emit_bytes({0x41, 0x5c});       // pop r12
+		emit_bytes({0x5b});             // pop rbx
+		emit_bytes({0xc3});             // ret
+	}
+};
+
+/**
+ * Masks of each flag in the SM83 flag register. The low nibble is always zero
+ * on hardware, but it is carried along like the interpreter does.
+ */
+const uint8_t ZERO_FLAG = 1 << flag::ZERO;
+const uint8_t SUBTRACT_FLAG = 1 << flag::SUBTRACT;
+const uint8_t HALFCARRY_FLAG = 1 << flag::HALFCARRY;
+const uint8_t CARRY_FLAG = 1 << flag::CARRY;
+const uint8_t LOW_NIBBLE = 0x0F;
+
+/**
+ * What translating an instruction produced
+ */
+enum class Translation {
+	/// Nothing, the instruction must be run by the step function
+	NONE,
+	/// Code that reads memory, if anything
+	READS,
+	/// Code that writes memory, which may change the block
+	WRITES,
+	/// Code that sets the PC and adds the cycles itself, at the end of a block
+	BRANCH
+};
+
+/**
+ * Translates single SM83 instructions into host code that works on the
+ * register storage. The cycles of translated instructions are added up at
+ * compile time, and only added to the running total before the block may be
+ * left.
+ */
+class Translator {
+  private:
+	Emitter &emitter;
+	const JitRegisters &regs;
+	bool *indirect_io;
+
+	/**
+	 * Cycles of the instructions translated since the last flush
+	 */
+	ClockCycles pending_cycles;
+
+	/**
+	 * Get an 8-bit register by the index opcodes encode it with. Index 6
+	 * encodes (HL), and must be handled by the caller.
+	 */
+	uint8_t *get_register(uint8_t index) const {
+		const std::array<uint8_t *, 8> registers = {
+		    regs.b, regs.c, regs.d, regs.e, regs.h, regs.l, nullptr, regs.a};
+		return registers[index];
+	}
+
+	/**
+	 * Load the address in a register pair into esi, and flag indirect I/O if
+	 * it is at or above $FF00
+	 */
+	void load_pointer(uint8_t *high, uint8_t *low) {
+		emitter.load_pair(RSI, RCX, high, low);
+		emitter.cmp32(RSI, 0xFF00);
+		emitter.set_if(ABOVE_OR_EQUAL, indirect_io);
+	}
+
+	/**
+	 * Set HL to the address in esi plus or minus one, for (HL+) and (HL-)
+	 */
+	void step_hl(bool increment) {
+		emitter.mov(RAX, RSI);
+		emitter.step32(RAX, increment);
+		emitter.store_pair(regs.h, regs.l, RAX);
+	}
+
+	/**
+	 * Run the ALU operation encoded in bits 3-5 of an opcode on A and the
+	 * operand in ecx
+	 */
+	void alu(uint8_t op) {
+		const std::array<HostAlu, 8> host_ops = {ADD, ADC, SUB, SBB,
+		                                         AND, XOR, OR,  CMP};
+		auto host_op = host_ops[op];
+
+		emitter.load8(RAX, regs.a);
+		if (host_op == ADC || host_op == SBB) {
+			emitter.load8(RDX, regs.f);
+			emitter.load_carry(RDX);
+		}
+		emitter.alu8(host_op, RAX, RCX);
+		if (host_op != CMP) {
+			emitter.store8(regs.a, RAX);
+		}
+
+		// The host's half carry is undefined after logic operations, and
+		// its carry is cleared
+		auto logic = host_op == AND || host_op == XOR || host_op == OR;
+		auto subtract = host_op == SUB || host_op == SBB || host_op == CMP;
+		auto take = logic ? ZERO_FLAG : ZERO_FLAG | HALFCARRY_FLAG | CARRY_FLAG;
+		auto set = subtract          ? SUBTRACT_FLAG
+		           : host_op == AND ? HALFCARRY_FLAG
+		                            : 0;
+		emitter.update_flags(regs.f, take, static_cast<uint8_t>(set),
+		                     LOW_NIBBLE);
+	}
+
+	/**
+	 * LD r, r', with either side possibly (HL)
+	 */
+	Translation translate_load(OpCode opcode) {
+		auto dst = (opcode >> 3) & 0x07;
+		auto src = opcode & 0x07;
+
+		if (src == 6) {
+			load_pointer(regs.h, regs.l);
+			emitter.call_read();
+			emitter.store8(get_register(dst), RAX);
+			return Translation::READS;
+		}
+		if (dst == 6) {
+			load_pointer(regs.h, regs.l);
+			emitter.load8(RDX, get_register(src));
+			emitter.call_write();
+			return Translation::WRITES;
+		}
+		if (src != dst) {
+			emitter.load8(RAX, get_register(src));
+			emitter.store8(get_register(dst), RAX);
+		}
+		return Translation::READS;
+	}
+
+	/**
+	 * ALU operations on A and a register, or (HL)
+	 */
+	Translation translate_alu(OpCode opcode) {
+		auto src = opcode & 0x07;
+		if (src == 6) {
+			load_pointer(regs.h, regs.l);
+			emitter.call_read();
+			emitter.mov(RCX, RAX);
+		} else {
+			emitter.load8(RCX, get_register(src));
+		}
+		alu((opcode >> 3) & 0x07);
+		return Translation::READS;
+	}
+
+	/**
+	 * INC r and DEC r. The carry flag is left alone, like the host does.
+	 */
+	Translation translate_step(OpCode opcode) {
+		auto index = (opcode >> 3) & 0x07;
+		if (index == 6) {
+			return Translation::NONE;
+		}
+
+		auto increment = (opcode & 0x01) == 0;
+		emitter.load8(RAX, get_register(index));
+		emitter.step8(RAX, increment);
+		emitter.store8(get_register(index), RAX);
+		emitter.update_flags(regs.f, ZERO_FLAG | HALFCARRY_FLAG,
+		                     increment ? 0 : SUBTRACT_FLAG,
+		                     CARRY_FLAG | LOW_NIBBLE);
+		return Translation::READS;
+	}
+
+	/**
+	 * LD rr, d16, INC rr and DEC rr
+	 */
+	Translation translate_pair(const DecodedInstruction &inst) {
+		const std::array<uint8_t *, 3> high = {regs.b, regs.d, regs.h};
+		const std::array<uint8_t *, 3> low = {regs.c, regs.e, regs.l};
+		auto index = inst.opcode >> 4;
+
+		if ((inst.opcode & 0x0F) == 0x01) {
+			auto value = static_cast<uint16_t>((inst.operands[1] << 8) |
+			                                   inst.operands[0]);
+			if (index == 3) {
+				emitter.store16(regs.sp, value);
+			} else {
+				emitter.store8(high[index], inst.operands[1]);
+				emitter.store8(low[index], inst.operands[0]);
+			}
+			return Translation::READS;
+		}
+
+		auto increment = (inst.opcode & 0x0F) == 0x03;
+		if (index == 3) {
+			emitter.step16(regs.sp, increment);
+		} else {
+			emitter.load_pair(RAX, RCX, high[index], low[index]);
+			emitter.step32(RAX, increment);
+			emitter.store_pair(high[index], low[index], RAX);
+		}
+		return Translation::READS;
+	}
+
+	/**
+	 * Loads between A and memory at an address in a register pair, at a
+	 * fixed address, or in the high page
+	 */
+	Translation translate_memory(const DecodedInstruction &inst) {
+		auto immediate = static_cast<uint32_t>((inst.operands[1] << 8) |
+		                                       inst.operands[0]);
+		// clang-format off
+		switch (inst.opcode) {
+		case 0x02: case 0x0a:
+			load_pointer(regs.b, regs.c);
+			break;
+		case 0x12: case 0x1a:
+			load_pointer(regs.d, regs.e);
+			break;
+		case 0x22: case 0x2a: case 0x32: case 0x3a:
+			load_pointer(regs.h, regs.l);
+			step_hl(inst.opcode < 0x30);
+			break;
+		case 0xe0: case 0xf0:
+			emitter.mov(RSI, 0xFF00 | inst.operands[0]);
+			break;
+		case 0xe2: case 0xf2:
+			emitter.load8(RSI, regs.c);
+			emitter.or32(RSI, 0xFF00);
+			break;
+		default:
+			emitter.mov(RSI, immediate);
+			break;
+		}
+		// clang-format on
+
+		// Stores are LD (rr), A and the ones from $E0 on, loads the others
+		auto store = inst.opcode < 0x40 ? (inst.opcode & 0x0F) == 0x02
+		                                : inst.opcode < 0xf0;
+		if (store) {
+			emitter.load8(RDX, regs.a);
+			emitter.call_write();
+			return Translation::WRITES;
+		}
+		emitter.call_read();
+		emitter.store8(regs.a, RAX);
+		return Translation::READS;
+	}
+
+	/**
+	 * CPL, SCF and CCF
+	 */
+	Translation translate_flags(OpCode opcode) {
+		if (opcode == 0x2f) {
+			emitter.load8(RAX, regs.a);
+			emitter.not8(RAX);
+			emitter.store8(regs.a, RAX);
+			emitter.load8(RCX, regs.f);
+			emitter.alu8(OR, RCX, SUBTRACT_FLAG | HALFCARRY_FLAG);
+		} else {
+			emitter.load8(RCX, regs.f);
+			if (opcode == 0x3f) {
+				emitter.alu8(XOR, RCX, CARRY_FLAG);
+			} else {
+				emitter.alu8(OR, RCX, CARRY_FLAG);
+			}
+			emitter.alu8(AND, RCX, ZERO_FLAG | CARRY_FLAG | LOW_NIBBLE);
+		}
+		emitter.store8(regs.f, RCX);
+		return Translation::READS;
+	}
+
+	/**
+	 * BIT, RES and SET on registers
+	 */
+	Translation translate_prefixed(OpCode opcode) {
+		auto index = opcode & 0x07;
+		if (opcode < 0x40 || index == 6) {
+			return Translation::NONE;
+		}
+
+		auto mask = static_cast<uint8_t>(1 << ((opcode >> 3) & 0x07));
+		emitter.load8(RAX, get_register(index));
+		if (opcode < 0x80) {
+			emitter.test8(RAX, mask);
+			emitter.set8(EQUAL, RDX);
+			emitter.shl8(RDX, flag::ZERO);
+			emitter.load8(RCX, regs.f);
+			emitter.alu8(AND, RCX, CARRY_FLAG | LOW_NIBBLE);
+			emitter.alu8(OR, RCX, HALFCARRY_FLAG);
+			emitter.alu8(OR, RCX, RDX);
+			emitter.store8(regs.f, RCX);
+		} else {
+			if (opcode < 0xc0) {
+				emitter.alu8(AND, RAX, static_cast<uint8_t>(~mask));
+			} else {
+				emitter.alu8(OR, RAX, mask);
+			}
+			emitter.store8(get_register(index), RAX);
+		}
+		return Translation::READS;
+	}
+
+	/**
+	 * JR and JP, with or without a condition. These always end a block.
+	 */
+	Translation translate_branch(const DecodedInstruction &inst) {
+		auto target =
+		    inst.opcode < 0x40
+		        ? static_cast<Address>(inst.next_pc +
+		                               static_cast<int8_t>(inst.operands[0]))
+		        : static_cast<Address>((inst.operands[1] << 8) |
+		                               inst.operands[0]);
+		flush_cycles();
+
+		if (inst.opcode == 0x18 || inst.opcode == 0xc3) {
+			emitter.store16(regs.pc, target);
+			emitter.add_cycles(inst.cycles);
+			return Translation::BRANCH;
+		}
+
+		// Conditions are NZ, Z, NC and C, in that order
+		auto condition = (inst.opcode >> 3) & 0x03;
+		emitter.test_mem8(regs.f, condition < 2 ? ZERO_FLAG : CARRY_FLAG);
+		auto not_taken = emitter.jump_if(condition & 1 ? EQUAL : NOT_EQUAL);
+
+		emitter.store16(regs.pc, target);
+		emitter.add_cycles(inst.cycles_branched);
+		auto done = emitter.jump();
+
+		emitter.patch_to_here(not_taken);
+		emitter.store16(regs.pc, inst.next_pc);
+		emitter.add_cycles(inst.cycles);
+
+		emitter.patch_to_here(done);
+		return Translation::BRANCH;
+	}
+
+	Translation translate_instruction(const DecodedInstruction &inst) {
+		auto opcode = inst.opcode;
+		if (inst.prefixed) {
+			return translate_prefixed(opcode);
+		}
+		if (opcode == 0x76) { // HALT, in place of LD (HL), (HL)
+			return Translation::NONE;
+		}
+		if (opcode >= 0x40 && opcode < 0x80) {
+			return translate_load(opcode);
+		}
+		if (opcode >= 0x80 && opcode < 0xc0) {
+			return translate_alu(opcode);
+		}
+
+		// clang-format off
+		switch (opcode) {
+		case 0x00:
+			return Translation::READS;
+
+		case 0x01: case 0x11: case 0x21: case 0x31:
+		case 0x03: case 0x13: case 0x23: case 0x33:
+		case 0x0b: case 0x1b: case 0x2b: case 0x3b:
+			return translate_pair(inst);
+
+		case 0x04: case 0x0c: case 0x14: case 0x1c:
+		case 0x24: case 0x2c: case 0x34: case 0x3c:
+		case 0x05: case 0x0d: case 0x15: case 0x1d:
+		case 0x25: case 0x2d: case 0x35: case 0x3d:
+			return translate_step(opcode);
+
+		case 0x06: case 0x0e: case 0x16: case 0x1e:
+		case 0x26: case 0x2e: case 0x3e:
+			emitter.store8(get_register((opcode >> 3) & 0x07),
+			               inst.operands[0]);
+			return Translation::READS;
+
+		case 0x36: // LD (HL), d8
+			load_pointer(regs.h, regs.l);
+			emitter.mov(RDX, inst.operands[0]);
+			emitter.call_write();
+			return Translation::WRITES;
+
+		case 0x02: case 0x0a: case 0x12: case 0x1a:
+		case 0x22: case 0x2a: case 0x32: case 0x3a:
+		case 0xe0: case 0xf0: case 0xe2: case 0xf2:
+		case 0xea: case 0xfa:
+			return translate_memory(inst);
+
+		case 0x2f: case 0x37: case 0x3f:
+			return translate_flags(opcode);
+
+		case 0xc6: case 0xce: case 0xd6: case 0xde:
+		case 0xe6: case 0xee: case 0xf6: case 0xfe:
+			emitter.mov(RCX, inst.operands[0]);
+			alu((opcode >> 3) & 0x07);
+			return Translation::READS;
+
+		case 0x18: case 0x20: case 0x28: case 0x30: case 0x38:
+		case 0xc2: case 0xc3: case 0xca: case 0xd2: case 0xda:
+			return translate_branch(inst);
+
+		default:
+			return Translation::NONE;
+		}
+		// clang-format on
+	}
+
+  public:
+	Translator(Emitter &emitter, const JitRegisters &regs, bool *indirect_io)
+	    : emitter(emitter), regs(regs), indirect_io(indirect_io),
+	      pending_cycles(0) {}
+
+	/**
+	 * Emit code for the given instruction, if it is one that is translated
+	 */
+	Translation translate(const DecodedInstruction &inst) {
+		auto translation = translate_instruction(inst);
+		if (translation == Translation::READS ||
+		    translation == Translation::WRITES) {
+			pending_cycles += inst.cycles;
+		}
+		return translation;
+	}
+
+	/**
+	 * Add the cycles of the instructions translated so far to the total
+	 */
+	void flush_cycles() {
+		if (pending_cycles) {
+			emitter.add_cycles(pending_cycles);
+			pending_cycles = 0;
+		}
+	}
+};
+
+} // namespace
+
+Jit::Jit() : arena(nullptr), arena_used(0) {
+	auto mapping = mmap(nullptr, JIT_ARENA_SIZE, PROT_READ | PROT_WRITE,
+	                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mapping == MAP_FAILED) {
+		Log::error("Could not map JIT code arena");
+		return;
+	}
+	arena = static_cast<uint8_t *>(mapping);
+}
+
+Jit::~Jit() {
+	if (arena) {
+		munmap(arena, JIT_ARENA_SIZE);
+	}
+}
+
+bool Jit::is_supported() { return true; }
+
+JitFunction Jit::compile(const Block *block, const JitRegisters &registers,
+                         const JitCallbacks &callbacks, bool *indirect_io) {
+	auto emitter = Emitter();
+	auto translator = Translator(emitter, registers, indirect_io);
+	auto exits = std::vector<size_t>();
+
+	emitter.prologue(callbacks);
+
+	auto translation = Translation::NONE;
+	auto count = block->instructions.size();
+	for (size_t i = 0; i < count; ++i) {
+		auto &inst = block->instructions[i];
+		translation = translator.translate(inst);
+		if (translation == Translation::NONE) {
+			translator.flush_cycles();
+			emitter.call_step(&inst);
+		}
+
+		// Leave as soon as the block overwrites itself, or reaches I/O that
+		// the GPU must catch up with. There's nothing left to run after the
+		// last instruction, so skip the checks there.
+		auto writes = translation != Translation::READS;
+		auto pointer = inst.pointer != PointerRegister::NONE;
+		if (i + 1 == count || !(writes || pointer)) {
+			continue;
+		}
+
+		// The step function sets the PC itself
+		if (translation != Translation::NONE) {
+			emitter.store16(registers.pc, inst.next_pc);
+		}
+		translator.flush_cycles();
+		if (writes) {
+			exits.push_back(emitter.exit_if(&block->valid, false));
+		}
+		if (pointer) {
+			exits.push_back(emitter.exit_if(indirect_io, true));
+		}
+	}
+
+	if (translation == Translation::READS ||
+	    translation == Translation::WRITES) {
+		emitter.store16(registers.pc, block->instructions.back().next_pc);
+	}
+	translator.flush_cycles();
+
+	for (auto offset : exits) {
+		emitter.patch_to_here(offset);
+	}
+	emitter.epilogue();
+
+	return install(emitter.get_code());
+}
+
+JitFunction Jit::install(const std::vector<uint8_t> &code) {
+	if (!arena || arena_used + code.size() > JIT_ARENA_SIZE) {
+		return nullptr;
+	}
+
+	// Keep the arena W^X - never writable and executable at the same time.
+	// Hardened hosts may refuse either, and then nothing more is compiled.
+	if (mprotect(arena, JIT_ARENA_SIZE, PROT_READ | PROT_WRITE) != 0) {
+		release();
+		return nullptr;
+	}
+	auto start = arena + arena_used;
+	std::memcpy(start, code.data(), code.size());
+	if (mprotect(arena, JIT_ARENA_SIZE, PROT_READ | PROT_EXEC) != 0) {
+		release();
+		return nullptr;
+	}
+
+	// Keep each function 16 byte aligned
+	arena_used = (arena_used + code.size() + 15) & ~static_cast<size_t>(15);
+
+	return reinterpret_cast<JitFunction>(start);
+}
+
+void Jit::release() {
+	Log::error("Could not change JIT arena protection, using block cache");
+	munmap(arena, JIT_ARENA_SIZE);
+	arena = nullptr;
+	arena_used = 0;
+}
+
+void Jit::flush() { arena_used = 0; }
+
+#else
+
+Jit::Jit() : arena(nullptr), arena_used(0) {}
+
+Jit::~Jit() {}
+
+bool Jit::is_supported() { return false; }
+
+JitFunction Jit::compile(const Block *, const JitRegisters &,
+                         const JitCallbacks &, bool *) {
+	return nullptr;
+}
+
+JitFunction Jit::install(const std::vector<uint8_t> &) { return nullptr; }
+
+void Jit::release() {}
+
+void Jit::flush() {}
+
+#endif
+
+} // namespace cpu
@@ -0,0 +1,471 @@
+/**
+ * @file lockstep.cpp
+ * Defines the Lockstep class
+ */
+
+#include "cpu/lockstep.h"
+#include "cpu/alu.h"
+#include "cpu/cpu_impl.h"
+#include "cpu/register/register.h"
+
+#include <algorithm>
+
+namespace cpu {
+
+template class CPU<LaneMemory>;
+
+namespace {
+
+/**
+ * Index of each register in Lockstep::regs
+ */
+enum LaneRegister : uint8_t {
+	REG_B = 0,
+	REG_C = 1,
+	REG_D = 2,
+	REG_E = 3,
+	REG_H = 4,
+	REG_L = 5,
+	REG_F = 6,
+	REG_A = 7
+};
+
+/**
+ * Lanes only keep memory from this address onwards. Below it is ROM.
+ */
+const Address RAM_START = 0x8000;
+
+/**
+ * Echo RAM mirrors work RAM, 0x2000 bytes lower
+ */
+const Address ECHO_START = 0xE000;
+const Address ECHO_END = 0xFDFF;
+
+const Address JOYPAD_ADDR = 0xFF00;
+const Address INTERRUPT_FLAG_ADDR = 0xFF0F;
+const Address INTERRUPT_ENABLE_ADDR = 0xFFFF;
+
+/**
+ * Registers as the boot ROM leaves them
+ */
+const RegisterState initial_state = {
+    0x01B0, // AF
+    0x0013, // BC
+    0x00D8, // DE
+    0x014D, // HL
+    0xFFFE, // SP
+    0x0100, // PC
+    false,  // halted
+    false,  // interrupt_enabled
+    0,      // interrupt_enable_delay
+};
+
+} // namespace
+
+/// LaneMemory
+
+LaneMemory::LaneMemory(Lockstep *core) : core(core), lane(0) {}
+
+uint8_t LaneMemory::read(Address address) const {
+	// The interrupt registers live in the scalar CPU while it runs
+	if (address == INTERRUPT_FLAG_ADDR) {
+		return core->scalar_cpu->get_interrupts()->get_flag();
+	}
+	if (address == INTERRUPT_ENABLE_ADDR) {
+		return core->scalar_cpu->get_interrupts()->get_enable();
+	}
+	return core->read(lane, address);
+}
+
+void LaneMemory::write(Address address, uint8_t data) {
+	if (address == INTERRUPT_FLAG_ADDR) {
+		core->scalar_cpu->get_interrupts()->set_flag(data);
+		return;
+	}
+	if (address == INTERRUPT_ENABLE_ADDR) {
+		core->scalar_cpu->get_interrupts()->set_enable(data);
+		return;
+	}
+	core->write(lane, address, data);
+}
+
+/// Lockstep
+
+Lockstep::Lockstep(std::shared_ptr<std::vector<uint8_t>> rom_data,
+                   size_t lanes)
+    : lanes(lanes), rom_data(std::move(rom_data)), pc(lanes), sp(lanes),
+      halted(lanes), interrupt_enabled(lanes), interrupt_enable_delay(lanes),
+      cycles(lanes), buttons(lanes),
+      ram(static_cast<size_t>(0x10000 - RAM_START) * lanes), done(lanes),
+      mask(lanes), vector_enabled(true), stats() {
+	for (auto &reg : regs) {
+		reg.resize(lanes);
+	}
+
+	for (size_t lane = 0; lane < lanes; ++lane) {
+		set_register_state(lane, initial_state);
+
+		// Boot ROM disabled, LCD on and the default palette
+		ram_at(lane, 0xFF50) = 0x01;
+		ram_at(lane, 0xFF40) = 0x91;
+		ram_at(lane, 0xFF47) = 0xFC;
+	}
+
+	// The scalar CPU, built the same way as the Gameboy builds its CPU
+	auto a = std::make_unique<Register>();
+	auto b = std::make_unique<Register>();
+	auto c = std::make_unique<Register>();
+	auto d = std::make_unique<Register>();
+	auto e = std::make_unique<Register>();
+	auto f = std::make_unique<Register>();
+	auto h = std::make_unique<Register>();
+	auto l = std::make_unique<Register>();
+	auto af = std::make_unique<PairRegister>(a.get(), f.get());
+	auto bc = std::make_unique<PairRegister>(b.get(), c.get());
+	auto de = std::make_unique<PairRegister>(d.get(), e.get());
+	auto hl = std::make_unique<PairRegister>(h.get(), l.get());
+
+	scalar_memory = std::make_unique<LaneMemory>(this);
+	scalar_cpu = std::make_unique<CPU<LaneMemory>>(
+	    std::move(a), std::move(b), std::move(c), std::move(d), std::move(e),
+	    std::move(f), std::move(h), std::move(l), std::move(af),
+	    std::move(bc), std::move(de), std::move(hl),
+	    std::make_unique<DoubleRegister>(), std::make_unique<DoubleRegister>(),
+	    scalar_memory.get());
+}
+
+void Lockstep::step() {
+	++stats.steps;
+	std::fill(done.begin(), done.end(), 0);
+
+	for (size_t leader = 0; leader < lanes; ++leader) {
+		if (done[leader]) {
+			continue;
+		}
+		++stats.groups;
+		auto group_pc = pc[leader];
+
+		// Gather the lanes still to run at this PC. Earlier lanes have all
+		// run already, so the group starts at the leader.
+		size_t count = 0;
+		for (size_t lane = leader; lane < lanes; ++lane) {
+			mask[lane] = !done[lane] && pc[lane] == group_pc && is_ready(lane);
+			count += mask[lane];
+		}
+
+		// Code outside ROM may differ between lanes, so only ROM is shared
+		if (vector_enabled && count > 0 && group_pc < RAM_START &&
+		    run_vector(group_pc, leader)) {
+			for (size_t lane = leader; lane < lanes; ++lane) {
+				done[lane] |= mask[lane];
+			}
+			stats.vector_instructions += count;
+		}
+
+		// Whatever is left at this PC runs one lane at a time
+		for (size_t lane = leader; lane < lanes; ++lane) {
+			if (!done[lane] && pc[lane] == group_pc) {
+				run_scalar(lane);
+				done[lane] = 1;
+				++stats.scalar_instructions;
+			}
+		}
+	}
+}
+
+bool Lockstep::is_ready(size_t lane) const {
+	auto interrupts = ram_at(lane, INTERRUPT_FLAG_ADDR) &
+	                  ram_at(lane, INTERRUPT_ENABLE_ADDR);
+	// The instruction after an EI runs on the scalar CPU, which counts the
+	// delay down
+	return !halted[lane] && !interrupt_enable_delay[lane] &&
+	       !(interrupt_enabled[lane] && interrupts);
+}
+
+void Lockstep::run_scalar(size_t lane) {
+	scalar_memory->lane = lane;
+	scalar_cpu->set_register_state(get_register_state(lane));
+	auto interrupts = scalar_cpu->get_interrupts();
+	interrupts->set_flag(ram_at(lane, INTERRUPT_FLAG_ADDR));
+	interrupts->set_enable(ram_at(lane, INTERRUPT_ENABLE_ADDR));
+
+	cycles[lane] += scalar_cpu->tick();
+
+	set_register_state(lane, scalar_cpu->get_register_state());
+	ram_at(lane, INTERRUPT_FLAG_ADDR) = interrupts->get_flag();
+	ram_at(lane, INTERRUPT_ENABLE_ADDR) = interrupts->get_enable();
+}
+
+bool Lockstep::run_vector(Address group_pc, size_t first) {
+	auto opcode = read_rom(group_pc);
+	auto length = instruction_length[opcode];
+	auto imm8 = read_rom(group_pc + 1);
+	auto imm16 = static_cast<uint16_t>(imm8 | (read_rom(group_pc + 2) << 8));
+	auto cycle_count = scalar_cpu->get_opcode_cycles(opcode, false);
+
+	// Register fields of the opcode. Field 6 means (HL), which needs memory.
+	auto dst = (opcode >> 3) & 0x7;
+	auto src = opcode & 0x7;
+
+	const auto *m = mask.data();
+
+	if (opcode == 0x00) {
+		// NOP
+	} else if (opcode >= 0x40 && opcode <= 0x7F) {
+		// LD r, r' - also covers HALT at 0x76
+		if (dst == REG_F || src == REG_F) {
+			return false;
+		}
+		auto *to = regs[dst].data();
+		const auto *from = regs[src].data();
+		for (size_t i = first; i < lanes; ++i) {
+			to[i] = m[i] ? from[i] : to[i];
+		}
+	} else if (opcode >= 0x80 && opcode <= 0xBF) {
+		// ALU A, r
+		if (src == REG_F) {
+			return false;
+		}
+		const auto *from = regs[src].data();
+		run_alu(dst, first, [from](size_t i) { return from[i]; });
+	} else if ((opcode & 0xC7) == 0xC6) {
+		// ALU A, d8
+		run_alu(dst, first, [imm8](size_t) { return imm8; });
+	} else if ((opcode & 0xC7) == 0x06 && opcode < 0x40) {
+		// LD r, d8
+		if (dst == REG_F) {
+			return false;
+		}
+		auto *to = regs[dst].data();
+		for (size_t i = first; i < lanes; ++i) {
+			to[i] = m[i] ? imm8 : to[i];
+		}
+	} else if ((opcode & 0xC6) == 0x04 && opcode < 0x40) {
+		// INC r / DEC r
+		if (dst == REG_F) {
+			return false;
+		}
+		auto is_dec = opcode & 0x01;
+		auto *reg = regs[dst].data();
+		auto *flags = regs[REG_F].data();
+		for (size_t i = first; i < lanes; ++i) {
+			auto new_flags = flags[i];
+			auto result = is_dec ? alu::dec(reg[i], new_flags)
+			                     : alu::inc(reg[i], new_flags);
+			reg[i] = m[i] ? result : reg[i];
+			flags[i] = m[i] ? new_flags : flags[i];
+		}
+	} else if ((opcode & 0xCF) == 0x01 || (opcode & 0xC7) == 0x03) {
+		// LD rr, d16 / INC rr / DEC rr. These opcodes are all below 0x40.
+		auto pair = (opcode >> 4) & 0x3;
+		auto is_load = (opcode & 0x0F) == 0x01;
+		auto delta = static_cast<uint16_t>((opcode & 0x08) ? 0xFFFF : 1);
+		if (pair == 3) {
+			// SP
+			for (size_t i = first; i < lanes; ++i) {
+				auto value = static_cast<uint16_t>(
+				    is_load ? imm16 : sp[i] + delta);
+				sp[i] = m[i] ? value : sp[i];
+			}
+		} else {
+			// BC, DE or HL, which are stored as two 8-bit registers
+			auto *high = regs[2 * pair].data();
+			auto *low = regs[2 * pair + 1].data();
+			for (size_t i = first; i < lanes; ++i) {
+				auto current = static_cast<uint16_t>((high[i] << 8) | low[i]);
+				auto value = static_cast<uint16_t>(
+				    is_load ? imm16 : current + delta);
+				high[i] = m[i] ? static_cast<uint8_t>(value >> 8) : high[i];
+				low[i] = m[i] ? static_cast<uint8_t>(value) : low[i];
+			}
+		}
+	} else if (opcode == 0x18 || opcode == 0xC3) {
+		// JR e / JP a16
+		auto target = opcode == 0x18
+		                  ? static_cast<Address>(group_pc + 2 +
+		                                         static_cast<int8_t>(imm8))
+		                  : imm16;
+		branch(first, opcode, -1, length, target);
+		return true;
+	} else if ((opcode & 0xE7) == 0x20) {
+		// JR cc, e
+		auto target =
+		    static_cast<Address>(group_pc + 2 + static_cast<int8_t>(imm8));
+		branch(first, opcode, (opcode >> 3) & 0x3, length, target);
+		return true;
+	} else if ((opcode & 0xE7) == 0xC2) {
+		// JP cc, a16
+		branch(first, opcode, (opcode >> 3) & 0x3, length, imm16);
+		return true;
+	} else {
+		return false;
+	}
+
+	advance(first, length, cycle_count);
+	return true;
+}
+
+template <typename Operand>
+void Lockstep::run_alu(uint8_t alu_op, size_t first, Operand operand) {
+	auto *acc = regs[REG_A].data();
+	auto *flags = regs[REG_F].data();
+	const auto *m = mask.data();
+
+	// Pick the operation outside the loop, so that each loop is branch free
+	auto run = [&](auto op) {
+		for (size_t i = first; i < lanes; ++i) {
+			auto new_flags = flags[i];
+			auto result = op(acc[i], operand(i), new_flags);
+			acc[i] = m[i] ? result : acc[i];
+			flags[i] = m[i] ? new_flags : flags[i];
+		}
+	};
+
+	switch (alu_op) {
+	case 0:
+		run(alu::add);
+		break;
+	case 1:
+		run(alu::adc);
+		break;
+	case 2:
+		run(alu::sub);
+		break;
+	case 3:
+		run(alu::sbc);
+		break;
+	case 4:
+		run(alu::and_);
+		break;
+	case 5:
+		run(alu::xor_);
+		break;
+	case 6:
+		run(alu::or_);
+		break;
+	case 7:
+		run(alu::cp);
+		break;
+	}
+}
+
+void Lockstep::advance(size_t first, uint8_t length, ClockCycles cycle_count) {
+	const auto *m = mask.data();
+	for (size_t i = first; i < lanes; ++i) {
+		pc[i] = static_cast<uint16_t>(pc[i] + (m[i] ? length : 0));
+		cycles[i] += m[i] ? cycle_count : 0;
+	}
+}
+
+void Lockstep::branch(size_t first, OpCode opcode, int condition,
+                      uint8_t length, Address target) {
+	auto not_taken_cycles = scalar_cpu->get_opcode_cycles(opcode, false);
+	auto taken_cycles = scalar_cpu->get_opcode_cycles(opcode, true);
+
+	// Conditions are NZ, Z, NC and C
+	auto flag_bit = condition < 2 ? flag::ZERO : flag::CARRY;
+	auto wanted = static_cast<uint8_t>(condition & 0x1);
+
+	const auto *flags = regs[REG_F].data();
+	const auto *m = mask.data();
+	for (size_t i = first; i < lanes; ++i) {
+		auto taken =
+		    condition < 0 || alu::get_flag(flags[i], flag_bit) == wanted;
+		auto next = static_cast<uint16_t>(pc[i] + length);
+		auto new_pc = taken ? target : next;
+		pc[i] = m[i] ? new_pc : pc[i];
+		cycles[i] += m[i] ? (taken ? taken_cycles : not_taken_cycles) : 0;
+	}
+}
+
+uint8_t &Lockstep::ram_at(size_t lane, Address address) {
+	return ram[static_cast<size_t>(address - RAM_START) * lanes + lane];
+}
+
+const uint8_t &Lockstep::ram_at(size_t lane, Address address) const {
+	return ram[static_cast<size_t>(address - RAM_START) * lanes + lane];
+}
+
+uint8_t Lockstep::read_rom(Address address) const {
+	return address < rom_data->size() ? (*rom_data)[address] : 0xFF;
+}
+
+uint8_t Lockstep::read(size_t lane, Address address) const {
+	if (address < RAM_START) {
+		return read_rom(address);
+	}
+	if (address >= ECHO_START && address <= ECHO_END) {
+		address -= 0x2000;
+	}
+
+	// Same as controller::Controller - bit 5 clear selects the buttons,
+	// otherwise the directions are read. Pressed buttons read as 0.
+	if (address == JOYPAD_ADDR) {
+		auto select = ram_at(lane, address) & 0x30;
+		auto pressed = (select & 0x20) ? buttons[lane] & 0x0F
+		                               : buttons[lane] >> 4;
+		return static_cast<uint8_t>(select | (~pressed & 0x0F));
+	}
+
+	return ram_at(lane, address);
+}
+
+void Lockstep::write(size_t lane, Address address, uint8_t value) {
+	if (address < RAM_START) {
+		return;
+	}
+	if (address >= ECHO_START && address <= ECHO_END) {
+		address -= 0x2000;
+	}
+	ram_at(lane, address) = value;
+}
+
+RegisterState Lockstep::get_register_state(size_t lane) const {
+	auto pair = [lane, this](uint8_t high, uint8_t low) {
+		return static_cast<uint16_t>((regs[high][lane] << 8) |
+		                             regs[low][lane]);
+	};
+
+	auto state = RegisterState{};
+	state.af = pair(REG_A, REG_F);
+	state.bc = pair(REG_B, REG_C);
+	state.de = pair(REG_D, REG_E);
+	state.hl = pair(REG_H, REG_L);
+	state.sp = sp[lane];
+	state.pc = pc[lane];
+	state.halted = halted[lane];
+	state.interrupt_enabled = interrupt_enabled[lane];
+	state.interrupt_enable_delay = interrupt_enable_delay[lane];
+	return state;
+}
+
+void Lockstep::set_register_state(size_t lane, const RegisterState &state) {
+	auto set_pair = [lane, this](uint8_t high, uint8_t low, uint16_t value) {
+		regs[high][lane] = static_cast<uint8_t>(value >> 8);
+		regs[low][lane] = static_cast<uint8_t>(value);
+	};
+
+	set_pair(REG_A, REG_F, state.af);
+	set_pair(REG_B, REG_C, state.bc);
+	set_pair(REG_D, REG_E, state.de);
+	set_pair(REG_H, REG_L, state.hl);
+	sp[lane] = state.sp;
+	pc[lane] = state.pc;
+	halted[lane] = state.halted;
+	interrupt_enabled[lane] = state.interrupt_enabled;
+	interrupt_enable_delay[lane] = state.interrupt_enable_delay;
+}
+
+void Lockstep::set_vector_enabled(bool enabled) { vector_enabled = enabled; }
+
+void Lockstep::set_buttons(size_t lane, uint8_t pressed) {
+	buttons[lane] = pressed;
+}
+
+ClockCycles Lockstep::get_cycles(size_t lane) const { return cycles[lane]; }
+
+size_t Lockstep::get_lane_count() const { return lanes; }
+
+const LockstepStats &Lockstep::get_stats() const { return stats; }
+
+} // namespace cpu
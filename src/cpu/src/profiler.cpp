@@ -0,0 +1,204 @@
+/**
+ * @file profiler.cpp
+ * Defines the Profiler class
+ */
+
+#include "cpu/profiler.h"
+#include "util/disassembler.h"
+#include "util/helpers.h"
+
+#include <algorithm>
+#include <numeric>
+#include <string>
+
+namespace cpu {
+
+namespace {
+
+/**
+ * Get the mnemonic of an opcode, stored as 0xCBxx if prefixed
+ */
+std::string get_full_mnemonic(uint16_t opcode) {
+	if ((opcode >> 8) == 0xCB) {
+		return get_cb_mnemonic(static_cast<uint8_t>(opcode));
+	}
+	return get_mnemonic(static_cast<uint8_t>(opcode));
+}
+
+} // namespace
+
+Profiler::Profiler()
+    : pc_counts(0x10000), pc_cycles(0x10000), pc_opcodes(0x10000) {
+	reset();
+}
+
+bool Profiler::is_supported() {
+#ifdef TVP_PROFILER
+	return true;
+#else
+	return false;
+#endif
+}
+
+void Profiler::record(Address pc, OpCode opcode, bool prefixed,
+                      ClockCycles cycles, bool conditional, bool taken) {
+	if (!prefixed) {
+		opcode_counts[opcode]++;
+		opcode_cycles[opcode] += cycles;
+		pc_opcodes[pc] = opcode;
+	} else {
+		cb_opcode_counts[opcode]++;
+		cb_opcode_cycles[opcode] += cycles;
+		pc_opcodes[pc] = 0xCB00 | opcode;
+	}
+
+	if (conditional) {
+		if (taken) {
+			branches_taken[opcode]++;
+		} else {
+			branches_not_taken[opcode]++;
+		}
+	}
+
+	pc_counts[pc]++;
+	pc_cycles[pc] += cycles;
+}
+
+void Profiler::reset() {
+	opcode_counts.fill(0);
+	opcode_cycles.fill(0);
+	cb_opcode_counts.fill(0);
+	cb_opcode_cycles.fill(0);
+	branches_taken.fill(0);
+	branches_not_taken.fill(0);
+	std::fill(pc_counts.begin(), pc_counts.end(), 0);
+	std::fill(pc_cycles.begin(), pc_cycles.end(), 0);
+	std::fill(pc_opcodes.begin(), pc_opcodes.end(), 0);
+}
+
+std::vector<Address> Profiler::get_hotspots() const {
+	auto hotspots = std::vector<Address>();
+	for (uint32_t pc = 0; pc < pc_counts.size(); ++pc) {
+		if (pc_counts[pc]) {
+			hotspots.push_back(static_cast<Address>(pc));
+		}
+	}
+
+	std::stable_sort(hotspots.begin(), hotspots.end(),
+	                 [&](Address x, Address y) {
+		                 return pc_counts[x] > pc_counts[y];
+	                 });
+	return hotspots;
+}
+
+void Profiler::dump_csv(std::ostream &out) const {
+	out << "kind,key,mnemonic,count,cycles,taken,not_taken\n";
+
+	for (uint16_t op = 0; op < 256; ++op) {
+		if (opcode_counts[op]) {
+			out << "opcode," << num_to_hex(static_cast<uint8_t>(op)) << ",\""
+			    << get_mnemonic(op) << "\"," << opcode_counts[op] << ","
+			    << opcode_cycles[op] << ",,\n";
+		}
+	}
+
+	for (uint16_t op = 0; op < 256; ++op) {
+		if (cb_opcode_counts[op]) {
+			out << "cb_opcode," << num_to_hex(static_cast<uint8_t>(op))
+			    << ",\"" << get_cb_mnemonic(op) << "\","
+			    << cb_opcode_counts[op] << "," << cb_opcode_cycles[op]
+			    << ",,\n";
+		}
+	}
+
+	for (uint16_t op = 0; op < 256; ++op) {
+		if (branches_taken[op] || branches_not_taken[op]) {
+			out << "branch," << num_to_hex(static_cast<uint8_t>(op)) << ",\""
+			    << get_mnemonic(op) << "\","
+			    << branches_taken[op] + branches_not_taken[op] << ",,"
+			    << branches_taken[op] << "," << branches_not_taken[op]
+			    << "\n";
+		}
+	}
+
+	for (auto pc : get_hotspots()) {
+		out << "pc," << num_to_hex(pc) << ",\""
+		    << get_full_mnemonic(pc_opcodes[pc]) << "\"," << pc_counts[pc]
+		    << "," << pc_cycles[pc] << ",,\n";
+	}
+}
+
+void Profiler::dump_json(std::ostream &out) const {
+	auto total =
+	    std::accumulate(opcode_counts.begin(), opcode_counts.end(),
+	                    static_cast<uint64_t>(0)) +
+	    std::accumulate(cb_opcode_counts.begin(), cb_opcode_counts.end(),
+	                    static_cast<uint64_t>(0));
+	auto total_cycles =
+	    std::accumulate(opcode_cycles.begin(), opcode_cycles.end(),
+	                    static_cast<uint64_t>(0)) +
+	    std::accumulate(cb_opcode_cycles.begin(), cb_opcode_cycles.end(),
+	                    static_cast<uint64_t>(0));
+
+	out << "{\n";
+	out << "  \"instructions\": " << total << ",\n";
+	out << "  \"cycles\": " << total_cycles << ",\n";
+
+	// Writes one array of opcode counts
+	auto write_opcodes = [&](const char *name,
+	                         const std::array<uint64_t, 256> &counts,
+	                         const std::array<uint64_t, 256> &cycles,
+	                         std::string (*mnemonic)(uint8_t)) {
+		out << "  \"" << name << "\": [";
+		auto first = true;
+		for (uint16_t op = 0; op < 256; ++op) {
+			if (!counts[op]) {
+				continue;
+			}
+			out << (first ? "\n" : ",\n");
+			out << "    {\"opcode\": \"" << num_to_hex(static_cast<uint8_t>(op))
+			    << "\", \"mnemonic\": \"" << mnemonic(op)
+			    << "\", \"count\": " << counts[op]
+			    << ", \"cycles\": " << cycles[op] << "}";
+			first = false;
+		}
+		out << "\n  ],\n";
+	};
+
+	write_opcodes("opcodes", opcode_counts, opcode_cycles, get_mnemonic);
+	write_opcodes("cb_opcodes", cb_opcode_counts, cb_opcode_cycles,
+	              get_cb_mnemonic);
+
+	out << "  \"branches\": [";
+	auto first = true;
+	for (uint16_t op = 0; op < 256; ++op) {
+		auto taken = branches_taken[op];
+		auto not_taken = branches_not_taken[op];
+		if (!taken && !not_taken) {
+			continue;
+		}
+		out << (first ? "\n" : ",\n");
+		out << "    {\"opcode\": \"" << num_to_hex(static_cast<uint8_t>(op))
+		    << "\", \"mnemonic\": \"" << get_mnemonic(op)
+		    << "\", \"taken\": " << taken << ", \"not_taken\": " << not_taken
+		    << ", \"taken_ratio\": "
+		    << static_cast<double>(taken) / (taken + not_taken) << "}";
+		first = false;
+	}
+	out << "\n  ],\n";
+
+	out << "  \"hotspots\": [";
+	first = true;
+	for (auto pc : get_hotspots()) {
+		out << (first ? "\n" : ",\n");
+		out << "    {\"pc\": \"" << num_to_hex(pc) << "\", \"mnemonic\": \""
+		    << get_full_mnemonic(pc_opcodes[pc])
+		    << "\", \"count\": " << pc_counts[pc]
+		    << ", \"cycles\": " << pc_cycles[pc] << "}";
+		first = false;
+	}
+	out << "\n  ]\n";
+	out << "}\n";
+}
+
+} // namespace cpu
@@ -30,6 +30,8 @@ void Register::operator--() { _value--; }
 
 void Register::operator--(int) { _value--; }
 
+uint8_t *Register::get_storage() { return &_value; }
+
 // 16-bit Register
 DoubleRegister::DoubleRegister() : _value(static_cast<uint16_t>(0)) {}
 DoubleRegister::DoubleRegister(uint16_t value) : _value(value) {}
@@ -66,6 +68,8 @@ void DoubleRegister::operator--() { _value--; }
 
 void DoubleRegister::operator--(int) { _value--; }
 
+uint16_t *DoubleRegister::get_storage() { return &_value; }
+
 // PairRegister
 PairRegister::PairRegister(RegisterInterface *first, RegisterInterface *second)
     : _first(first), _second(second) {}
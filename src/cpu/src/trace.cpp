@@ -0,0 +1,221 @@
+/**
+ * @file trace.cpp
+ * Defines the TraceWriter class and the trace file helpers
+ */
+
+#include "cpu/trace.h"
+#include "util/disassembler.h"
+#include "util/helpers.h"
+#include "util/log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+namespace cpu {
+
+namespace {
+
+/**
+ * Header at the start of every trace file
+ */
+struct TraceHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t record_size;
+	uint64_t capacity;
+
+	/// Total number of records written, including overwritten ones
+	uint64_t count;
+};
+
+const char TRACE_MAGIC[8] = {'T', 'V', 'P', 'T', 'R', 'A', 'C', 'E'};
+
+} // namespace
+
+TraceWriter::TraceWriter(const std::string &path, uint64_t capacity)
+    : file(path, std::ios::in | std::ios::out | std::ios::binary |
+                     std::ios::trunc),
+      capacity(std::max<uint64_t>(capacity, 1)), count(0), cycles(0),
+      chunk(), mutex(), chunk_ready(), full_chunks(), free_chunks(),
+      stopping(false) {
+	if (!file) {
+		Log::error("Could not open trace file " + path);
+		return;
+	}
+
+	chunk.reserve(CHUNK_RECORDS);
+	write_header(0);
+	writer_thread = std::thread(&TraceWriter::run_writer, this);
+}
+
+TraceWriter::~TraceWriter() {
+	if (!writer_thread.joinable()) {
+		return;
+	}
+
+	flush_chunk();
+	{
+		auto lock = std::lock_guard<std::mutex>(mutex);
+		stopping = true;
+	}
+	chunk_ready.notify_one();
+	writer_thread.join();
+}
+
+bool TraceWriter::is_open() const { return writer_thread.joinable(); }
+
+uint64_t TraceWriter::get_count() const { return count + chunk.size(); }
+
+void TraceWriter::flush_chunk() {
+	if (chunk.empty()) {
+		return;
+	}
+
+	count += chunk.size();
+	auto next = std::vector<TraceRecord>();
+	{
+		auto lock = std::lock_guard<std::mutex>(mutex);
+		full_chunks.push_back(std::move(chunk));
+		if (!free_chunks.empty()) {
+			next = std::move(free_chunks.back());
+			free_chunks.pop_back();
+		}
+	}
+	chunk_ready.notify_one();
+
+	chunk = std::move(next);
+	chunk.clear();
+	chunk.reserve(CHUNK_RECORDS);
+}
+
+void TraceWriter::run_writer() {
+	uint64_t written = 0;
+	auto lock = std::unique_lock<std::mutex>(mutex);
+	while (true) {
+		chunk_ready.wait(lock,
+		                 [this] { return stopping || !full_chunks.empty(); });
+		if (full_chunks.empty()) {
+			break;
+		}
+
+		auto records = std::move(full_chunks.front());
+		full_chunks.erase(full_chunks.begin());
+
+		// Write without holding the lock, so the emulator never waits on disk
+		lock.unlock();
+		write_records(written, records);
+		written += records.size();
+		write_header(written);
+		lock.lock();
+
+		free_chunks.push_back(std::move(records));
+	}
+}
+
+void TraceWriter::write_records(uint64_t index,
+                                const std::vector<TraceRecord> &records) {
+	auto offset = size_t{0};
+	while (offset < records.size()) {
+		// Write up to the end of the ring, then wrap around to the start
+		auto slot = (index + offset) % capacity;
+		auto length = std::min<uint64_t>(records.size() - offset,
+		                                 capacity - slot);
+		file.seekp(sizeof(TraceHeader) + slot * sizeof(TraceRecord));
+		file.write(reinterpret_cast<const char *>(&records[offset]),
+		           length * sizeof(TraceRecord));
+		offset += length;
+	}
+}
+
+void TraceWriter::write_header(uint64_t written) {
+	auto header = TraceHeader{};
+	std::memcpy(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+	header.version = TRACE_VERSION;
+	header.record_size = sizeof(TraceRecord);
+	header.capacity = capacity;
+	header.count = written;
+
+	file.seekp(0);
+	file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	file.flush();
+}
+
+bool read_trace(const std::string &path, Trace *trace) {
+	auto file = std::ifstream(path, std::ios::binary);
+	if (!file) {
+		Log::error("Could not open trace file " + path);
+		return false;
+	}
+
+	auto header = TraceHeader{};
+	file.read(reinterpret_cast<char *>(&header), sizeof(header));
+	if (!file || std::memcmp(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) ||
+	    header.version != TRACE_VERSION ||
+	    header.record_size != sizeof(TraceRecord) || header.capacity == 0) {
+		Log::error("Not a trace file: " + path);
+		return false;
+	}
+
+	// Once the ring has wrapped, the oldest record is the next one that would
+	// have been overwritten
+	auto size = std::min(header.count, header.capacity);
+	auto ring = std::vector<TraceRecord>(size);
+	file.read(reinterpret_cast<char *>(ring.data()),
+	          size * sizeof(TraceRecord));
+	if (!file) {
+		Log::error("Trace file is truncated: " + path);
+		return false;
+	}
+
+	trace->first = header.count - size;
+	auto oldest = trace->first % header.capacity;
+	trace->records.clear();
+	trace->records.reserve(size);
+	trace->records.insert(trace->records.end(), ring.begin() + oldest,
+	                      ring.end());
+	trace->records.insert(trace->records.end(), ring.begin(),
+	                      ring.begin() + oldest);
+	return true;
+}
+
+std::optional<uint64_t> find_divergence(const Trace &a, const Trace &b) {
+	auto start = std::max(a.first, b.first);
+	auto end = std::min(a.first + a.records.size(), b.first + b.records.size());
+	for (auto index = start; index < end; ++index) {
+		if (a.records[index - a.first] != b.records[index - b.first]) {
+			return index;
+		}
+	}
+
+	if (a.first + a.records.size() != b.first + b.records.size()) {
+		return end;
+	}
+	return std::nullopt;
+}
+
+std::string format_trace_record(const TraceRecord &record,
+                                const std::vector<uint8_t> *rom) {
+	auto mnemonic = record.prefixed ? get_cb_mnemonic(record.opcode)
+	                                : get_mnemonic(record.opcode);
+
+	// Use the ROM for operands, unless another bank or the boot ROM was
+	// mapped in, and the opcode there differs
+	if (rom && record.pc < 0x8000 && record.pc < rom->size()) {
+		auto inst = disassemble_instruction(&(*rom)[record.pc],
+		                                    rom->size() - record.pc, record.pc);
+		if (inst.opcode == record.opcode &&
+		    inst.prefixed == static_cast<bool>(record.prefixed)) {
+			mnemonic = inst.text;
+		}
+	}
+
+	auto out = std::stringstream();
+	out << num_to_hex(record.pc) << "  " << mnemonic << "  af="
+	    << num_to_hex(record.af) << " bc=" << num_to_hex(record.bc)
+	    << " de=" << num_to_hex(record.de) << " hl=" << num_to_hex(record.hl)
+	    << " sp=" << num_to_hex(record.sp) << " cycles=" << record.cycles;
+	return out.str();
+}
+
+} // namespace cpu
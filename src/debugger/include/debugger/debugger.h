@@ -8,12 +8,16 @@
 #include "cartridge/cartridge.h"
 #include "cpu/cpu.h"
 #include "cpu/utils.h"
+#include "debugger/disassembly_loader.h"
 #include "gameboy/gameboy.h"
 #include "gpu/gpu.h"
 #include "memory/memory.h"
 #include "memory/utils.h"
 
+#include <array>
 #include <cstdint>
+#include <iostream>
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -27,9 +31,96 @@ using namespace cartridge;
 namespace debugger {
 
 /**
- * Define the debugger class, for breakpoint debugging the CPU and Memory
+ * A comparison that must hold for a breakpoint or watchpoint to stop, like
+ * "A == $10", "HL >= $C000", "[$C000] != 0" or "value == 3". An empty
+ * condition always holds.
  */
-class Debugger {
+struct Condition {
+	/**
+	 * What the left hand side of the comparison reads
+	 * REGISTER -> An 8 or 16-bit register
+	 * MEMORY   -> A byte of memory
+	 * VALUE    -> The byte read or written by a watched access
+	 */
+	enum class Source { NONE, REGISTER, MEMORY, VALUE };
+
+	enum class Compare { EQUAL, NOT_EQUAL, LESS, LESS_EQUAL, GREATER,
+	                     GREATER_EQUAL };
+
+	Source source;
+
+	/// Name of the register, for REGISTER
+	std::string name;
+
+	/// Address read, for MEMORY
+	Address address;
+
+	Compare compare;
+	uint16_t value;
+
+	/**
+	 * Parse a condition from text
+	 *
+	 * @return false if the text is not a valid condition
+	 */
+	static bool parse(const std::string &text, Condition *condition);
+};
+
+/**
+ * Stops execution before the instruction at an address runs
+ */
+struct Breakpoint {
+	Address address;
+	Condition condition;
+};
+
+/**
+ * Stops execution after an instruction reads or writes a range of addresses
+ */
+struct Watchpoint {
+	Address start, end;
+
+	/// Accesses to stop on, as memory::WatchFlags
+	uint8_t flags;
+
+	Condition condition;
+};
+
+/**
+ * Why the debugger stopped
+ * NONE       -> Still running
+ * STEP       -> A single step finished
+ * BREAKPOINT -> The PC reached a breakpoint
+ * WATCHPOINT -> A watched address was read or written
+ */
+enum class StopReason { NONE, STEP, BREAKPOINT, WATCHPOINT };
+
+/**
+ * Details of the last stop
+ */
+struct StopInfo {
+	StopReason reason;
+
+	/// PC when execution stopped
+	Address pc;
+
+	/// Address and byte of the watched access, for WATCHPOINT
+	Address address;
+	uint8_t value;
+	bool write;
+};
+
+/**
+ * Define the debugger class, for breakpoint debugging the CPU and Memory.
+ *
+ * Breakpoints and watchpoints are found through one byte per 256 byte page,
+ * so addresses on pages without any cost a single load to check. Only an
+ * attached debugger hands the watched pages to Memory, so regular runs don't
+ * check them at all. The CPU runs in the interpreter while attached, since
+ * cached blocks and fused instructions skip over addresses. Interrupts are
+ * dispatched in steps of their own, so the vectors can be stopped on.
+ */
+class Debugger : public WatchHandler {
 	/**
 	 * Ticks for this object
 	 */
@@ -43,7 +134,7 @@ class Debugger {
 	/**
 	 * Pointer to CPU instance inside gameboy
 	 */
-	CPU *cpu;
+	gameboy::GameboyCPU *cpu;
 
 	/**
 	 * Pointer to memory instance inside gameboy
@@ -53,23 +144,164 @@ class Debugger {
 	/**
 	 * Pointer to GPU instance inside gameboy
 	 */
-	GPU *gpu;
+	gameboy::GameboyGPU *gpu;
 
 	/**
 	 * Pointer to Cartridge instance inside gameboy
 	 */
 	Cartridge *cartridge;
 
+	/**
+	 * Disassembly of the whole ROM
+	 */
+	DisassemblyLoader disassembly;
+
+	/**
+	 * Breakpoints by address, and the number of breakpoints on every page.
+	 * A page can hold PAGE_SIZE of them, which doesn't fit in a byte.
+	 */
+	std::map<Address, Breakpoint> breakpoints;
+	std::array<uint16_t, PAGE_COUNT> breakpoint_pages;
+
+	/**
+	 * Watchpoints, and the union of their flags on every page
+	 */
+	std::vector<Watchpoint> watchpoints;
+	WatchPages watch_pages;
+
+	/**
+	 * Details of the last stop
+	 */
+	StopInfo stop;
+
+	/**
+	 * Whether the interactive loop is waiting for a command
+	 */
+	bool paused;
+
+	/**
+	 * Set while a condition reads memory, so that the read is not watched
+	 */
+	bool evaluating;
+
+	/**
+	 * Set to run the instruction at a breakpoint, when resuming from it
+	 */
+	bool skip_breakpoint;
+
+	/**
+	 * Recalculate the watch flags of every page
+	 */
+	void update_watch_pages();
+
+	/**
+	 * Check if the condition holds now
+	 *
+	 * @param value Byte read or written, for watchpoint conditions
+	 */
+	bool check(const Condition &condition, uint8_t value);
+
+	/**
+	 * Read and run one command from the input
+	 */
+	void run_command(std::istream &in, std::ostream &out);
+
+	/**
+	 * Print the reason for the last stop, and the next instruction
+	 */
+	void print_stop(std::ostream &out);
+
+	/**
+	 * Print the registers and CPU flags
+	 */
+	void print_registers(std::ostream &out);
+
+	/**
+	 * Print instructions from the given address onwards
+	 */
+	void print_disassembly(std::ostream &out, Address address, size_t count);
+
   public:
 	/**
-	 * Debugger constructor
+	 * Debugger constructor. The debugger starts out paused.
 	 */
 	Debugger(std::unique_ptr<gameboy::Gameboy> gameboy);
 
 	/**
-	 * Run debugger iteration
+	 * Detach from the gameboy's memory
+	 */
+	~Debugger();
+
+	/**
+	 * Run debugger iteration. While paused, this reads and runs one command
+	 * from standard input. Otherwise, it runs until a stop or for a while.
 	 */
 	void tick();
+
+	/**
+	 * Add a breakpoint, replacing any at the same address
+	 *
+	 * @param address Address of the instruction to stop at
+	 * @param condition Condition to stop on, empty to always stop
+	 * @return false if the condition is not valid
+	 */
+	bool add_breakpoint(Address address, const std::string &condition = "");
+
+	/**
+	 * Remove the breakpoint at an address
+	 *
+	 * @return false if there is no breakpoint there
+	 */
+	bool remove_breakpoint(Address address);
+
+	/**
+	 * Add a watchpoint over a range of addresses
+	 *
+	 * @param start First address watched
+	 * @param end Last address watched
+	 * @param flags Accesses to stop on, as memory::WatchFlags
+	 * @param condition Condition to stop on, empty to always stop
+	 * @return false if the condition is not valid
+	 */
+	bool add_watchpoint(Address start, Address end, uint8_t flags,
+	                    const std::string &condition = "");
+
+	/**
+	 * Remove every watchpoint that starts at an address
+	 *
+	 * @return false if there is no watchpoint there
+	 */
+	bool remove_watchpoint(Address start);
+
+	/**
+	 * Run a single instruction, unless a breakpoint stops it first
+	 *
+	 * @return Why execution stopped, STEP if nothing else did
+	 */
+	StopReason step();
+
+	/**
+	 * Run until a breakpoint or watchpoint stops execution
+	 *
+	 * @param max_ticks Give up after this many ticks
+	 * @return Why execution stopped, NONE if it did not
+	 */
+	StopReason run(uint64_t max_ticks);
+
+	/**
+	 * Get details of the last stop
+	 */
+	const StopInfo &get_stop() const;
+
+	/**
+	 * Get the debugged gameboy
+	 */
+	gameboy::Gameboy *get_gameboy();
+
+	/**
+	 * @see WatchHandler#on_watch
+	 */
+	void on_watch(Address address, uint8_t data, bool write) override;
 };
 
 } // namespace debugger
@@ -1,24 +1,50 @@
 /**
- * @file disasembly_loader.h
+ * @file disassembly_loader.h
+ * Declares the DisassemblyLoader class
  */
 
 #pragma once
 
+#include "util/disassembler.h"
+
 #include <cstdint>
 #include <vector>
 
 namespace debugger {
 
 /**
- * This class uses a the MGBDIS disassembler script, invoked through
- * the Python system library
+ * Holds the disassembly of a whole ROM, for looking up the instruction at an
+ * address while debugging
  */
 class DisassemblyLoader {
   private:
+	/**
+	 * Instructions of every bank, in address order
+	 */
+	std::vector<BankDisassembly> banks;
+
   public:
 	DisassemblyLoader();
 
-	void disassemble(std::vector<uint8_t> data);
+	/**
+	 * Disassemble every bank of the given ROM, replacing the previous
+	 * disassembly. Banks are decoded in parallel.
+	 */
+	void disassemble(const std::vector<uint8_t> &data);
+
+	/**
+	 * Find the instruction that starts at the given address
+	 *
+	 * @param bank ROM bank mapped at $4000-$7FFF. Ignored for $0000-$3FFF.
+	 * @param address Address of the instruction
+	 * @return The instruction, or nullptr if none starts there
+	 */
+	const DisassembledInstruction *find(size_t bank, uint16_t address) const;
+
+	/**
+	 * Get the instructions of every bank
+	 */
+	const std::vector<BankDisassembly> &get_banks() const;
 };
 
-} // namespace debugger
\ No newline at end of file
+} // namespace debugger
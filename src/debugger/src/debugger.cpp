@@ -5,23 +5,490 @@
 
 #include "debugger/debugger.h"
 #include "gameboy/gameboy.h"
+#include "util/disassembler.h"
+#include "util/helpers.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
 
 namespace debugger {
 
+namespace {
+
+/**
+ * Number of ticks tick() runs for between checks for a stop, while running
+ */
+const uint64_t RUN_TICKS = 10000;
+
+/**
+ * Parse a number as $hex, 0xhex or decimal
+ *
+ * @return false if the text is not a number that fits in 16 bits
+ */
+bool parse_number(const std::string &text, uint16_t *value) {
+	auto digits = text;
+	auto base = 10;
+	if (!digits.empty() && digits[0] == '$') {
+		digits = digits.substr(1);
+		base = 16;
+	} else if (digits.size() > 2 && digits[0] == '0' &&
+	           (digits[1] == 'x' || digits[1] == 'X')) {
+		digits = digits.substr(2);
+		base = 16;
+	}
+
+	if (digits.empty()) {
+		return false;
+	}
+
+	char *end = nullptr;
+	auto number = std::strtoul(digits.c_str(), &end, base);
+	if (*end != '\0' || number > 0xFFFF) {
+		return false;
+	}
+	*value = static_cast<uint16_t>(number);
+	return true;
+}
+
+/**
+ * Get a register by name from a snapshot
+ *
+ * @return false if there is no register with that name
+ */
+bool get_register(const RegisterState &state, const std::string &name,
+                  uint16_t *value) {
+	// clang-format off
+	const std::map<std::string, uint16_t> registers = {
+	    {"A", state.af >> 8}, {"F", state.af & 0xFF},
+	    {"B", state.bc >> 8}, {"C", state.bc & 0xFF},
+	    {"D", state.de >> 8}, {"E", state.de & 0xFF},
+	    {"H", state.hl >> 8}, {"L", state.hl & 0xFF},
+	    {"AF", state.af}, {"BC", state.bc}, {"DE", state.de},
+	    {"HL", state.hl}, {"SP", state.sp}, {"PC", state.pc},
+	};
+	// clang-format on
+
+	auto it = registers.find(name);
+	if (it == registers.end()) {
+		return false;
+	}
+	*value = it->second;
+	return true;
+}
+
+} // namespace
+
+bool Condition::parse(const std::string &text, Condition *condition) {
+	*condition = Condition{};
+	condition->source = Source::NONE;
+
+	auto in = std::istringstream(text);
+	auto lhs = std::string();
+	auto op = std::string();
+	auto rhs = std::string();
+	auto extra = std::string();
+	if (!(in >> lhs)) {
+		// Nothing but whitespace, so the condition always holds
+		return true;
+	}
+	if (!(in >> op >> rhs) || (in >> extra)) {
+		return false;
+	}
+
+	std::transform(lhs.begin(), lhs.end(), lhs.begin(), ::toupper);
+	auto state = RegisterState{};
+	uint16_t unused;
+	if (lhs == "VALUE") {
+		condition->source = Source::VALUE;
+	} else if (lhs.size() > 2 && lhs.front() == '[' && lhs.back() == ']') {
+		condition->source = Source::MEMORY;
+		if (!parse_number(lhs.substr(1, lhs.size() - 2),
+		                  &condition->address)) {
+			return false;
+		}
+	} else if (get_register(state, lhs, &unused)) {
+		condition->source = Source::REGISTER;
+		condition->name = lhs;
+	} else {
+		return false;
+	}
+
+	const std::map<std::string, Compare> compares = {
+	    {"==", Compare::EQUAL},      {"!=", Compare::NOT_EQUAL},
+	    {"<", Compare::LESS},        {"<=", Compare::LESS_EQUAL},
+	    {">", Compare::GREATER},     {">=", Compare::GREATER_EQUAL},
+	};
+	auto it = compares.find(op);
+	if (it == compares.end()) {
+		return false;
+	}
+	condition->compare = it->second;
+
+	return parse_number(rhs, &condition->value);
+}
+
 Debugger::Debugger(std::unique_ptr<gameboy::Gameboy> gameboy)
-    : gameboy(std::move(gameboy)) {
+    : ticks(0), gameboy(std::move(gameboy)), breakpoints(),
+      breakpoint_pages(), watchpoints(), watch_pages(), stop(), paused(true),
+      evaluating(false), skip_breakpoint(false) {
+	cpu = this->gameboy->cpu.get();
+	memory = this->gameboy->memory.get();
+	gpu = this->gameboy->gpu.get();
+	cartridge = this->gameboy->cartridge.get();
 
-	// TODO
-	cpu = nullptr;
-	gpu = nullptr;
-	cartridge = nullptr;
+	// Cached blocks and fused instructions run past breakpoints, and so
+	// would a handler's first instruction run along with its interrupt
+	cpu->set_execution_mode(ExecutionMode::INTERPRETER);
+	cpu->set_superinstructions_enabled(false);
+	cpu->set_dispatch_alone(true);
+
+	memory->set_watch(&watch_pages, this);
+	disassembly.disassemble(*cartridge->get_state().data);
+}
+
+Debugger::~Debugger() {
+	memory->set_watch(nullptr, nullptr);
+	cpu->set_dispatch_alone(false);
 }
 
 void Debugger::tick() {
-	ticks++;
-	// TODO: Do debug stuff here
+	if (paused) {
+		std::cout << "(tvp) " << std::flush;
+		run_command(std::cin, std::cout);
+		return;
+	}
+
+	if (run(RUN_TICKS) != StopReason::NONE) {
+		paused = true;
+		print_stop(std::cout);
+	}
+}
+
+bool Debugger::add_breakpoint(Address address, const std::string &condition) {
+	auto breakpoint = Breakpoint{};
+	breakpoint.address = address;
+	if (!Condition::parse(condition, &breakpoint.condition)) {
+		return false;
+	}
+
+	if (!breakpoints.count(address)) {
+		breakpoint_pages[address / PAGE_SIZE]++;
+	}
+	breakpoints[address] = breakpoint;
+	return true;
+}
+
+bool Debugger::remove_breakpoint(Address address) {
+	if (!breakpoints.erase(address)) {
+		return false;
+	}
+	breakpoint_pages[address / PAGE_SIZE]--;
+	return true;
+}
+
+bool Debugger::add_watchpoint(Address start, Address end, uint8_t flags,
+                              const std::string &condition) {
+	auto watchpoint = Watchpoint{};
+	watchpoint.start = std::min(start, end);
+	watchpoint.end = std::max(start, end);
+	watchpoint.flags = flags & (WATCH_READ | WATCH_WRITE);
+	if (!watchpoint.flags ||
+	    !Condition::parse(condition, &watchpoint.condition)) {
+		return false;
+	}
+
+	watchpoints.push_back(watchpoint);
+	update_watch_pages();
+	return true;
+}
+
+bool Debugger::remove_watchpoint(Address start) {
+	auto size = watchpoints.size();
+	watchpoints.erase(std::remove_if(watchpoints.begin(), watchpoints.end(),
+	                                 [start](const Watchpoint &watchpoint) {
+		                                 return watchpoint.start == start;
+	                                 }),
+	                  watchpoints.end());
+	update_watch_pages();
+	return watchpoints.size() != size;
+}
+
+void Debugger::update_watch_pages() {
+	watch_pages.fill(0);
+	for (auto &watchpoint : watchpoints) {
+		for (auto page = watchpoint.start / PAGE_SIZE;
+		     page <= watchpoint.end / PAGE_SIZE; ++page) {
+			watch_pages[page] |= watchpoint.flags;
+		}
+	}
+}
 
+StopReason Debugger::step() {
+	stop = StopInfo{};
+	auto pc = cpu->pc->get();
+
+	// A halted CPU stays on the same PC, and doesn't run the instruction there
+	if (breakpoint_pages[pc / PAGE_SIZE] && !skip_breakpoint &&
+	    !cpu->halted) {
+		auto it = breakpoints.find(pc);
+		if (it != breakpoints.end() && check(it->second.condition, 0)) {
+			stop.reason = StopReason::BREAKPOINT;
+			stop.pc = pc;
+
+			// Resuming runs the instruction, instead of stopping again
+			skip_breakpoint = true;
+			return stop.reason;
+		}
+	}
+	skip_breakpoint = false;
+
+	ticks++;
 	gameboy->tick();
+
+	// A watched access fills in the stop while the instruction runs
+	if (stop.reason == StopReason::NONE) {
+		stop.reason = StopReason::STEP;
+	}
+	stop.pc = cpu->pc->get();
+	return stop.reason;
+}
+
+StopReason Debugger::run(uint64_t max_ticks) {
+	for (uint64_t i = 0; i < max_ticks; ++i) {
+		auto reason = step();
+		if (reason != StopReason::STEP) {
+			return reason;
+		}
+	}
+
+	stop = StopInfo{};
+	return StopReason::NONE;
+}
+
+const StopInfo &Debugger::get_stop() const { return stop; }
+
+gameboy::Gameboy *Debugger::get_gameboy() { return gameboy.get(); }
+
+void Debugger::on_watch(Address address, uint8_t data, bool write) {
+	if (evaluating || stop.reason == StopReason::WATCHPOINT) {
+		return;
+	}
+
+	auto flag = write ? WATCH_WRITE : WATCH_READ;
+	for (auto &watchpoint : watchpoints) {
+		if (address >= watchpoint.start && address <= watchpoint.end &&
+		    (watchpoint.flags & flag) && check(watchpoint.condition, data)) {
+			stop.reason = StopReason::WATCHPOINT;
+			stop.address = address;
+			stop.value = data;
+			stop.write = write;
+			return;
+		}
+	}
+}
+
+bool Debugger::check(const Condition &condition, uint8_t value) {
+	uint16_t lhs = 0;
+	switch (condition.source) {
+	case Condition::Source::NONE:
+		return true;
+	case Condition::Source::REGISTER:
+		get_register(cpu->get_register_state(), condition.name, &lhs);
+		break;
+	case Condition::Source::MEMORY:
+		evaluating = true;
+		lhs = memory->read(condition.address);
+		evaluating = false;
+		break;
+	case Condition::Source::VALUE:
+		lhs = value;
+		break;
+	}
+
+	switch (condition.compare) {
+	case Condition::Compare::EQUAL:
+		return lhs == condition.value;
+	case Condition::Compare::NOT_EQUAL:
+		return lhs != condition.value;
+	case Condition::Compare::LESS:
+		return lhs < condition.value;
+	case Condition::Compare::LESS_EQUAL:
+		return lhs <= condition.value;
+	case Condition::Compare::GREATER:
+		return lhs > condition.value;
+	case Condition::Compare::GREATER_EQUAL:
+		return lhs >= condition.value;
+	}
+	return false;
+}
+
+void Debugger::run_command(std::istream &in, std::ostream &out) {
+	auto line = std::string();
+	if (!std::getline(in, line)) {
+		// No more input, so there is nobody left to debug for
+		std::exit(0);
+	}
+
+	auto args = std::istringstream(line);
+	auto command = std::string();
+	args >> command;
+
+	// The rest of the line, for conditions
+	auto rest = [&args]() {
+		auto text = std::string();
+		std::getline(args, text);
+		return text;
+	};
+
+	auto arg = std::string();
+	uint16_t address = 0;
+	uint16_t end = 0;
+	if (command.empty()) {
+		return;
+	} else if (command == "c") {
+		paused = false;
+	} else if (command == "s") {
+		uint16_t count = 1;
+		if (args >> arg && !parse_number(arg, &count)) {
+			out << "Bad step count " << arg << "\n";
+			return;
+		}
+		for (uint16_t i = 0; i < count; ++i) {
+			if (step() != StopReason::STEP) {
+				break;
+			}
+		}
+		print_stop(out);
+	} else if (command == "b") {
+		if (!(args >> arg) || !parse_number(arg, &address) ||
+		    !add_breakpoint(address, rest())) {
+			out << "Usage: b <address> [condition]\n";
+		}
+	} else if (command == "w") {
+		auto kind = std::string();
+		if (!(args >> arg) || !parse_number(arg, &address) ||
+		    !(args >> kind)) {
+			out << "Usage: w <start> [end] <r|w|rw> [condition]\n";
+			return;
+		}
+
+		// The end address is optional
+		end = address;
+		if (parse_number(kind, &end) && !(args >> kind)) {
+			kind.clear();
+		}
+
+		uint8_t flags = 0;
+		flags |= kind.find('r') != std::string::npos ? WATCH_READ : 0;
+		flags |= kind.find('w') != std::string::npos ? WATCH_WRITE : 0;
+		if (!add_watchpoint(address, end, flags, rest())) {
+			out << "Usage: w <start> [end] <r|w|rw> [condition]\n";
+		}
+	} else if (command == "d" || command == "dw") {
+		if (!(args >> arg) || !parse_number(arg, &address)) {
+			out << "Usage: " << command << " <address>\n";
+		} else if (command == "d" ? !remove_breakpoint(address)
+		                          : !remove_watchpoint(address)) {
+			out << "Nothing at " << num_to_hex(address) << "\n";
+		}
+	} else if (command == "r") {
+		print_registers(out);
+	} else if (command == "x") {
+		uint16_t count = 16;
+		if (!(args >> arg) || !parse_number(arg, &address) ||
+		    (args >> arg && !parse_number(arg, &count))) {
+			out << "Usage: x <address> [count]\n";
+			return;
+		}
+		evaluating = true;
+		for (uint32_t i = 0; i < count; ++i) {
+			auto addr = static_cast<Address>(address + i);
+			if (i % 16 == 0) {
+				out << (i ? "\n" : "") << num_to_hex(addr) << ":";
+			}
+			out << " " << num_to_hex(memory->read(addr)).substr(2);
+		}
+		evaluating = false;
+		out << "\n";
+	} else if (command == "l") {
+		address = cpu->pc->get();
+		if (args >> arg && !parse_number(arg, &address)) {
+			out << "Usage: l [address]\n";
+			return;
+		}
+		print_disassembly(out, address, 10);
+	} else if (command == "q") {
+		std::exit(0);
+	} else {
+		out << "Commands:\n"
+		    << "  c                           continue\n"
+		    << "  s [count]                   step instructions\n"
+		    << "  b <address> [condition]     add a breakpoint\n"
+		    << "  w <start> [end] <r|w|rw> [condition]\n"
+		    << "                              add a watchpoint\n"
+		    << "  d <address>                 delete a breakpoint\n"
+		    << "  dw <start>                  delete a watchpoint\n"
+		    << "  r                           show registers\n"
+		    << "  x <address> [count]         show memory\n"
+		    << "  l [address]                 list instructions\n"
+		    << "  q                           quit\n"
+		    << "Conditions compare a register, [address] or the watched "
+		       "value, like \"A == $10\"\n";
+	}
+}
+
+void Debugger::print_stop(std::ostream &out) {
+	switch (stop.reason) {
+	case StopReason::BREAKPOINT:
+		out << "Breakpoint at " << num_to_hex(stop.pc) << "\n";
+		break;
+	case StopReason::WATCHPOINT:
+		out << "Watchpoint: " << (stop.write ? "wrote " : "read ")
+		    << num_to_hex(stop.value) << (stop.write ? " to " : " from ")
+		    << num_to_hex(stop.address) << "\n";
+		break;
+	default:
+		break;
+	}
+	print_disassembly(out, cpu->pc->get(), 1);
+}
+
+void Debugger::print_registers(std::ostream &out) {
+	auto state = cpu->get_register_state();
+	out << "AF=" << num_to_hex(state.af) << " BC=" << num_to_hex(state.bc)
+	    << " DE=" << num_to_hex(state.de) << " HL=" << num_to_hex(state.hl)
+	    << " SP=" << num_to_hex(state.sp) << " PC=" << num_to_hex(state.pc)
+	    << (state.halted ? " halted" : "")
+	    << (state.interrupt_enabled ? " IME" : "") << "\n";
+}
+
+void Debugger::print_disassembly(std::ostream &out, Address address,
+                                 size_t count) {
+	// The boot ROM is mapped over the start of the cartridge until $FF50 is
+	// written
+	auto boot_mapped = memory->get_io()->get(io::BOOT) != 0x1;
+
+	evaluating = true;
+	for (size_t i = 0; i < count; ++i) {
+		auto inst = DisassembledInstruction{};
+		auto cached = disassembly.find(1, address);
+		if (cached && !(boot_mapped && address < 0x0100)) {
+			inst = *cached;
+		} else {
+			uint8_t bytes[3];
+			for (auto j = 0; j < 3; ++j) {
+				bytes[j] = memory->read(static_cast<Address>(address + j));
+			}
+			inst = disassemble_instruction(bytes, sizeof(bytes), address);
+		}
+
+		out << (address == cpu->pc->get() ? "> " : "  ")
+		    << num_to_hex(address) << "  " << inst.text << "\n";
+		address = static_cast<Address>(address + inst.length);
+	}
+	evaluating = false;
 }
 
 } // namespace debugger
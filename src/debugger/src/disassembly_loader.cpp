@@ -0,0 +1,46 @@
+/**
+ * @file disassembly_loader.cpp
+ * Defines the DisassemblyLoader class
+ */
+
+#include "debugger/disassembly_loader.h"
+
+#include <algorithm>
+
+namespace debugger {
+
+DisassemblyLoader::DisassemblyLoader() : banks() {}
+
+void DisassemblyLoader::disassemble(const std::vector<uint8_t> &data) {
+	banks = disassemble_rom(data);
+}
+
+const DisassembledInstruction *DisassemblyLoader::find(size_t bank,
+                                                       uint16_t address) const {
+	if (address >= 0x8000) {
+		return nullptr;
+	}
+
+	bank = address < 0x4000 ? 0 : bank;
+	if (bank >= banks.size()) {
+		return nullptr;
+	}
+
+	auto &instructions = banks[bank].instructions;
+	auto it = std::lower_bound(instructions.begin(), instructions.end(),
+	                           address,
+	                           [](const DisassembledInstruction &inst,
+	                              uint16_t address) {
+		                           return inst.address < address;
+	                           });
+	if (it == instructions.end() || it->address != address) {
+		return nullptr;
+	}
+	return &*it;
+}
+
+const std::vector<BankDisassembly> &DisassemblyLoader::get_banks() const {
+	return banks;
+}
+
+} // namespace debugger
@@ -0,0 +1,91 @@
+/**
+ * @file batch.h
+ * Declares the Batch class, for running many headless Gameboys at once
+ */
+
+#pragma once
+
+#include "cpu/utils.h"
+#include "gameboy/gameboy.h"
+#include "gpu/utils.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace gameboy {
+
+/**
+ * Totals for a complete batch run
+ */
+struct BatchResult {
+	/// Number of instances run
+	uint64_t instances;
+
+	/// Number of frames emulated, over all instances
+	uint64_t frames;
+
+	/// Wall clock time for the whole batch
+	double seconds;
+
+	/// Number of threads used
+	size_t threads;
+
+	/**
+	 * Get the aggregate frames per second over all instances
+	 */
+	double get_fps() const { return seconds > 0 ? frames / seconds : 0; }
+};
+
+/**
+ * Called on the worker thread with each instance once it finishes its frames,
+ * before it is destroyed
+ */
+using BatchCallback = std::function<void(uint64_t index, Gameboy &gameboy)>;
+
+/**
+ * Runs many independent headless instances of one ROM in a single process,
+ * spread over a ThreadPool. All instances share one copy of the ROM data.
+ */
+class Batch {
+  private:
+	/**
+	 * ROM data shared by every instance
+	 */
+	std::shared_ptr<std::vector<uint8_t>> rom_data;
+
+	/**
+	 * CPU execution mode of every instance
+	 */
+	cpu::ExecutionMode mode;
+
+	/**
+	 * GPU render mode of every instance
+	 */
+	gpu::RenderMode render_mode;
+
+  public:
+	/**
+	 * @param rom_data Complete contents of the ROM
+	 * @param mode CPU execution mode of every instance
+	 * @param render_mode GPU render mode of every instance
+	 */
+	Batch(std::shared_ptr<std::vector<uint8_t>> rom_data,
+	      cpu::ExecutionMode mode = cpu::ExecutionMode::INTERPRETER,
+	      gpu::RenderMode render_mode = gpu::RenderMode::SCANLINE);
+
+	/**
+	 * Run each instance from power on for the given number of frames. Blocks
+	 * until all instances have finished.
+	 *
+	 * @param instances Number of instances to run
+	 * @param frames Number of frames to run each instance for
+	 * @param thread_count Number of threads to use. 0 uses one per core.
+	 * @param callback Called with each instance once it finishes, if given
+	 */
+	BatchResult run(uint64_t instances, uint64_t frames,
+	                size_t thread_count = 0, BatchCallback callback = nullptr);
+};
+
+} // namespace gameboy
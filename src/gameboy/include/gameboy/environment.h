@@ -0,0 +1,128 @@
+/**
+ * @file environment.h
+ * Declares the Environment class, a reset/step/observe interface to a
+ * headless Gameboy for training code
+ */
+
+#pragma once
+
+#include "cpu/utils.h"
+#include "gameboy/gameboy.h"
+#include "gpu/utils.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace gameboy {
+
+/**
+ * What an Environment exposes after every step. The pointers stay valid for
+ * the lifetime of the Environment, and their contents are updated in place by
+ * every call to step or reset.
+ */
+struct Observation {
+	/// Current contents of the screen, one shade (0-3) per pixel, row major
+	const gpu::VideoBuffer *screen;
+
+	/// Values of the watched RAM addresses, in the order they were given
+	const uint8_t *ram;
+
+	/// Number of watched RAM addresses
+	size_t ram_size;
+
+	/// Number of frames emulated since startup
+	uint64_t frame;
+};
+
+/**
+ * Runs one headless Gameboy in fixed steps of whole frames, for driving it
+ * from training code. Every step holds the given buttons for the given number
+ * of frames. reset() restores a saved snapshot rather than rebooting, so it
+ * costs a copy of the emulated state.
+ */
+class Environment {
+  private:
+	/**
+	 * Gameboy being driven
+	 */
+	std::unique_ptr<Gameboy> gameboy;
+
+	/**
+	 * Snapshot that reset() restores
+	 */
+	std::unique_ptr<GameboyState> reset_state;
+
+	/**
+	 * Addresses that are read into the observation after every step
+	 */
+	std::vector<Address> ram_addresses;
+
+	/**
+	 * Values of the watched addresses, which the observation points to
+	 */
+	std::vector<uint8_t> ram_values;
+
+	Observation observation;
+
+	/**
+	 * Read the watched addresses and the frame count into the observation
+	 */
+	void update_observation();
+
+  public:
+	/**
+	 * @param rom_data Complete contents of the ROM, which may be shared with
+	 * other environments
+	 * @param ram_addresses Addresses to read into every observation
+	 * @param reset_frames Number of frames to run before saving the state
+	 * that reset() restores, for skipping the boot ROM and title screens
+	 * @param mode CPU execution mode
+	 */
+	Environment(std::shared_ptr<std::vector<uint8_t>> rom_data,
+	            std::vector<Address> ram_addresses = {},
+	            uint64_t reset_frames = 0,
+	            cpu::ExecutionMode mode = cpu::ExecutionMode::INTERPRETER);
+
+	/**
+	 * Restore the reset state, including the buttons held at the time
+	 */
+	const Observation &reset();
+
+	/**
+	 * Hold the given buttons for a number of frames
+	 *
+	 * @param pressed One bit per controller::Button, set if pressed
+	 * @param frames Number of whole frames to run
+	 */
+	const Observation &step(uint8_t pressed, uint64_t frames = 1);
+
+	/**
+	 * Get the observation after the last step, without running anything
+	 */
+	const Observation &observe() const;
+
+	/**
+	 * Save the current state, like Gameboy::save_state
+	 */
+	void save_state(GameboyState *state) const;
+
+	/**
+	 * Restore a state taken by save_state on any environment running the
+	 * same ROM
+	 */
+	const Observation &load_state(const GameboyState &state);
+
+	/**
+	 * Make reset() restore the given state from now on
+	 */
+	void set_reset_state(const GameboyState &state);
+
+	/**
+	 * Get the Gameboy being driven, for anything the observation does not
+	 * cover
+	 */
+	Gameboy &get_gameboy();
+};
+
+} // namespace gameboy
@@ -13,6 +13,8 @@
 #include "memory/memory.h"
 #include "util/helpers.h"
 #include "util/log.h"
+#include "util/perf.h"
+#include "video/headless_video.h"
 #include "video/video.h"
 
 #include "debugger/debugger.fwd.h"
@@ -34,6 +36,27 @@ using namespace controller;
 
 namespace gameboy {
 
+/**
+ * The CPU and GPU, instantiated over the Gameboy's memory
+ */
+using GameboyCPU = cpu::CPU<memory::Memory>;
+using GameboyGPU = gpu::GPU<memory::Memory, GameboyCPU>;
+
+/**
+ * Snapshot of the complete emulated state of a Gameboy, for saving and
+ * restoring it. Host side state, like the window and the CPU code caches, is
+ * not included.
+ */
+struct GameboyState {
+	RegisterState registers;
+	uint8_t interrupt_flag;
+	uint8_t interrupt_enable;
+	MemoryState memory;
+	GPUState gpu;
+	ControllerState controller;
+	CartridgeState cartridge;
+};
+
 /**
  * Gameboy class that initializes and contains the complete application
  */
@@ -52,7 +75,7 @@ class Gameboy {
 	/**
 	 * Video instance
 	 */
-	std::unique_ptr<Video> video;
+	std::unique_ptr<VideoInterface> video;
 
 	/**
 	 * Memory instance
@@ -62,20 +85,20 @@ class Gameboy {
 	/**
 	 * CPU instance
 	 */
-	std::unique_ptr<CPU> cpu;
+	std::unique_ptr<GameboyCPU> cpu;
 
 	/**
 	 * GPU instance
 	 */
-	std::unique_ptr<GPU> gpu;
+	std::unique_ptr<GameboyGPU> gpu;
 
 	/**
 	 * Helper method to create a CPU object
 	 *
 	 * @param memory_ptr Pointer to memory instance
-	 * @return std::unique_ptr<CPU> New CPU instance
+	 * @return std::unique_ptr<GameboyCPU> New CPU instance
 	 */
-	std::unique_ptr<CPU> create_cpu(Memory *memory_ptr);
+	std::unique_ptr<GameboyCPU> create_cpu(Memory *memory_ptr);
 
 	/**
 	 * Helper method to create a GPU object
@@ -83,23 +106,56 @@ class Gameboy {
 	 * @param memory_ptr Pointer to memory instance
 	 * @param cpu_ptr Pointer to cpu instance
 	 * @param video_ptr Pointer to video instance
-	 * @return std::unique_ptr<GPU>
+	 * @return std::unique_ptr<GameboyGPU>
 	 */
-	std::unique_ptr<GPU> create_gpu(Memory *memory_ptr, CPU *cpu_ptr,
-	                                Video *video_ptr);
+	std::unique_ptr<GameboyGPU> create_gpu(Memory *memory_ptr,
+	                                       GameboyCPU *cpu_ptr,
+	                                       VideoInterface *video_ptr);
 
 	/**
 	 * @brief Construct a new Gameboy object
 	 *
 	 * @param rom_path Path to ROM File
+	 * @param headless Run without opening a window
+	 */
+	Gameboy(std::string rom_path, bool headless = false);
+
+	/**
+	 * @brief Construct a new Gameboy object from an already loaded cartridge
+	 *
+	 * @param cartridge Cartridge instance
+	 * @param headless Run without opening a window
 	 */
-	Gameboy(std::string rom_path);
+	Gameboy(std::unique_ptr<Cartridge> cartridge, bool headless = false);
 
 	/**
 	 * Runs one CPU tick and corresponding GPU tick
 	 */
 	void tick();
 
+	/**
+	 * Save a snapshot of the emulated state. The snapshot is large, so it is
+	 * filled in place, and can be reused across calls.
+	 */
+	void save_state(GameboyState *state) const;
+
+	/**
+	 * Restore the emulated state from a snapshot taken by save_state on this
+	 * or another Gameboy running the same ROM
+	 */
+	void load_state(const GameboyState &state);
+
+	/**
+	 * Create a headless copy of this Gameboy, which then runs independently.
+	 * The copy shares the ROM and all memory pages with this Gameboy, and
+	 * either side copies a page only when it first writes to it.
+	 *
+	 * The new instance starts with empty code caches, so this costs a few
+	 * times more than forking into an existing instance with save_state and
+	 * load_state, which share pages the same way.
+	 */
+	std::unique_ptr<Gameboy> clone() const;
+
 	/**
 	 * The all-seeing Debugger overlord may peep into this object, muahaha!
 	 */
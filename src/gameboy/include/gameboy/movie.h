@@ -0,0 +1,172 @@
+/**
+ * @file movie.h
+ * Declares the Movie, MovieRecorder and MoviePlayer classes, for recording
+ * the buttons of a run and replaying them exactly
+ */
+
+#pragma once
+
+#include "gameboy/gameboy.h"
+
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace gameboy {
+
+/**
+ * One frame of a Movie
+ */
+struct MovieFrame {
+	/// Buttons held from the end of this frame, one bit per controller::Button
+	uint8_t buttons;
+
+	/// Hash of the video buffer at the end of this frame
+	uint64_t hash;
+};
+
+/**
+ * The buttons and screen hash at the end of every frame of a run.
+ *
+ * Buttons only ever change when a frame ends, since that is when Video polls
+ * for input. Replaying a movie sets the buttons at the same points, so the
+ * replay runs exactly the same guest code as the recording. The screen
+ * hashes detect when it does not.
+ *
+ * Movies are stored as text. The first two lines are "tvp-movie 1" and
+ * "rom <hash>", and every further line is one frame, as "<buttons> <hash>"
+ * in hex.
+ */
+class Movie {
+  private:
+	/**
+	 * Hash of the ROM the movie was recorded with
+	 */
+	uint64_t rom_hash;
+
+	std::vector<MovieFrame> frames;
+
+  public:
+	explicit Movie(uint64_t rom_hash = 0);
+
+	/**
+	 * Hash the contents of a video buffer
+	 */
+	static uint64_t hash_frame(const gpu::VideoBuffer &v_buffer);
+
+	/**
+	 * Hash ROM data, to check that a movie is replayed with the right ROM
+	 */
+	static uint64_t hash_rom(const std::vector<uint8_t> &rom_data);
+
+	/**
+	 * Write the header of a movie file
+	 */
+	static void write_header(std::ostream &out, uint64_t rom_hash);
+
+	/**
+	 * Write one frame line of a movie file
+	 */
+	static void write_frame(std::ostream &out, const MovieFrame &frame);
+
+	/**
+	 * Load a movie from a file
+	 *
+	 * @return false if the file could not be read or is not a movie
+	 */
+	bool load(const std::string &path);
+
+	/**
+	 * Save the movie to a file
+	 *
+	 * @return false if the file could not be written
+	 */
+	bool save(const std::string &path) const;
+
+	void add_frame(const MovieFrame &frame);
+
+	const std::vector<MovieFrame> &get_frames() const;
+
+	uint64_t get_rom_hash() const;
+};
+
+/**
+ * Records the buttons and screen of a Gameboy at the end of every frame, and
+ * writes each frame to a file as it ends
+ */
+class MovieRecorder {
+  private:
+	Gameboy *gameboy;
+
+	std::ofstream file;
+
+	/**
+	 * Frames recorded so far
+	 */
+	uint64_t frame_count;
+
+  public:
+	/**
+	 * @param gameboy Gameboy to record, which must not have run yet
+	 * @param path Path of the movie file to write
+	 */
+	MovieRecorder(Gameboy *gameboy, const std::string &path);
+
+	/**
+	 * Check if the movie file could be opened
+	 */
+	bool is_open() const;
+
+	/**
+	 * Record any frames that ended since the last call. Call after every tick.
+	 */
+	void update();
+};
+
+/**
+ * Replays a Movie on a Gameboy, setting the buttons at the end of every frame
+ * and comparing the screen against the recorded hashes
+ */
+class MoviePlayer {
+  private:
+	Gameboy *gameboy;
+
+	const Movie *movie;
+
+	/**
+	 * Frames replayed so far
+	 */
+	uint64_t frame_count;
+
+	/**
+	 * First frame whose screen did not match the movie, if any
+	 */
+	std::optional<uint64_t> desync_frame;
+
+  public:
+	/**
+	 * @param gameboy Gameboy to drive, which must not have run yet
+	 * @param movie Movie to replay, which must outlive the player
+	 */
+	MoviePlayer(Gameboy *gameboy, const Movie *movie);
+
+	/**
+	 * Apply the buttons, and check the screen, of any frames that ended since
+	 * the last call. Call after every tick.
+	 */
+	void update();
+
+	/**
+	 * Check if every frame of the movie has been replayed
+	 */
+	bool is_finished() const;
+
+	/**
+	 * Get the first frame whose screen did not match the movie, if any
+	 */
+	std::optional<uint64_t> get_desync_frame() const;
+};
+
+} // namespace gameboy
@@ -0,0 +1,92 @@
+/**
+ * @file tvp_env.h
+ * C interface to the Environment class, for training code in other languages.
+ * Every function takes the handle returned by tvp_env_create.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Screen dimensions, in pixels
+ */
+#define TVP_SCREEN_WIDTH 160
+#define TVP_SCREEN_HEIGHT 144
+
+typedef struct tvp_env tvp_env;
+typedef struct tvp_state tvp_state;
+
+/**
+ * Create an environment. The ROM data is copied, and padded to 32KB if it is
+ * shorter.
+ *
+ * @param ram_addresses Addresses to read after every step, may be NULL
+ * @param reset_frames Number of frames to run before saving the reset state
+ * @return NULL if the ROM is too small to hold a header
+ */
+tvp_env *tvp_env_create(const uint8_t *rom, size_t rom_size,
+                        const uint16_t *ram_addresses, size_t ram_count,
+                        uint64_t reset_frames);
+
+void tvp_env_destroy(tvp_env *env);
+
+/**
+ * Restore the reset state
+ */
+void tvp_env_reset(tvp_env *env);
+
+/**
+ * Hold the buttons for a number of frames. Buttons are one bit each, in the
+ * order right, left, up, down, A, B, select, start from bit 0.
+ */
+void tvp_env_step(tvp_env *env, uint8_t buttons, uint64_t frames);
+
+/**
+ * Get the screen, one shade (0-3) per byte, TVP_SCREEN_WIDTH bytes per row.
+ * The pointer stays valid until the environment is destroyed.
+ */
+const uint8_t *tvp_env_screen(const tvp_env *env);
+
+/**
+ * Get the values of the watched addresses, in the order they were given.
+ * The pointer stays valid until the environment is destroyed.
+ */
+const uint8_t *tvp_env_ram(const tvp_env *env);
+
+/**
+ * Get the number of frames emulated since startup
+ */
+uint64_t tvp_env_frame(const tvp_env *env);
+
+/**
+ * Save the current state into a new snapshot, which is freed with
+ * tvp_state_destroy
+ */
+tvp_state *tvp_env_save(const tvp_env *env);
+
+/**
+ * Save the current state into an existing snapshot, without allocating
+ */
+void tvp_env_save_into(const tvp_env *env, tvp_state *state);
+
+/**
+ * Restore a snapshot saved from any environment running the same ROM
+ */
+void tvp_env_load(tvp_env *env, const tvp_state *state);
+
+/**
+ * Make tvp_env_reset restore the given snapshot from now on
+ */
+void tvp_env_set_reset_state(tvp_env *env, const tvp_state *state);
+
+void tvp_state_destroy(tvp_state *state);
+
+#ifdef __cplusplus
+}
+#endif
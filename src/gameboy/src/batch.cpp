@@ -0,0 +1,56 @@
+/**
+ * @file batch.cpp
+ * Defines the Batch class
+ */
+
+#include "gameboy/batch.h"
+#include "util/thread_pool.h"
+
+#include <atomic>
+#include <chrono>
+
+namespace gameboy {
+
+Batch::Batch(std::shared_ptr<std::vector<uint8_t>> rom_data,
+             cpu::ExecutionMode mode, gpu::RenderMode render_mode)
+    : rom_data(std::move(rom_data)), mode(mode), render_mode(render_mode) {}
+
+BatchResult Batch::run(uint64_t instances, uint64_t frames,
+                       size_t thread_count, BatchCallback callback) {
+	auto pool = ThreadPool(thread_count);
+	auto total_frames = std::atomic<uint64_t>(0);
+
+	auto start = std::chrono::steady_clock::now();
+
+	// One task per instance, so that the pool can balance instances that run
+	// at different speeds
+	for (uint64_t i = 0; i < instances; ++i) {
+		pool.submit([this, i, frames, &callback, &total_frames]() {
+			auto gb = std::make_unique<Gameboy>(
+			    std::make_unique<Cartridge>(rom_data), true);
+			gb->cpu->set_execution_mode(mode);
+			gb->gpu->set_render_mode(render_mode);
+
+			while (gb->gpu->get_frame_count() < frames) {
+				gb->tick();
+			}
+			total_frames += gb->gpu->get_frame_count();
+
+			if (callback) {
+				callback(i, *gb);
+			}
+		});
+	}
+	pool.wait();
+
+	auto elapsed = std::chrono::steady_clock::now() - start;
+
+	auto result = BatchResult{};
+	result.instances = instances;
+	result.frames = total_frames;
+	result.seconds = std::chrono::duration<double>(elapsed).count();
+	result.threads = pool.get_thread_count();
+	return result;
+}
+
+} // namespace gameboy
@@ -0,0 +1,67 @@
+/**
+ * @file environment.cpp
+ * Defines the Environment class
+ */
+
+#include "gameboy/environment.h"
+
+namespace gameboy {
+
+Environment::Environment(std::shared_ptr<std::vector<uint8_t>> rom_data,
+                         std::vector<Address> ram_addresses,
+                         uint64_t reset_frames, cpu::ExecutionMode mode)
+    : gameboy(std::make_unique<Gameboy>(
+          std::make_unique<Cartridge>(std::move(rom_data)), true)),
+      reset_state(std::make_unique<GameboyState>()),
+      ram_addresses(std::move(ram_addresses)) {
+	gameboy->cpu->set_execution_mode(mode);
+
+	ram_values.resize(this->ram_addresses.size());
+	observation.screen = &gameboy->gpu->get_video_buffer();
+	observation.ram = ram_values.data();
+	observation.ram_size = ram_values.size();
+
+	step(0, reset_frames);
+	gameboy->save_state(reset_state.get());
+}
+
+void Environment::update_observation() {
+	for (size_t i = 0; i < ram_addresses.size(); ++i) {
+		ram_values[i] = gameboy->memory->read(ram_addresses[i]);
+	}
+	observation.frame = gameboy->gpu->get_frame_count();
+}
+
+const Observation &Environment::reset() { return load_state(*reset_state); }
+
+const Observation &Environment::step(uint8_t pressed, uint64_t frames) {
+	gameboy->controller->set_buttons(pressed);
+
+	auto target = gameboy->gpu->get_frame_count() + frames;
+	while (gameboy->gpu->get_frame_count() < target) {
+		gameboy->tick();
+	}
+
+	update_observation();
+	return observation;
+}
+
+const Observation &Environment::observe() const { return observation; }
+
+void Environment::save_state(GameboyState *state) const {
+	gameboy->save_state(state);
+}
+
+const Observation &Environment::load_state(const GameboyState &state) {
+	gameboy->load_state(state);
+	update_observation();
+	return observation;
+}
+
+void Environment::set_reset_state(const GameboyState &state) {
+	*reset_state = state;
+}
+
+Gameboy &Environment::get_gameboy() { return *gameboy; }
+
+} // namespace gameboy
@@ -1,12 +1,22 @@
 #include "gameboy/gameboy.h"
 
+#include <algorithm>
+
 namespace gameboy {
 
-Gameboy::Gameboy(std::string rom_path) {
-	cartridge = std::make_unique<Cartridge>(rom_path);
+Gameboy::Gameboy(std::string rom_path, bool headless)
+    : Gameboy(std::make_unique<Cartridge>(rom_path), headless) {}
+
+Gameboy::Gameboy(std::unique_ptr<Cartridge> cartridge, bool headless)
+    : cartridge(std::move(cartridge)) {
 	controller = std::make_unique<Controller>();
-	video = make_unique<Video>(controller.get(), cartridge->get_metadata());
-	memory = make_unique<Memory>(cartridge.get(), controller.get());
+	if (headless) {
+		video = make_unique<HeadlessVideo>();
+	} else {
+		video = make_unique<Video>(controller.get(),
+		                           this->cartridge->get_metadata());
+	}
+	memory = make_unique<Memory>(this->cartridge.get(), controller.get());
 	cpu = create_cpu(memory.get());
 	gpu = create_gpu(memory.get(), cpu.get(), video.get());
 
@@ -14,15 +24,71 @@ Gameboy::Gameboy(std::string rom_path) {
 	memory->set_cpu(cpu.get());
 	memory->set_gpu(gpu.get());
 
+	cpu->set_superinstructions_enabled(true);
+
 	Log::info("GameBoy Start Successful!");
 }
 
 void Gameboy::tick() {
+	// Let the CPU know how far it can fuse instructions without missing an
+	// interrupt from the GPU, or the end of an OAM DMA
+	auto horizon = gpu->get_cycles_until_event();
+	auto dma_cycles = memory->get_dma_cycles();
+	if (dma_cycles) {
+		horizon = std::min(horizon, dma_cycles);
+	}
+	cpu->set_event_horizon(horizon);
+	cpu->set_bus_locked(dma_cycles != 0);
+
 	auto cpu_cycles = cpu->tick();
 	gpu->tick(cpu_cycles);
+
+	// A DMA only needs counting down while it holds the bus
+	if (dma_cycles) {
+		memory->run_dma(cpu_cycles);
+	}
+}
+
+void Gameboy::save_state(GameboyState *state) const {
+	state->registers = cpu->get_register_state();
+	state->interrupt_flag = cpu->get_interrupts()->get_flag();
+	state->interrupt_enable = cpu->get_interrupts()->get_enable();
+	state->memory = memory->get_state();
+	state->gpu = gpu->get_state();
+	state->controller = controller->get_state();
+	state->cartridge = cartridge->get_state();
+}
+
+void Gameboy::load_state(const GameboyState &state) {
+	// Cached code is only stale if the ROM, or the boot ROM mapping, changed
+	if (cartridge->get_state().data != state.cartridge.data) {
+		cpu->invalidate_code(0x0000, 0x7FFF);
+	} else if (memory->read(0xFF50) != state.memory.get_byte(0xFF50)) {
+		cpu->invalidate_code(0x0000, 0x00FF);
+	}
+
+	cpu->set_register_state(state.registers);
+	cpu->get_interrupts()->set_flag(state.interrupt_flag);
+	cpu->get_interrupts()->set_enable(state.interrupt_enable);
+	memory->set_state(state.memory);
+	gpu->set_state(state.gpu);
+	controller->set_state(state.controller);
+	cartridge->set_state(state.cartridge);
+}
+
+std::unique_ptr<Gameboy> Gameboy::clone() const {
+	auto child = std::make_unique<Gameboy>(
+	    std::make_unique<Cartridge>(cartridge->get_state().data), true);
+	child->cpu->set_execution_mode(cpu->get_execution_mode());
+	child->gpu->set_render_mode(gpu->get_render_mode());
+
+	auto state = std::make_unique<GameboyState>();
+	save_state(state.get());
+	child->load_state(*state);
+	return child;
 }
 
-unique_ptr<CPU> Gameboy::create_cpu(Memory *memory_ptr) {
+unique_ptr<GameboyCPU> Gameboy::create_cpu(Memory *memory_ptr) {
 	auto a = make_unique<Register>();
 	auto b = make_unique<Register>();
 	auto c = make_unique<Register>();
@@ -37,34 +103,18 @@ unique_ptr<CPU> Gameboy::create_cpu(Memory *memory_ptr) {
 	auto hl = make_unique<PairRegister>(h.get(), l.get());
 	auto pc = make_unique<DoubleRegister>();
 	auto sp = make_unique<DoubleRegister>();
-	auto iflag = make_unique<Register>();
-	auto ienable = make_unique<Register>();
 
-	return make_unique<CPU>(move(a), move(b), move(c), move(d), move(e),
-	                        move(f), move(h), move(l), move(af), move(bc),
-	                        move(de), move(hl), move(pc), move(sp), move(iflag),
-	                        move(ienable), memory_ptr);
+	return make_unique<GameboyCPU>(move(a), move(b), move(c), move(d), move(e),
+	                               move(f), move(h), move(l), move(af),
+	                               move(bc), move(de), move(hl), move(pc),
+	                               move(sp), memory_ptr);
 }
 
-unique_ptr<GPU> Gameboy::create_gpu(Memory *memory_ptr, CPU *cpu_ptr,
-                                    Video *video_ptr) {
-	auto lcdc = make_unique<cpu::Register>();
-	auto stat = make_unique<cpu::Register>();
-	auto scy = make_unique<cpu::Register>();
-	auto scx = make_unique<cpu::Register>();
-	auto ly = make_unique<cpu::Register>();
-	auto lyc = make_unique<cpu::Register>();
-	auto wy = make_unique<cpu::Register>();
-	auto wx = make_unique<cpu::Register>();
-	auto bgp = make_unique<cpu::Register>();
-	auto obp0 = make_unique<cpu::Register>();
-	auto obp1 = make_unique<cpu::Register>();
-	auto dma = make_unique<cpu::Register>();
-
-	return make_unique<GPU>(move(lcdc), move(stat), move(scy), move(scx),
-	                        move(ly), move(lyc), move(wy), move(wx), move(bgp),
-	                        move(obp0), move(obp1), move(dma), memory_ptr,
-	                        cpu_ptr, video_ptr);
+unique_ptr<GameboyGPU> Gameboy::create_gpu(Memory *memory_ptr,
+                                           GameboyCPU *cpu_ptr,
+                                           VideoInterface *video_ptr) {
+	return make_unique<GameboyGPU>(memory_ptr->get_io(), memory_ptr, cpu_ptr,
+	                               video_ptr);
 }
 
 } // namespace gameboy
@@ -0,0 +1,166 @@
+/**
+ * @file movie.cpp
+ * Defines the Movie, MovieRecorder and MoviePlayer classes
+ */
+
+#include "gameboy/movie.h"
+#include "util/helpers.h"
+#include "util/log.h"
+
+#include <iomanip>
+#include <sstream>
+
+namespace gameboy {
+
+/**
+ * First line of every movie file
+ */
+const std::string MOVIE_MAGIC = "tvp-movie 1";
+
+/**
+ * Number of frames between flushes of a recording, so that little is lost if
+ * the emulator is killed
+ */
+const uint64_t RECORD_FLUSH_INTERVAL = 60;
+
+/// Movie
+
+Movie::Movie(uint64_t rom_hash) : rom_hash(rom_hash), frames() {}
+
+uint64_t Movie::hash_frame(const gpu::VideoBuffer &v_buffer) {
+	return hash_bytes(reinterpret_cast<const uint8_t *>(v_buffer.data()),
+	                  v_buffer.size());
+}
+
+uint64_t Movie::hash_rom(const std::vector<uint8_t> &rom_data) {
+	return hash_bytes(rom_data.data(), rom_data.size());
+}
+
+void Movie::write_header(std::ostream &out, uint64_t rom_hash) {
+	out << MOVIE_MAGIC << "\n"
+	    << "rom " << std::hex << std::setfill('0') << std::setw(16)
+	    << rom_hash << std::dec << "\n";
+}
+
+void Movie::write_frame(std::ostream &out, const MovieFrame &frame) {
+	out << std::hex << std::setfill('0') << std::setw(2) << +frame.buttons
+	    << " " << std::setw(16) << frame.hash << std::dec << "\n";
+}
+
+bool Movie::load(const std::string &path) {
+	auto file = std::ifstream(path);
+	if (!file) {
+		Log::error("Could not open movie file " + path);
+		return false;
+	}
+
+	auto line = std::string();
+	if (!std::getline(file, line) || line != MOVIE_MAGIC) {
+		Log::error(path + " is not a movie file");
+		return false;
+	}
+
+	auto label = std::string();
+	if (!std::getline(file, line) ||
+	    !(std::istringstream(line) >> label >> std::hex >> rom_hash) ||
+	    label != "rom") {
+		Log::error(path + " has no ROM hash");
+		return false;
+	}
+
+	frames.clear();
+	while (std::getline(file, line)) {
+		unsigned int buttons = 0;
+		auto frame = MovieFrame{};
+		if (!(std::istringstream(line) >> std::hex >> buttons >> frame.hash)) {
+			Log::error("Bad frame " + std::to_string(frames.size()) + " in " +
+			           path);
+			return false;
+		}
+		frame.buttons = static_cast<uint8_t>(buttons);
+		frames.push_back(frame);
+	}
+	return true;
+}
+
+bool Movie::save(const std::string &path) const {
+	auto file = std::ofstream(path);
+	if (!file) {
+		Log::error("Could not open movie file " + path);
+		return false;
+	}
+
+	write_header(file, rom_hash);
+	for (auto &frame : frames) {
+		write_frame(file, frame);
+	}
+	return static_cast<bool>(file);
+}
+
+void Movie::add_frame(const MovieFrame &frame) { frames.push_back(frame); }
+
+const std::vector<MovieFrame> &Movie::get_frames() const { return frames; }
+
+uint64_t Movie::get_rom_hash() const { return rom_hash; }
+
+/// MovieRecorder
+
+MovieRecorder::MovieRecorder(Gameboy *gameboy, const std::string &path)
+    : gameboy(gameboy), file(path), frame_count(0) {
+	if (!file) {
+		Log::error("Could not open movie file " + path);
+		return;
+	}
+	auto rom_data = gameboy->cartridge->get_state().data;
+	Movie::write_header(file, Movie::hash_rom(*rom_data));
+}
+
+bool MovieRecorder::is_open() const { return file.is_open(); }
+
+void MovieRecorder::update() {
+	auto gpu_frames = gameboy->gpu->get_frame_count();
+	if (frame_count == gpu_frames) {
+		return;
+	}
+
+	// Only one frame can end per tick, so the buffer holds that frame
+	auto frame = MovieFrame{};
+	frame.buttons = gameboy->controller->get_buttons();
+	frame.hash = Movie::hash_frame(gameboy->gpu->get_video_buffer());
+	Movie::write_frame(file, frame);
+	frame_count = gpu_frames;
+
+	if (frame_count % RECORD_FLUSH_INTERVAL == 0) {
+		file.flush();
+	}
+}
+
+/// MoviePlayer
+
+MoviePlayer::MoviePlayer(Gameboy *gameboy, const Movie *movie)
+    : gameboy(gameboy), movie(movie), frame_count(0), desync_frame() {}
+
+void MoviePlayer::update() {
+	auto gpu_frames = gameboy->gpu->get_frame_count();
+	if (frame_count == gpu_frames || is_finished()) {
+		return;
+	}
+
+	auto &frame = movie->get_frames()[frame_count];
+	if (!desync_frame &&
+	    Movie::hash_frame(gameboy->gpu->get_video_buffer()) != frame.hash) {
+		desync_frame = frame_count;
+	}
+	gameboy->controller->set_buttons(frame.buttons);
+	frame_count = gpu_frames;
+}
+
+bool MoviePlayer::is_finished() const {
+	return frame_count >= movie->get_frames().size();
+}
+
+std::optional<uint64_t> MoviePlayer::get_desync_frame() const {
+	return desync_frame;
+}
+
+} // namespace gameboy
@@ -0,0 +1,90 @@
+/**
+ * @file tvp_env.cpp
+ * Defines the C interface to the Environment class
+ */
+
+#include "gameboy/tvp_env.h"
+#include "gameboy/environment.h"
+
+using namespace gameboy;
+
+static_assert(sizeof(gpu::Pixel) == 1, "Screen is exposed as one byte/pixel");
+static_assert(TVP_SCREEN_WIDTH == gpu::SCREEN_WIDTH, "Screen width mismatch");
+static_assert(TVP_SCREEN_HEIGHT == gpu::SCREEN_HEIGHT,
+              "Screen height mismatch");
+
+struct tvp_env {
+	std::unique_ptr<Environment> env;
+};
+
+struct tvp_state {
+	GameboyState state;
+};
+
+extern "C" {
+
+tvp_env *tvp_env_create(const uint8_t *rom, size_t rom_size,
+                        const uint16_t *ram_addresses, size_t ram_count,
+                        uint64_t reset_frames) {
+	// Cartridge reads the header without checking the size
+	if (!rom || rom_size < 0x150) {
+		return nullptr;
+	}
+
+	// Pad short ROMs to the 32KB the cartridge is read from
+	auto rom_data = std::make_shared<std::vector<uint8_t>>(rom, rom + rom_size);
+	if (rom_data->size() < 0x8000) {
+		rom_data->resize(0x8000);
+	}
+	auto addresses = std::vector<Address>();
+	if (ram_addresses) {
+		addresses.assign(ram_addresses, ram_addresses + ram_count);
+	}
+
+	auto handle = new tvp_env;
+	handle->env = std::make_unique<Environment>(
+	    std::move(rom_data), std::move(addresses), reset_frames);
+	return handle;
+}
+
+void tvp_env_destroy(tvp_env *env) { delete env; }
+
+void tvp_env_reset(tvp_env *env) { env->env->reset(); }
+
+void tvp_env_step(tvp_env *env, uint8_t buttons, uint64_t frames) {
+	env->env->step(buttons, frames);
+}
+
+const uint8_t *tvp_env_screen(const tvp_env *env) {
+	return reinterpret_cast<const uint8_t *>(
+	    env->env->observe().screen->data());
+}
+
+const uint8_t *tvp_env_ram(const tvp_env *env) {
+	return env->env->observe().ram;
+}
+
+uint64_t tvp_env_frame(const tvp_env *env) {
+	return env->env->observe().frame;
+}
+
+tvp_state *tvp_env_save(const tvp_env *env) {
+	auto state = new tvp_state;
+	env->env->save_state(&state->state);
+	return state;
+}
+
+void tvp_env_save_into(const tvp_env *env, tvp_state *state) {
+	env->env->save_state(&state->state);
+}
+
+void tvp_env_load(tvp_env *env, const tvp_state *state) {
+	env->env->load_state(state->state);
+}
+
+void tvp_env_set_reset_state(tvp_env *env, const tvp_state *state) {
+	env->env->set_reset_state(state->state);
+}
+
+void tvp_state_destroy(tvp_state *state) { delete state; }
+}
@@ -7,6 +7,6 @@
 
 namespace gpu {
 
-class GPU;
+template <typename Bus, typename Cpu> class GPU;
 
 } // namespace gpu
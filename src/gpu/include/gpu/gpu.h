@@ -3,22 +3,30 @@
  * Declares the GPU Class
  */
 
-#include "cpu/cpu_interface.h"
-#include "cpu/register/register_interface.h"
 #include "cpu/utils.h"
 #include "gpu/gpu_interface.h"
+#include "gpu/pixel_fifo.h"
 #include "gpu/utils.h"
-#include "memory/memory_interface.h"
+#include "memory/io_registers.h"
+#include "util/thread_pool.h"
 #include "video/video_interface.h"
 
 #include "debugger/debugger.fwd.h"
 
+#include <array>
 #include <cstdint>
 #include <memory>
+#include <ostream>
 #include <vector>
 
 #pragma once
 
+namespace bench {
+
+class GPUAccess;
+
+} // namespace bench
+
 namespace gpu {
 
 /**
@@ -82,141 +90,333 @@ struct Tile {
 	bool double_height;
 };
 
+/**
+ * The registers and VRAM write counts that a BG line was drawn from. A line
+ * is only drawn again when one of these differs from the last frame.
+ */
+struct LineState {
+	/**
+	 * False until the line has been drawn, and after the cache of drawn lines
+	 * is cleared
+	 */
+	bool drawn;
+
+	uint8_t lcdc;
+	uint8_t scx;
+	uint8_t scy;
+	uint8_t bgp;
+
+	/**
+	 * Write counts of the tile map row and the tile data that the line reads
+	 */
+	uint32_t map_writes;
+	uint32_t tile_writes;
+
+	bool operator==(const LineState &other) const {
+		return drawn == other.drawn && lcdc == other.lcdc &&
+		       scx == other.scx && scy == other.scy && bgp == other.bgp &&
+		       map_writes == other.map_writes &&
+		       tile_writes == other.tile_writes;
+	}
+
+	bool operator!=(const LineState &other) const {
+		return !(*this == other);
+	}
+};
+
+/**
+ * The registers and write counts that the sprites of a frame were drawn from
+ */
+struct SpriteState {
+	uint8_t lcdc;
+	uint8_t obp0;
+	uint8_t obp1;
+	uint32_t oam_writes;
+	uint32_t tile_writes;
+
+	bool operator==(const SpriteState &other) const {
+		return lcdc == other.lcdc && obp0 == other.obp0 &&
+		       obp1 == other.obp1 && oam_writes == other.oam_writes &&
+		       tile_writes == other.tile_writes;
+	}
+
+	bool operator!=(const SpriteState &other) const {
+		return !(*this == other);
+	}
+};
+
+/**
+ * Copy of VRAM that deferred lines are drawn from. It has the same peek as a
+ * bus, so that lines are drawn the same way from either.
+ */
+struct VRAMSnapshot {
+	static constexpr Address START = 0x8000;
+	static constexpr Address END = 0x9FFF;
+
+	std::array<uint8_t, END - START + 1> data;
+
+	uint8_t peek(Address address) const { return data[address - START]; }
+};
+
+/**
+ * A BG line waiting to be drawn by the render pool, with the registers and
+ * the VRAM it had when the GPU reached it
+ */
+struct DeferredLine {
+	uint8_t line;
+	LineState state;
+	std::shared_ptr<const VRAMSnapshot> vram;
+};
+
+/**
+ * Counts of the work that was skipped by reusing unchanged lines and frames
+ */
+struct RenderStats {
+	/// BG lines drawn, and BG lines copied from the last frame instead
+	uint64_t lines_drawn;
+	uint64_t lines_reused;
+
+	/// Frames painted, and frames that were the same as the last one
+	uint64_t frames_painted;
+	uint64_t frames_reused;
+
+	/**
+	 * Write the counts, and the share of lines and frames reused
+	 */
+	void write_summary(std::ostream &out) const;
+};
+
+/**
+ * Snapshot of the timing and video buffer of a GPU. The LCD registers are
+ * part of the MemoryState. Cached lines are not, and are drawn again after
+ * loading. Neither is the pixel FIFO partway through a line, so a line that
+ * was in its pixel transfer is drawn again from its start.
+ */
+struct GPUState {
+	bool display_enabled;
+	GPUMode mode;
+	cpu::ClockCycles current_cycles;
+	cpu::ClockCycles hblank_cycles;
+	uint64_t frame_count;
+	VideoBuffer v_buffer;
+	PixelFifoState fifo;
+};
+
 /**
  * The GPU class, which controls pixel display to the screen
+ *
+ * Like the CPU, the GPU is a template over the memory it reads, and over the
+ * CPU it interrupts, so that neither is a virtual call. The definitions are in
+ * gpu_impl.h. The video output stays an interface, since it is only called
+ * once a frame, and is picked at runtime.
+ *
+ * @tparam Bus Memory the GPU reads tiles and sprites from
+ * @tparam Cpu CPU the GPU raises interrupts on
  */
-class GPU : public GPUInterface {
+template <typename Bus, typename Cpu> class GPU final : public GPUInterface {
 
 	/**
-	 * LCD Control Register @FF40
-	 * Contains bits controlling various display states
+	 * Hardware I/O registers, which hold the LCD registers @FF40 - @FF4B.
+	 * The GPU reads and writes these directly, without going through the bus.
+	 */
+	memory::IORegisters *io;
+
+	/**
+	 * Memory instance, for performing reads and writes to main memory
 	 */
-	std::unique_ptr<cpu::IReg> lcdc;
+	Bus *memory;
+
+	/**
+	 * CPU instance, for interrupting the CPU
+	 */
+	Cpu *cpu;
+
+	/**
+	 * Video instance, for writing video buffer to output
+	 */
+	video::VideoInterface *video;
 
 	/**
-	 * LCD Status Register @FF41
-	 * Contains bits controlling various rendering modes
+	 * Whether the LCD is on. While it is off, LY stays at 0, the mode stays
+	 * HBLANK, and the GPU only counts cycles, to keep frames passing at the
+	 * usual rate. Nothing is rendered and no interrupts are raised.
 	 */
-	std::unique_ptr<cpu::IReg> stat;
+	bool display_enabled;
 
 	/**
-	 * LCD Scroll Y @FF42
-	 * Specifies the Y position in the 256x256 pixels BG map (32x32 tiles)
-	 * which is to be displayed at the upper/left LCD display position.
+	 * The current mode that the GPU is in
 	 */
-	std::unique_ptr<cpu::IReg> scy;
+	GPUMode mode;
 
 	/**
-	 * LCD Scroll Y @FF43
-	 * Specifies the X position in the 256x256 pixels BG map (32x32 tiles)
-	 * which is to be displayed at the upper/left LCD display position.
+	 * Count the number of cycles elapsed in the current mode of the GPU. This
+	 * is used to check for transitions to the next mode.
+	 *
+	 * Note that in RenderMode::SCANLINE, the quantum of video output is one
+	 * mode of the scanline, not the pixel. Draw actions are performed only
+	 * once per scanline, and not per pixel like the real GameBoy hardware.
+	 * RenderMode::PIXEL_FIFO draws per pixel, at a higher cost.
 	 */
-	std::unique_ptr<cpu::IReg> scx;
+	cpu::ClockCycles current_cycles;
 
 	/**
-	 * LCDC Y-Coordinate @FF44
-	 * The LY indicates the vertical line to which the present data is
-	 * transferred to the LCD Driver.
+	 * Length of the HBLANK of the current line. The rest of the line after
+	 * the pixel transfer, which only varies with the pixel FIFO.
 	 */
-	std::unique_ptr<cpu::IReg> ly;
+	cpu::ClockCycles hblank_cycles;
 
 	/**
-	 * LYC LC-Compare @FF45
-	 * This register is constantly compared with the LCDC register and the
-	 * corresponding bits in STAT are set depending on this
+	 * How lines are drawn, and the pixel FIFO that draws them dot by dot in
+	 * RenderMode::PIXEL_FIFO
 	 */
-	std::unique_ptr<cpu::IReg> lyc;
+	RenderMode render_mode;
+	PixelFifo<Bus> fifo;
 
 	/**
-	 * Window Y Position @FF4A
-	 * Holds the Y position of the overlay window
+	 * Video Buffer
+	 * This is a 2D array that contains the complete contents of the current
+	 * frame to be drawn. This will be sent to the Video driver every frame to
+	 * be painted on to the screen.
 	 */
-	std::unique_ptr<cpu::IReg> wy;
+	VideoBuffer v_buffer;
 
 	/**
-	 * Window X Position @FF4B
-	 * Holds the X position of the overlay window, subtracted by 7 (wx - 7)
+	 * Number of complete frames drawn since startup
 	 */
-	std::unique_ptr<cpu::IReg> wx;
+	uint64_t frame_count;
 
 	/**
-	 * BG Palette Data @FF47
-	 * This register assigns gray shades to the color numbers of the BG and
-	 * Window tiles.
-	 *   Bit 7-6 - Shade for Color Number 3
-	 *   Bit 5-4 - Shade for Color Number 2
-	 *   Bit 3-2 - Shade for Color Number 1
-	 *   Bit 1-0 - Shade for Color Number 0
-	 * The four possible gray shades are:
-	 *   00  White
-	 *   01  Light gray
-	 *   10  Dark gray
-	 *   11  Black
+	 * BG lines as last drawn, without sprites. Lines whose LineState is
+	 * unchanged are copied from here into the video buffer instead of being
+	 * drawn again.
 	 */
-	std::unique_ptr<cpu::IReg> bgp;
+	VideoBuffer bg_buffer;
+	std::array<LineState, SCREEN_HEIGHT> line_states;
 
 	/**
-	 * Object Palette 0 Data @FF48
-	 * This register assigns gray shades for sprite palette 0. It works exactly
-	 * as BGP (FF47), except that the lower two bits aren't used because sprite
-	 * data 00 is transparent.
+	 * What the sprites of the last painted frame were drawn from
 	 */
-	std::unique_ptr<cpu::IReg> obp0;
+	SpriteState sprite_state;
 
 	/**
-	 * Object Palette 1 Data @FF49
-	 * This register assigns gray shades for sprite palette 1. It works exactly
-	 * as BGP (FF47), except that the lower two bits aren't used because sprite
-	 * data 00 is transparent.
+	 * The last painted frame, and whether it is still valid. It is only
+	 * valid once a frame has been painted since the cache was last cleared.
 	 */
-	std::unique_ptr<cpu::IReg> obp1;
+	VideoBuffer last_frame;
+	bool last_frame_valid;
 
 	/**
-	 * DMA Transfer @FF46
-	 * Writing to this register launches a DMA transfer from ROM or RAM to OAM
-	 * memory (sprite attribute table). The written value specifies the transfer
-	 * source address divided by 100h
+	 * Set once a line of the current frame has been drawn, rather than
+	 * copied
 	 */
-	std::unique_ptr<cpu::IReg> dma;
+	bool frame_changed;
 
 	/**
-	 * Memory instance, for performing reads and writes to main memory
+	 * Counts of the lines and frames reused
 	 */
-	memory::MemoryInterface *memory;
+	RenderStats render_stats;
 
 	/**
-	 * CPU instance, for interrupting the CPU
+	 * Lines of the current frame that the render pool draws, and whether
+	 * they have been handed to it yet
 	 */
-	cpu::CPUInterface *cpu;
+	std::vector<DeferredLine> deferred_lines;
+	bool deferred_submitted;
 
 	/**
-	 * Video instance, for writing video buffer to output
+	 * Latest copy of VRAM for deferred lines, and the VRAM write count when
+	 * it was taken. Lines share a copy until VRAM is written.
 	 */
-	video::VideoInterface *video;
+	std::shared_ptr<const VRAMSnapshot> vram_snapshot;
+	uint32_t vram_snapshot_writes;
 
 	/**
-	 * The current mode that the GPU is in
+	 * Threads that draw the BG lines of a frame from VBLANK onwards, while
+	 * the CPU runs on. nullptr to draw each line when it is reached. Kept
+	 * last, so that it finishes its tasks before the rest is destroyed.
 	 */
-	GPUMode mode;
+	std::unique_ptr<ThreadPool> render_pool;
 
 	/**
-	 * Count the number of cycles elapsed in the current mode of the GPU. This
-	 * is used to check for transitions to the next mode.
+	 * Get what the current line would be drawn from
+	 */
+	LineState get_line_state();
+
+	/**
+	 * Get what the sprites would be drawn from
+	 */
+	SpriteState get_sprite_state();
+
+	/**
+	 * Forget every cached line and the last frame, so that everything is
+	 * drawn again
+	 */
+	void clear_render_cache();
+
+	/**
+	 * Draw the sprites and paint the frame, or paint the last frame again if
+	 * nothing it was drawn from has changed
+	 */
+	void end_frame();
+
+	/**
+	 * Paint the video buffer if it changed, or repeat the last frame
+	 */
+	void paint(bool changed);
+
+	/**
+	 * Keep the current line for the render pool, along with a copy of VRAM
+	 * if it has changed since the last one
+	 */
+	void defer_line(const LineState &state);
+
+	/**
+	 * Hand the deferred lines of the current frame to the render pool
+	 */
+	void submit_deferred_lines();
+
+	/**
+	 * Wait for the render pool to draw the deferred lines, and copy them to
+	 * the video buffer. Lines that were never handed to it are drawn again
+	 * next frame.
+	 */
+	void finish_deferred_lines();
+
+	/**
+	 * Draw a BG line from the registers in its state, and tiles read from
+	 * the given source. Only reads its arguments, so that deferred lines can
+	 * be drawn on other threads.
 	 *
-	 * TODO: Note that the quantum of video output in TVP is one mode of the
-	 * scanline, not the pixel. Currently there is no Pixel FIFO implementation,
-	 * so draw actions are performed only once per scanline, and not per pixel
-	 * like it would in the real GameBoy hardware.
+	 * Picks the renderer for the tile map and tile data selected in LCDC
+	 * from a table, once for the whole line.
+	 *
+	 * @tparam Source Bus or VRAMSnapshot
+	 * @param line Index of the line on the screen
+	 * @param pixels Where to write the line's SCREEN_WIDTH pixels
 	 */
-	cpu::ClockCycles current_cycles;
+	template <typename Source>
+	static void draw_bg_line(const Source &source, const LineState &state,
+	                         uint8_t line, Pixel *pixels);
 
 	/**
-	 * Video Buffer
-	 * This is a 2D array that contains the complete contents of the current
-	 * frame to be drawn. This will be sent to the Video driver every frame to
-	 * be painted on to the screen.
+	 * Draw a BG line with the LCDC selections fixed at compile time
+	 *
+	 * @tparam HighTileData Tiles are numbered from $8000 rather than $9000
+	 * @tparam HighTileMap The tile map is at $9C00 rather than $9800
+	 * @see draw_bg_line
 	 */
-	VideoBuffer v_buffer;
+	template <bool HighTileData, bool HighTileMap, typename Source>
+	static void draw_bg_line_with(const Source &source,
+	                              const LineState &state, uint8_t line,
+	                              Pixel *pixels);
+
+	/**
+	 * Run the pixel transfer up to the cycles elapsed in it, and set the
+	 * length of the HBLANK that follows
+	 *
+	 * @return true once the pixel transfer of the line is done
+	 */
+	bool transfer_pixels();
 
 	/**
 	 * Set the mode and the LCD Status register bits to match
@@ -241,10 +441,15 @@ class GPU : public GPUInterface {
 
 	/**
 	 * Convert the given internal color value to a pixel color using the given
-	 * palette register's current value. The BG uses the BGP palette, and
-	 * Sprites use OBJ0 and OBJ1
+	 * palette register value. The BG uses the BGP palette, and Sprites use
+	 * OBJ0 and OBJ1
+	 */
+	static Pixel get_pixel_from_palette(GBPixel gb_pixel, uint8_t palette);
+
+	/**
+	 * Get the pixel colors of all four internal colors in a palette
 	 */
-	Pixel get_pixel_from_palette(GBPixel gb_pixel, cpu::IReg *reg);
+	static std::array<Pixel, 4> get_palette_colors(uint8_t palette);
 
 	/**
 	 * Write the current scanline of pixels into the video buffer
@@ -252,23 +457,25 @@ class GPU : public GPUInterface {
 	void write_line();
 
 	/**
-	 * Write the current scanline's BG pixels into the video buffer
+	 * Write the current scanline's BG pixels into the BG buffer, from the
+	 * given state of the line
 	 */
-	void write_bg_line();
+	void write_bg_line(const LineState &state);
 
 	/**
 	 * Write all sprites for the current frame into the video buffer
 	 */
 	void write_sprites();
 
+	/**
+	 * Write all sprites, with the sprite size fixed at compile time
+	 *
+	 * @tparam TallSprites Sprites are 8x16 rather than 8x8
+	 */
+	template <bool TallSprites> void write_sprites_with();
+
   public:
-	GPU(std::unique_ptr<cpu::IReg> lcdc, std::unique_ptr<cpu::IReg> stat,
-	    std::unique_ptr<cpu::IReg> scy, std::unique_ptr<cpu::IReg> scx,
-	    std::unique_ptr<cpu::IReg> ly, std::unique_ptr<cpu::IReg> lyc,
-	    std::unique_ptr<cpu::IReg> wy, std::unique_ptr<cpu::IReg> wx,
-	    std::unique_ptr<cpu::IReg> bgp, std::unique_ptr<cpu::IReg> obp0,
-	    std::unique_ptr<cpu::IReg> obp1, std::unique_ptr<cpu::IReg> dma,
-	    memory::MemoryInterface *memory, cpu::CPUInterface *cpu,
+	GPU(memory::IORegisters *io, Bus *memory, Cpu *cpu,
 	    video::VideoInterface *video);
 
 	/**
@@ -276,26 +483,75 @@ class GPU : public GPUInterface {
 	 */
 	void tick(cpu::ClockCycles cycles) override;
 
-	/// Getters for Registers
-	/// Simply return a pointer so that Memory can manipulate these values with
-	/// easily, as each register corresponds to a memory location
-	cpu::IReg *get_lcdc() override;
-	cpu::IReg *get_stat() override;
-	cpu::IReg *get_scy() override;
-	cpu::IReg *get_scx() override;
-	cpu::IReg *get_ly() override;
-	cpu::IReg *get_lyc() override;
-	cpu::IReg *get_wy() override;
-	cpu::IReg *get_wx() override;
-	cpu::IReg *get_bgp() override;
-	cpu::IReg *get_obp0() override;
-	cpu::IReg *get_obp1() override;
-	cpu::IReg *get_dma() override;
+	/**
+	 * @see GPUInterface#set_display_enabled
+	 */
+	void set_display_enabled(bool enabled) override;
+
+	/**
+	 * Check whether the LCD is on
+	 */
+	bool is_display_enabled() const;
+
+	/**
+	 * Get the number of complete frames drawn since startup
+	 */
+	uint64_t get_frame_count();
+
+	/**
+	 * Get the number of cycles until the GPU next changes mode. The GPU only
+	 * raises interrupts when changing mode. With the LCD off, this is the
+	 * rest of the blank frame. It is 0 during a pixel transfer through the
+	 * pixel FIFO, since any write then can change the pixels that follow.
+	 */
+	cpu::ClockCycles get_cycles_until_event();
+
+	/**
+	 * Get the video buffer, which holds the last drawn frame and the lines
+	 * drawn so far of the current one
+	 */
+	const VideoBuffer &get_video_buffer() const;
+
+	/**
+	 * Draw the BG lines of each frame on the given number of threads, from
+	 * VBLANK onwards, instead of when each line is reached. Every line is
+	 * drawn from the registers and VRAM it had when it was reached, so the
+	 * frames are the same either way. 0 draws each line when it is reached.
+	 */
+	void set_render_threads(size_t threads);
+
+	/**
+	 * Draw lines at once per scanline, or dot by dot through the pixel FIFO.
+	 * A line in its pixel transfer starts again with the new renderer.
+	 */
+	void set_render_mode(RenderMode render_mode);
+
+	RenderMode get_render_mode() const;
+
+	/**
+	 * Get the counts of the lines and frames reused
+	 */
+	const RenderStats &get_render_stats() const;
+
+	/**
+	 * Get a snapshot of the timing and video buffer
+	 */
+	GPUState get_state() const;
+
+	/**
+	 * Load the timing and video buffer from a snapshot
+	 */
+	void set_state(const GPUState &state);
 
 	/**
 	 * Debugger may access private members of this class
 	 */
 	friend class debugger::Debugger;
+
+	/**
+	 * Benchmarks may call the rendering internals directly
+	 */
+	friend class bench::GPUAccess;
 };
 
 } // namespace gpu
@@ -0,0 +1,818 @@
+/**
+ * @file gpu_impl.h
+ * Defines the GPU class template. Only included where the GPU is instantiated.
+ */
+
+#pragma once
+
+#include "gpu/gpu.h"
+#include "gpu/pixel_fifo_impl.h"
+#include "gpu/utils.h"
+#include "memory/utils.h"
+
+#include "util/helpers.h"
+#include "util/log.h"
+#include "util/perf.h"
+
+#include <algorithm>
+
+namespace gpu {
+
+namespace io = memory::io;
+
+template <typename Bus, typename Cpu>
+GPU<Bus, Cpu>::GPU(memory::IORegisters *io, Bus *memory, Cpu *cpu,
+                   video::VideoInterface *video)
+    : io(io), memory(memory), cpu(cpu), video(video),
+      display_enabled(io->get_bit(io::LCDC, lcdc_flag::DISPLAY_ENABLE)),
+      mode(GPUMode::OAM), current_cycles(0), hblank_cycles(CLOCKS_HBLANK),
+      render_mode(RenderMode::SCANLINE), fifo(io, memory), v_buffer({}),
+      frame_count(0), bg_buffer({}), line_states(), sprite_state(),
+      last_frame({}), last_frame_valid(false), frame_changed(false),
+      render_stats(), deferred_lines(), deferred_submitted(false),
+      vram_snapshot(nullptr), vram_snapshot_writes(0), render_pool(nullptr) {
+	if (!display_enabled) {
+		change_mode(GPUMode::HBLANK);
+	}
+}
+
+template <typename Bus, typename Cpu>
+void GPU<Bus, Cpu>::tick(cpu::ClockCycles cycles_elapsed) {
+	// Increment local cycle count
+	current_cycles += cycles_elapsed;
+
+	// With the LCD off there is no state machine to run. Blank frames are
+	// still counted and shown, so that the frame rate and window events do
+	// not stall while a game loads VRAM.
+	if (!display_enabled) {
+		if (current_cycles >= CLOCKS_FRAME) {
+			current_cycles -= CLOCKS_FRAME;
+			paint(!last_frame_valid);
+			frame_count++;
+			Perf::end_frame();
+		}
+		return;
+	}
+
+	// Switch modes if we've completed a mode in the current scanline, and
+	// execute code for that mode
+	// Cycle: (OAM -> VRAM -> HBLANK) x 144 lines
+	//        VBLANK x 10 lines
+	switch (mode) {
+	case GPUMode::OAM:
+		if (current_cycles >= CLOCKS_OAM) {
+			current_cycles -= CLOCKS_OAM;
+
+			// The OAM time on real hardware is used for fetching details about
+			// the current scanline's sprite positions and visiblity. Only the
+			// pixel FIFO needs them, and scans OAM all at once here. Then move
+			// into VRAM Pixel transfer mode.
+			if (render_mode == RenderMode::PIXEL_FIFO) {
+				auto line = io->get(io::LY);
+				fifo.start_line(line, &v_buffer[line * SCREEN_WIDTH]);
+			}
+			change_mode(GPUMode::VRAM);
+		}
+		break;
+	case GPUMode::VRAM:
+		// VRAM is when pixel transfer happens onto the screen, and the VRAM
+		// is locked and cannot be accessed. Unlike real hardware, scanline
+		// drawing happens at the the end of the complete scanline after
+		// HBLANK, unless the pixel FIFO draws the pixels as they are reached
+		if (transfer_pixels()) {
+			// If the HBLANK interrupt flag is enabled, fire an LCD interrupt
+			if (io->get_bit(io::STAT, stat_flag::HBLANK_INTERRUPT_ENABLE)) {
+				fire_interrupt(cpu::Interrupt::LCD_STAT);
+			}
+
+			// If the LY register hits the LYC register, set the flag
+			if (io->get(io::LY) == io->get(io::LYC)) {
+				io->set_bit(io::STAT, stat_flag::LYC_COINCIDENCE, 0);
+
+				// If the coincidence interupt is enabled, fire an interrupt
+				if (io->get_bit(io::STAT,
+				                stat_flag::LYC_COINCIDENCE_INTERRUPT_ENABLE)) {
+					fire_interrupt(cpu::Interrupt::LCD_STAT);
+				}
+			} else {
+				io->set_bit(io::STAT, stat_flag::LYC_COINCIDENCE, 0);
+			}
+
+			// Transition to HBLANK mode
+			change_mode(GPUMode::HBLANK);
+		}
+		break;
+	case GPUMode::HBLANK:
+		if (current_cycles >= hblank_cycles) {
+			current_cycles -= hblank_cycles;
+
+			if (render_mode == RenderMode::SCANLINE) {
+				write_line();
+			} else {
+				++render_stats.lines_drawn;
+			}
+
+			// We've completed the HBLANK and this scanline. Increment line_y
+			io->set(io::LY, static_cast<uint8_t>(io->get(io::LY) + 1));
+
+			// There are 144 scanlines on the LCD, after which we break into
+			// VBLANK. Otherwise, we go back to OAM for the next line.
+			if (io->get(io::LY) < 144) {
+				change_mode(GPUMode::OAM);
+			} else {
+				fire_interrupt(cpu::Interrupt::VBLANK);
+				change_mode(GPUMode::VBLANK);
+
+				// The render pool draws the frame during VBLANK
+				if (render_pool) {
+					submit_deferred_lines();
+				}
+			}
+		}
+		break;
+	case GPUMode::VBLANK:
+		if (current_cycles >= CLOCKS_SCANLINE) {
+			current_cycles -= CLOCKS_SCANLINE;
+
+			// The VBLANK runs for an extra 10 scanlines, beyound the 144
+			// scanline screen height. This gives us a total of 154 scanlines
+			// per frame, after which we break into OAM for the first line of
+			// the next frame. Increment the line_y at each line.
+			io->set(io::LY, static_cast<uint8_t>(io->get(io::LY) + 1));
+
+			if (io->get(io::LY) == 154) {
+				end_frame();
+				frame_count++;
+				Perf::end_frame();
+				io->set(io::LY, 0);
+				fifo.start_frame();
+				change_mode(GPUMode::OAM);
+			}
+		}
+		break;
+	};
+}
+
+template <typename Bus, typename Cpu>
+void GPU<Bus, Cpu>::set_display_enabled(bool enabled) {
+	if (enabled == display_enabled) {
+		return;
+	}
+	finish_deferred_lines();
+	display_enabled = enabled;
+	current_cycles = 0;
+	io->set(io::LY, 0);
+	clear_render_cache();
+
+	if (enabled) {
+		// The LCD starts again from the top of the screen
+		fifo.start_frame();
+		change_mode(GPUMode::OAM);
+	} else {
+		// The screen goes blank, and LY is held at 0 in HBLANK
+		change_mode(GPUMode::HBLANK);
+		v_buffer.fill(Pixel::ZERO);
+	}
+}
+
+template <typename Bus, typename Cpu>
+bool GPU<Bus, Cpu>::is_display_enabled() const {
+	return display_enabled;
+}
+
+template <typename Bus, typename Cpu>
+void GPU<Bus, Cpu>::write_line() {
+	auto perf_scope = PerfScope(PerfSection::GPU_LINE);
+	auto current_line = io->get(io::LY);
+
+	// Draw the BG line only if something it is drawn from has changed since
+	// the last frame
+	auto state = get_line_state();
+	if (state == line_states[current_line]) {
+		++render_stats.lines_reused;
+	} else {
+		line_states[current_line] = state;
+		frame_changed = true;
+		++render_stats.lines_drawn;
+
+		// Deferred lines are copied to the video buffer once drawn
+		if (render_pool) {
+			defer_line(state);
+			return;
+		}
+		write_bg_line(state);
+	}
+
+	// Copy the BG line to the video buffer, where the sprites go on top
+	auto line_start = current_line * SCREEN_WIDTH;
+	std::copy_n(bg_buffer.begin() + line_start, SCREEN_WIDTH,
+	            v_buffer.begin() + line_start);
+}
+
+template <typename Bus, typename Cpu>
+LineState GPU<Bus, Cpu>::get_line_state() {
+	auto state = LineState{};
+	state.drawn = true;
+	state.lcdc = io->get(io::LCDC);
+	state.scx = io->get(io::SCX);
+	state.scy = io->get(io::SCY);
+	state.bgp = io->get(io::BGP);
+
+	// The line reads one row of the tile map
+	auto tile_map_index =
+	    io->get_bit(io::LCDC, lcdc_flag::BG_TILE_MAP_DISPLAY_SELECT);
+	auto bg_y = (state.scy + io->get(io::LY)) % BG_HEIGHT;
+	auto map_row = static_cast<Address>(TILE_MAP_ADDRS[tile_map_index] +
+	                                    (bg_y / TILE_HEIGHT) * 32);
+	state.map_writes =
+	    memory->get_write_count(map_row, static_cast<Address>(map_row + 31));
+
+	// And any of the 256 tiles that write_bg_line can address
+	auto tile_set_index =
+	    io->get_bit(io::LCDC, lcdc_flag::BG_TILE_DATA_SELECT);
+	auto tile_shift = tile_set_index == 0 ? 128 : 0;
+	auto tiles_start = static_cast<Address>(TILE_SET_ADDRS[tile_set_index] +
+	                                        tile_shift * TILE_SIZE);
+	state.tile_writes = memory->get_write_count(
+	    tiles_start, static_cast<Address>(tiles_start + 256 * TILE_SIZE - 1));
+	return state;
+}
+
+template <typename Bus, typename Cpu>
+SpriteState GPU<Bus, Cpu>::get_sprite_state() {
+	auto state = SpriteState{};
+	state.lcdc = io->get(io::LCDC);
+	state.obp0 = io->get(io::OBP0);
+	state.obp1 = io->get(io::OBP1);
+	state.oam_writes = memory->get_write_count(
+	    OAM_START_ADDR,
+	    static_cast<Address>(OAM_START_ADDR + 40 * OAM_ENTRY_SIZE - 1));
+
+	// Sprites use the lower tile set, and twice as much of it at 8x16
+	auto tile_size = io->get_bit(io::LCDC, lcdc_flag::SPRITE_SIZE)
+	                     ? 2 * TILE_SIZE
+	                     : TILE_SIZE;
+	state.tile_writes = memory->get_write_count(
+	    TILE_SET_ADDRS[1],
+	    static_cast<Address>(TILE_SET_ADDRS[1] + 256 * tile_size - 1));
+	return state;
+}
+
+template <typename Bus, typename Cpu>
+void GPU<Bus, Cpu>::clear_render_cache() {
+	for (auto &state : line_states) {
+		state.drawn = false;
+	}
+	last_frame_valid = false;
+	vram_snapshot = nullptr;
+}
+
+template <typename Bus, typename Cpu>
+void GPU<Bus, Cpu>::end_frame() {
+	if (render_pool) {
+		auto perf_scope = PerfScope(PerfSection::GPU_LINE);
+		finish_deferred_lines();
+	}
+
+	// The pixel FIFO has drawn the sprites along with the lines
+	if (render_mode == RenderMode::PIXEL_FIFO) {
+		paint(true);
+		return;
+	}
+
+	auto sprites = get_sprite_state();
+	auto changed =
+	    frame_changed || !last_frame_valid || sprites != sprite_state;
+	if (changed) {
+		write_sprites();
+		sprite_state = sprites;
+	}
+	paint(changed);
+	frame_changed = false;
+}
+
+template <typename Bus, typename Cpu>
+void GPU<Bus, Cpu>::paint(bool changed) {
+	if (changed) {
+		video->paint(v_buffer);
+		last_frame = v_buffer;
+		last_frame_valid = true;
+		++render_stats.frames_painted;
+	} else {
+		// Every line was copied from the cache, and the sprites are the same,
+		// so the frame is the last one
+		v_buffer = last_frame;
+		video->repaint();
+		++render_stats.frames_reused;
+	}
+}
+
+template <typename Bus, typename Cpu>
+void GPU<Bus, Cpu>::defer_line(const LineState &state) {
+	auto vram_writes =
+	    memory->get_write_count(VRAMSnapshot::START, VRAMSnapshot::END);
+	if (!vram_snapshot || vram_writes != vram_snapshot_writes) {
+		auto snapshot = std::make_shared<VRAMSnapshot>();
+		memory->peek_block(VRAMSnapshot::START, snapshot->data.data(),
+		                   snapshot->data.size());
+		vram_snapshot = std::move(snapshot);
+		vram_snapshot_writes = vram_writes;
+	}
+
+	deferred_lines.push_back(
+	    DeferredLine{io->get(io::LY), state, vram_snapshot});
+}
+
+template <typename Bus, typename Cpu>
+void GPU<Bus, Cpu>::submit_deferred_lines() {
+	if (deferred_lines.empty()) {
+		return;
+	}
+
+	// One task per thread, each with a run of lines
+	auto threads = render_pool->get_thread_count();
+	auto count = deferred_lines.size();
+	for (size_t thread = 0; thread < threads; ++thread) {
+		auto begin = count * thread / threads;
+		auto end = count * (thread + 1) / threads;
+		if (begin == end) {
+			continue;
+		}
+
+		render_pool->submit([this, begin, end] {
+			for (auto i = begin; i < end; ++i) {
+				auto &deferred = deferred_lines[i];
+				draw_bg_line(*deferred.vram, deferred.state, deferred.line,
+				             &bg_buffer[deferred.line * SCREEN_WIDTH]);
+			}
+		});
+	}
+	deferred_submitted = true;
+}
+
+template <typename Bus, typename Cpu>
+void GPU<Bus, Cpu>::finish_deferred_lines() {
+	if (deferred_submitted) {
+		render_pool->wait();
+		deferred_submitted = false;
+
+		for (auto &deferred : deferred_lines) {
+			auto line_start = deferred.line * SCREEN_WIDTH;
+			std::copy_n(bg_buffer.begin() + line_start, SCREEN_WIDTH,
+			            v_buffer.begin() + line_start);
+		}
+	} else {
+		for (auto &deferred : deferred_lines) {
+			line_states[deferred.line].drawn = false;
+		}
+	}
+	deferred_lines.clear();
+}
+
+template <typename Bus, typename Cpu>
+void GPU<Bus, Cpu>::set_render_threads(size_t threads) {
+	finish_deferred_lines();
+	render_pool = threads ? std::make_unique<ThreadPool>(threads) : nullptr;
+}
+
+template <typename Bus, typename Cpu>
+void GPU<Bus, Cpu>::write_bg_line(const LineState &state) {
+	auto current_line = io->get(io::LY);
+	draw_bg_line(*memory, state, current_line,
+	             &bg_buffer[current_line * SCREEN_WIDTH]);
+}
+
+template <typename Bus, typename Cpu>
+template <typename Source>
+void GPU<Bus, Cpu>::draw_bg_line(const Source &source, const LineState &state,
+                                 uint8_t line, Pixel *pixels) {
+	using Renderer =
+	    void (*)(const Source &, const LineState &, uint8_t, Pixel *);
+
+	// Indexed by the BG tile map select bit, then the tile data select bit
+	static constexpr Renderer renderers[] = {
+	    &draw_bg_line_with<false, false, Source>,
+	    &draw_bg_line_with<false, true, Source>,
+	    &draw_bg_line_with<true, false, Source>,
+	    &draw_bg_line_with<true, true, Source>,
+	};
+	static_assert(lcdc_flag::BG_TILE_DATA_SELECT ==
+	                  lcdc_flag::BG_TILE_MAP_DISPLAY_SELECT + 1,
+	              "The renderer index is two adjacent LCDC bits");
+
+	auto index = (state.lcdc >> lcdc_flag::BG_TILE_MAP_DISPLAY_SELECT) & 0x03;
+	renderers[index](source, state, line, pixels);
+}
+
+template <typename Bus, typename Cpu>
+template <bool HighTileData, bool HighTileMap, typename Source>
+void GPU<Bus, Cpu>::draw_bg_line_with(const Source &source,
+                                      const LineState &state, uint8_t line,
+                                      Pixel *pixels) {
+	// This keeps the addressing the scanline renderer has always had, which
+	// is not the hardware's. Tile numbers of the $8800 tile set are unsigned
+	// from $9000, so tiles 128-255 are read from $9800 onwards instead of
+	// $8800-$8FFF. The first byte of each tile line is also taken as the high
+	// bit plane, where the hardware has it as the low one.
+	//
+	// TODO: Switch to the hardware addressing and bit order, which the pixel
+	// FIFO already uses. That changes the frame hashes of the regression
+	// tests, so they need to be regenerated along with it.
+	const auto tile_data_addr = HighTileData
+	                                ? TILE_SET_ADDRS[1]
+	                                : TILE_SET_ADDRS[0] + 128 * TILE_SIZE;
+	const auto tile_map_addr = TILE_MAP_ADDRS[HighTileMap];
+	auto colors = get_palette_colors(state.bgp);
+
+	// The whole line is in one row of the BG map, and one line of its tiles
+	// Mod by BG dimensions to account for wrapping
+	auto bg_y = (state.scy + line) % BG_HEIGHT;
+	auto map_row_addr = tile_map_addr + (bg_y / TILE_HEIGHT) * 32;
+	auto tile_line_offset = 2 * (bg_y % TILE_HEIGHT);
+
+	// Draw a tile at a time, starting partway into the first one when the
+	// scroll isn't a multiple of the tile width
+	auto bg_x = static_cast<int>(state.scx);
+	auto tile_index_x = bg_x % TILE_WIDTH;
+	for (int i = 0; i < SCREEN_WIDTH;) {
+		// Fetch the tile number from the tile map in memory
+		auto tile_x = (bg_x % BG_WIDTH) / TILE_WIDTH;
+		auto tile_num =
+		    source.peek(static_cast<Address>(map_row_addr + tile_x));
+
+		// Find the addr of this tile's line and read both of its bytes
+		auto tile_line_index =
+		    tile_data_addr + tile_num * TILE_SIZE + tile_line_offset;
+		auto pix_data_high =
+		    source.peek(static_cast<Address>(tile_line_index));
+		auto pix_data_low =
+		    source.peek(static_cast<Address>(tile_line_index + 1));
+
+		for (; tile_index_x < TILE_WIDTH && i < SCREEN_WIDTH;
+		     ++tile_index_x, ++i) {
+			auto reverse_index_x = 7 - tile_index_x;
+			auto first = (pix_data_high >> reverse_index_x) & 1;
+			auto second = (pix_data_low >> reverse_index_x) & 1;
+			pixels[i] = colors[(first << 1) | second];
+		}
+
+		bg_x += TILE_WIDTH - (bg_x % TILE_WIDTH);
+		tile_index_x = 0;
+	}
+}
+
+template <typename Bus, typename Cpu>
+void GPU<Bus, Cpu>::write_sprites() {
+	auto perf_scope = PerfScope(PerfSection::GPU_SPRITES);
+
+	// The sprite size is the same for the whole frame
+	if (io->get_bit(io::LCDC, lcdc_flag::SPRITE_SIZE)) {
+		write_sprites_with<true>();
+	} else {
+		write_sprites_with<false>();
+	}
+}
+
+template <typename Bus, typename Cpu>
+template <bool TallSprites>
+void GPU<Bus, Cpu>::write_sprites_with() {
+	constexpr auto sprite_size_scale = TallSprites ? 2 : 1;
+	constexpr auto real_height = TILE_HEIGHT * sprite_size_scale;
+	constexpr auto tile_size = TILE_SIZE * sprite_size_scale;
+
+	// Sprites are taken from the lower tileset
+	auto tile_set_addr = TILE_SET_ADDRS[1];
+
+	// Both palettes are the same for every sprite
+	auto palettes = std::array<std::array<Pixel, 4>, 2>{
+	    get_palette_colors(io->get(io::OBP0)),
+	    get_palette_colors(io->get(io::OBP1))};
+
+	// For all 40 sprites in OAM...
+	for (int i = 0; i < 40; ++i) {
+
+		// Get the current sprite OAM info from memory
+		auto curr_addr = OAM_START_ADDR + (i * OAM_ENTRY_SIZE);
+		auto oam = get_oam_from_memory(curr_addr);
+
+		// Top-left corner points are easier to work with
+		auto sprite_x = oam.pos_x - 8;
+		auto sprite_y = oam.pos_y - 16;
+
+		// Skip drawing sprites which are offscreen
+		if (oam.pos_x == 0 || oam.pos_x >= SCREEN_HEIGHT + 24)
+			continue;
+
+		if (oam.pos_y == 0 || oam.pos_y >= SCREEN_WIDTH)
+			continue;
+
+		// Load the right palette based on the current palette flag
+		auto &colors = palettes[oam.palette];
+
+		// TODO: Tall sprites start at 16 * (tile_number & 0xFE) on the
+		// hardware, as in the pixel FIFO. This keeps the original addressing.
+		auto tile_start = tile_set_addr + tile_size * oam.tile_number;
+
+		// Draw the 8x8 or 8x16 pixel by copying the right pixels from the
+		// tileset to the screen, from the rectangular tile of addresses
+		for (int y = 0; y < real_height; ++y) {
+			// Handle sprite flipping
+			auto rel_y = oam.flip_y ? real_height - (y + 1) : y;
+
+			// Bounds checks
+			auto pixel_y = sprite_y + rel_y;
+			if (pixel_y < 0 || pixel_y >= SCREEN_HEIGHT)
+				continue;
+
+			// Each line of the tile has two bytes
+			auto line_start = static_cast<Address>(tile_start + 2 * rel_y);
+			auto lower = memory->peek(line_start);
+			auto higher = memory->peek(line_start + 1);
+
+			for (int x = 0; x < TILE_WIDTH; ++x) {
+				auto rel_x = oam.flip_x ? TILE_WIDTH - (x + 1) : x;
+
+				// Find actual screen pixel to draw on
+				auto pixel_x = sprite_x + rel_x;
+				if (pixel_x < 0 || pixel_x >= SCREEN_WIDTH)
+					continue;
+
+				// Get pixel from the tile line, and draw it
+				auto bit_num = 7 - rel_x;
+				auto high_bit = (higher >> bit_num) & 1;
+				auto low_bit = (lower >> bit_num) & 1;
+				v_buffer[pixel_y * SCREEN_WIDTH + pixel_x] =
+				    colors[(high_bit << 1) | low_bit];
+			}
+		}
+	}
+}
+
+template <typename Bus, typename Cpu>
+bool GPU<Bus, Cpu>::transfer_pixels() {
+	if (render_mode == RenderMode::SCANLINE) {
+		if (current_cycles < CLOCKS_VRAM) {
+			return false;
+		}
+		current_cycles -= CLOCKS_VRAM;
+		hblank_cycles = CLOCKS_HBLANK;
+		return true;
+	}
+
+	// Catch the pixel FIFO up to the cycles elapsed, a dot at a time. HBLANK
+	// takes the rest of the line once it is done. This runs after every
+	// instruction, so it is too fine grained to time, and counts as CPU.
+	while (fifo.get_dots() < current_cycles) {
+		if (fifo.step()) {
+			current_cycles -= fifo.get_dots();
+			hblank_cycles = CLOCKS_SCANLINE - CLOCKS_OAM - fifo.get_dots();
+			return true;
+		}
+	}
+	return false;
+}
+
+template <typename Bus, typename Cpu>
+Pixel GPU<Bus, Cpu>::get_pixel_from_palette(GBPixel gb_pixel,
+                                             uint8_t palette) {
+	auto pix_index = static_cast<uint8_t>(gb_pixel);
+	auto reg_value = palette;
+
+	// Read the required palette bits from the register
+	// The 4 palette values are stored as pairs of bits
+	bool high_bit = reg_value & (1 << (2 * pix_index + 1));
+	bool low_bit = reg_value & (1 << (2 * pix_index));
+
+	auto pix_value = (high_bit << 1) + low_bit;
+
+	return static_cast<Pixel>(pix_value);
+}
+
+template <typename Bus, typename Cpu>
+std::array<Pixel, 4> GPU<Bus, Cpu>::get_palette_colors(uint8_t palette) {
+	return {get_pixel_from_palette(GBPixel::ZERO, palette),
+	        get_pixel_from_palette(GBPixel::ONE, palette),
+	        get_pixel_from_palette(GBPixel::TWO, palette),
+	        get_pixel_from_palette(GBPixel::THREE, palette)};
+}
+
+template <typename Bus, typename Cpu>
+void GPU<Bus, Cpu>::change_mode(GPUMode new_mode) {
+	// Change modes
+	mode = new_mode;
+
+	// Set the correct bits in the status register
+	// OAM    -> 10
+	// VRAM   -> 11
+	// HBLANK -> 00
+	// VBLANK -> 01
+	switch (mode) {
+	case GPUMode::OAM:
+		io->set_bit(io::STAT, stat_flag::MODE_HIGH_BIT, 1);
+		io->set_bit(io::STAT, stat_flag::MODE_LOW_BIT, 0);
+		break;
+	case GPUMode::VRAM:
+		io->set_bit(io::STAT, stat_flag::MODE_HIGH_BIT, 1);
+		io->set_bit(io::STAT, stat_flag::MODE_LOW_BIT, 1);
+		break;
+	case GPUMode::HBLANK:
+		io->set_bit(io::STAT, stat_flag::MODE_HIGH_BIT, 0);
+		io->set_bit(io::STAT, stat_flag::MODE_LOW_BIT, 0);
+		break;
+	case GPUMode::VBLANK:
+		io->set_bit(io::STAT, stat_flag::MODE_HIGH_BIT, 0);
+		io->set_bit(io::STAT, stat_flag::MODE_LOW_BIT, 1);
+		break;
+	}
+}
+
+template <typename Bus, typename Cpu>
+void GPU<Bus, Cpu>::fire_interrupt(cpu::Interrupt interrupt) {
+	cpu->get_interrupts()->request(interrupt);
+}
+
+template <typename Bus, typename Cpu>
+OAMEntry GPU<Bus, Cpu>::get_oam_from_memory(Address address) {
+	auto entry = OAMEntry{};
+
+	// Read the first three bytes
+	entry.pos_y = memory->peek(address);
+	entry.pos_x = memory->peek(address + 1);
+	entry.tile_number = memory->peek(address + 2);
+
+	// Use fourth byte to set flags
+	auto flags = memory->peek(address + 3);
+	entry.priority = flags & (1 << oam_flag::BG_PRIORITY);
+	entry.flip_x = flags & (1 << oam_flag::FLIP_X);
+	entry.flip_y = flags & (1 << oam_flag::FLIP_Y);
+	entry.palette = flags & (1 << oam_flag::PALETTE);
+
+	return entry;
+}
+
+template <typename Bus, typename Cpu>
+Tile GPU<Bus, Cpu>::get_tile_from_memory(uint8_t tile_number, bool sprite) {
+	// Check for double height sprites if a sprite is requested
+	auto size_multiplier = 1;
+	if (sprite && io->get_bit(io::LCDC, lcdc_flag::SPRITE_SIZE)) {
+		size_multiplier = 2;
+	}
+
+	// Determine the start address of this tile
+	// Sprites are always pulled from the lower tileset
+	auto tile_set_num = io->get_bit(io::LCDC, lcdc_flag::BG_TILE_DATA_SELECT);
+	auto tile_set_addr =
+	    sprite ? TILE_SET_ADDRS[1] : TILE_SET_ADDRS[tile_set_num];
+	auto tile_height = 8 * size_multiplier;
+	auto tile_size = TILE_SIZE * size_multiplier;
+	auto tile_offset = tile_size * tile_number;
+
+	Address tile_start = tile_set_addr + tile_offset;
+
+	// Tile Data is stored by composing the two bytes in each line of the 8x8
+	// (or 16x8) tile. For example, the first line in a tile image (where the
+	// numbers here correspond to the GBPixel value) would look like :
+	//
+	// 1 2 2 1 3 3 2 0
+	//
+	// We convert this to binary, then compose the upper and lower bits together
+	// 0 1 1 0 1 1 1 0  ->  6E
+	// 1 0 0 1 1 1 0 0  ->  9C
+	//
+	// Hence, this first line of the tile would be represented as two adjacent
+	// bytes in memory : 0x6E and 0x9C. Similarly, we would read each of the 8
+	// lines for a total of 16 bytes (Or 32 bytes for double height tiles)
+
+	auto tile = Tile{};
+	tile.double_height = size_multiplier == 2 ? true : false;
+	tile.data.reserve(tile_size);
+
+	for (int line = 0; line < tile_height; ++line) {
+		// Each line has two bytes
+		auto line_index = 2 * line;
+		Address line_start = tile_start + line_index;
+
+		// Read these two bytes
+		auto lower = memory->peek(line_start);
+		auto higher = memory->peek(line_start + 1);
+
+		// Convert line bytes into colors
+		for (int i = 0; i < 8; ++i) {
+			auto bit_num = 7 - i;
+			bool high_bit = (1 << bit_num) & higher;
+			bool low_bit = (1 << bit_num) & lower;
+
+			uint8_t color_val = (high_bit << 1) | low_bit;
+			auto color = static_cast<GBPixel>(color_val);
+
+			tile.data.push_back(color);
+		}
+	}
+
+	return tile;
+}
+
+template <typename Bus, typename Cpu>
+uint64_t GPU<Bus, Cpu>::get_frame_count() { return frame_count; }
+
+template <typename Bus, typename Cpu>
+cpu::ClockCycles GPU<Bus, Cpu>::get_cycles_until_event() {
+	cpu::ClockCycles mode_cycles = 0;
+	if (!display_enabled) {
+		mode_cycles = CLOCKS_FRAME;
+	} else {
+		switch (mode) {
+		case GPUMode::OAM:
+			mode_cycles = CLOCKS_OAM;
+			break;
+		case GPUMode::VRAM:
+			if (render_mode == RenderMode::SCANLINE) {
+				mode_cycles = CLOCKS_VRAM;
+			}
+			break;
+		case GPUMode::HBLANK:
+			mode_cycles = hblank_cycles;
+			break;
+		case GPUMode::VBLANK:
+			mode_cycles = CLOCKS_SCANLINE;
+			break;
+		}
+	}
+
+	// The GPU may already be behind, if the CPU ran a long block
+	return current_cycles < mode_cycles ? mode_cycles - current_cycles : 0;
+}
+
+template <typename Bus, typename Cpu>
+const VideoBuffer &GPU<Bus, Cpu>::get_video_buffer() const { return v_buffer; }
+
+template <typename Bus, typename Cpu>
+void GPU<Bus, Cpu>::set_render_mode(RenderMode new_mode) {
+	if (new_mode == render_mode) {
+		return;
+	}
+	finish_deferred_lines();
+	render_mode = new_mode;
+	clear_render_cache();
+
+	// The pixel FIFO catches up with the cycles already in the transfer
+	if (render_mode == RenderMode::PIXEL_FIFO && mode == GPUMode::VRAM) {
+		auto line = io->get(io::LY);
+		fifo.start_line(line, &v_buffer[line * SCREEN_WIDTH]);
+	}
+}
+
+template <typename Bus, typename Cpu>
+RenderMode GPU<Bus, Cpu>::get_render_mode() const {
+	return render_mode;
+}
+
+template <typename Bus, typename Cpu>
+const RenderStats &GPU<Bus, Cpu>::get_render_stats() const {
+	return render_stats;
+}
+
+template <typename Bus, typename Cpu>
+GPUState GPU<Bus, Cpu>::get_state() const {
+	auto state = GPUState{};
+	state.display_enabled = display_enabled;
+	state.mode = mode;
+	state.current_cycles = current_cycles;
+	state.hblank_cycles = hblank_cycles;
+	state.frame_count = frame_count;
+	state.v_buffer = v_buffer;
+	state.fifo = fifo.get_state();
+
+	// Include the lines that the render pool is still drawing
+	if (deferred_submitted) {
+		render_pool->wait();
+		for (auto &deferred : deferred_lines) {
+			auto line_start = deferred.line * SCREEN_WIDTH;
+			std::copy_n(bg_buffer.begin() + line_start, SCREEN_WIDTH,
+			            state.v_buffer.begin() + line_start);
+		}
+	}
+	return state;
+}
+
+template <typename Bus, typename Cpu>
+void GPU<Bus, Cpu>::set_state(const GPUState &state) {
+	finish_deferred_lines();
+	display_enabled = state.display_enabled;
+	mode = state.mode;
+	current_cycles = state.current_cycles;
+	hblank_cycles = state.hblank_cycles;
+	frame_count = state.frame_count;
+	v_buffer = state.v_buffer;
+	fifo.set_state(state.fifo);
+	clear_render_cache();
+
+	// The pixel FIFO draws a line in its pixel transfer again from the start
+	if (render_mode == RenderMode::PIXEL_FIFO && display_enabled &&
+	    mode == GPUMode::VRAM) {
+		auto line = io->get(io::LY);
+		fifo.start_line(line, &v_buffer[line * SCREEN_WIDTH]);
+	}
+}
+
+} // namespace gpu
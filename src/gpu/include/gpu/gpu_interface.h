@@ -3,7 +3,6 @@
  * Declares the interface for a GPU
  */
 
-#include "cpu/register/register_interface.h"
 #include "cpu/utils.h"
 
 #include <cstdint>
@@ -22,19 +21,10 @@ class GPUInterface {
 	 */
 	virtual void tick(cpu::ClockCycles cycles) = 0;
 
-	/// Getters for the 12 GPU registers
-	virtual cpu::IReg *get_lcdc() = 0;
-	virtual cpu::IReg *get_stat() = 0;
-	virtual cpu::IReg *get_scy() = 0;
-	virtual cpu::IReg *get_scx() = 0;
-	virtual cpu::IReg *get_ly() = 0;
-	virtual cpu::IReg *get_lyc() = 0;
-	virtual cpu::IReg *get_wy() = 0;
-	virtual cpu::IReg *get_wx() = 0;
-	virtual cpu::IReg *get_bgp() = 0;
-	virtual cpu::IReg *get_obp0() = 0;
-	virtual cpu::IReg *get_obp1() = 0;
-	virtual cpu::IReg *get_dma() = 0;
+	/**
+	 * Turn the LCD on or off, when bit 7 of the LCD Control register changes
+	 */
+	virtual void set_display_enabled(bool enabled) = 0;
 };
 
 } // namespace gpu
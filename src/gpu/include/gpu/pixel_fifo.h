@@ -0,0 +1,225 @@
+/**
+ * @file pixel_fifo.h
+ * Declares the PixelFifo class, which draws the GPU's lines a dot at a time
+ */
+
+#include "cpu/utils.h"
+#include "gpu/utils.h"
+#include "memory/io_registers.h"
+
+#include <array>
+#include <cstdint>
+
+#pragma once
+
+namespace gpu {
+
+/**
+ * A sprite picked by the OAM scan for the current line, as stored in OAM
+ */
+struct LineSprite {
+	uint8_t pos_y;
+	uint8_t pos_x;
+	uint8_t tile_number;
+	uint8_t flags;
+};
+
+/**
+ * One pixel of a sprite, waiting in the sprite FIFO
+ */
+struct SpritePixel {
+	/**
+	 * Color number in the sprite's palette. 0 is transparent.
+	 */
+	uint8_t color;
+
+	/**
+	 * OBP1 rather than OBP0
+	 */
+	bool palette;
+
+	/**
+	 * Only drawn over BG color 0
+	 */
+	bool behind_bg;
+};
+
+/**
+ * The frame state of the pixel FIFO that carries over between lines
+ */
+struct PixelFifoState {
+	/**
+	 * Line of the window to draw next
+	 */
+	uint8_t window_line;
+
+	/**
+	 * Set once LY has matched WY in this frame, after which the window can
+	 * start on any line
+	 */
+	bool window_reached;
+};
+
+/**
+ * Draws the pixels of a line during the pixel transfer mode, one dot at a
+ * time, the way the hardware does. A fetcher reads a tile line every 6 dots
+ * into the BG FIFO, which shifts one pixel out to the LCD every dot. Sprites
+ * are fetched into a second FIFO when the LCD reaches them, and stall the BG
+ * while they are fetched.
+ *
+ * Every register is read when the hardware would read it, so writes during
+ * a line take effect from the next pixel or tile. The length of the pixel
+ * transfer depends on the line: 172 dots, plus one for each pixel of the
+ * SCX fine scroll, 6 to start the window, and 6 to 11 for each sprite.
+ *
+ * @tparam Bus Memory the tiles and sprites are read from
+ */
+template <typename Bus> class PixelFifo {
+	/**
+	 * Dots the fetcher takes to read a tile number and both bytes of a
+	 * tile line. After this it waits for the BG FIFO to empty, and pushes.
+	 */
+	static constexpr uint8_t FETCH_DOTS = 6;
+
+	/**
+	 * Dots a sprite fetch stalls the LCD for. Before that, it waits for the
+	 * fetcher to be done with the BG tile up to this dot of the fetch.
+	 */
+	static constexpr uint8_t SPRITE_FETCH_DOTS = 6;
+	static constexpr uint8_t SPRITE_WAIT_DOT = 5;
+
+	/**
+	 * At most 10 sprites are drawn on a line
+	 */
+	static constexpr uint8_t MAX_LINE_SPRITES = 10;
+
+	memory::IORegisters *io;
+	Bus *memory;
+
+	/**
+	 * Where the pixels of the current line go, and the line number
+	 */
+	Pixel *pixels;
+	uint8_t line;
+
+	/**
+	 * Dots of the pixel transfer so far, and pixels sent to the LCD
+	 */
+	cpu::ClockCycles dots;
+	uint8_t lcd_x;
+
+	/**
+	 * Pixels still to drop from the FIFO before the LCD takes any, for the
+	 * SCX fine scroll, or for a window that starts left of the screen
+	 */
+	uint8_t discard;
+
+	/**
+	 * Fetcher state: dots into the current fetch, the tile column it reads,
+	 * and the bytes read so far. The first fetch of every line is made
+	 * twice, and the first result dropped.
+	 */
+	uint8_t fetch_dot;
+	uint8_t fetch_x;
+	uint8_t fetch_tile;
+	uint8_t fetch_low;
+	uint8_t fetch_high;
+	bool fetch_dummy;
+	bool fetch_window;
+
+	/**
+	 * The BG FIFO, as the two bit planes of up to 8 pixels, shifted out from
+	 * the top bit. The fetcher only pushes when it is empty, so it never
+	 * holds more than one tile line.
+	 */
+	uint8_t bg_low;
+	uint8_t bg_high;
+	uint8_t bg_count;
+
+	/**
+	 * The sprite FIFO, which shifts out along with the BG FIFO
+	 */
+	std::array<SpritePixel, TILE_WIDTH> sprite_fifo;
+	uint8_t sprite_head;
+	uint8_t sprite_count;
+
+	/**
+	 * Sprites on this line, in the order they are fetched, and the next one
+	 * to fetch. The LCD is stalled for sprite_stall more dots while the next
+	 * one is fetched.
+	 */
+	std::array<LineSprite, MAX_LINE_SPRITES> sprites;
+	uint8_t line_sprite_count;
+	uint8_t next_sprite;
+	uint8_t sprite_stall;
+
+	/**
+	 * Window progress through the frame
+	 */
+	PixelFifoState state;
+
+	/**
+	 * Pick the sprites on this line from OAM, in the order they are fetched
+	 */
+	void scan_oam();
+
+	/**
+	 * Run the fetcher for one dot
+	 */
+	void step_fetcher();
+
+	/**
+	 * Stop the BG and start fetching the window, if the LCD has reached it
+	 */
+	void start_window();
+
+	/**
+	 * Read the next sprite's line, and mix it into the sprite FIFO
+	 */
+	void fetch_sprite();
+
+	/**
+	 * Shift a pixel out of both FIFOs, and send it to the LCD unless it is
+	 * discarded
+	 */
+	void shift_pixel();
+
+  public:
+	PixelFifo(memory::IORegisters *io, Bus *memory);
+
+	/**
+	 * Reset the window for a new frame
+	 */
+	void start_frame();
+
+	/**
+	 * Scan OAM and empty the FIFOs for the given line, at the end of the OAM
+	 * mode
+	 *
+	 * @param line Index of the line on the screen
+	 * @param pixels Where to write the line's SCREEN_WIDTH pixels
+	 */
+	void start_line(uint8_t line, Pixel *pixels);
+
+	/**
+	 * Run the pixel transfer for one dot
+	 *
+	 * @return true once the last pixel of the line has been sent
+	 */
+	bool step();
+
+	/**
+	 * Get the number of dots the pixel transfer has run for on this line
+	 */
+	cpu::ClockCycles get_dots() const { return dots; }
+
+	/**
+	 * Get the number of pixels sent to the LCD on this line
+	 */
+	uint8_t get_lcd_x() const { return lcd_x; }
+
+	PixelFifoState get_state() const { return state; }
+	void set_state(const PixelFifoState &new_state) { state = new_state; }
+};
+
+} // namespace gpu
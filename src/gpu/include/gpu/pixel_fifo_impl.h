@@ -0,0 +1,287 @@
+/**
+ * @file pixel_fifo_impl.h
+ * Defines the PixelFifo class template. Only included where the GPU is
+ * instantiated.
+ */
+
+#pragma once
+
+#include "gpu/pixel_fifo.h"
+#include "memory/utils.h"
+
+#include <algorithm>
+
+namespace gpu {
+
+namespace io = memory::io;
+
+template <typename Bus>
+PixelFifo<Bus>::PixelFifo(memory::IORegisters *io, Bus *memory)
+    : io(io), memory(memory), pixels(nullptr), line(0), dots(0), lcd_x(0),
+      discard(0), fetch_dot(0), fetch_x(0), fetch_tile(0), fetch_low(0),
+      fetch_high(0), fetch_dummy(false), fetch_window(false), bg_low(0),
+      bg_high(0), bg_count(0), sprite_fifo(), sprite_head(0),
+      sprite_count(0), sprites(), line_sprite_count(0), next_sprite(0),
+      sprite_stall(0), state() {}
+
+template <typename Bus> void PixelFifo<Bus>::start_frame() {
+	state = PixelFifoState{};
+}
+
+template <typename Bus>
+void PixelFifo<Bus>::start_line(uint8_t new_line, Pixel *new_pixels) {
+	line = new_line;
+	pixels = new_pixels;
+	dots = 0;
+	lcd_x = 0;
+	discard = io->get(io::SCX) % TILE_WIDTH;
+
+	fetch_dot = 0;
+	fetch_x = 0;
+	fetch_dummy = true;
+	fetch_window = false;
+	bg_count = 0;
+	sprite_head = 0;
+	sprite_count = 0;
+	next_sprite = 0;
+	sprite_stall = 0;
+
+	// The window can only start on lines from the one that matches WY
+	if (io->get(io::WY) == line) {
+		state.window_reached = true;
+	}
+	scan_oam();
+}
+
+template <typename Bus> void PixelFifo<Bus>::scan_oam() {
+	auto height = io->get_bit(io::LCDC, lcdc_flag::SPRITE_SIZE)
+	                  ? 2 * TILE_HEIGHT
+	                  : TILE_HEIGHT;
+
+	// The first 10 sprites in OAM that cover the line
+	line_sprite_count = 0;
+	for (int i = 0; i < 40 && line_sprite_count < MAX_LINE_SPRITES; ++i) {
+		auto address =
+		    static_cast<Address>(OAM_START_ADDR + i * OAM_ENTRY_SIZE);
+		auto top = memory->peek(address) - 16;
+		if (line < top || line >= top + height) {
+			continue;
+		}
+
+		auto &sprite = sprites[line_sprite_count++];
+		sprite.pos_y = memory->peek(address);
+		sprite.pos_x = memory->peek(address + 1);
+		sprite.tile_number = memory->peek(address + 2);
+		sprite.flags = memory->peek(address + 3);
+	}
+
+	// Sprites are fetched from left to right. Where they overlap, the first
+	// one fetched wins, which is the one with the lower X, then the one
+	// first in OAM.
+	std::stable_sort(sprites.begin(), sprites.begin() + line_sprite_count,
+	                 [](const LineSprite &a, const LineSprite &b) {
+		                 return a.pos_x < b.pos_x;
+	                 });
+}
+
+template <typename Bus> bool PixelFifo<Bus>::step() {
+	++dots;
+
+	// The fetcher carries on with its BG tile during a sprite stall
+	if (sprite_stall) {
+		if (fetch_dot < FETCH_DOTS) {
+			step_fetcher();
+		}
+		if (--sprite_stall == 0) {
+			fetch_sprite();
+		}
+		return false;
+	}
+
+	start_window();
+	step_fetcher();
+	if (bg_count == 0) {
+		return false;
+	}
+
+	// Sprites the LCD passed while they were off are never fetched
+	while (next_sprite < line_sprite_count &&
+	       sprites[next_sprite].pos_x + TILE_WIDTH <= lcd_x) {
+		++next_sprite;
+	}
+
+	// Stall the LCD when it reaches the next sprite
+	if (next_sprite < line_sprite_count && discard == 0 &&
+	    io->get_bit(io::LCDC, lcdc_flag::SPRITE_DISPLAY_ENABLE) &&
+	    sprites[next_sprite].pos_x <= lcd_x + 8) {
+		auto wait =
+		    fetch_dot < SPRITE_WAIT_DOT ? SPRITE_WAIT_DOT - fetch_dot : 0;
+		sprite_stall = static_cast<uint8_t>(SPRITE_FETCH_DOTS + wait - 1);
+		return false;
+	}
+
+	shift_pixel();
+	if (lcd_x < SCREEN_WIDTH) {
+		return false;
+	}
+
+	if (fetch_window) {
+		++state.window_line;
+	}
+	return true;
+}
+
+template <typename Bus> void PixelFifo<Bus>::step_fetcher() {
+	// Push a fetched tile line once the BG FIFO is empty
+	if (fetch_dot == FETCH_DOTS) {
+		if (bg_count == 0) {
+			bg_low = fetch_low;
+			bg_high = fetch_high;
+			bg_count = TILE_WIDTH;
+			fetch_dot = 0;
+			++fetch_x;
+		}
+		return;
+	}
+
+	// Each read takes two dots
+	++fetch_dot;
+	if (fetch_dot % 2) {
+		return;
+	}
+
+	auto lcdc = io->get(io::LCDC);
+	auto tile_y = fetch_window
+	                  ? state.window_line
+	                  : static_cast<uint8_t>(line + io->get(io::SCY));
+
+	if (fetch_dot == 2) {
+		auto map_select = fetch_window
+		                      ? lcdc_flag::WINDOW_TILE_SELECT
+		                      : lcdc_flag::BG_TILE_MAP_DISPLAY_SELECT;
+		auto tile_x = fetch_window
+		                  ? fetch_x
+		                  : io->get(io::SCX) / TILE_WIDTH + fetch_x;
+		auto map_addr = TILE_MAP_ADDRS[(lcdc >> map_select) & 1] +
+		                (tile_y / TILE_HEIGHT) * 32 + (tile_x % 32);
+		fetch_tile = memory->peek(static_cast<Address>(map_addr));
+		return;
+	}
+
+	// Tiles are numbered from $8000, or signed from $9000
+	auto tile_addr =
+	    lcdc & (1 << lcdc_flag::BG_TILE_DATA_SELECT)
+	        ? TILE_SET_ADDRS[1] + fetch_tile * TILE_SIZE
+	        : 0x9000 + static_cast<int8_t>(fetch_tile) * TILE_SIZE;
+	auto line_addr =
+	    static_cast<Address>(tile_addr + (tile_y % TILE_HEIGHT) * 2);
+
+	if (fetch_dot == 4) {
+		fetch_low = memory->peek(line_addr);
+	} else {
+		fetch_high = memory->peek(line_addr + 1);
+
+		// The first fetch of the line is thrown away, and made again
+		if (fetch_dummy) {
+			fetch_dummy = false;
+			fetch_dot = 0;
+		}
+	}
+}
+
+template <typename Bus> void PixelFifo<Bus>::start_window() {
+	if (fetch_window || !state.window_reached ||
+	    !io->get_bit(io::LCDC, lcdc_flag::WINDOW_DISPLAY_ENABLE)) {
+		return;
+	}
+
+	// WX is the screen X of the window plus 7
+	auto window_x = io->get(io::WX);
+	if (lcd_x + 7 < window_x) {
+		return;
+	}
+
+	// Throw away the BG, and fetch the window from its first column
+	fetch_window = true;
+	fetch_x = 0;
+	fetch_dot = 0;
+	bg_count = 0;
+	discard = window_x < 7 ? static_cast<uint8_t>(7 - window_x) : 0;
+}
+
+template <typename Bus> void PixelFifo<Bus>::fetch_sprite() {
+	auto &sprite = sprites[next_sprite++];
+	auto tall = io->get_bit(io::LCDC, lcdc_flag::SPRITE_SIZE);
+	auto height = tall ? 2 * TILE_HEIGHT : TILE_HEIGHT;
+
+	// Both tiles of a tall sprite are read as one, from an even tile number
+	auto row = line + 16 - sprite.pos_y;
+	if (sprite.flags & (1 << oam_flag::FLIP_Y)) {
+		row = height - 1 - row;
+	}
+	auto tile_number = tall ? sprite.tile_number & 0xFE : sprite.tile_number;
+	auto line_addr = static_cast<Address>(TILE_SET_ADDRS[1] +
+	                                      tile_number * TILE_SIZE + row * 2);
+	auto low = memory->peek(line_addr);
+	auto high = memory->peek(line_addr + 1);
+
+	auto flip_x = sprite.flags & (1 << oam_flag::FLIP_X);
+	auto palette = (sprite.flags & (1 << oam_flag::PALETTE)) != 0;
+	auto behind_bg = (sprite.flags & (1 << oam_flag::BG_PRIORITY)) != 0;
+
+	// Pixels left of the screen are dropped. The rest only replace pixels of
+	// earlier sprites that are transparent.
+	auto skip = std::min(lcd_x + 8 - sprite.pos_x, int{TILE_WIDTH});
+	for (auto i = skip; i < TILE_WIDTH; ++i) {
+		auto bit = flip_x ? i : 7 - i;
+		auto color = static_cast<uint8_t>((((high >> bit) & 1) << 1) |
+		                                  ((low >> bit) & 1));
+
+		auto slot = i - skip;
+		auto &pixel = sprite_fifo[(sprite_head + slot) % TILE_WIDTH];
+		if (slot >= sprite_count || pixel.color == 0) {
+			pixel = SpritePixel{color, palette, behind_bg};
+		}
+	}
+	sprite_count = std::max(sprite_count, static_cast<uint8_t>(8 - skip));
+}
+
+template <typename Bus> void PixelFifo<Bus>::shift_pixel() {
+	auto bg_color =
+	    static_cast<uint8_t>(((bg_high >> 7) << 1) | (bg_low >> 7));
+	bg_low = static_cast<uint8_t>(bg_low << 1);
+	bg_high = static_cast<uint8_t>(bg_high << 1);
+	--bg_count;
+
+	auto sprite = SpritePixel{0, false, false};
+	if (sprite_count) {
+		sprite = sprite_fifo[sprite_head];
+		sprite_head = (sprite_head + 1) % TILE_WIDTH;
+		--sprite_count;
+	}
+
+	if (discard) {
+		--discard;
+		return;
+	}
+
+	// With the BG off, it is blank, and every sprite pixel is on top
+	auto lcdc = io->get(io::LCDC);
+	auto bg_enabled = lcdc & (1 << lcdc_flag::BG_DISPLAY);
+	if (!bg_enabled) {
+		bg_color = 0;
+	}
+
+	auto pixel = Pixel::ZERO;
+	if (sprite.color && (lcdc & (1 << lcdc_flag::SPRITE_DISPLAY_ENABLE)) &&
+	    !(sprite.behind_bg && bg_color)) {
+		auto palette = io->get(sprite.palette ? io::OBP1 : io::OBP0);
+		pixel = static_cast<Pixel>((palette >> (2 * sprite.color)) & 0x03);
+	} else if (bg_enabled) {
+		auto palette = io->get(io::BGP);
+		pixel = static_cast<Pixel>((palette >> (2 * bg_color)) & 0x03);
+	}
+	pixels[lcd_x++] = pixel;
+}
+
+} // namespace gpu
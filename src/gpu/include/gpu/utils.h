@@ -48,6 +48,20 @@ using VideoBuffer = std::array<Pixel, PIXEL_COUNT>;
  */
 enum class GPUMode { OAM, VRAM, HBLANK, VBLANK };
 
+/**
+ * Selects how the GPU draws lines
+ * SCANLINE   -> Draw each line at once after its HBLANK. The pixel transfer
+ *               always takes CLOCKS_VRAM.
+ * PIXEL_FIFO -> Draw a dot at a time through a pixel FIFO during the pixel
+ *               transfer, which then takes as long as the line needs
+ *
+ * The two do not draw the same frames. The scanline renderer keeps its
+ * original tile addressing and bit plane order, and the pixel FIFO follows
+ * the hardware. They only agree on tiles with equal bytes in every line,
+ * numbered below 128, and on frames without sprites.
+ */
+enum class RenderMode { SCANLINE, PIXEL_FIFO };
+
 /**
  * Constants for number of clock Cycles in each stage of the GPU frame cycle
  * Steps :
@@ -4,10 +4,14 @@
  */
 
 #include "debugger/debugger.h"
+#include "gameboy/batch.h"
 #include "gameboy/gameboy.h"
+#include "gameboy/movie.h"
 
 #include <cxxopts.hpp>
 
+#include <chrono>
+
 using namespace std;
 using namespace cpu;
 using namespace gpu;
@@ -18,6 +22,11 @@ using namespace debugger;
 using namespace cartridge;
 using namespace controller;
 
+/**
+ * Number of frames between writes of the --perf-file summary
+ */
+const uint64_t PERF_WRITE_INTERVAL = 60;
+
 int main(int argc, char *argv[]) {
 	ios_base::sync_with_stdio(false);
 
@@ -31,6 +40,44 @@ int main(int argc, char *argv[]) {
 			cxxopts::value<string>())
 		("d,debug", "Enable the debugger",
 			cxxopts::value<bool>()->default_value("false"))
+		("c,cpu", "CPU execution mode - interpreter, block or jit",
+			cxxopts::value<string>()->default_value("interpreter"))
+		("g,gpu", "GPU render mode - scanline, or fifo to draw each dot "
+		 "through a pixel FIFO, for effects within a line",
+			cxxopts::value<string>()->default_value("scanline"))
+		("f,frames", "Exit after this many frames - 0 runs forever",
+			cxxopts::value<uint64_t>()->default_value("0"))
+		("p,profile", "Write an opcode pair profile to this file on exit",
+			cxxopts::value<string>()->default_value(""))
+		("s,stats", "Write profiler statistics to this .csv or .json file "
+			"on exit - needs a TVP_PROFILER build",
+			cxxopts::value<string>()->default_value(""))
+		("perf", "Measure host time per frame and print a summary on exit",
+			cxxopts::value<bool>()->default_value("false"))
+		("perf-file", "Measure host time per frame and rewrite a summary to "
+			"this file every 60 frames",
+			cxxopts::value<string>()->default_value(""))
+		("b,batch", "Run this many headless instances of the ROM at once for "
+			"--frames frames each, then print the total frames/sec",
+			cxxopts::value<uint64_t>()->default_value("0"))
+		("t,threads", "Number of threads for --batch - 0 uses every core",
+			cxxopts::value<size_t>()->default_value("0"))
+		("record", "Record the buttons and screen of every frame to this "
+			"movie file",
+			cxxopts::value<string>()->default_value(""))
+		("replay", "Replay this movie file headless at full speed, and exit "
+			"with an error if the screen ever differs from the recording",
+			cxxopts::value<string>()->default_value(""))
+		("trace", "Record every executed instruction to this binary trace "
+			"file, for comparing runs with tvp_trace_diff",
+			cxxopts::value<string>()->default_value(""))
+		("trace-size", "Number of most recent instructions kept in the "
+			"--trace file",
+			cxxopts::value<uint64_t>()->default_value("1000000"))
+		("render-threads", "Draw the BG lines of each frame on this many "
+		 "threads at VBLANK, from the registers latched at every line - 0 "
+		 "draws each line when it is reached",
+			cxxopts::value<size_t>()->default_value("0"))
 		("h,help", "Print this information");
 	// clang-format on
 
@@ -52,15 +99,179 @@ int main(int argc, char *argv[]) {
 		exit(1);
 	}
 
+	// Select the CPU execution mode
+	auto execution_mode = ExecutionMode::INTERPRETER;
+	auto cpu_mode = parsed_args["cpu"].as<string>();
+	if (cpu_mode == "block") {
+		execution_mode = ExecutionMode::BLOCK_CACHE;
+	} else if (cpu_mode == "jit") {
+		execution_mode = ExecutionMode::JIT;
+	} else if (cpu_mode != "interpreter") {
+		cout << cmdline_args_parser.help();
+		exit(1);
+	}
+
+	// Select the GPU render mode
+	auto render_mode = RenderMode::SCANLINE;
+	auto gpu_mode = parsed_args["gpu"].as<string>();
+	if (gpu_mode == "fifo") {
+		render_mode = RenderMode::PIXEL_FIFO;
+	} else if (gpu_mode != "scanline") {
+		cout << cmdline_args_parser.help();
+		exit(1);
+	}
+	auto render_threads = parsed_args["render-threads"].as<size_t>();
+
+	// Run a batch of headless instances instead, if requested
+	auto instances = parsed_args["batch"].as<uint64_t>();
+	if (instances > 0) {
+		auto frames = parsed_args["frames"].as<uint64_t>();
+		if (frames == 0) {
+			cout << "--batch needs a frame limit, set with --frames" << endl;
+			exit(1);
+		}
+
+		// Every instance logs its startup, so only keep errors
+		Log::set_level(LogLevel::ERROR);
+
+		auto rom_data = make_shared<vector<uint8_t>>(
+		    Cartridge::read_file(rom_path));
+		auto batch = Batch(rom_data, execution_mode, render_mode);
+		auto result = batch.run(instances, frames,
+		                        parsed_args["threads"].as<size_t>());
+
+		cout << result.instances << " instances, " << result.frames
+		     << " frames in " << result.seconds << "s on " << result.threads
+		     << " threads - " << result.get_fps() << " frames/sec" << endl;
+		return 0;
+	}
+
+	// Replay a movie headless instead, if requested
+	auto replay_path = parsed_args["replay"].as<string>();
+	if (not replay_path.empty()) {
+		auto movie = Movie();
+		if (not movie.load(replay_path)) {
+			exit(1);
+		}
+
+		auto gameboy = make_unique<Gameboy>(rom_path, true);
+		gameboy->cpu->set_execution_mode(execution_mode);
+		gameboy->gpu->set_render_mode(render_mode);
+		gameboy->gpu->set_render_threads(render_threads);
+		auto rom_data = gameboy->cartridge->get_state().data;
+		if (Movie::hash_rom(*rom_data) != movie.get_rom_hash()) {
+			Log::warn("The movie was recorded with a different ROM");
+		}
+
+		// Replay the whole movie, unless a frame limit is set
+		auto frames = parsed_args["frames"].as<uint64_t>();
+		auto player = MoviePlayer(gameboy.get(), &movie);
+		auto start = chrono::steady_clock::now();
+		while (not player.is_finished() &&
+		       (frames == 0 || gameboy->gpu->get_frame_count() < frames)) {
+			gameboy->tick();
+			player.update();
+		}
+		auto elapsed = chrono::duration<double>(chrono::steady_clock::now() -
+		                                        start)
+		                   .count();
+
+		auto replayed = gameboy->gpu->get_frame_count();
+		cout << "Replayed " << replayed << " frames in " << elapsed << "s - "
+		     << replayed / elapsed << " frames/sec" << endl;
+		if (auto desync_frame = player.get_desync_frame()) {
+			cout << "Desync at frame " << *desync_frame << endl;
+			return 1;
+		}
+		return 0;
+	}
+
 	// Create main gameboy instance
 	auto gameboy = make_unique<Gameboy>(rom_path);
+	gameboy->cpu->set_execution_mode(execution_mode);
+	gameboy->gpu->set_render_mode(render_mode);
+	gameboy->gpu->set_render_threads(render_threads);
+
+	// Record a movie, if requested
+	auto record_path = parsed_args["record"].as<string>();
+	auto recorder = unique_ptr<MovieRecorder>();
+	if (not record_path.empty()) {
+		recorder = make_unique<MovieRecorder>(gameboy.get(), record_path);
+		if (not recorder->is_open()) {
+			exit(1);
+		}
+	}
+
+	// Count opcode pairs for the profile, if requested
+	auto profile_path = parsed_args["profile"].as<string>();
+	if (not profile_path.empty()) {
+		gameboy->cpu->set_opcode_profiling(true);
+	}
+
+	// Collect instruction statistics, if requested
+	auto stats_path = parsed_args["stats"].as<string>();
+	if (not stats_path.empty()) {
+		if (not gameboy->cpu->set_profiler_enabled(true)) {
+			exit(1);
+		}
+	}
+
+	// Record an instruction trace, if requested
+	auto trace_path = parsed_args["trace"].as<string>();
+	if (not trace_path.empty()) {
+		if (not gameboy->cpu->start_trace(
+		        trace_path, parsed_args["trace-size"].as<uint64_t>())) {
+			exit(1);
+		}
+	}
+
+	// Measure host time, if requested
+	auto perf_summary = parsed_args["perf"].as<bool>();
+	auto perf_path = parsed_args["perf-file"].as<string>();
+	if (perf_summary or not perf_path.empty()) {
+		Perf::enable();
+	}
 
 	// Turn on debugging if needed
 	auto debugger_on = parsed_args["debug"].as<bool>();
 	if (not debugger_on) {
-		// Start Gameboy normally
-		for (auto i = 0; /*Infinite Loop*/; i++) {
+		// Start Gameboy normally, and run until the frame limit if one is set
+		auto frames = parsed_args["frames"].as<uint64_t>();
+		uint64_t next_perf_write = PERF_WRITE_INTERVAL;
+		while (frames == 0 || gameboy->gpu->get_frame_count() < frames) {
 			gameboy->tick();
+
+			if (recorder) {
+				recorder->update();
+			}
+
+			if (not perf_path.empty() &&
+			    Perf::get_frame_count() >= next_perf_write) {
+				auto perf_file = ofstream(perf_path);
+				Perf::write_summary(perf_file);
+				next_perf_write += PERF_WRITE_INTERVAL;
+			}
+		}
+
+		if (perf_summary) {
+			Perf::write_summary(cout);
+			gameboy->gpu->get_render_stats().write_summary(cout);
+		}
+
+		if (not profile_path.empty()) {
+			auto profile_file = ofstream(profile_path);
+			gameboy->cpu->dump_opcode_profile(profile_file, 64);
+		}
+
+		if (not stats_path.empty()) {
+			auto stats_file = ofstream(stats_path);
+			auto is_json = stats_path.size() >= 5 &&
+			               stats_path.substr(stats_path.size() - 5) == ".json";
+			if (is_json) {
+				gameboy->cpu->get_profiler()->dump_json(stats_file);
+			} else {
+				gameboy->cpu->get_profiler()->dump_csv(stats_file);
+			}
 		}
 	} else {
 		// Start Gameboy with Debugger
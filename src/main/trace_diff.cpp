@@ -0,0 +1,98 @@
+/**
+ * @file trace_diff.cpp
+ * Main entrypoint for the tvp_trace_diff executable, which compares two
+ * instruction traces and prints where they first differ
+ */
+
+#include "cpu/trace.h"
+
+#include <cxxopts.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+using namespace std;
+using namespace cpu;
+
+/**
+ * Print the records of a trace from the given instruction index up to, and
+ * including, the one that differs
+ */
+void print_records(const string &name, const Trace &trace, uint64_t start,
+                   uint64_t divergence, const vector<uint8_t> *rom) {
+	cout << name << ":\n";
+	auto end = trace.first + trace.records.size();
+	for (auto index = max(start, trace.first);
+	     index <= divergence && index < end; ++index) {
+		cout << (index == divergence ? "> " : "  ") << index << "  "
+		     << format_trace_record(trace.records[index - trace.first], rom)
+		     << "\n";
+	}
+	if (divergence >= end) {
+		cout << "> " << divergence << "  end of trace\n";
+	}
+}
+
+int main(int argc, char *argv[]) {
+	auto cmdline_args_parser = cxxopts::Options(
+	    "tvp_trace_diff", "Find the first instruction where two tvp traces "
+	                      "differ");
+
+	// clang-format off
+	cmdline_args_parser.add_options()
+		("a", "First trace file", cxxopts::value<string>())
+		("b", "Second trace file", cxxopts::value<string>())
+		("c,context", "Number of instructions to print before the difference",
+			cxxopts::value<uint64_t>()->default_value("8"))
+		("r,rom", "ROM the traces were recorded with, to show operands",
+			cxxopts::value<string>()->default_value(""))
+		("h,help", "Print this information");
+	// clang-format on
+	cmdline_args_parser.parse_positional({"a", "b"});
+	cmdline_args_parser.positional_help("<trace_a> <trace_b>");
+
+	auto parsed_args = cmdline_args_parser.parse(argc, argv);
+	if (parsed_args["help"].as<bool>() || !parsed_args.count("a") ||
+	    !parsed_args.count("b")) {
+		cout << cmdline_args_parser.help();
+		return 1;
+	}
+
+	auto path_a = parsed_args["a"].as<string>();
+	auto path_b = parsed_args["b"].as<string>();
+	auto trace_a = Trace{};
+	auto trace_b = Trace{};
+	if (!read_trace(path_a, &trace_a) || !read_trace(path_b, &trace_b)) {
+		return 1;
+	}
+
+	auto divergence = find_divergence(trace_a, trace_b);
+	if (!divergence) {
+		cout << "Traces match, " << trace_a.records.size() << " instructions"
+		     << endl;
+		return 0;
+	}
+
+	auto index = *divergence;
+	cout << "Traces differ at instruction " << index << "\n\n";
+
+	// Read the ROM, if given
+	auto rom = vector<uint8_t>();
+	auto rom_path = parsed_args["rom"].as<string>();
+	if (!rom_path.empty()) {
+		auto rom_file = ifstream(rom_path, ios::binary);
+		rom.assign(istreambuf_iterator<char>(rom_file),
+		           istreambuf_iterator<char>());
+	}
+	auto rom_ptr = rom.empty() ? nullptr : &rom;
+
+	auto context = parsed_args["context"].as<uint64_t>();
+	auto start = index > context ? index - context : 0;
+	print_records(path_a, trace_a, start, index, rom_ptr);
+	cout << "\n";
+	print_records(path_b, trace_b, start, index, rom_ptr);
+	cout << flush;
+	return 2;
+}
@@ -0,0 +1,165 @@
+/**
+ * @file io_registers.h
+ * Declares the IORegisters class, which holds the hardware I/O registers
+ */
+
+#pragma once
+
+#include "memory/utils.h"
+
+#include <array>
+#include <cstdint>
+#include <functional>
+
+namespace memory {
+
+/**
+ * Address and number of the hardware I/O registers, $FF00 - $FF7F
+ */
+const Address IO_START = 0xFF00;
+const size_t IO_SIZE = 0x80;
+
+/**
+ * Values of all the I/O registers, indexed by address - IO_START
+ */
+using IORegisterValues = std::array<uint8_t, IO_SIZE>;
+
+namespace io {
+/**
+ * Offsets of the I/O registers from IO_START
+ */
+enum IORegister : uint8_t {
+	P1 = 0x00,   // Joypad
+	SB = 0x01,   // Serial transfer data
+	SC = 0x02,   // Serial transfer control
+	DIV = 0x04,  // Divider
+	TIMA = 0x05, // Timer counter
+	TMA = 0x06,  // Timer modulo
+	TAC = 0x07,  // Timer control
+	IF = 0x0F,   // Interrupt flag
+	NR10 = 0x10, // First sound register
+	NR52 = 0x26, // Sound on/off
+	WAVE = 0x30, // Start of wave pattern RAM
+	LCDC = 0x40, // LCD control
+	STAT = 0x41, // LCD status
+	SCY = 0x42,  // Scroll Y
+	SCX = 0x43,  // Scroll X
+	LY = 0x44,   // Current line
+	LYC = 0x45,  // Line compare
+	DMA = 0x46,  // OAM DMA source
+	BGP = 0x47,  // BG palette
+	OBP0 = 0x48, // Sprite palette 0
+	OBP1 = 0x49, // Sprite palette 1
+	WY = 0x4A,   // Window Y
+	WX = 0x4B,   // Window X
+	BOOT = 0x50  // Boot ROM disable
+};
+} // namespace io
+
+/**
+ * The hardware I/O registers, as one flat array of bytes.
+ *
+ * Devices that own a register, like the GPU, read and write the bytes
+ * directly. The bus goes through read and write, which call the hooks of
+ * registers that have side effects, like the joypad or DMA. Registers without
+ * hooks are a single load or store.
+ */
+class IORegisters {
+  public:
+	/**
+	 * Called instead of loading the register value, for bus reads
+	 */
+	using ReadHook = std::function<uint8_t()>;
+
+	/**
+	 * Called instead of storing the register value, for bus writes. The hook
+	 * stores the value itself, if it should be stored.
+	 */
+	using WriteHook = std::function<void(uint8_t data)>;
+
+  private:
+	IORegisterValues values;
+
+	/**
+	 * Which hooks every register has, as HookFlags
+	 */
+	enum HookFlags : uint8_t { READ_HOOK = 1, WRITE_HOOK = 2 };
+	std::array<uint8_t, IO_SIZE> hooked;
+
+	std::array<ReadHook, IO_SIZE> read_hooks;
+	std::array<WriteHook, IO_SIZE> write_hooks;
+
+  public:
+	/**
+	 * All registers start out zero, without hooks
+	 */
+	IORegisters();
+
+	/**
+	 * Get the stored value of a register, without side effects
+	 */
+	uint8_t get(uint8_t reg) const { return values[reg]; }
+
+	/**
+	 * Store the value of a register, without side effects
+	 */
+	void set(uint8_t reg, uint8_t value) { values[reg] = value; }
+
+	/**
+	 * Get a single bit of a register
+	 */
+	bool get_bit(uint8_t reg, uint8_t bit) const {
+		return values[reg] & (1 << bit);
+	}
+
+	/**
+	 * Set or clear a single bit of a register
+	 */
+	void set_bit(uint8_t reg, uint8_t bit, bool value) {
+		values[reg] = static_cast<uint8_t>(
+		    (values[reg] & ~(1 << bit)) | (static_cast<uint8_t>(value) << bit));
+	}
+
+	/**
+	 * Read a register from the bus, calling its read hook if it has one
+	 */
+	uint8_t read(uint8_t reg) const {
+		if (hooked[reg] & READ_HOOK) {
+			return read_hooks[reg]();
+		}
+		return values[reg];
+	}
+
+	/**
+	 * Write a register from the bus, calling its write hook if it has one
+	 */
+	void write(uint8_t reg, uint8_t data) {
+		if (hooked[reg] & WRITE_HOOK) {
+			write_hooks[reg](data);
+			return;
+		}
+		values[reg] = data;
+	}
+
+	/**
+	 * Set the hook for bus reads of a register, or remove it with nullptr
+	 */
+	void set_read_hook(uint8_t reg, ReadHook hook);
+
+	/**
+	 * Set the hook for bus writes to a register, or remove it with nullptr
+	 */
+	void set_write_hook(uint8_t reg, WriteHook hook);
+
+	/**
+	 * Get the stored values of all registers
+	 */
+	const IORegisterValues &get_values() const;
+
+	/**
+	 * Store the values of all registers, without side effects
+	 */
+	void set_values(const IORegisterValues &new_values);
+};
+
+} // namespace memory
@@ -9,6 +9,7 @@
 #include "controller/controller.h"
 #include "cpu/cpu_interface.h"
 #include "gpu/gpu_interface.h"
+#include "memory/io_registers.h"
 #include "memory/memory_interface.h"
 
 #include "debugger/debugger.fwd.h"
@@ -19,6 +20,68 @@
 
 namespace memory {
 
+/**
+ * Size in bytes of each page of Memory. Pages are shared between snapshots
+ * and clones, and copied on the first write.
+ */
+const size_t PAGE_SIZE = 0x100;
+const size_t PAGE_COUNT = 0x10000 / PAGE_SIZE;
+
+/**
+ * Length of an OAM DMA transfer, during which the CPU can only reach the
+ * high page ($FF00 - $FFFF)
+ */
+const cpu::ClockCycles DMA_CYCLES = 160;
+
+using Page = std::array<uint8_t, PAGE_SIZE>;
+
+/**
+ * Pages of the complete address space, in address order
+ */
+using PageTable = std::array<std::shared_ptr<Page>, PAGE_COUNT>;
+
+/**
+ * Kinds of access that can be watched on a page, as bit flags
+ */
+enum WatchFlags : uint8_t { WATCH_READ = 1, WATCH_WRITE = 2 };
+
+/**
+ * Watch flags of every page, indexed by address / PAGE_SIZE
+ */
+using WatchPages = std::array<uint8_t, PAGE_COUNT>;
+
+/**
+ * Receives reads and writes to watched pages
+ */
+class WatchHandler {
+  public:
+	virtual ~WatchHandler() {}
+
+	/**
+	 * Called after a watched read, or before a watched write
+	 *
+	 * @param address Address accessed
+	 * @param data Byte read or about to be written
+	 * @param write Whether this is a write
+	 */
+	virtual void on_watch(Address address, uint8_t data, bool write) = 0;
+};
+
+/**
+ * Snapshot of the contents of Memory. The pages are shared with the memory
+ * until either side writes to them, so taking a snapshot is cheap.
+ */
+struct MemoryState {
+	PageTable pages;
+	IORegisterValues io;
+	cpu::ClockCycles dma_cycles;
+
+	/**
+	 * Get the stored byte at the given address
+	 */
+	uint8_t get_byte(Address address) const;
+};
+
 /**
  * Main memory (RAM) implementation for the GameBoy
  * The GameBoy has memory-mapped IO, and hence some of these memory locations
@@ -41,13 +104,20 @@ namespace memory {
  * $0100 - $014F  ->  Cartridge Header Area
  * $0000 - $00FF  ->  Restart and Interrupt Vectors
  */
-class Memory : public MemoryInterface {
+class Memory final : public MemoryInterface {
   private:
 	/**
-	 * Main memory array - the GameBoy can address 65536 total bytes of memory
-	 * Not all of these wll be used, as most will be mapped to other devices
+	 * Main memory - the GameBoy can address 65536 total bytes of memory
+	 * Not all of these wll be used, as most will be mapped to other devices.
+	 * The memory is split into copy-on-write pages, so that snapshots and
+	 * clones only copy the pages that are written to afterwards.
 	 */
-	std::array<uint8_t, 0x10000> memory;
+	PageTable pages;
+
+	/**
+	 * Hardware I/O registers, $FF00 - $FF7F. Not stored in the pages.
+	 */
+	IORegisters io;
 
 	/**
 	 * Pointer to cartridge instance
@@ -70,7 +140,114 @@ class Memory : public MemoryInterface {
 	gpu::GPUInterface *gpu;
 
 	/**
-	 * Initiates a DMA transfer, starting from the given address offset
+	 * Pages with watched addresses, and where to report accesses to them.
+	 * nullptr unless a debugger is attached, so that is the only check on
+	 * every access otherwise.
+	 */
+	const WatchPages *watch_pages;
+	WatchHandler *watch_handler;
+
+	/**
+	 * Cycles left in the current OAM DMA transfer, or 0
+	 */
+	cpu::ClockCycles dma_cycles;
+
+	/**
+	 * Set while CPU accesses need more than a plain lookup, because memory
+	 * is watched or a DMA has the bus. This is the only check on every
+	 * access otherwise.
+	 */
+	bool intercepted;
+
+	/**
+	 * Recalculate whether accesses are intercepted
+	 */
+	void update_intercepted();
+
+	/**
+	 * Offsets within a page, from begin up to end, that hold plain RAM.
+	 * These are read and written straight from the page, without going
+	 * through any device.
+	 */
+	struct DirectRange {
+		uint16_t begin, end;
+	};
+
+	/**
+	 * Plain RAM in every page. Empty for pages that are only mapped to
+	 * devices, like the cartridge.
+	 */
+	std::array<DirectRange, PAGE_COUNT> direct;
+
+	/**
+	 * Number of writes to every page, counted where pages are made writable
+	 */
+	std::array<uint32_t, PAGE_COUNT> write_counts;
+
+	/**
+	 * Check if a run of bytes is plain RAM, all on the same page
+	 */
+	bool is_direct(Address address, size_t length) const {
+		auto range = direct[address / PAGE_SIZE];
+		auto offset = address % PAGE_SIZE;
+		return offset >= range.begin && offset + length <= range.end;
+	}
+
+	/**
+	 * Read a byte from the device or RAM mapped at the given address
+	 */
+	uint8_t read_mapped(Address address) const;
+
+	/**
+	 * Write a byte to the device or RAM mapped at the given address
+	 */
+	void write_mapped(Address address, uint8_t data);
+
+	/**
+	 * Read or write a 16-bit value that isn't in plain RAM, or is intercepted
+	 */
+	uint16_t read16_mapped(Address address) const;
+	void write16_mapped(Address address, uint16_t data);
+
+	/**
+	 * Read or write a byte while a DMA has the bus, or a debugger is
+	 * attached. Accesses outside the high page are dropped during a DMA, and
+	 * accesses to watched pages are reported. Kept out of read and write, so
+	 * that they stay a check and a jump otherwise.
+	 */
+	uint8_t read_intercepted(Address address) const;
+	void write_intercepted(Address address, uint8_t data);
+
+	/**
+	 * Get the stored byte at the given address
+	 */
+	uint8_t get_byte(Address address) const;
+
+	/**
+	 * Store a byte at the given address, copying its page first if it is
+	 * shared
+	 */
+	void set_byte(Address address, uint8_t data);
+
+	/**
+	 * Get a pointer to the stored byte at the given address, for writing.
+	 * The page is copied first if it is shared, as in set_byte.
+	 */
+	uint8_t *get_writable(Address address);
+
+	/**
+	 * Set the plain RAM ranges of every page
+	 */
+	void init_direct_pages();
+
+	/**
+	 * Set the hooks of the I/O registers that have side effects
+	 */
+	void init_io_hooks();
+
+	/**
+	 * Copies the 160 bytes at the given page into OAM, and starts the window
+	 * in which the CPU is locked out of the bus
 	 */
 	void dma_transfer(uint8_t offset);
 
@@ -82,13 +259,101 @@ class Memory : public MemoryInterface {
 
 	/**
 	 * @see MemoryInterface#read
+	 *
+	 * Defined here, so that the CPU and GPU can inline it
 	 */
-	uint8_t read(Address address) const override;
+	uint8_t read(Address address) const override {
+		if (intercepted) {
+			return read_intercepted(address);
+		}
+		return read_mapped(address);
+	}
 
 	/**
 	 * @see MemoryInterface#write
 	 */
-	void write(Address address, uint8_t data) override;
+	void write(Address address, uint8_t data) override {
+		if (intercepted) {
+			write_intercepted(address, data);
+			return;
+		}
+		write_mapped(address, data);
+	}
+
+	/**
+	 * @see MemoryInterface#read16
+	 *
+	 * Both bytes are loaded from the page at once, if they are in plain RAM
+	 */
+	uint16_t read16(Address address) const override {
+		if (!intercepted && is_direct(address, 2)) {
+			auto &page = *pages[address / PAGE_SIZE];
+			auto offset = address % PAGE_SIZE;
+			return static_cast<uint16_t>(page[offset] |
+			                             (page[offset + 1] << 8));
+		}
+		return read16_mapped(address);
+	}
+
+	/**
+	 * @see MemoryInterface#write16
+	 */
+	void write16(Address address, uint16_t data) override {
+		if (!intercepted && is_direct(address, 2)) {
+			auto bytes = get_writable(address);
+			bytes[0] = static_cast<uint8_t>(data);
+			bytes[1] = static_cast<uint8_t>(data >> 8);
+			return;
+		}
+		write16_mapped(address, data);
+	}
+
+	/**
+	 * @see MemoryInterface#copy
+	 *
+	 * A copy from plain RAM to plain RAM, each within a page, is a single
+	 * memmove between the pages
+	 */
+	void copy(Address destination, Address source, size_t length) override;
+
+	/**
+	 * @see MemoryInterface#peek
+	 *
+	 * Plain RAM, like VRAM and OAM, is read straight from its page
+	 */
+	uint8_t peek(Address address) const override {
+		if (is_direct(address, 1)) {
+			return (*pages[address / PAGE_SIZE])[address % PAGE_SIZE];
+		}
+		return read_mapped(address);
+	}
+
+	/**
+	 * @see MemoryInterface#peek_block
+	 *
+	 * Plain RAM is copied a page at a time
+	 */
+	void peek_block(Address start, uint8_t *destination,
+	                size_t length) const override;
+
+	/**
+	 * Get the number of cycles left in the current OAM DMA transfer, or 0 if
+	 * there is none
+	 */
+	cpu::ClockCycles get_dma_cycles() const { return dma_cycles; }
+
+	/**
+	 * Count down the current OAM DMA transfer, and give the bus back to the
+	 * CPU once it is done. Only needs to be called while a DMA is running.
+	 */
+	void run_dma(cpu::ClockCycles cycles);
+
+	/**
+	 * @see MemoryInterface#get_write_count
+	 *
+	 * Writes are counted per page
+	 */
+	uint32_t get_write_count(Address start, Address end) const override;
 
 	/**
 	 * Set the CPU Object pointer for this class
@@ -100,6 +365,31 @@ class Memory : public MemoryInterface {
 	 */
 	void set_gpu(gpu::GPUInterface *gpu) override;
 
+	/**
+	 * Get the hardware I/O registers
+	 */
+	IORegisters *get_io();
+
+	/**
+	 * Report accesses to watched pages to the handler. Both must outlive the
+	 * memory, or be replaced first. nullptr turns watching off.
+	 *
+	 * @param pages Watch flags of every page
+	 * @param handler Handler called for every access to a watched page
+	 */
+	void set_watch(const WatchPages *pages, WatchHandler *handler);
+
+	/**
+	 * Get a snapshot of the memory contents. Registers that belong to other
+	 * devices are not included.
+	 */
+	MemoryState get_state() const;
+
+	/**
+	 * Load the memory contents from a snapshot
+	 */
+	void set_state(const MemoryState &state);
+
 	/**
 	 * Allow debugger to view private members of this class
 	 */
@@ -6,6 +6,7 @@
 #include "cpu/cpu_interface.h"
 #include "gpu/gpu_interface.h"
 #include "memory/utils.h"
+#include <cstddef>
 #include <cstdint>
 
 #pragma once
@@ -35,6 +36,82 @@ class MemoryInterface {
 	 */
 	virtual void write(Address address, uint8_t data) = 0;
 
+	/**
+	 * Read a byte for a device other than the CPU, like the GPU reading VRAM
+	 * and OAM. The CPU being locked out of the bus does not apply, and the
+	 * read is not reported to a debugger.
+	 *
+	 * @param address Location to read byte from
+	 * @return Value of the byte
+	 */
+	virtual uint8_t peek(Address address) const { return read(address); }
+
+	/**
+	 * Read a block of bytes as a device other than the CPU, as with peek
+	 *
+	 * @param start Location of the first byte
+	 * @param destination Buffer to copy the bytes to
+	 * @param length Number of bytes
+	 */
+	virtual void peek_block(Address start, uint8_t *destination,
+	                        size_t length) const {
+		for (size_t i = 0; i < length; ++i) {
+			destination[i] = peek(static_cast<Address>(start + i));
+		}
+	}
+
+	/**
+	 * Read a little-endian 16-bit value, low byte first. Buses override this
+	 * when they can read both bytes at once.
+	 *
+	 * @param address Location of the low byte
+	 * @return Value of the two bytes
+	 */
+	virtual uint16_t read16(Address address) const {
+		uint16_t low = read(address);
+		uint16_t high = read(static_cast<Address>(address + 1));
+		return static_cast<uint16_t>((high << 8) | low);
+	}
+
+	/**
+	 * Write a little-endian 16-bit value. The high byte is written first, as
+	 * PUSH, CALL and interrupts do when storing to the stack.
+	 *
+	 * @param address Location of the low byte
+	 * @param data Value of the two bytes
+	 */
+	virtual void write16(Address address, uint16_t data) {
+		write(static_cast<Address>(address + 1),
+		      static_cast<uint8_t>(data >> 8));
+		write(address, static_cast<uint8_t>(data));
+	}
+
+	/**
+	 * Copy a block of bytes, as if each one was read and then written in
+	 * address order
+	 *
+	 * @param destination Location of the first byte written
+	 * @param source Location of the first byte read
+	 * @param length Number of bytes
+	 */
+	virtual void copy(Address destination, Address source, size_t length) {
+		for (size_t i = 0; i < length; ++i) {
+			write(static_cast<Address>(destination + i),
+			      read(static_cast<Address>(source + i)));
+		}
+	}
+
+	/**
+	 * Get a count that changes whenever memory in the given range is
+	 * written. Readers like the GPU use it to keep what they derived from
+	 * memory until it changes. Counts may be kept for larger blocks than
+	 * the range, so writes close to it can change it too.
+	 *
+	 * @param start First address of the range
+	 * @param end Last address of the range
+	 */
+	virtual uint32_t get_write_count(Address start, Address end) const = 0;
+
 	/**
 	 * Set the CPU Object pointer for this class
 	 */
@@ -0,0 +1,32 @@
+/**
+ * @file io_registers.cpp
+ * Defines the IORegisters class
+ */
+
+#include "memory/io_registers.h"
+
+#include <utility>
+
+namespace memory {
+
+IORegisters::IORegisters() : values(), hooked(), read_hooks(), write_hooks() {}
+
+void IORegisters::set_read_hook(uint8_t reg, ReadHook hook) {
+	hooked[reg] = static_cast<uint8_t>(
+	    hook ? hooked[reg] | READ_HOOK : hooked[reg] & ~READ_HOOK);
+	read_hooks[reg] = std::move(hook);
+}
+
+void IORegisters::set_write_hook(uint8_t reg, WriteHook hook) {
+	hooked[reg] = static_cast<uint8_t>(
+	    hook ? hooked[reg] | WRITE_HOOK : hooked[reg] & ~WRITE_HOOK);
+	write_hooks[reg] = std::move(hook);
+}
+
+const IORegisterValues &IORegisters::get_values() const { return values; }
+
+void IORegisters::set_values(const IORegisterValues &new_values) {
+	values = new_values;
+}
+
+} // namespace memory
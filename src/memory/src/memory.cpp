@@ -4,95 +4,257 @@
  */
 
 #include "memory/memory.h"
+#include "gpu/utils.h"
 #include "util/helpers.h"
 #include "util/log.h"
 
+#include <algorithm>
+#include <cstring>
+
 namespace memory {
 
+uint8_t MemoryState::get_byte(Address address) const {
+	if (address >= IO_START && address < IO_START + IO_SIZE) {
+		return io[address - IO_START];
+	}
+	return (*pages[address / PAGE_SIZE])[address % PAGE_SIZE];
+}
+
 Memory::Memory(cartridge::Cartridge *cartridge,
                controller::Controller *controller)
-    : memory(std::array<uint8_t, 0x10000>()), cartridge(cartridge),
-      controller(controller) {}
+    : pages(), io(), cartridge(cartridge), controller(controller),
+      watch_pages(nullptr), watch_handler(nullptr), dma_cycles(0),
+      intercepted(false), write_counts() {
+	// Every page starts out as the same page of zeroes, and is only copied
+	// once it is written to
+	pages.fill(std::make_shared<Page>());
+
+	init_direct_pages();
+	init_io_hooks();
+}
+
+void Memory::init_direct_pages() {
+	direct.fill(DirectRange{0, 0});
+
+	// VRAM and the BG maps
+	for (auto page = 0x80; page <= 0x9F; ++page) {
+		direct[page] = DirectRange{0, PAGE_SIZE};
+	}
+
+	// Main Work RAM
+	for (auto page = 0xC0; page <= 0xDF; ++page) {
+		direct[page] = DirectRange{0, PAGE_SIZE};
+	}
+
+	// OAM, up to the restricted memory after it
+	direct[0xFE] = DirectRange{0x00, 0xA0};
+
+	// High RAM, between the I/O registers and the Interrupt Enable register
+	direct[0xFF] = DirectRange{0x80, 0xFF};
+}
+
+void Memory::init_io_hooks() {
+	// Joypad
+	io.set_read_hook(io::P1, [this] { return controller->get_value(); });
+	io.set_write_hook(io::P1, [this](uint8_t data) {
+		controller->set_value(data);
+	});
+
+	// Serial data transfer and timers
+	// TODO: Serial Data Transfer, System timers
+	for (auto reg : {io::SB, io::SC}) {
+		io.set_write_hook(reg, [this, reg](uint8_t data) {
+			Log::warn("Attempt to write to SDT register " +
+			          num_to_hex(static_cast<Address>(IO_START + reg)));
+			io.set(reg, data);
+		});
+	}
+	for (auto reg : {io::DIV, io::TIMA, io::TMA, io::TAC}) {
+		io.set_write_hook(reg, [this, reg](uint8_t data) {
+			Log::warn("Attempt to write to timer register " +
+			          num_to_hex(static_cast<Address>(IO_START + reg)));
+			io.set(reg, data);
+		});
+	}
+
+	// Interrupt Flag register
+	io.set_read_hook(io::IF,
+	                 [this] { return cpu->get_interrupts()->get_flag(); });
+	io.set_write_hook(io::IF, [this](uint8_t data) {
+		cpu->get_interrupts()->set_flag(data);
+	});
+
+	// Sound Controller Registers
+	// TODO: Sound Controller
+	for (uint8_t reg = io::NR10; reg < io::LCDC; ++reg) {
+		io.set_write_hook(reg, [this, reg](uint8_t data) {
+			Log::warn("Attempt to write to sound register " +
+			          num_to_hex(static_cast<Address>(IO_START + reg)));
+			io.set(reg, data);
+		});
+	}
+
+	// GPU Registers. Turning the LCD on or off starts or stops the GPU, and
+	// LY only counts up with the GPU.
+	io.set_write_hook(io::LCDC, [this](uint8_t data) {
+		auto was_enabled = io.get_bit(io::LCDC, gpu::lcdc_flag::DISPLAY_ENABLE);
+		io.set(io::LCDC, data);
+
+		auto enabled = io.get_bit(io::LCDC, gpu::lcdc_flag::DISPLAY_ENABLE);
+		if (enabled != was_enabled) {
+			gpu->set_display_enabled(enabled);
+		}
+	});
+	io.set_write_hook(io::LY, [](uint8_t) {
+		Log::error("Cannot write to LY register location");
+	});
+	io.set_read_hook(io::DMA, [] {
+		Log::warn("Cannot read from DMA register");
+		return static_cast<uint8_t>(0xFF); // DMA is non-readable
+	});
+	io.set_write_hook(io::DMA, [this](uint8_t data) {
+		io.set(io::DMA, data);
+		dma_transfer(data);
+	});
+
+	// Boot ROM disable switch
+	io.set_write_hook(io::BOOT, [this](uint8_t data) {
+		io.set(io::BOOT, data);
+
+		// The cartridge is now mapped over the boot ROM
+		cpu->invalidate_code(0x0000, 0x00FF);
+	});
+
+	// Unused memory that Tetris writes to
+	for (uint32_t reg = io::BOOT + 1; reg < IO_SIZE; ++reg) {
+		io.set_write_hook(static_cast<uint8_t>(reg), [reg](uint8_t) {
+			Log::warn("Attempt to write to invalid address " +
+			          num_to_hex(static_cast<Address>(IO_START + reg)));
+		});
+	}
+}
+
+uint8_t Memory::get_byte(Address address) const {
+	return (*pages[address / PAGE_SIZE])[address % PAGE_SIZE];
+}
+
+void Memory::set_byte(Address address, uint8_t data) {
+	*get_writable(address) = data;
+}
 
 bool address_in_range(Address addr, Address start, Address end) {
 	return (addr >= start && addr <= end) || (addr >= end && addr <= start);
 }
 
-uint8_t Memory::read(Address address) const {
-	// Interrupt Enable Register
-	if (address == 0xFFFF) {
-		return cpu->get_interrupt_enable()->get();
+uint8_t *Memory::get_writable(Address address) {
+	auto &page = pages[address / PAGE_SIZE];
+
+	// Take a private copy of a shared page before changing it. As with
+	// Cartridge data, a count of one can't go stale.
+	if (page.use_count() > 1) {
+		page = std::make_shared<Page>(*page);
 	}
+	++write_counts[address / PAGE_SIZE];
+	return page->data() + address % PAGE_SIZE;
+}
 
-	// High RAM
-	if (address_in_range(address, 0xFFFE, 0xFF80)) {
-		return memory[address];
+uint16_t Memory::read16_mapped(Address address) const {
+	// Cartridge ROM past the boot ROM, which has both bytes side by side
+	if (!intercepted && address_in_range(address, 0x7FFE, 0x0100)) {
+		return cartridge->read16(address);
 	}
 
-	// Boot ROM disable switch
-	if (address == 0xFF50) {
-		return memory[address];
-	}
-
-	// GPU Registers
-	if (address_in_range(address, 0xFF4B, 0xFF40)) {
-		auto register_offset = static_cast<uint16_t>(address - 0xFF40);
-		switch (register_offset) {
-		case 0x0:
-			return gpu->get_lcdc()->get();
-		case 0x1:
-			return gpu->get_stat()->get();
-		case 0x2:
-			return gpu->get_scy()->get();
-		case 0x4:
-			return gpu->get_ly()->get();
-		case 0x5:
-			return gpu->get_lyc()->get();
-		case 0x6:
-			Log::warn("Cannot read from DMA register");
-			return 0xFF; // DMA is non-readable
-		case 0x7:
-			return gpu->get_bgp()->get();
-		case 0x8:
-			return gpu->get_obp0()->get();
-		case 0x9:
-			return gpu->get_obp1()->get();
-		case 0xA:
-			return gpu->get_wy()->get();
-		case 0xB:
-			return gpu->get_wx()->get();
+	uint16_t low = read(address);
+	uint16_t high = read(static_cast<Address>(address + 1));
+	return static_cast<uint16_t>((high << 8) | low);
+}
+
+void Memory::write16_mapped(Address address, uint16_t data) {
+	write(static_cast<Address>(address + 1), static_cast<uint8_t>(data >> 8));
+	write(address, static_cast<uint8_t>(data));
+}
+
+void Memory::copy(Address destination, Address source, size_t length) {
+	if (!intercepted && is_direct(source, length) &&
+	    is_direct(destination, length)) {
+		// Get the destination first, since copying it may replace the
+		// source page too
+		auto to = get_writable(destination);
+		auto from = pages[source / PAGE_SIZE]->data() + source % PAGE_SIZE;
+		std::memmove(to, from, length);
+		return;
+	}
+
+	MemoryInterface::copy(destination, source, length);
+}
+
+void Memory::peek_block(Address start, uint8_t *destination,
+                        size_t length) const {
+	// One page at a time, since only some pages are plain RAM
+	while (length) {
+		auto chunk = std::min(length, PAGE_SIZE - start % PAGE_SIZE);
+		if (is_direct(start, chunk)) {
+			auto page = pages[start / PAGE_SIZE]->data();
+			std::memcpy(destination, page + start % PAGE_SIZE, chunk);
+		} else {
+			for (size_t i = 0; i < chunk; ++i) {
+				destination[i] = peek(static_cast<Address>(start + i));
+			}
 		}
+		start = static_cast<Address>(start + chunk);
+		destination += chunk;
+		length -= chunk;
 	}
+}
 
-	// Sound Controller Registers
-	if (address_in_range(address, 0xFF26, 0xFF10)) {
-		// TODO: Sound Controller
-		Log::warn("Attempt to read from sound register " + num_to_hex(address));
-		return memory[address];
+uint8_t Memory::read_intercepted(Address address) const {
+	// During an OAM DMA, only the high page is on the CPU's internal bus
+	if (dma_cycles && address < IO_START) {
+		return 0xFF;
 	}
 
-	// Interrupt Flag register
-	if (address == 0xFF0F) {
-		return cpu->get_interrupt_flag()->get();
+	auto data = read_mapped(address);
+	if (watch_pages && (*watch_pages)[address / PAGE_SIZE] & WATCH_READ) {
+		watch_handler->on_watch(address, data, false);
 	}
+	return data;
+}
 
-	// Timer registers
-	if (address_in_range(address, 0xFF07, 0xFF04)) {
-		// TODO: System Timers
-		Log::warn("Attempt to read from timer register " + num_to_hex(address));
-		return memory[address];
+void Memory::write_intercepted(Address address, uint8_t data) {
+	if (dma_cycles && address < IO_START) {
+		return;
 	}
 
-	// Serial data transfer registers
-	if (address_in_range(address, 0xFF02, 0xFF01)) {
-		// TODO: Serial Data Transfer
-		Log::warn("Attempt to read from SDT register " + num_to_hex(address));
-		return memory[address];
+	if (watch_pages && (*watch_pages)[address / PAGE_SIZE] & WATCH_WRITE) {
+		watch_handler->on_watch(address, data, true);
+	}
+	write_mapped(address, data);
+}
+
+void Memory::update_intercepted() {
+	intercepted = watch_pages != nullptr || dma_cycles != 0;
+}
+
+void Memory::set_watch(const WatchPages *pages, WatchHandler *handler) {
+	watch_pages = handler ? pages : nullptr;
+	watch_handler = handler;
+	update_intercepted();
+}
+
+uint8_t Memory::read_mapped(Address address) const {
+	// Interrupt Enable Register
+	if (address == 0xFFFF) {
+		return cpu->get_interrupts()->get_enable();
 	}
 
-	// Controller
-	if (address == 0xFF00) {
-		return controller->get_value();
+	// High RAM
+	if (address_in_range(address, 0xFFFE, 0xFF80)) {
+		return get_byte(address);
+	}
+
+	// Hardware I/O Registers
+	if (address >= IO_START) {
+		return io.read(static_cast<uint8_t>(address - IO_START));
 	}
 
 	// Restricted memory
@@ -104,18 +266,18 @@ uint8_t Memory::read(Address address) const {
 
 	// OAM
 	if (address_in_range(address, 0xFE9F, 0xFE00)) {
-		return memory[address];
+		return get_byte(address);
 	}
 
 	// Echo RAM, returns copy of RAM
 	if (address_in_range(address, 0xFDFF, 0xE000)) {
 		Log::warn("Reading from " + num_to_hex(address) + " which is Echo RAM");
-		return memory[address - 0x2000];
+		return get_byte(address - 0x2000);
 	}
 
 	// Main Work RAM
 	if (address_in_range(address, 0xDFFF, 0xC000)) {
-		return memory[address];
+		return get_byte(address);
 	}
 
 	// Cartridge RAM
@@ -127,12 +289,12 @@ uint8_t Memory::read(Address address) const {
 
 	// BG Data Maps
 	if (address_in_range(address, 0x9FFF, 0x9800)) {
-		return memory[address];
+		return get_byte(address);
 	}
 
 	// VRAM
 	if (address_in_range(address, 0x97FF, 0x8000)) {
-		return memory[address];
+		return get_byte(address);
 	}
 
 	// Cartridge Data
@@ -143,7 +305,7 @@ uint8_t Memory::read(Address address) const {
 	// Interrupt Vectors and Boot Rom
 	if (address_in_range(address, 0x00FF, 0x0000)) {
 		// If 0xFF50 is set, Boot ROM is enabled
-		if (memory[0xFF50] == 0x1) {
+		if (io.get(io::BOOT) == 0x1) {
 			return cartridge->read(address);
 		} else {
 			return boot[address];
@@ -152,110 +314,25 @@ uint8_t Memory::read(Address address) const {
 
 	Log::error("Default for location " + num_to_hex(address) + " returned!");
 
-	return memory[address];
+	return get_byte(address);
 }
 
-void Memory::write(Address address, uint8_t data) {
+void Memory::write_mapped(Address address, uint8_t data) {
 	// Interrupt Enable Register
 	if (address == 0xFFFF) {
-		cpu->get_interrupt_enable()->set(data);
+		cpu->get_interrupts()->set_enable(data);
 		return;
 	}
 
 	// High RAM
 	if (address_in_range(address, 0xFFFE, 0xFF80)) {
-		memory[address] = data;
-		return;
-	}
-
-	// Unused memory that Tetris writes to
-	if (address_in_range(address, 0xFF7F, 0xFF51)) {
-		Log::warn("Attempt to write to invalid address " + num_to_hex(address));
-		return;
-	}
-
-	// Boot ROM disable switch
-	if (address == 0xFF50) {
-		memory[address] = data;
-		return;
-	}
-
-	/// GPU Registers
-	if (address_in_range(address, 0xFF4B, 0xFF40)) {
-		auto register_offset = static_cast<uint16_t>(address - 0xFF40);
-		switch (register_offset) {
-		case 0x0:
-			gpu->get_lcdc()->set(data);
-			return;
-		case 0x1:
-			gpu->get_stat()->set(data);
-			return;
-		case 0x2:
-			gpu->get_scy()->set(data);
-			return;
-		case 0x3:
-			gpu->get_scx()->set(data);
-			return;
-		case 0x4:
-			Log::error("Cannot write to LY register location");
-			return;
-		case 0x5:
-			gpu->get_lyc()->set(data);
-			return;
-		case 0x6:
-			dma_transfer(data);
-			return;
-		case 0x7:
-			gpu->get_bgp()->set(data);
-			return;
-		case 0x8:
-			gpu->get_obp0()->set(data);
-			return;
-		case 0x9:
-			gpu->get_obp1()->set(data);
-			return;
-		case 0xA:
-			gpu->get_wy()->set(data);
-			return;
-		case 0xB:
-			gpu->get_wx()->set(data);
-			return;
-		}
-	}
-
-	// Sound Controller Registers
-	if (address_in_range(address, 0xFF3F, 0xFF10)) {
-		// TODO: Sound Controller
-		Log::warn("Attempt to write to sound register " + num_to_hex(address));
-		memory[address] = data;
-		return;
-	}
-
-	// Interrupt Flag register
-	if (address == 0xFF0F) {
-		cpu->get_interrupt_flag()->set(data);
-		return;
-	}
-
-	// Timer registers
-	if (address_in_range(address, 0xFF07, 0xFF04)) {
-		// TODO: System timers
-		Log::warn("Attempt to write to timer register " + num_to_hex(address));
-		memory[address] = data;
+		set_byte(address, data);
 		return;
 	}
 
-	// Serial data transfer registers
-	if (address_in_range(address, 0xFF02, 0xFF01)) {
-		// TODO: Serial Data Transfer
-		Log::warn("Attempt to write to SDT register " + num_to_hex(address));
-		memory[address] = data;
-		return;
-	}
-
-	// Controller
-	if (address == 0xFF00) {
-		controller->set_value(data);
+	// Hardware I/O Registers
+	if (address >= IO_START) {
+		io.write(static_cast<uint8_t>(address - IO_START), data);
 		return;
 	}
 
@@ -268,20 +345,20 @@ void Memory::write(Address address, uint8_t data) {
 
 	// OAM
 	if (address_in_range(address, 0xFE9F, 0xFE00)) {
-		memory[address] = data;
+		set_byte(address, data);
 		return;
 	}
 
 	// Echo RAM, returns copy of RAM
 	if (address_in_range(address, 0xFDFF, 0xE000)) {
 		Log::warn("Writing to " + num_to_hex(address) + " which is Echo RAM");
-		memory[address - 0x2000] = data;
+		set_byte(address - 0x2000, data);
 		return;
 	}
 
 	// Main Work RAM
 	if (address_in_range(address, 0xDFFF, 0xC000)) {
-		memory[address] = data;
+		set_byte(address, data);
 		return;
 	}
 
@@ -294,25 +371,27 @@ void Memory::write(Address address, uint8_t data) {
 
 	// BG Data Maps
 	if (address_in_range(address, 0x9FFF, 0x9800)) {
-		memory[address] = data;
+		set_byte(address, data);
 		return;
 	}
 
 	// VRAM
 	if (address_in_range(address, 0x97FF, 0x8000)) {
-		memory[address] = data;
+		set_byte(address, data);
 		return;
 	}
 
 	// Cartridge Data
 	if (address_in_range(address, 0x7FFF, 0x0100)) {
 		cartridge->write(address, data);
+		cpu->invalidate_code(address, address);
 		return;
 	}
 
 	// Interrupt Vectors
 	if (address_in_range(address, 0x00FF, 0x0000)) {
 		cartridge->write(address, data);
+		cpu->invalidate_code(address, address);
 		return;
 	}
 
@@ -323,17 +402,73 @@ void Memory::set_cpu(cpu::CPUInterface *p_cpu) { cpu = p_cpu; }
 
 void Memory::set_gpu(gpu::GPUInterface *p_gpu) { gpu = p_gpu; }
 
+IORegisters *Memory::get_io() { return &io; }
+
+MemoryState Memory::get_state() const {
+	auto state = MemoryState{};
+	state.pages = pages;
+	state.io = io.get_values();
+	state.dma_cycles = dma_cycles;
+	return state;
+}
+
+void Memory::set_state(const MemoryState &state) {
+	// Every page may have changed
+	pages = state.pages;
+	for (auto &count : write_counts) {
+		++count;
+	}
+	io.set_values(state.io);
+	dma_cycles = state.dma_cycles;
+	update_intercepted();
+}
+
 void Memory::dma_transfer(uint8_t offset) {
 	// The DMA routine transfers the 160 byte block at the given address to the
-	// corresponding block in high RAM (+ 0xFE00). We copy each byte in the
-	// block to the destination.
-	Address dma_start = offset * 0x100;
+	// corresponding block in OAM (+ 0xFE00)
+	const Address destination = 0xFE00;
+	const size_t length = 0xA0;
+	auto source = static_cast<Address>(offset * 0x100);
+
+	// Sources past Work RAM reach it through Echo RAM
+	if (source >= 0xE000) {
+		source = static_cast<Address>(source - 0x2000);
+	}
+
+	auto oam = get_writable(destination);
+	auto boot_mapped = io.get(io::BOOT) != 0x1;
+	if (source < 0x8000 && !(boot_mapped && source < 0x0100)) {
+		// Cartridge ROM, in one copy out of the ROM data
+		cartridge->read_block(source, oam, length);
+	} else if (is_direct(source, length)) {
+		// Plain RAM, in one copy between the pages
+		auto from = pages[source / PAGE_SIZE]->data() + source % PAGE_SIZE;
+		std::memmove(oam, from, length);
+	} else {
+		// Anything else, like the boot ROM or cartridge RAM, byte by byte
+		for (size_t i = 0; i < length; ++i) {
+			oam[i] = read_mapped(static_cast<Address>(source + i));
+		}
+	}
+
+	// The CPU is locked out of the bus until the transfer is done. Restarting
+	// a transfer restarts the window.
+	dma_cycles = DMA_CYCLES;
+	update_intercepted();
+}
 
-	for (Address i = 0x0; i <= 0x9F; i++) {
-		Address source = dma_start + i;
-		Address destination = 0xFE00 + i;
+uint32_t Memory::get_write_count(Address start, Address end) const {
+	uint32_t count = 0;
+	for (auto page = start / PAGE_SIZE; page <= end / PAGE_SIZE; ++page) {
+		count += write_counts[page];
+	}
+	return count;
+}
 
-		memory[destination] = memory[source];
+void Memory::run_dma(cpu::ClockCycles cycles) {
+	dma_cycles = cycles < dma_cycles ? dma_cycles - cycles : 0;
+	if (!dma_cycles) {
+		update_intercepted();
 	}
 }
 
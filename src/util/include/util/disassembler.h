@@ -0,0 +1,89 @@
+/**
+ * @file disassembler.h
+ * Declares functions to disassemble Game Boy machine code
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Longest text of a disassembled instruction, including the terminating zero
+ */
+const size_t MAX_DISASSEMBLY_TEXT = 24;
+
+/**
+ * A single decoded instruction, with its operands filled into the text
+ */
+struct DisassembledInstruction {
+	/// Address the instruction was decoded at
+	uint16_t address;
+
+	/// Length in bytes, including the opcode and any 0xCB prefix
+	uint8_t length;
+
+	/// Opcode, or the second byte of 0xCB prefixed instructions
+	uint8_t opcode;
+
+	bool prefixed;
+
+	/// Set for jumps and calls to a constant address, which is in target
+	bool has_target;
+	uint16_t target;
+
+	/// Text of the instruction, like "JR NZ, $0155"
+	char text[MAX_DISASSEMBLY_TEXT];
+};
+
+/**
+ * Instructions decoded from one 16KB bank of a ROM
+ */
+struct BankDisassembly {
+	size_t bank;
+	std::vector<DisassembledInstruction> instructions;
+};
+
+/**
+ * Decode the instruction at the start of the given bytes. Does not allocate.
+ * Unused opcodes, and instructions cut off by the end of the bytes, decode as
+ * a single "DB" byte.
+ *
+ * @param data Bytes to decode
+ * @param size Number of bytes available, at least 1
+ * @param address Address of the first byte, for relative jump targets
+ */
+DisassembledInstruction disassemble_instruction(const uint8_t *data,
+                                                size_t size, uint16_t address);
+
+/**
+ * Decode every bank of a ROM, from start to end of each bank. Bank 0 is
+ * decoded at $0000 and every other bank at $4000, where it is mapped in.
+ * Banks are decoded in parallel.
+ *
+ * @param rom Complete contents of the ROM
+ * @param thread_count Number of threads to use. 0 uses one per core.
+ */
+std::vector<BankDisassembly> disassemble_rom(const std::vector<uint8_t> &rom,
+                                             size_t thread_count = 0);
+
+/**
+ * Write a disassembly as text, one instruction per line with its bank and
+ * address
+ */
+void write_disassembly(std::ostream &out,
+                       const std::vector<BankDisassembly> &banks);
+
+/**
+ * Get the mnemonic of an unprefixed opcode, with placeholders for operands,
+ * like "JR NZ, r8"
+ */
+std::string get_mnemonic(uint8_t opcode);
+
+/**
+ * Get the mnemonic of a 0xCB prefixed opcode, like "RL C"
+ */
+std::string get_cb_mnemonic(uint8_t opcode);
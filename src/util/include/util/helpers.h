@@ -3,6 +3,8 @@
  * Declares some nifty helper functions
  */
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 
@@ -13,5 +15,9 @@
  */
 template <typename T> std::string num_to_hex(T i);
 
-std::string get_mnemonic(uint8_t opcode);
-std::string get_cb_mnemonic(uint8_t opcode);
+/**
+ * 64-bit FNV-1a hash of a block of bytes. Stable across hosts and builds, so
+ * hashes can be stored in files.
+ */
+uint64_t hash_bytes(const uint8_t *data, size_t size);
+
@@ -16,9 +16,16 @@ enum class LogLevel { VERBOSE, INFO, WARN, ERROR, FATAL };
  * Static class to just dump stuff to std::out with pretty output
  */
 class Log {
+  private:
+	/// Messages below this level are dropped
+	static LogLevel min_level;
+
   public:
 	Log() = delete;
 
+	/// Set the minimum level of messages that are printed
+	static void set_level(LogLevel log_level);
+
 	/// Log something. Defaults to LogLevel::INFO if no level given
 	static void log(std::string message, LogLevel log_level = LogLevel::INFO);
 
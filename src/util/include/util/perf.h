@@ -0,0 +1,154 @@
+/**
+ * @file perf.h
+ * Declares the Perf class, for measuring host time spent per emulated frame
+ */
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#pragma once
+
+/**
+ * Parts of the emulator that host time is measured for. CPU is not timed
+ * itself, since it runs an instruction at a time. It is the rest of the
+ * frame, after the other sections.
+ */
+enum class PerfSection { CPU, GPU_LINE, GPU_SPRITES, VIDEO_PAINT, INPUT };
+
+/**
+ * Number of PerfSection values
+ */
+const size_t PERF_SECTION_COUNT = 5;
+
+/**
+ * Histogram of durations in nanoseconds, with log-linear buckets. Each power
+ * of two is split into 16 buckets, giving ~6% precision across the whole
+ * range. Recording and reading are lock-free, so another thread can read
+ * percentiles while the emulator records.
+ */
+class Histogram {
+  private:
+	/**
+	 * Number of linear sub-buckets per power of two, as a power of two
+	 */
+	static const uint32_t SUB_BUCKET_BITS = 4;
+	static const uint32_t BUCKET_COUNT = 64 << SUB_BUCKET_BITS;
+
+	std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets;
+	std::atomic<uint64_t> count;
+	std::atomic<uint64_t> sum;
+	std::atomic<uint64_t> max;
+
+	/**
+	 * Get the bucket index for the given value
+	 */
+	static uint32_t get_bucket(uint64_t value);
+
+	/**
+	 * Get the smallest value that falls into the given bucket
+	 */
+	static uint64_t get_bucket_start(uint32_t bucket);
+
+  public:
+	Histogram();
+
+	/**
+	 * Add a value to the histogram
+	 */
+	void record(uint64_t value);
+
+	/**
+	 * Clear all recorded values
+	 */
+	void reset();
+
+	/**
+	 * Get the value below which the given fraction of values fall
+	 *
+	 * @param percentile Fraction between 0 and 1, like 0.99 for p99
+	 */
+	uint64_t get_percentile(double percentile) const;
+
+	uint64_t get_count() const;
+	uint64_t get_mean() const;
+	uint64_t get_max() const;
+};
+
+/**
+ * Static class that measures host time spent in each PerfSection, and the
+ * total host time per emulated frame. Everything is a no-op until enable()
+ * is called.
+ *
+ * Timestamps come from the TSC on x86-64 hosts, calibrated against
+ * std::chrono::steady_clock, and from steady_clock elsewhere.
+ */
+class Perf {
+  private:
+	/// Set once measurements are enabled
+	static bool enabled;
+
+	/// Timestamp ticks per nanosecond
+	static double ticks_per_ns;
+
+	/// Timestamp at the end of the previous frame
+	static uint64_t frame_start;
+
+	/// Ticks spent in each section during the current frame
+	static std::array<uint64_t, PERF_SECTION_COUNT> frame_ticks;
+
+	/// Host time per frame, and per section per frame
+	static Histogram frame_times;
+	static std::array<Histogram, PERF_SECTION_COUNT> section_times;
+
+  public:
+	Perf() = delete;
+
+	/// Start measuring. Calibrates the timestamp counter, which takes ~20ms.
+	static void enable();
+
+	/// Check if measurements are enabled
+	static bool is_enabled() { return enabled; }
+
+	/// Read the timestamp counter
+	static uint64_t now();
+
+	/// Add time spent in a section during the current frame
+	static void add(PerfSection section, uint64_t ticks) {
+		frame_ticks[static_cast<size_t>(section)] += ticks;
+	}
+
+	/// Mark the end of an emulated frame
+	static void end_frame();
+
+	/// Get the number of frames measured
+	static uint64_t get_frame_count();
+
+	/// Write a summary of frame and section times
+	static void write_summary(std::ostream &out);
+
+	/// Get the name of a section
+	static std::string get_section_name(PerfSection section);
+};
+
+/**
+ * Measures the time until the end of the enclosing scope, and adds it to the
+ * given section. Costs a single branch when Perf is not enabled.
+ */
+class PerfScope {
+  private:
+	PerfSection section;
+	uint64_t start;
+
+  public:
+	explicit PerfScope(PerfSection section)
+	    : section(section), start(Perf::is_enabled() ? Perf::now() : 0) {}
+
+	~PerfScope() {
+		if (Perf::is_enabled()) {
+			Perf::add(section, Perf::now() - start);
+		}
+	}
+};
@@ -0,0 +1,96 @@
+/**
+ * @file thread_pool.h
+ * Declares the ThreadPool class
+ */
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#pragma once
+
+/**
+ * Fixed size pool of threads that run submitted tasks. Each thread has its own
+ * queue of tasks, and steals from the other queues once its own is empty, so
+ * that uneven tasks still keep every thread busy.
+ */
+class ThreadPool {
+  private:
+	/**
+	 * Queue of tasks waiting to run on one thread
+	 */
+	struct TaskQueue {
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	std::vector<std::unique_ptr<TaskQueue>> queues;
+	std::vector<std::thread> threads;
+
+	/**
+	 * Guards the counts below, and the condition variables that wait on them
+	 */
+	std::mutex state_mutex;
+	std::condition_variable work_available;
+	std::condition_variable all_done;
+
+	/// Number of tasks submitted but not yet started
+	size_t queued;
+
+	/// Number of tasks submitted but not yet finished
+	size_t pending;
+
+	/// Set when the pool is being destroyed
+	bool stopping;
+
+	/// Queue that the next task submitted from outside the pool goes to
+	size_t next_queue;
+
+	/**
+	 * Take a task from the given thread's own queue, newest first, or steal
+	 * the oldest task from another thread's queue
+	 *
+	 * @return true if a task was found
+	 */
+	bool pop_task(size_t index, std::function<void()> &task);
+
+	/**
+	 * Main loop of each thread
+	 */
+	void run_worker(size_t index);
+
+  public:
+	/**
+	 * @param thread_count Number of threads to start. 0 starts one per core.
+	 */
+	explicit ThreadPool(size_t thread_count = 0);
+
+	/**
+	 * Wait for the running tasks to finish, and stop all threads. Tasks that
+	 * have not started yet are still run.
+	 */
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+	/**
+	 * Add a task to the pool. Tasks submitted from one of the pool's threads
+	 * go to that thread's own queue.
+	 */
+	void submit(std::function<void()> task);
+
+	/**
+	 * Block until every submitted task has finished
+	 */
+	void wait();
+
+	/**
+	 * Get the number of threads in the pool
+	 */
+	size_t get_thread_count() const;
+};
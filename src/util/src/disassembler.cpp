@@ -0,0 +1,529 @@
+/**
+ * @file disassembler.cpp
+ * Defines the disassembler functions
+ */
+
+#include "util/disassembler.h"
+#include "util/thread_pool.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+/**
+ * Kinds of operand that follow an opcode. The mnemonic names the operand with
+ * a placeholder, which is replaced by its value when disassembling.
+ * D8  -> 8-bit immediate, "d8"
+ * D16 -> 16-bit immediate, "d16"
+ * A8  -> Offset into $FF00, "a8"
+ * A16 -> 16-bit address, "a16"
+ * J16 -> 16-bit jump or call target, "a16"
+ * R8  -> Signed jump offset from the next instruction, "r8"
+ * S8  -> Signed offset added to SP, "r8"
+ */
+enum OperandKind : uint8_t { NONE, D8, D16, A8, A16, J16, R8, S8 };
+
+/**
+ * Placeholder text of each operand kind
+ */
+constexpr std::array<const char *, 8> operand_placeholders = {
+    "", "d8", "d16", "a8", "a16", "a16", "r8", "r8"};
+
+/**
+ * Mnemonic, length and operand of an unprefixed opcode
+ */
+struct OpcodeInfo {
+	const char *mnemonic;
+	uint8_t length;
+	OperandKind operand;
+};
+
+// clang-format off
+constexpr std::array<OpcodeInfo, 256> opcode_table = {{
+    /* 0x00 */ {"NOP", 1, NONE},
+    /* 0x01 */ {"LD BC, d16", 3, D16},
+    /* 0x02 */ {"LD (BC), A", 1, NONE},
+    /* 0x03 */ {"INC BC", 1, NONE},
+    /* 0x04 */ {"INC B", 1, NONE},
+    /* 0x05 */ {"DEC B", 1, NONE},
+    /* 0x06 */ {"LD B, d8", 2, D8},
+    /* 0x07 */ {"RLCA", 1, NONE},
+    /* 0x08 */ {"LD (a16), SP", 3, A16},
+    /* 0x09 */ {"ADD HL, BC", 1, NONE},
+    /* 0x0A */ {"LD A, (BC)", 1, NONE},
+    /* 0x0B */ {"DEC BC", 1, NONE},
+    /* 0x0C */ {"INC C", 1, NONE},
+    /* 0x0D */ {"DEC C", 1, NONE},
+    /* 0x0E */ {"LD C, d8", 2, D8},
+    /* 0x0F */ {"RRCA", 1, NONE},
+    /* 0x10 */ {"STOP 0", 2, NONE},
+    /* 0x11 */ {"LD DE, d16", 3, D16},
+    /* 0x12 */ {"LD (DE), A", 1, NONE},
+    /* 0x13 */ {"INC DE", 1, NONE},
+    /* 0x14 */ {"INC D", 1, NONE},
+    /* 0x15 */ {"DEC D", 1, NONE},
+    /* 0x16 */ {"LD D, d8", 2, D8},
+    /* 0x17 */ {"RLA", 1, NONE},
+    /* 0x18 */ {"JR r8", 2, R8},
+    /* 0x19 */ {"ADD HL, DE", 1, NONE},
+    /* 0x1A */ {"LD A, (DE)", 1, NONE},
+    /* 0x1B */ {"DEC DE", 1, NONE},
+    /* 0x1C */ {"INC E", 1, NONE},
+    /* 0x1D */ {"DEC E", 1, NONE},
+    /* 0x1E */ {"LD E, d8", 2, D8},
+    /* 0x1F */ {"RRA", 1, NONE},
+    /* 0x20 */ {"JR NZ, r8", 2, R8},
+    /* 0x21 */ {"LD HL, d16", 3, D16},
+    /* 0x22 */ {"LD (HL+), A", 1, NONE},
+    /* 0x23 */ {"INC HL", 1, NONE},
+    /* 0x24 */ {"INC H", 1, NONE},
+    /* 0x25 */ {"DEC H", 1, NONE},
+    /* 0x26 */ {"LD H, d8", 2, D8},
+    /* 0x27 */ {"DAA", 1, NONE},
+    /* 0x28 */ {"JR Z, r8", 2, R8},
+    /* 0x29 */ {"ADD HL, HL", 1, NONE},
+    /* 0x2A */ {"LD A, (HL+)", 1, NONE},
+    /* 0x2B */ {"DEC HL", 1, NONE},
+    /* 0x2C */ {"INC L", 1, NONE},
+    /* 0x2D */ {"DEC L", 1, NONE},
+    /* 0x2E */ {"LD L, d8", 2, D8},
+    /* 0x2F */ {"CPL", 1, NONE},
+    /* 0x30 */ {"JR NC, r8", 2, R8},
+    /* 0x31 */ {"LD SP, d16", 3, D16},
+    /* 0x32 */ {"LD (HL-), A", 1, NONE},
+    /* 0x33 */ {"INC SP", 1, NONE},
+    /* 0x34 */ {"INC (HL)", 1, NONE},
+    /* 0x35 */ {"DEC (HL)", 1, NONE},
+    /* 0x36 */ {"LD (HL), d8", 2, D8},
+    /* 0x37 */ {"SCF", 1, NONE},
+    /* 0x38 */ {"JR C, r8", 2, R8},
+    /* 0x39 */ {"ADD HL, SP", 1, NONE},
+    /* 0x3A */ {"LD A, (HL-)", 1, NONE},
+    /* 0x3B */ {"DEC SP", 1, NONE},
+    /* 0x3C */ {"INC A", 1, NONE},
+    /* 0x3D */ {"DEC A", 1, NONE},
+    /* 0x3E */ {"LD A, d8", 2, D8},
+    /* 0x3F */ {"CCF", 1, NONE},
+    /* 0x40 */ {"LD B, B", 1, NONE},
+    /* 0x41 */ {"LD B, C", 1, NONE},
+    /* 0x42 */ {"LD B, D", 1, NONE},
+    /* 0x43 */ {"LD B, E", 1, NONE},
+    /* 0x44 */ {"LD B, H", 1, NONE},
+    /* 0x45 */ {"LD B, L", 1, NONE},
+    /* 0x46 */ {"LD B, (HL)", 1, NONE},
+    /* 0x47 */ {"LD B, A", 1, NONE},
+    /* 0x48 */ {"LD C, B", 1, NONE},
+    /* 0x49 */ {"LD C, C", 1, NONE},
+    /* 0x4A */ {"LD C, D", 1, NONE},
+    /* 0x4B */ {"LD C, E", 1, NONE},
+    /* 0x4C */ {"LD C, H", 1, NONE},
+    /* 0x4D */ {"LD C, L", 1, NONE},
+    /* 0x4E */ {"LD C, (HL)", 1, NONE},
+    /* 0x4F */ {"LD C, A", 1, NONE},
+    /* 0x50 */ {"LD D, B", 1, NONE},
+    /* 0x51 */ {"LD D, C", 1, NONE},
+    /* 0x52 */ {"LD D, D", 1, NONE},
+    /* 0x53 */ {"LD D, E", 1, NONE},
+    /* 0x54 */ {"LD D, H", 1, NONE},
+    /* 0x55 */ {"LD D, L", 1, NONE},
+    /* 0x56 */ {"LD D, (HL)", 1, NONE},
+    /* 0x57 */ {"LD D, A", 1, NONE},
+    /* 0x58 */ {"LD E, B", 1, NONE},
+    /* 0x59 */ {"LD E, C", 1, NONE},
+    /* 0x5A */ {"LD E, D", 1, NONE},
+    /* 0x5B */ {"LD E, E", 1, NONE},
+    /* 0x5C */ {"LD E, H", 1, NONE},
+    /* 0x5D */ {"LD E, L", 1, NONE},
+    /* 0x5E */ {"LD E, (HL)", 1, NONE},
+    /* 0x5F */ {"LD E, A", 1, NONE},
+    /* 0x60 */ {"LD H, B", 1, NONE},
+    /* 0x61 */ {"LD H, C", 1, NONE},
+    /* 0x62 */ {"LD H, D", 1, NONE},
+    /* 0x63 */ {"LD H, E", 1, NONE},
+    /* 0x64 */ {"LD H, H", 1, NONE},
+    /* 0x65 */ {"LD H, L", 1, NONE},
+    /* 0x66 */ {"LD H, (HL)", 1, NONE},
+    /* 0x67 */ {"LD H, A", 1, NONE},
+    /* 0x68 */ {"LD L, B", 1, NONE},
+    /* 0x69 */ {"LD L, C", 1, NONE},
+    /* 0x6A */ {"LD L, D", 1, NONE},
+    /* 0x6B */ {"LD L, E", 1, NONE},
+    /* 0x6C */ {"LD L, H", 1, NONE},
+    /* 0x6D */ {"LD L, L", 1, NONE},
+    /* 0x6E */ {"LD L, (HL)", 1, NONE},
+    /* 0x6F */ {"LD L, A", 1, NONE},
+    /* 0x70 */ {"LD (HL), B", 1, NONE},
+    /* 0x71 */ {"LD (HL), C", 1, NONE},
+    /* 0x72 */ {"LD (HL), D", 1, NONE},
+    /* 0x73 */ {"LD (HL), E", 1, NONE},
+    /* 0x74 */ {"LD (HL), H", 1, NONE},
+    /* 0x75 */ {"LD (HL), L", 1, NONE},
+    /* 0x76 */ {"HALT", 1, NONE},
+    /* 0x77 */ {"LD (HL), A", 1, NONE},
+    /* 0x78 */ {"LD A, B", 1, NONE},
+    /* 0x79 */ {"LD A, C", 1, NONE},
+    /* 0x7A */ {"LD A, D", 1, NONE},
+    /* 0x7B */ {"LD A, E", 1, NONE},
+    /* 0x7C */ {"LD A, H", 1, NONE},
+    /* 0x7D */ {"LD A, L", 1, NONE},
+    /* 0x7E */ {"LD A, (HL)", 1, NONE},
+    /* 0x7F */ {"LD A, A", 1, NONE},
+    /* 0x80 */ {"ADD A, B", 1, NONE},
+    /* 0x81 */ {"ADD A, C", 1, NONE},
+    /* 0x82 */ {"ADD A, D", 1, NONE},
+    /* 0x83 */ {"ADD A, E", 1, NONE},
+    /* 0x84 */ {"ADD A, H", 1, NONE},
+    /* 0x85 */ {"ADD A, L", 1, NONE},
+    /* 0x86 */ {"ADD A, (HL)", 1, NONE},
+    /* 0x87 */ {"ADD A, A", 1, NONE},
+    /* 0x88 */ {"ADC A, B", 1, NONE},
+    /* 0x89 */ {"ADC A, C", 1, NONE},
+    /* 0x8A */ {"ADC A, D", 1, NONE},
+    /* 0x8B */ {"ADC A, E", 1, NONE},
+    /* 0x8C */ {"ADC A, H", 1, NONE},
+    /* 0x8D */ {"ADC A, L", 1, NONE},
+    /* 0x8E */ {"ADC A, (HL)", 1, NONE},
+    /* 0x8F */ {"ADC A, A", 1, NONE},
+    /* 0x90 */ {"SUB B", 1, NONE},
+    /* 0x91 */ {"SUB C", 1, NONE},
+    /* 0x92 */ {"SUB D", 1, NONE},
+    /* 0x93 */ {"SUB E", 1, NONE},
+    /* 0x94 */ {"SUB H", 1, NONE},
+    /* 0x95 */ {"SUB L", 1, NONE},
+    /* 0x96 */ {"SUB (HL)", 1, NONE},
+    /* 0x97 */ {"SUB A", 1, NONE},
+    /* 0x98 */ {"SBC A, B", 1, NONE},
+    /* 0x99 */ {"SBC A, C", 1, NONE},
+    /* 0x9A */ {"SBC A, D", 1, NONE},
+    /* 0x9B */ {"SBC A, E", 1, NONE},
+    /* 0x9C */ {"SBC A, H", 1, NONE},
+    /* 0x9D */ {"SBC A, L", 1, NONE},
+    /* 0x9E */ {"SBC A, (HL)", 1, NONE},
+    /* 0x9F */ {"SBC A, A", 1, NONE},
+    /* 0xA0 */ {"AND B", 1, NONE},
+    /* 0xA1 */ {"AND C", 1, NONE},
+    /* 0xA2 */ {"AND D", 1, NONE},
+    /* 0xA3 */ {"AND E", 1, NONE},
+    /* 0xA4 */ {"AND H", 1, NONE},
+    /* 0xA5 */ {"AND L", 1, NONE},
+    /* 0xA6 */ {"AND (HL)", 1, NONE},
+    /* 0xA7 */ {"AND A", 1, NONE},
+    /* 0xA8 */ {"XOR B", 1, NONE},
+    /* 0xA9 */ {"XOR C", 1, NONE},
+    /* 0xAA */ {"XOR D", 1, NONE},
+    /* 0xAB */ {"XOR E", 1, NONE},
+    /* 0xAC */ {"XOR H", 1, NONE},
+    /* 0xAD */ {"XOR L", 1, NONE},
+    /* 0xAE */ {"XOR (HL)", 1, NONE},
+    /* 0xAF */ {"XOR A", 1, NONE},
+    /* 0xB0 */ {"OR B", 1, NONE},
+    /* 0xB1 */ {"OR C", 1, NONE},
+    /* 0xB2 */ {"OR D", 1, NONE},
+    /* 0xB3 */ {"OR E", 1, NONE},
+    /* 0xB4 */ {"OR H", 1, NONE},
+    /* 0xB5 */ {"OR L", 1, NONE},
+    /* 0xB6 */ {"OR (HL)", 1, NONE},
+    /* 0xB7 */ {"OR A", 1, NONE},
+    /* 0xB8 */ {"CP B", 1, NONE},
+    /* 0xB9 */ {"CP C", 1, NONE},
+    /* 0xBA */ {"CP D", 1, NONE},
+    /* 0xBB */ {"CP E", 1, NONE},
+    /* 0xBC */ {"CP H", 1, NONE},
+    /* 0xBD */ {"CP L", 1, NONE},
+    /* 0xBE */ {"CP (HL)", 1, NONE},
+    /* 0xBF */ {"CP A", 1, NONE},
+    /* 0xC0 */ {"RET NZ", 1, NONE},
+    /* 0xC1 */ {"POP BC", 1, NONE},
+    /* 0xC2 */ {"JP NZ, a16", 3, J16},
+    /* 0xC3 */ {"JP a16", 3, J16},
+    /* 0xC4 */ {"CALL NZ, a16", 3, J16},
+    /* 0xC5 */ {"PUSH BC", 1, NONE},
+    /* 0xC6 */ {"ADD A, d8", 2, D8},
+    /* 0xC7 */ {"RST 00H", 1, NONE},
+    /* 0xC8 */ {"RET Z", 1, NONE},
+    /* 0xC9 */ {"RET", 1, NONE},
+    /* 0xCA */ {"JP Z, a16", 3, J16},
+    /* 0xCB */ {"PREFIX CB", 2, NONE},
+    /* 0xCC */ {"CALL Z, a16", 3, J16},
+    /* 0xCD */ {"CALL a16", 3, J16},
+    /* 0xCE */ {"ADC A, d8", 2, D8},
+    /* 0xCF */ {"RST 08H", 1, NONE},
+    /* 0xD0 */ {"RET NC", 1, NONE},
+    /* 0xD1 */ {"POP DE", 1, NONE},
+    /* 0xD2 */ {"JP NC, a16", 3, J16},
+    /* 0xD3 */ {"DB", 1, NONE},
+    /* 0xD4 */ {"CALL NC, a16", 3, J16},
+    /* 0xD5 */ {"PUSH DE", 1, NONE},
+    /* 0xD6 */ {"SUB d8", 2, D8},
+    /* 0xD7 */ {"RST 10H", 1, NONE},
+    /* 0xD8 */ {"RET C", 1, NONE},
+    /* 0xD9 */ {"RETI", 1, NONE},
+    /* 0xDA */ {"JP C, a16", 3, J16},
+    /* 0xDB */ {"DB", 1, NONE},
+    /* 0xDC */ {"CALL C, a16", 3, J16},
+    /* 0xDD */ {"DB", 1, NONE},
+    /* 0xDE */ {"SBC A, d8", 2, D8},
+    /* 0xDF */ {"RST 18H", 1, NONE},
+    /* 0xE0 */ {"LDH (a8), A", 2, A8},
+    /* 0xE1 */ {"POP HL", 1, NONE},
+    /* 0xE2 */ {"LD (C), A", 1, NONE},
+    /* 0xE3 */ {"DB", 1, NONE},
+    /* 0xE4 */ {"DB", 1, NONE},
+    /* 0xE5 */ {"PUSH HL", 1, NONE},
+    /* 0xE6 */ {"AND d8", 2, D8},
+    /* 0xE7 */ {"RST 20H", 1, NONE},
+    /* 0xE8 */ {"ADD SP, r8", 2, S8},
+    /* 0xE9 */ {"JP (HL)", 1, NONE},
+    /* 0xEA */ {"LD (a16), A", 3, A16},
+    /* 0xEB */ {"DB", 1, NONE},
+    /* 0xEC */ {"DB", 1, NONE},
+    /* 0xED */ {"DB", 1, NONE},
+    /* 0xEE */ {"XOR d8", 2, D8},
+    /* 0xEF */ {"RST 28H", 1, NONE},
+    /* 0xF0 */ {"LDH A, (a8)", 2, A8},
+    /* 0xF1 */ {"POP AF", 1, NONE},
+    /* 0xF2 */ {"LD A, (C)", 1, NONE},
+    /* 0xF3 */ {"DI", 1, NONE},
+    /* 0xF4 */ {"DB", 1, NONE},
+    /* 0xF5 */ {"PUSH AF", 1, NONE},
+    /* 0xF6 */ {"OR d8", 2, D8},
+    /* 0xF7 */ {"RST 30H", 1, NONE},
+    /* 0xF8 */ {"LD HL, SP+r8", 2, S8},
+    /* 0xF9 */ {"LD SP, HL", 1, NONE},
+    /* 0xFA */ {"LD A, (a16)", 3, A16},
+    /* 0xFB */ {"EI", 1, NONE},
+    /* 0xFC */ {"DB", 1, NONE},
+    /* 0xFD */ {"DB", 1, NONE},
+    /* 0xFE */ {"CP d8", 2, D8},
+    /* 0xFF */ {"RST 38H", 1, NONE},
+}};
+// clang-format on
+
+/**
+ * 0xCB prefixed opcodes are regular. Bits 6-7 select the group, bits 3-5 the
+ * operation or bit number, and bits 0-2 the register.
+ */
+constexpr std::array<const char *, 8> cb_operations = {
+    "RLC", "RRC", "RL", "RR", "SLA", "SRA", "SWAP", "SRL"};
+constexpr std::array<const char *, 4> cb_groups = {"", "BIT", "RES", "SET"};
+constexpr std::array<const char *, 8> cb_registers = {
+    "B", "C", "D", "E", "H", "L", "(HL)", "A"};
+
+constexpr char hex_digits[] = "0123456789ABCDEF";
+
+/**
+ * Appends text to a fixed buffer, dropping whatever does not fit
+ */
+class TextWriter {
+  private:
+	char *buffer;
+	size_t capacity;
+	size_t size;
+
+  public:
+	TextWriter(char *buffer, size_t capacity)
+	    : buffer(buffer), capacity(capacity), size(0) {
+		buffer[0] = '\0';
+	}
+
+	void put(char c) {
+		if (size + 1 < capacity) {
+			buffer[size++] = c;
+			buffer[size] = '\0';
+		}
+	}
+
+	void put(const char *text) {
+		while (*text) {
+			put(*text++);
+		}
+	}
+
+	/**
+	 * Write a value as "$" and the given number of hex digits
+	 */
+	void put_hex(uint16_t value, int digits) {
+		put('$');
+		for (auto shift = (digits - 1) * 4; shift >= 0; shift -= 4) {
+			put(hex_digits[(value >> shift) & 0xF]);
+		}
+	}
+
+	/**
+	 * Write a signed offset. A "+" just before it is replaced by the sign.
+	 */
+	void put_signed(int8_t value) {
+		if (value < 0) {
+			if (size > 0 && buffer[size - 1] == '+') {
+				buffer[size - 1] = '-';
+			} else {
+				put('-');
+			}
+		}
+		put_hex(static_cast<uint8_t>(value < 0 ? -value : value), 2);
+	}
+};
+
+/**
+ * Write the text of a 0xCB prefixed instruction
+ */
+void write_cb_mnemonic(TextWriter &writer, uint8_t opcode) {
+	auto group = opcode >> 6;
+	auto middle = (opcode >> 3) & 0x7;
+	if (group == 0) {
+		writer.put(cb_operations[middle]);
+	} else {
+		writer.put(cb_groups[group]);
+		writer.put(' ');
+		writer.put(static_cast<char>('0' + middle));
+		writer.put(',');
+	}
+	writer.put(' ');
+	writer.put(cb_registers[opcode & 0x7]);
+}
+
+/**
+ * Decode a whole bank of a ROM
+ */
+void disassemble_bank(const std::vector<uint8_t> &rom, BankDisassembly *bank) {
+	const size_t BANK_SIZE = 0x4000;
+	auto start = bank->bank * BANK_SIZE;
+	auto end = std::min(start + BANK_SIZE, rom.size());
+	auto base = static_cast<uint16_t>(bank->bank == 0 ? 0x0000 : 0x4000);
+
+	// Most instructions are a single byte, so this rarely grows
+	bank->instructions.reserve((end - start) / 2);
+	for (auto offset = start; offset < end;) {
+		auto address = static_cast<uint16_t>(base + (offset - start));
+		bank->instructions.push_back(
+		    disassemble_instruction(&rom[offset], end - offset, address));
+		offset += bank->instructions.back().length;
+	}
+}
+
+} // namespace
+
+DisassembledInstruction disassemble_instruction(const uint8_t *data,
+                                                size_t size, uint16_t address) {
+	auto inst = DisassembledInstruction{};
+	inst.address = address;
+	inst.opcode = data[0];
+	auto writer = TextWriter(inst.text, MAX_DISASSEMBLY_TEXT);
+
+	auto &info = opcode_table[data[0]];
+	if (size < info.length) {
+		// Cut off by the end of the data, so this can only be a byte of data
+		inst.length = 1;
+		writer.put("DB ");
+		writer.put_hex(data[0], 2);
+		return inst;
+	}
+	inst.length = info.length;
+
+	if (data[0] == 0xCB) {
+		inst.opcode = data[1];
+		inst.prefixed = true;
+		write_cb_mnemonic(writer, data[1]);
+		return inst;
+	}
+
+	if (info.length == 1 && std::strcmp(info.mnemonic, "DB") == 0) {
+		writer.put("DB ");
+		writer.put_hex(data[0], 2);
+		return inst;
+	}
+
+	// RST jumps to a fixed vector, which is part of its opcode
+	if ((data[0] & 0xC7) == 0xC7) {
+		inst.has_target = true;
+		inst.target = data[0] & 0x38;
+	}
+
+	// Copy the mnemonic, replacing the placeholder with the operand
+	auto placeholder = operand_placeholders[info.operand];
+	auto placeholder_length = std::strlen(placeholder);
+	auto immediate =
+	    info.length == 3 ? static_cast<uint16_t>(data[1] | (data[2] << 8)) : 0;
+	for (auto text = info.mnemonic; *text;) {
+		if (info.operand == NONE ||
+		    std::strncmp(text, placeholder, placeholder_length) != 0) {
+			writer.put(*text++);
+			continue;
+		}
+		text += placeholder_length;
+
+		switch (info.operand) {
+		case D8:
+			writer.put_hex(data[1], 2);
+			break;
+		case A8:
+			writer.put_hex(0xFF00 | data[1], 4);
+			break;
+		case D16:
+		case A16:
+			writer.put_hex(immediate, 4);
+			break;
+		case J16:
+			inst.has_target = true;
+			inst.target = immediate;
+			writer.put_hex(immediate, 4);
+			break;
+		case R8:
+			inst.has_target = true;
+			inst.target = static_cast<uint16_t>(
+			    address + 2 + static_cast<int8_t>(data[1]));
+			writer.put_hex(inst.target, 4);
+			break;
+		case S8:
+			writer.put_signed(static_cast<int8_t>(data[1]));
+			break;
+		case NONE:
+			break;
+		}
+	}
+
+	return inst;
+}
+
+std::vector<BankDisassembly> disassemble_rom(const std::vector<uint8_t> &rom,
+                                             size_t thread_count) {
+	const size_t BANK_SIZE = 0x4000;
+	auto banks = std::vector<BankDisassembly>((rom.size() + BANK_SIZE - 1) /
+	                                          BANK_SIZE);
+
+	// Every bank is independent, and writes only to its own entry
+	auto pool = ThreadPool(thread_count);
+	for (size_t i = 0; i < banks.size(); ++i) {
+		banks[i].bank = i;
+		pool.submit([&rom, &banks, i]() { disassemble_bank(rom, &banks[i]); });
+	}
+	pool.wait();
+
+	return banks;
+}
+
+void write_disassembly(std::ostream &out,
+                       const std::vector<BankDisassembly> &banks) {
+	char prefix[16];
+	for (auto &bank : banks) {
+		for (auto &inst : bank.instructions) {
+			std::snprintf(prefix, sizeof(prefix), "%02zX:%04X  ", bank.bank,
+			              inst.address);
+			out << prefix << inst.text << "\n";
+		}
+	}
+}
+
+std::string get_mnemonic(uint8_t opcode) {
+	return opcode_table[opcode].mnemonic;
+}
+
+std::string get_cb_mnemonic(uint8_t opcode) {
+	char text[MAX_DISASSEMBLY_TEXT];
+	auto writer = TextWriter(text, sizeof(text));
+	write_cb_mnemonic(writer, opcode);
+	return text;
+}
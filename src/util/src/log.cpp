@@ -9,9 +9,16 @@
 
 using namespace std;
 
+LogLevel Log::min_level = LogLevel::VERBOSE;
+
+void Log::set_level(LogLevel log_level) { min_level = log_level; }
+
 #if defined(_WIN32) || defined(WIN32)
 
 void Log::log(string message, LogLevel log_level) {
+	if (log_level < min_level && log_level != LogLevel::FATAL)
+		return;
+
 	switch (log_level) {
 	case LogLevel::VERBOSE:
 		cout << " [VERB] ";
@@ -54,6 +61,9 @@ const auto END = "\033[0m";
 }; // namespace color
 
 void Log::log(string message, LogLevel log_level) {
+	if (log_level < min_level && log_level != LogLevel::FATAL)
+		return;
+
 	switch (log_level) {
 	case LogLevel::VERBOSE:
 		cout << color::GRAY << " [VERB] " << color::END;
@@ -0,0 +1,211 @@
+/**
+ * @file perf.cpp
+ * Defines the Perf and Histogram classes
+ */
+
+#include "util/perf.h"
+
+#include <chrono>
+#include <iomanip>
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define TVP_HAS_TSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+using namespace std;
+
+/// Histogram
+
+Histogram::Histogram() : buckets(), count(0), sum(0), max(0) {}
+
+uint32_t Histogram::get_bucket(uint64_t value) {
+	// Values below the sub-bucket count map to themselves
+	if (value < (1u << SUB_BUCKET_BITS)) {
+		return static_cast<uint32_t>(value);
+	}
+
+	// Otherwise, the top bit picks the power of two, and the next
+	// SUB_BUCKET_BITS bits pick the bucket within it
+	uint32_t msb = 63;
+	while (!(value >> msb)) {
+		--msb;
+	}
+	auto shift = msb - SUB_BUCKET_BITS;
+	auto sub_bucket = (value >> shift) & ((1u << SUB_BUCKET_BITS) - 1);
+	return ((shift + 1) << SUB_BUCKET_BITS) | static_cast<uint32_t>(sub_bucket);
+}
+
+uint64_t Histogram::get_bucket_start(uint32_t bucket) {
+	auto power = bucket >> SUB_BUCKET_BITS;
+	auto sub_bucket = bucket & ((1u << SUB_BUCKET_BITS) - 1);
+	if (power == 0) {
+		return sub_bucket;
+	}
+	auto shift = power - 1;
+	return ((1ull << SUB_BUCKET_BITS) | sub_bucket) << shift;
+}
+
+void Histogram::record(uint64_t value) {
+	buckets[get_bucket(value)].fetch_add(1, memory_order_relaxed);
+	count.fetch_add(1, memory_order_relaxed);
+	sum.fetch_add(value, memory_order_relaxed);
+
+	auto current_max = max.load(memory_order_relaxed);
+	while (value > current_max &&
+	       !max.compare_exchange_weak(current_max, value,
+	                                  memory_order_relaxed)) {
+	}
+}
+
+void Histogram::reset() {
+	for (auto &bucket : buckets) {
+		bucket.store(0, memory_order_relaxed);
+	}
+	count.store(0, memory_order_relaxed);
+	sum.store(0, memory_order_relaxed);
+	max.store(0, memory_order_relaxed);
+}
+
+uint64_t Histogram::get_percentile(double percentile) const {
+	auto total = get_count();
+	if (total == 0) {
+		return 0;
+	}
+
+	auto target = static_cast<uint64_t>(percentile * total);
+	uint64_t seen = 0;
+	for (uint32_t i = 0; i < BUCKET_COUNT; ++i) {
+		seen += buckets[i].load(memory_order_relaxed);
+		if (seen > target) {
+			return get_bucket_start(i);
+		}
+	}
+	return get_max();
+}
+
+uint64_t Histogram::get_count() const {
+	return count.load(memory_order_relaxed);
+}
+
+uint64_t Histogram::get_mean() const {
+	auto total = get_count();
+	return total ? sum.load(memory_order_relaxed) / total : 0;
+}
+
+uint64_t Histogram::get_max() const { return max.load(memory_order_relaxed); }
+
+/// Perf
+
+bool Perf::enabled = false;
+double Perf::ticks_per_ns = 1.0;
+uint64_t Perf::frame_start = 0;
+array<uint64_t, PERF_SECTION_COUNT> Perf::frame_ticks = {};
+Histogram Perf::frame_times;
+array<Histogram, PERF_SECTION_COUNT> Perf::section_times;
+
+uint64_t Perf::now() {
+#ifdef TVP_HAS_TSC
+	return __rdtsc();
+#else
+	return chrono::duration_cast<chrono::nanoseconds>(
+	           chrono::steady_clock::now().time_since_epoch())
+	    .count();
+#endif
+}
+
+void Perf::enable() {
+#ifdef TVP_HAS_TSC
+	// Find the TSC frequency by comparing it with the steady clock
+	auto clock_start = chrono::steady_clock::now();
+	auto tsc_start = now();
+	this_thread::sleep_for(chrono::milliseconds(20));
+	auto tsc_end = now();
+	auto clock_end = chrono::steady_clock::now();
+
+	auto elapsed_ns =
+	    chrono::duration_cast<chrono::nanoseconds>(clock_end - clock_start)
+	        .count();
+	ticks_per_ns = static_cast<double>(tsc_end - tsc_start) / elapsed_ns;
+#endif
+
+	frame_ticks.fill(0);
+	frame_start = now();
+	enabled = true;
+}
+
+void Perf::end_frame() {
+	if (!enabled) {
+		return;
+	}
+
+	auto frame_end = now();
+	auto total_ticks = frame_end - frame_start;
+	frame_times.record(static_cast<uint64_t>(total_ticks / ticks_per_ns));
+	frame_start = frame_end;
+
+	// The CPU gets whatever the timed sections left
+	auto cpu = static_cast<size_t>(PerfSection::CPU);
+	uint64_t timed_ticks = 0;
+	for (size_t i = 0; i < PERF_SECTION_COUNT; ++i) {
+		timed_ticks += i == cpu ? 0 : frame_ticks[i];
+	}
+	frame_ticks[cpu] = total_ticks > timed_ticks ? total_ticks - timed_ticks : 0;
+
+	for (size_t i = 0; i < PERF_SECTION_COUNT; ++i) {
+		section_times[i].record(
+		    static_cast<uint64_t>(frame_ticks[i] / ticks_per_ns));
+		frame_ticks[i] = 0;
+	}
+}
+
+uint64_t Perf::get_frame_count() { return frame_times.get_count(); }
+
+string Perf::get_section_name(PerfSection section) {
+	switch (section) {
+	case PerfSection::CPU:
+		return "cpu";
+	case PerfSection::GPU_LINE:
+		return "gpu_line";
+	case PerfSection::GPU_SPRITES:
+		return "gpu_sprites";
+	case PerfSection::VIDEO_PAINT:
+		return "video_paint";
+	case PerfSection::INPUT:
+		return "input";
+	}
+	return "unknown";
+}
+
+void Perf::write_summary(ostream &out) {
+	// Durations are printed in microseconds
+	auto us = [](uint64_t ns) { return ns / 1000.0; };
+
+	auto mean_frame = frame_times.get_mean();
+	out << fixed << setprecision(1);
+	out << "frames " << frame_times.get_count() << "\n";
+	out << left << setw(14) << "section" << right << setw(10) << "mean_us"
+	    << setw(10) << "p50_us" << setw(10) << "p99_us" << setw(10)
+	    << "max_us" << setw(8) << "share" << "\n";
+
+	auto write_row = [&](const string &name, const Histogram &histogram) {
+		auto share = mean_frame ? 100.0 * histogram.get_mean() / mean_frame
+		                        : 0.0;
+		out << left << setw(14) << name << right << setw(10)
+		    << us(histogram.get_mean()) << setw(10)
+		    << us(histogram.get_percentile(0.50)) << setw(10)
+		    << us(histogram.get_percentile(0.99)) << setw(10)
+		    << us(histogram.get_max()) << setw(7) << share << "%\n";
+	};
+
+	write_row("frame", frame_times);
+	for (size_t i = 0; i < PERF_SECTION_COUNT; ++i) {
+		write_row(get_section_name(static_cast<PerfSection>(i)),
+		          section_times[i]);
+	}
+}
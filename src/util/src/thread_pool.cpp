@@ -0,0 +1,135 @@
+/**
+ * @file thread_pool.cpp
+ * Defines the ThreadPool class
+ */
+
+#include "util/thread_pool.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+/**
+ * The pool that the current thread belongs to, if any, and its index in it
+ */
+thread_local const ThreadPool *current_pool = nullptr;
+thread_local size_t current_index = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t thread_count)
+    : queued(0), pending(0), stopping(false), next_queue(0) {
+	if (thread_count == 0) {
+		thread_count = max(1u, thread::hardware_concurrency());
+	}
+
+	for (size_t i = 0; i < thread_count; ++i) {
+		queues.push_back(make_unique<TaskQueue>());
+	}
+	for (size_t i = 0; i < thread_count; ++i) {
+		threads.emplace_back(&ThreadPool::run_worker, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		auto lock = unique_lock<mutex>(state_mutex);
+		stopping = true;
+	}
+	work_available.notify_all();
+
+	for (auto &worker : threads) {
+		worker.join();
+	}
+}
+
+void ThreadPool::submit(function<void()> task) {
+	// Count the task first, so that a thread that finds it always has
+	// something to subtract from
+	size_t index;
+	{
+		auto lock = unique_lock<mutex>(state_mutex);
+		++queued;
+		++pending;
+		if (current_pool == this) {
+			index = current_index;
+		} else {
+			index = next_queue;
+			next_queue = (next_queue + 1) % queues.size();
+		}
+	}
+
+	{
+		auto &queue = *queues[index];
+		auto lock = unique_lock<mutex>(queue.mutex);
+		queue.tasks.push_back(move(task));
+	}
+	work_available.notify_one();
+}
+
+void ThreadPool::wait() {
+	auto lock = unique_lock<mutex>(state_mutex);
+	all_done.wait(lock, [this]() { return pending == 0; });
+}
+
+size_t ThreadPool::get_thread_count() const { return threads.size(); }
+
+bool ThreadPool::pop_task(size_t index, function<void()> &task) {
+	// Own queue first, newest task first since it is most likely to be warm
+	// in the cache
+	{
+		auto &queue = *queues[index];
+		auto lock = unique_lock<mutex>(queue.mutex);
+		if (!queue.tasks.empty()) {
+			task = move(queue.tasks.back());
+			queue.tasks.pop_back();
+			return true;
+		}
+	}
+
+	// Then steal the oldest task from the other queues
+	for (size_t i = 1; i < queues.size(); ++i) {
+		auto &queue = *queues[(index + i) % queues.size()];
+		auto lock = unique_lock<mutex>(queue.mutex);
+		if (!queue.tasks.empty()) {
+			task = move(queue.tasks.front());
+			queue.tasks.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ThreadPool::run_worker(size_t index) {
+	current_pool = this;
+	current_index = index;
+
+	while (true) {
+		auto task = function<void()>();
+		if (pop_task(index, task)) {
+			{
+				auto lock = unique_lock<mutex>(state_mutex);
+				--queued;
+			}
+
+			task();
+
+			auto lock = unique_lock<mutex>(state_mutex);
+			if (--pending == 0) {
+				all_done.notify_all();
+			}
+			continue;
+		}
+
+		// Nothing to run - sleep until a task is submitted. A task may be
+		// counted but not pushed yet, in which case this just retries.
+		auto lock = unique_lock<mutex>(state_mutex);
+		work_available.wait(lock, [this]() { return stopping || queued > 0; });
+		if (stopping && queued == 0) {
+			return;
+		}
+	}
+}
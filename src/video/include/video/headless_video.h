@@ -0,0 +1,29 @@
+/**
+ * @file headless_video.h
+ * Declares the HeadlessVideo class, which discards all output
+ */
+#pragma once
+
+#include "gpu/utils.h"
+#include "video/video_interface.h"
+
+namespace video {
+
+/**
+ * Video output that draws nothing. Used when running without a window, such as
+ * in benchmarks and automated runs.
+ */
+class HeadlessVideo : public VideoInterface {
+  public:
+	/**
+	 * Drop the frame
+	 */
+	void paint(gpu::VideoBuffer &v_buffer) override;
+
+	/**
+	 * Drop the repeated frame
+	 */
+	void repaint() override;
+};
+
+} // namespace video
@@ -15,6 +15,11 @@
 
 namespace video {
 
+/**
+ * Number of window pixels per GameBoy pixel, in each direction
+ */
+const auto MULT = 3;
+
 class Video : public VideoInterface {
   private:
 	/**
@@ -63,6 +68,19 @@ class Video : public VideoInterface {
 	 * Print the contents of the buffer to the terminal
 	 */
 	void paint(gpu::VideoBuffer &v_buffer);
+
+	/**
+	 * Draw the window again from the texture, without uploading anything
+	 */
+	void repaint();
+
+	/**
+	 * Convert the contents of the buffer into scaled up image pixels
+	 *
+	 * @param v_buffer Buffer to read pixels from
+	 * @param image Image to write to, of the window size
+	 */
+	static void fill_image(const gpu::VideoBuffer &v_buffer, sf::Image *image);
 };
 
 } // namespace video
@@ -12,12 +12,20 @@ namespace video {
 
 class VideoInterface {
   public:
+	virtual ~VideoInterface() = default;
+
 	/**
 	 * This method takes a VideoBuffer array, and outputs it to the display
 	 *
 	 * @param v_buffer Buffer to display
 	 */
 	virtual void paint(gpu::VideoBuffer &v_buffer) = 0;
+
+	/**
+	 * Output the last painted buffer again, for a frame that is the same as
+	 * the one before
+	 */
+	virtual void repaint() = 0;
 };
 
 } // namespace video
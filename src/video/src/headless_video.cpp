@@ -0,0 +1,14 @@
+/**
+ * @file headless_video.cpp
+ * Defines the HeadlessVideo class
+ */
+
+#include "video/headless_video.h"
+
+namespace video {
+
+void HeadlessVideo::paint(gpu::VideoBuffer &) {}
+
+void HeadlessVideo::repaint() {}
+
+} // namespace video
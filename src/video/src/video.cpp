@@ -7,6 +7,7 @@
 #include "gpu/utils.h"
 #include "util/helpers.h"
 #include "util/log.h"
+#include "util/perf.h"
 
 #include <SFML/Graphics.hpp>
 #include <SFML/Window.hpp>
@@ -17,8 +18,6 @@ using namespace gpu;
 using namespace controller;
 using namespace cartridge;
 
-const auto MULT = 3;
-
 namespace video {
 
 Video::Video(ControllerInterface *controller,
@@ -90,9 +89,40 @@ void Video::event_handler() {
 
 void Video::paint(VideoBuffer &v_buffer) {
 	// Handle window events
-	event_handler();
+	{
+		auto perf_scope = PerfScope(PerfSection::INPUT);
+		event_handler();
+	}
+
+	auto perf_scope = PerfScope(PerfSection::VIDEO_PAINT);
 
 	// Create pixel buffer from input
+	fill_image(v_buffer, window_image.get());
+
+	// Draw window
+	window->clear();
+	window_texture->loadFromImage(*(window_image));
+	window_sprite->setTexture(*(window_texture), true);
+	window->draw(*(window_sprite));
+	window->display();
+}
+
+void Video::repaint() {
+	// Handle window events
+	{
+		auto perf_scope = PerfScope(PerfSection::INPUT);
+		event_handler();
+	}
+
+	auto perf_scope = PerfScope(PerfSection::VIDEO_PAINT);
+
+	// The texture still holds the frame
+	window->clear();
+	window->draw(*(window_sprite));
+	window->display();
+}
+
+void Video::fill_image(const VideoBuffer &v_buffer, sf::Image *image) {
 	for (int i = 0; i < PIXEL_COUNT; ++i) {
 		auto pixel = v_buffer[i];
 		sf::Color color;
@@ -114,17 +144,10 @@ void Video::paint(VideoBuffer &v_buffer) {
 			for (int l = 0; l < MULT; l++) {
 				auto a = (i % SCREEN_WIDTH) * MULT + k;
 				auto b = (i / SCREEN_WIDTH) * MULT + l;
-				window_image->setPixel(a, b, color);
+				image->setPixel(a, b, color);
 			}
 		}
 	}
-
-	// Draw window
-	window->clear();
-	window_texture->loadFromImage(*(window_image));
-	window_sprite->setTexture(*(window_texture), true);
-	window->draw(*(window_sprite));
-	window->display();
 }
 
 } // namespace video
@@ -11,7 +11,7 @@ using namespace std;
 
 class CPUArithmeticOpcodeTest : public Test {
   protected:
-	unique_ptr<CPU> cpu;
+	unique_ptr<CPU<MemoryMock>> cpu;
 
 	unique_ptr<MemoryMock> memory;
 
@@ -50,10 +50,10 @@ class CPUArithmeticOpcodeTest : public Test {
 
 		memory = make_unique<MemoryMock>();
 
-		cpu = make_unique<CPU>(move(a), move(b), move(c), move(d), move(e),
-		                       move(f), move(h), move(l), move(af), move(bc),
-		                       move(de), move(hl), move(sp), move(pc),
-		                       memory.get());
+		cpu = make_unique<CPU<MemoryMock>>(
+		    move(a), move(b), move(c), move(d), move(e), move(f), move(h),
+		    move(l), move(af), move(bc), move(de), move(hl), move(sp), move(pc),
+		    memory.get());
 	}
 };
 
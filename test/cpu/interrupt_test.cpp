@@ -0,0 +1,120 @@
+#include "gameboy/gameboy.h"
+#include "utils/rom.h"
+
+#include <gtest/gtest.h>
+
+using namespace testing;
+using namespace cpu;
+using namespace std;
+using namespace test_utils;
+
+/**
+ * Runs small ROMs one instruction at a time, with a VBLANK interrupt
+ * requested and enabled, but IME off
+ */
+class InterruptTest : public Test {
+  protected:
+	unique_ptr<gameboy::Gameboy> gb;
+
+	/**
+	 * Load a ROM that requests the interrupt and then runs the given code,
+	 * and step up to the start of that code
+	 */
+	void load(const vector<uint8_t> &code) {
+		Log::set_level(LogLevel::ERROR);
+
+		// clang-format off
+		auto program = vector<uint8_t>{
+		    0xF3,             // $0150: DI
+		    0x31, 0xFE, 0xFF, //        LD SP, $FFFE
+		    0x3E, 0x01,       //        LD A, $01
+		    0xE0, 0xFF,       //        LDH ($FF), A
+		    0xE0, 0x0F,       //        LDH ($0F), A
+		};
+		// clang-format on
+		program.insert(program.end(), code.begin(), code.end());
+
+		gb = make_unique<gameboy::Gameboy>(
+		    make_unique<cartridge::Cartridge>(make_rom(program)), true);
+		gb->memory->write(0xFF50, 1);
+
+		// JP $0150, and the five setup instructions
+		for (auto i = 0; i < 6; ++i) {
+			gb->cpu->tick();
+		}
+		ASSERT_EQ(pc(), 0x015A);
+	}
+
+	uint16_t pc() { return gb->cpu->get_register_state().pc; }
+};
+
+TEST_F(InterruptTest, EiDelayTest) {
+	load({0xFB, 0x00, 0x00}); // EI, NOP, NOP
+
+	gb->cpu->tick();
+	EXPECT_EQ(pc(), 0x015B);
+	EXPECT_FALSE(gb->cpu->get_register_state().interrupt_enabled);
+
+	// The instruction after EI always runs before the interrupt
+	gb->cpu->tick();
+	EXPECT_EQ(pc(), 0x015C);
+	EXPECT_EQ(gb->cpu->get_register_state().interrupt_enable_delay, 1);
+
+	// Then the interrupt is taken, and the first handler instruction runs
+	gb->cpu->tick();
+	EXPECT_EQ(pc(), 0x0041);
+	EXPECT_EQ(gb->memory->read(0xFFFC), 0x5C);
+	EXPECT_EQ(gb->memory->read(0xFFFD), 0x01);
+	EXPECT_EQ(gb->cpu->get_interrupts()->get_flag(), 0x00);
+	EXPECT_FALSE(gb->cpu->get_register_state().interrupt_enabled);
+}
+
+TEST_F(InterruptTest, DiCancelsEiTest) {
+	load({0xFB, 0xF3, 0x00, 0x00}); // EI, DI, NOP, NOP
+
+	for (auto i = 0; i < 4; ++i) {
+		gb->cpu->tick();
+	}
+	EXPECT_EQ(pc(), 0x015E);
+	EXPECT_EQ(gb->cpu->get_interrupts()->get_flag(), 0x01);
+}
+
+TEST_F(InterruptTest, RetiTest) {
+	// LD HL, $0160; PUSH HL; RETI; then NOPs at $0160
+	load({0x21, 0x60, 0x01, 0xE5, 0xD9, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	      0x00, 0x00, 0x00});
+
+	for (auto i = 0; i < 3; ++i) {
+		gb->cpu->tick();
+	}
+	EXPECT_EQ(pc(), 0x0160);
+
+	// RETI enables interrupts without a delay
+	gb->cpu->tick();
+	EXPECT_EQ(pc(), 0x0041);
+}
+
+TEST_F(InterruptTest, PendingMaskTest) {
+	auto interrupts = InterruptController{};
+	EXPECT_EQ(interrupts.get_pending(), 0x00);
+
+	// Requested interrupts are only pending once enabled
+	interrupts.request(Interrupt::TIMER);
+	EXPECT_EQ(interrupts.get_pending(), 0x00);
+	interrupts.set_enable(0xFF);
+	EXPECT_EQ(interrupts.get_pending(), 0x04);
+
+	interrupts.set_master_enable(false);
+	EXPECT_EQ(interrupts.get_pending(), 0x00);
+
+	// A pending EI shows up until it has counted down
+	interrupts.enable_after_next();
+	EXPECT_EQ(interrupts.get_pending(), InterruptController::DELAYED_ENABLE);
+	EXPECT_TRUE(interrupts.step_delay());
+	EXPECT_FALSE(interrupts.step_delay());
+	EXPECT_EQ(interrupts.get_pending(), 0x04);
+
+	interrupts.acknowledge(2);
+	EXPECT_EQ(interrupts.get_flag(), 0x00);
+	EXPECT_EQ(interrupts.get_pending(), 0x00);
+}
@@ -0,0 +1,313 @@
+#include "gameboy/gameboy.h"
+#include "utils/rom.h"
+
+#include <gtest/gtest.h>
+
+using namespace testing;
+using namespace cpu;
+using namespace std;
+using namespace test_utils;
+
+/**
+ * Differential tests for the JIT. Two Gameboys run the same ROM, one with the
+ * plain interpreter and one with the JIT. After every block the JIT runs, the
+ * interpreter is run for the same number of cycles, and the two are compared.
+ */
+class JitTest : public Test {
+  protected:
+	unique_ptr<gameboy::Gameboy> reference;
+	unique_ptr<gameboy::Gameboy> jit;
+
+	void load(const vector<uint8_t> &rom, bool skip_boot_rom) {
+		Log::set_level(LogLevel::ERROR);
+
+		reference = make_unique<gameboy::Gameboy>(
+		    make_unique<cartridge::Cartridge>(rom), true);
+		jit = make_unique<gameboy::Gameboy>(
+		    make_unique<cartridge::Cartridge>(rom), true);
+		jit->cpu->set_execution_mode(ExecutionMode::JIT);
+
+		if (skip_boot_rom) {
+			reference->memory->write(0xFF50, 1);
+			jit->memory->write(0xFF50, 1);
+		}
+	}
+
+	/**
+	 * Run one block on the JIT, and the same number of cycles on the
+	 * reference. The GPU is ticked once for the whole step on both, so that
+	 * interrupts are raised at the same points.
+	 */
+	void step_block() {
+		auto jit_cycles = jit->cpu->tick();
+		ClockCycles reference_cycles = 0;
+		while (reference_cycles < jit_cycles) {
+			reference_cycles += reference->cpu->tick();
+		}
+		ASSERT_EQ(reference_cycles, jit_cycles);
+
+		jit->gpu->tick(jit_cycles);
+		reference->gpu->tick(reference_cycles);
+	}
+
+	void expect_same_registers() {
+		auto expected = reference->cpu->get_register_state();
+		auto actual = jit->cpu->get_register_state();
+		ASSERT_EQ(expected.pc, actual.pc);
+		ASSERT_EQ(expected.sp, actual.sp);
+		ASSERT_EQ(expected.af, actual.af);
+		ASSERT_EQ(expected.bc, actual.bc);
+		ASSERT_EQ(expected.de, actual.de);
+		ASSERT_EQ(expected.hl, actual.hl);
+		ASSERT_EQ(expected.halted, actual.halted);
+		ASSERT_EQ(expected.interrupt_enabled, actual.interrupt_enabled);
+	}
+
+	void expect_same_memory(Address start, Address end) {
+		for (uint32_t addr = start; addr <= end; ++addr) {
+			ASSERT_EQ(reference->memory->read(addr), jit->memory->read(addr))
+			    << "at address " << addr;
+		}
+	}
+
+	/**
+	 * Run the given number of blocks, checking the registers and the given
+	 * memory range after every block. VRAM and work RAM are compared at the
+	 * end of the run.
+	 */
+	void run_and_compare(int blocks, Address start, Address end) {
+		for (auto i = 0; i < blocks; ++i) {
+			step_block();
+			expect_same_registers();
+			expect_same_memory(start, end);
+			if (HasFatalFailure()) {
+				FAIL() << "Mismatch after block " << i;
+			}
+		}
+
+		expect_same_memory(0x8000, 0x9FFF);
+		expect_same_memory(0xC000, 0xDFFF);
+	}
+};
+
+TEST_F(JitTest, BootRomTest) {
+	if (!Jit::is_supported()) {
+		return;
+	}
+
+	load(make_rom({0x18, 0xFE}), false); // JR -2
+
+	// The first part of the boot ROM clears VRAM and decodes the logo
+	run_and_compare(50000, 0xFF80, 0xFFFE);
+}
+
+TEST_F(JitTest, LoopTest) {
+	if (!Jit::is_supported()) {
+		return;
+	}
+
+	// clang-format off
+	load(make_rom({
+	    0x31, 0xFE, 0xFF, // $0150: LD SP, $FFFE
+	    0x21, 0x00, 0xC0, // $0153: LD HL, $C000
+	    0x06, 0x40,       //        LD B, $40
+	    0x78,             // $0158: LD A, B
+	    0x22,             //        LD (HL+), A
+	    0x81,             //        ADD A, C
+	    0x4F,             //        LD C, A
+	    0xCB, 0x11,       //        RL C
+	    0xC5,             //        PUSH BC
+	    0xD1,             //        POP DE
+	    0x05,             //        DEC B
+	    0x20, 0xF5,       //        JR NZ, $0158
+	    0xCD, 0x70, 0x01, //        CALL $0170
+	    0x18, 0xEB,       //        JR $0153
+	    0x00, 0x00, 0x00, 0x00,
+	    0x00, 0x00, 0x00, 0x00,
+	    0x19,             // $0170: ADD HL, DE
+	    0x2F,             //        CPL
+	    0x3C,             //        INC A
+	    0xC9,             //        RET
+	}), true);
+	// clang-format on
+
+	run_and_compare(20000, 0xC000, 0xC0FF);
+}
+
+TEST_F(JitTest, SelfModifyingCodeTest) {
+	if (!Jit::is_supported()) {
+		return;
+	}
+
+	// Toggle the instruction at $0160 between INC A and DEC A on every pass,
+	// so that the block containing it keeps being invalidated
+	// clang-format off
+	load(make_rom({
+	    0x31, 0xFE, 0xFF, // $0150: LD SP, $FFFE
+	    0xFA, 0x60, 0x01, // $0153: LD A, ($0160)
+	    0xEE, 0x01,       //        XOR $01
+	    0xEA, 0x60, 0x01, //        LD ($0160), A
+	    0x00,             //        NOP
+	    0x00, 0x00, 0x00,
+	    0x00,
+	    0x3C,             // $0160: INC A
+	    0x3C,             //        INC A
+	    0x47,             //        LD B, A
+	    0x04,             //        INC B
+	    0x21, 0x60, 0x01, //        LD HL, $0160
+	    0x34,             //        INC (HL)
+	    0x35,             //        DEC (HL)
+	    0x0C,             //        INC C
+	    0x18, 0xE7,       //        JR $0153
+	}), true);
+	// clang-format on
+
+	run_and_compare(20000, 0xFF80, 0xFFFE);
+	expect_same_memory(0x0150, 0x016F);
+}
+
+TEST_F(JitTest, FlagsTest) {
+	if (!Jit::is_supported()) {
+		return;
+	}
+
+	// Push the result and flags of each ALU operation on every pair of
+	// operands, so that they can be compared after every pass
+	// clang-format off
+	load(make_rom({
+	    0x31, 0xFE, 0xFF, // $0150: LD SP, $FFFE
+	    0x01, 0x00, 0x00, //        LD BC, $0000
+	    0x78,             // $0156: LD A, B
+	    0x81,             //        ADD A, C
+	    0xF5,             //        PUSH AF
+	    0x78,             //        LD A, B
+	    0x89,             //        ADC A, C
+	    0xF5,             //        PUSH AF
+	    0x78,             //        LD A, B
+	    0x91,             //        SUB C
+	    0xF5,             //        PUSH AF
+	    0x78,             //        LD A, B
+	    0x99,             //        SBC A, C
+	    0xF5,             //        PUSH AF
+	    0x78,             //        LD A, B
+	    0xA1,             //        AND C
+	    0xF5,             //        PUSH AF
+	    0x78,             //        LD A, B
+	    0xA9,             //        XOR C
+	    0xF5,             //        PUSH AF
+	    0x78,             //        LD A, B
+	    0xB1,             //        OR C
+	    0xF5,             //        PUSH AF
+	    0x78,             //        LD A, B
+	    0xB9,             //        CP C
+	    0xF5,             //        PUSH AF
+	    0x78,             //        LD A, B
+	    0x3C,             //        INC A
+	    0xF5,             //        PUSH AF
+	    0x78,             //        LD A, B
+	    0x3D,             //        DEC A
+	    0xF5,             //        PUSH AF
+	    0x31, 0xFE, 0xFF, //        LD SP, $FFFE
+	    0x0C,             //        INC C
+	    0x20, 0xDC,       //        JR NZ, $0156
+	    0x04,             //        INC B
+	    0x18, 0xD9,       //        JR $0156
+	}), true);
+	// clang-format on
+
+	run_and_compare(256 * 257, 0xFFE8, 0xFFFD);
+}
+
+TEST_F(JitTest, TranslatedOpcodesTest) {
+	if (!Jit::is_supported()) {
+		return;
+	}
+
+	// Mix the instructions that are translated with some that are not, and
+	// keep the registers changing from pass to pass
+	// clang-format off
+	load(make_rom({
+	    0x31, 0xFE, 0xFF, // $0150: LD SP, $FFFE
+	    0x21, 0x00, 0xC0, //        LD HL, $C000
+	    0x01, 0x34, 0x12, //        LD BC, $1234
+	    0x11, 0x78, 0x56, //        LD DE, $5678
+	    0x78,             // $015C: LD A, B
+	    0x89,             //        ADC A, C
+	    0x47,             //        LD B, A
+	    0x9B,             //        SBC A, E
+	    0x4F,             //        LD C, A
+	    0xAA,             //        XOR D
+	    0xBB,             //        CP E
+	    0x17,             //        RLA
+	    0x22,             //        LD (HL+), A
+	    0xC6, 0x3B,       //        ADD A, $3B
+	    0x96,             //        SUB (HL)
+	    0x1C,             //        INC E
+	    0x15,             //        DEC D
+	    0xE6, 0xF7,       //        AND $F7
+	    0xB5,             //        OR L
+	    0xDE, 0x11,       //        SBC A, $11
+	    0x8E,             //        ADC A, (HL)
+	    0x57,             //        LD D, A
+	    0x3F,             //        CCF
+	    0x3C,             //        INC A
+	    0x0D,             //        DEC C
+	    0xCB, 0x5F,       //        BIT 3, A
+	    0xCB, 0xFB,       //        SET 7, E
+	    0xCB, 0x80,       //        RES 0, B
+	    0x2F,             //        CPL
+	    0x32,             //        LD (HL-), A
+	    0x2A,             //        LD A, (HL+)
+	    0x1A,             //        LD A, (DE)
+	    0x0B,             //        DEC BC
+	    0x13,             //        INC DE
+	    0x33,             //        INC SP
+	    0x3B,             //        DEC SP
+	    0x37,             //        SCF
+	    0x8A,             //        ADC A, D
+	    0x5F,             //        LD E, A
+	    0xEA, 0x00, 0xC1, //        LD ($C100), A
+	    0xFA, 0x01, 0xC1, //        LD A, ($C101)
+	    0xA3,             //        AND E
+	    0x7C,             //        LD A, H
+	    0xFE, 0xC1,       //        CP $C1
+	    0x38, 0xCB,       //        JR C, $015C
+	    0x26, 0xC0,       //        LD H, $C0
+	    0xC3, 0x5C, 0x01, //        JP $015C
+	}), true);
+	// clang-format on
+
+	run_and_compare(20000, 0xC000, 0xC1FF);
+}
+
+TEST_F(JitTest, IndirectIoTest) {
+	// clang-format off
+	auto rom = make_rom({
+	    0x21, 0xC0, 0xFE, // $0150: LD HL, $FEC0
+	    0x04,             // $0153: INC B
+	    0x2A,             //        LD A, (HL+)
+	    0x0C,             // $0155: INC C
+	    0x14,             //        INC D
+	    0x1C,             //        INC E
+	    0x18, 0xF9,       //        JR $0153
+	});
+	// clang-format on
+
+	// Blocks run whole until HL reaches I/O, and then stop after the load,
+	// whether they are compiled or not
+	for (auto mode : {ExecutionMode::BLOCK_CACHE, ExecutionMode::JIT}) {
+		load(rom, true);
+		jit->cpu->set_execution_mode(mode);
+		jit->cpu->tick();
+
+		while (jit->cpu->get_register_state().hl < 0xFF10) {
+			auto io = jit->cpu->get_register_state().hl >= 0xFF00;
+			jit->cpu->tick();
+			ASSERT_EQ(jit->cpu->get_register_state().pc,
+			          io ? 0x0155 : 0x0153);
+			if (io) {
+				jit->cpu->tick();
+			}
+		}
+	}
+}
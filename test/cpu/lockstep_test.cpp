@@ -0,0 +1,104 @@
+#include "cpu/lockstep.h"
+#include "utils/rom.h"
+
+#include <gtest/gtest.h>
+
+using namespace testing;
+using namespace cpu;
+using namespace std;
+using namespace test_utils;
+
+const size_t LANES = 8;
+
+/**
+ * Runs a ROM on a many lane Lockstep core, and on one single lane core per
+ * lane with the vectorized kernels turned off, and compares every lane.
+ */
+class LockstepTest : public Test {
+  protected:
+	unique_ptr<Lockstep> lockstep;
+	vector<unique_ptr<Lockstep>> references;
+
+	void load(const vector<uint8_t> &program) {
+		auto rom = make_shared<vector<uint8_t>>(make_rom(program));
+
+		lockstep = make_unique<Lockstep>(rom, LANES);
+		for (size_t lane = 0; lane < LANES; ++lane) {
+			references.push_back(make_unique<Lockstep>(rom, 1));
+			references[lane]->set_vector_enabled(false);
+
+			// Give each lane different buttons, so that they diverge
+			auto pressed = static_cast<uint8_t>(lane * 0x13);
+			lockstep->set_buttons(lane, pressed);
+			references[lane]->set_buttons(0, pressed);
+		}
+	}
+
+	void expect_same_lanes(Address start, Address end) {
+		for (size_t lane = 0; lane < LANES; ++lane) {
+			auto &reference = *references[lane];
+			ASSERT_EQ(reference.get_register_state(0),
+			          lockstep->get_register_state(lane))
+			    << "lane " << lane;
+			ASSERT_EQ(reference.get_cycles(0), lockstep->get_cycles(lane))
+			    << "lane " << lane;
+			for (uint32_t addr = start; addr <= end; ++addr) {
+				ASSERT_EQ(reference.read(0, addr), lockstep->read(lane, addr))
+				    << "lane " << lane << " address " << addr;
+			}
+		}
+	}
+};
+
+TEST_F(LockstepTest, MatchesScalarTest) {
+	// clang-format off
+	load({
+	    0x31, 0xFE, 0xFF, // $0150: LD SP, $FFFE
+	    0x21, 0x00, 0xC0, //        LD HL, $C000
+	    0x3E, 0x20,       //        LD A, $20
+	    0xE0, 0x00,       //        LDH ($00), A
+	    0xF0, 0x00,       // $015A: LDH A, ($00)
+	    0xE6, 0x0F,       //        AND $0F
+	    0x47,             //        LD B, A
+	    0x0E, 0x10,       //        LD C, $10
+	    0x78,             // $0161: LD A, B
+	    0x81,             //        ADD A, C
+	    0xEE, 0x5A,       //        XOR $5A
+	    0x47,             //        LD B, A
+	    0x22,             //        LD (HL+), A
+	    0x0D,             //        DEC C
+	    0x20, 0xF7,       //        JR NZ, $0161
+	    0xFE, 0x80,       //        CP $80
+	    0x38, 0x02,       //        JR C, $0170
+	    0x14,             //        INC D
+	    0x13,             //        INC DE
+	    0x1C,             // $0170: INC E
+	    0x7C,             //        LD A, H
+	    0xFE, 0xC4,       //        CP $C4
+	    0x20, 0xE4,       //        JR NZ, $015A
+	    0x21, 0x00, 0xC0, //        LD HL, $C000
+	    0xC5,             //        PUSH BC
+	    0xD1,             //        POP DE
+	    0x18, 0xDD,       //        JR $015A
+	});
+	// clang-format on
+
+	for (auto i = 0; i < 20; ++i) {
+		for (auto j = 0; j < 500; ++j) {
+			lockstep->step();
+			for (auto &reference : references) {
+				reference->step();
+			}
+		}
+		expect_same_lanes(0xC000, 0xC3FF);
+		if (HasFatalFailure()) {
+			FAIL() << "Mismatch after " << (i + 1) * 500 << " steps";
+		}
+	}
+
+	// Most instructions are shared, but the lanes must have diverged
+	auto &stats = lockstep->get_stats();
+	EXPECT_GT(stats.vector_instructions, stats.scalar_instructions);
+	EXPECT_GT(stats.groups, stats.steps);
+	expect_same_lanes(0xFF80, 0xFFFE);
+}
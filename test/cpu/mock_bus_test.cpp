@@ -0,0 +1,58 @@
+#include "cpu/cpu.h"
+#include "cpu/register/register.h"
+#include "memory/mocks/memory_mock.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace testing;
+using namespace cpu;
+using namespace std;
+
+/**
+ * Runs the CPU over mocked memory, using the instantiation in
+ * memory/mocks/memory_mock.cpp
+ */
+class MockBusTest : public Test {
+  protected:
+	StrictMock<MemoryMock> memory;
+	unique_ptr<CPU<MemoryMock>> cpu;
+
+	void SetUp() override {
+		auto a = make_unique<Register>();
+		auto b = make_unique<Register>();
+		auto c = make_unique<Register>();
+		auto d = make_unique<Register>();
+		auto e = make_unique<Register>();
+		auto f = make_unique<Register>();
+		auto h = make_unique<Register>();
+		auto l = make_unique<Register>();
+		auto af = make_unique<PairRegister>(a.get(), f.get());
+		auto bc = make_unique<PairRegister>(b.get(), c.get());
+		auto de = make_unique<PairRegister>(d.get(), e.get());
+		auto hl = make_unique<PairRegister>(h.get(), l.get());
+
+		cpu = make_unique<CPU<MemoryMock>>(
+		    move(a), move(b), move(c), move(d), move(e), move(f), move(h),
+		    move(l), move(af), move(bc), move(de), move(hl),
+		    make_unique<DoubleRegister>(), make_unique<DoubleRegister>(),
+		    &memory);
+	}
+};
+
+TEST_F(MockBusTest, LoadStoreTest) {
+	// LD A, $42 then LD ($C000), A
+	EXPECT_CALL(memory, read(0x0000)).WillOnce(Return(0x3E));
+	EXPECT_CALL(memory, read(0x0001)).WillOnce(Return(0x42));
+	EXPECT_CALL(memory, read(0x0002)).WillOnce(Return(0xEA));
+	EXPECT_CALL(memory, read(0x0003)).WillOnce(Return(0x00));
+	EXPECT_CALL(memory, read(0x0004)).WillOnce(Return(0xC0));
+	EXPECT_CALL(memory, write(0xC000, 0x42));
+
+	EXPECT_EQ(cpu->tick(), cpu->get_opcode_cycles(0x3E, false));
+	EXPECT_EQ(cpu->tick(), cpu->get_opcode_cycles(0xEA, false));
+
+	auto state = cpu->get_register_state();
+	EXPECT_EQ(state.af >> 8, 0x42);
+	EXPECT_EQ(state.pc, 0x0005);
+}
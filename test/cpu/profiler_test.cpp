@@ -0,0 +1,67 @@
+#include "cpu/profiler.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+using namespace testing;
+using namespace cpu;
+using namespace std;
+
+class ProfilerTest : public Test {
+  protected:
+	unique_ptr<Profiler> profiler;
+
+	ProfilerTest() {
+		profiler = make_unique<Profiler>();
+
+		// DEC B ; JR NZ, r8 - looping three times
+		for (auto i = 0; i < 3; ++i) {
+			profiler->record(0x0150, 0x05, false, 1, false, false);
+			profiler->record(0x0151, 0x20, false, i < 2 ? 3 : 2, true, i < 2);
+		}
+
+		// RL C
+		profiler->record(0x0153, 0x11, true, 2, false, false);
+	}
+};
+
+TEST_F(ProfilerTest, CsvTest) {
+	auto out = stringstream();
+	profiler->dump_csv(out);
+	auto csv = out.str();
+
+	EXPECT_THAT(csv, StartsWith("kind,key,mnemonic,count,cycles"));
+	EXPECT_THAT(csv, HasSubstr("opcode,0x05,\"DEC B\",3,3,,\n"));
+	EXPECT_THAT(csv, HasSubstr("opcode,0x20,\"JR NZ, r8\",3,8,,\n"));
+	EXPECT_THAT(csv, HasSubstr("cb_opcode,0x11,\"RL C\",1,2,,\n"));
+	EXPECT_THAT(csv, HasSubstr("branch,0x20,\"JR NZ, r8\",3,,2,1\n"));
+	EXPECT_THAT(csv, HasSubstr("pc,0x0151,\"JR NZ, r8\",3,8,,\n"));
+	EXPECT_THAT(csv, HasSubstr("pc,0x0153,\"RL C\",1,2,,\n"));
+
+	// RL C is the least executed, so it is the last hotspot
+	EXPECT_THAT(csv, EndsWith("pc,0x0153,\"RL C\",1,2,,\n"));
+}
+
+TEST_F(ProfilerTest, JsonTest) {
+	auto out = stringstream();
+	profiler->dump_json(out);
+	auto json = out.str();
+
+	EXPECT_THAT(json, HasSubstr("\"instructions\": 7"));
+	EXPECT_THAT(json, HasSubstr("\"cycles\": 13"));
+	EXPECT_THAT(json, HasSubstr("{\"opcode\": \"0x20\", \"mnemonic\": "
+	                            "\"JR NZ, r8\", \"taken\": 2, "
+	                            "\"not_taken\": 1"));
+	EXPECT_THAT(json, HasSubstr("{\"pc\": \"0x0150\", \"mnemonic\": "
+	                            "\"DEC B\", \"count\": 3, \"cycles\": 3}"));
+}
+
+TEST_F(ProfilerTest, ResetTest) {
+	profiler->reset();
+
+	auto out = stringstream();
+	profiler->dump_csv(out);
+	EXPECT_EQ(out.str(), "kind,key,mnemonic,count,cycles,taken,not_taken\n");
+}
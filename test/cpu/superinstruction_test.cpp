@@ -0,0 +1,142 @@
+#include "gameboy/gameboy.h"
+#include "utils/rom.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+using namespace testing;
+using namespace cpu;
+using namespace std;
+using namespace test_utils;
+
+/**
+ * Runs the same ROM with and without superinstructions, and checks that the
+ * two stay in step at every frame boundary
+ */
+class SuperinstructionTest : public Test {
+  protected:
+	unique_ptr<gameboy::Gameboy> plain;
+	unique_ptr<gameboy::Gameboy> fused;
+
+	/**
+	 * Copies memory, waits on LY and runs counted loops, with the VBLANK
+	 * interrupt counting frames in E
+	 */
+	static vector<uint8_t> make_loop_rom() {
+		// clang-format off
+		auto rom = make_rom({
+		    0x31, 0xFE, 0xFF, // $0150: LD SP, $FFFE
+		    0x3E, 0x01,       //        LD A, $01
+		    0xEA, 0xFF, 0xFF, //        LD ($FFFF), A
+		    0xFB,             //        EI
+		    0x21, 0x00, 0xC0, // $0159: LD HL, $C000
+		    0x11, 0x00, 0xC1, //        LD DE, $C100
+		    0x06, 0x20,       //        LD B, $20
+		    0x2A,             // $0161: LD A, (HL+)
+		    0x12,             //        LD (DE), A
+		    0x13,             //        INC DE
+		    0x05,             //        DEC B
+		    0x20, 0xFA,       //        JR NZ, $0161
+		    0x0E, 0x10,       //        LD C, $10
+		    0x0D,             // $0169: DEC C
+		    0x20, 0xFD,       //        JR NZ, $0169
+		    0xF0, 0x44,       // $016C: LDH A, ($44)
+		    0xFE, 0x90,       //        CP $90
+		    0x20, 0xFA,       //        JR NZ, $016C
+		    0x7B,             //        LD A, E
+		    0xFE, 0x05,       //        CP $05
+		    0x28, 0x02,       //        JR Z, $0179
+		    0x18, 0xE0,       //        JR $0159
+		    0x01, 0x30, 0x00, // $0179: LD BC, $0030
+		    0x0B,             // $017C: DEC BC
+		    0x78,             //        LD A, B
+		    0xB1,             //        OR C
+		    0x20, 0xFB,       //        JR NZ, $017C
+		    0xA7,             //        AND A
+		    0x28, 0xD5,       //        JR Z, $0159
+		});
+
+		// VBLANK handler: INC E ; RETI
+		rom[0x0040] = 0x1C;
+		rom[0x0041] = 0xD9;
+		// clang-format on
+
+		return rom;
+	}
+
+	void load(const vector<uint8_t> &rom) {
+		Log::set_level(LogLevel::ERROR);
+
+		plain = make_unique<gameboy::Gameboy>(
+		    make_unique<cartridge::Cartridge>(rom), true);
+		fused = make_unique<gameboy::Gameboy>(
+		    make_unique<cartridge::Cartridge>(rom), true);
+		plain->cpu->set_superinstructions_enabled(false);
+
+		plain->memory->write(0xFF50, 1);
+		fused->memory->write(0xFF50, 1);
+	}
+
+	/**
+	 * Run until the next frame is drawn
+	 *
+	 * @return Number of ticks taken
+	 */
+	static uint64_t run_frame(gameboy::Gameboy *gb) {
+		auto target = gb->gpu->get_frame_count() + 1;
+		uint64_t ticks = 0;
+		while (gb->gpu->get_frame_count() < target) {
+			gb->tick();
+			++ticks;
+		}
+		return ticks;
+	}
+};
+
+TEST_F(SuperinstructionTest, MatchesInterpreterTest) {
+	load(make_loop_rom());
+
+	uint64_t plain_ticks = 0, fused_ticks = 0;
+	for (auto frame = 0; frame < 30; ++frame) {
+		plain_ticks += run_frame(plain.get());
+		fused_ticks += run_frame(fused.get());
+
+		ASSERT_EQ(plain->cpu->get_register_state(),
+		          fused->cpu->get_register_state())
+		    << "Registers differ after frame " << frame;
+
+		for (uint32_t addr = 0xC000; addr < 0xC200; ++addr) {
+			ASSERT_EQ(plain->memory->read(addr), fused->memory->read(addr))
+			    << "Memory differs at " << addr << " after frame " << frame;
+		}
+	}
+
+	// The VBLANK handler must have run on every frame
+	EXPECT_GE(fused->cpu->get_register_state().de & 0xFF, 29);
+
+	// Fused sequences take a single tick
+	EXPECT_LT(fused_ticks, plain_ticks);
+}
+
+TEST_F(SuperinstructionTest, OpcodeProfileTest) {
+	load(make_loop_rom());
+	fused->cpu->set_opcode_profiling(true);
+	run_frame(fused.get());
+
+	auto profile = stringstream();
+	fused->cpu->dump_opcode_profile(profile, 4);
+
+	auto lines = vector<string>();
+	for (auto line = string(); getline(profile, line);) {
+		lines.push_back(line);
+	}
+	ASSERT_EQ(lines.size(), 4);
+
+	// The LY wait loop is by far the hottest code
+	auto wait_loop = vector<string>(lines.begin(), lines.begin() + 3);
+	EXPECT_THAT(wait_loop, Contains(HasSubstr("0xf0 0xfe")));
+	EXPECT_THAT(wait_loop, Contains(HasSubstr("0xfe 0x20")));
+	EXPECT_THAT(wait_loop, Contains(HasSubstr("0x20 0xf0")));
+}
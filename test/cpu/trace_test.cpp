@@ -0,0 +1,155 @@
+#include "cpu/trace.h"
+#include "gameboy/gameboy.h"
+#include "utils/rom.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+using namespace testing;
+using namespace gameboy;
+using namespace cpu;
+using namespace std;
+using namespace test_utils;
+
+class TraceTest : public Test {
+  protected:
+	string path_a, path_b;
+
+	void SetUp() override {
+		Log::set_level(LogLevel::ERROR);
+		path_a = TempDir() + "tvp_trace_test_a.bin";
+		path_b = TempDir() + "tvp_trace_test_b.bin";
+	}
+
+	void TearDown() override {
+		remove(path_a.c_str());
+		remove(path_b.c_str());
+	}
+
+	/**
+	 * Trace a small ROM for the given number of ticks
+	 */
+	void trace_rom(const string &path, ExecutionMode mode, uint64_t capacity,
+	               int ticks) {
+		// clang-format off
+		auto gb = make_unique<Gameboy>(make_unique<Cartridge>(make_rom({
+		    0x21, 0x00, 0xC0, // $0150: LD HL, $C000
+		    0x06, 0x10,       //        LD B, $10
+		    0x3C,             // $0155: INC A
+		    0x22,             //        LD (HL+), A
+		    0xCB, 0x11,       //        RL C
+		    0x05,             //        DEC B
+		    0x20, 0xF9,       //        JR NZ, $0155
+		    0x18, 0xF2,       //        JR $0150
+		})), true);
+		// clang-format on
+		gb->cpu->set_execution_mode(mode);
+
+		ASSERT_TRUE(gb->cpu->start_trace(path, capacity));
+		for (auto i = 0; i < ticks; ++i) {
+			gb->tick();
+		}
+		gb->cpu->stop_trace();
+	}
+};
+
+TEST_F(TraceTest, ModesMatchTest) {
+	trace_rom(path_a, ExecutionMode::INTERPRETER, 1000000, 20000);
+	trace_rom(path_b, ExecutionMode::BLOCK_CACHE, 1000000, 20000);
+
+	auto a = Trace{};
+	auto b = Trace{};
+	ASSERT_TRUE(read_trace(path_a, &a));
+	ASSERT_TRUE(read_trace(path_b, &b));
+	EXPECT_EQ(a.first, 0);
+	EXPECT_EQ(b.first, 0);
+
+	// A tick runs a whole block in block mode, so that trace runs further, but
+	// the instructions both ran are the same
+	EXPECT_EQ(a.records.size(), 20000);
+	EXPECT_GT(b.records.size(), a.records.size());
+	EXPECT_EQ(find_divergence(a, b), a.records.size());
+}
+
+TEST_F(TraceTest, RingTest) {
+	trace_rom(path_a, ExecutionMode::INTERPRETER, 100, 10000);
+
+	auto trace = Trace{};
+	ASSERT_TRUE(read_trace(path_a, &trace));
+
+	// Only the newest records are kept, oldest first
+	EXPECT_EQ(trace.first, 9900);
+	ASSERT_EQ(trace.records.size(), 100);
+	for (size_t i = 1; i < trace.records.size(); ++i) {
+		EXPECT_GT(trace.records[i].cycles, trace.records[i - 1].cycles);
+	}
+}
+
+TEST_F(TraceTest, ReadWhileTracingTest) {
+	auto writer = TraceWriter(path_a, 100000);
+	ASSERT_TRUE(writer.is_open());
+
+	// Fill one chunk, and start another that stays in memory
+	auto record = TraceRecord{};
+	for (auto i = 0; i < 5000; ++i) {
+		record.pc = static_cast<uint16_t>(i);
+		writer.record(record, 4);
+	}
+
+	// The writer thread updates the header after the chunk, without being
+	// closed
+	auto trace = Trace{};
+	for (auto i = 0; i < 500 && trace.records.empty(); ++i) {
+		this_thread::sleep_for(chrono::milliseconds(10));
+		ASSERT_TRUE(read_trace(path_a, &trace));
+	}
+
+	EXPECT_EQ(trace.first, 0);
+	ASSERT_EQ(trace.records.size(), 4096);
+	EXPECT_EQ(trace.records[4095].pc, 4095);
+	EXPECT_EQ(trace.records[4095].cycles, 4095 * 4);
+}
+
+TEST_F(TraceTest, DivergenceTest) {
+	trace_rom(path_a, ExecutionMode::INTERPRETER, 1000, 500);
+
+	auto a = Trace{};
+	ASSERT_TRUE(read_trace(path_a, &a));
+	auto b = a;
+	EXPECT_EQ(find_divergence(a, b), nullopt);
+
+	b.records[100].bc ^= 1;
+	EXPECT_EQ(find_divergence(a, b), 100);
+
+	// A trace that stops early differs where it ends
+	b = a;
+	b.records.resize(200);
+	EXPECT_EQ(find_divergence(a, b), 200);
+}
+
+TEST_F(TraceTest, FormatTest) {
+	auto record = TraceRecord{};
+	record.pc = 0x0157;
+	record.bc = 0x1234;
+	record.opcode = 0x11;
+	record.prefixed = true;
+	record.cycles = 42;
+
+	EXPECT_EQ(format_trace_record(record),
+	          "0x0157  RL C  af=0x0000 bc=0x1234 de=0x0000 hl=0x0000 "
+	          "sp=0x0000 cycles=42");
+}
+
+TEST_F(TraceTest, BadFileTest) {
+	auto trace = Trace{};
+	EXPECT_FALSE(read_trace(path_a, &trace));
+
+	auto file = fopen(path_a.c_str(), "w");
+	fputs("not a trace", file);
+	fclose(file);
+	EXPECT_FALSE(read_trace(path_a, &trace));
+}
@@ -0,0 +1,131 @@
+#include "debugger/debugger.h"
+#include "utils/rom.h"
+
+#include <gtest/gtest.h>
+
+using namespace testing;
+using namespace debugger;
+using namespace std;
+using namespace test_utils;
+
+class DebuggerTest : public Test {
+  protected:
+	unique_ptr<Debugger> debugger;
+
+	void SetUp() override {
+		Log::set_level(LogLevel::ERROR);
+
+		// clang-format off
+		auto gb = make_unique<gameboy::Gameboy>(make_unique<Cartridge>(
+		    make_rom({
+		        0x21, 0x00, 0xC0, // $0150: LD HL, $C000
+		        0x3C,             // $0153: INC A
+		        0x22,             // $0154: LD (HL+), A
+		        0x46,             // $0155: LD B, (HL)
+		        0x3D,             // $0156: DEC A
+		        0x3C,             // $0157: INC A
+		        0x18, 0xF9,       // $0158: JR $0153
+		    })), true);
+		// clang-format on
+
+		// Skip the boot ROM
+		gb->memory->write(0xFF50, 0x1);
+		auto state = gb->cpu->get_register_state();
+		state.af = 0x0000;
+		state.pc = 0x0150;
+		gb->cpu->set_register_state(state);
+
+		debugger = make_unique<Debugger>(move(gb));
+	}
+
+	RegisterState get_registers() {
+		return debugger->get_gameboy()->cpu->get_register_state();
+	}
+};
+
+TEST_F(DebuggerTest, BreakpointTest) {
+	ASSERT_TRUE(debugger->add_breakpoint(0x0155));
+
+	EXPECT_EQ(debugger->run(100), StopReason::BREAKPOINT);
+	EXPECT_EQ(debugger->get_stop().pc, 0x0155);
+	EXPECT_EQ(get_registers().pc, 0x0155);
+	EXPECT_EQ(get_registers().af >> 8, 1);
+
+	// Resuming runs the instruction at the breakpoint, and stops on the next
+	// pass around the loop
+	EXPECT_EQ(debugger->run(100), StopReason::BREAKPOINT);
+	EXPECT_EQ(get_registers().af >> 8, 2);
+
+	EXPECT_TRUE(debugger->remove_breakpoint(0x0155));
+	EXPECT_FALSE(debugger->remove_breakpoint(0x0155));
+	EXPECT_EQ(debugger->run(100), StopReason::NONE);
+}
+
+TEST_F(DebuggerTest, FullPageTest) {
+	// A breakpoint on every address of the page
+	for (uint16_t address = 0x0100; address < 0x0200; ++address) {
+		ASSERT_TRUE(debugger->add_breakpoint(address));
+	}
+	EXPECT_EQ(debugger->step(), StopReason::BREAKPOINT);
+	EXPECT_EQ(debugger->get_stop().pc, 0x0150);
+}
+
+TEST_F(DebuggerTest, ConditionTest) {
+	ASSERT_TRUE(debugger->add_breakpoint(0x0155, "A == $05"));
+	EXPECT_EQ(debugger->run(100), StopReason::BREAKPOINT);
+	EXPECT_EQ(get_registers().af >> 8, 5);
+	EXPECT_EQ(get_registers().hl, 0xC005);
+
+	ASSERT_TRUE(debugger->add_breakpoint(0x0155, "[$C007] != 0"));
+	EXPECT_EQ(debugger->run(100), StopReason::BREAKPOINT);
+	EXPECT_EQ(get_registers().hl, 0xC008);
+
+	EXPECT_FALSE(debugger->add_breakpoint(0x0155, "A =="));
+	EXPECT_FALSE(debugger->add_breakpoint(0x0155, "Q == 1"));
+	EXPECT_FALSE(debugger->add_breakpoint(0x0155, "A ~ 1"));
+	EXPECT_FALSE(debugger->add_breakpoint(0x0155, "HL == $10000"));
+}
+
+TEST_F(DebuggerTest, WatchpointTest) {
+	ASSERT_TRUE(
+	    debugger->add_watchpoint(0xC003, 0xC003, WATCH_WRITE, "value > 2"));
+
+	EXPECT_EQ(debugger->run(100), StopReason::WATCHPOINT);
+	auto &stop = debugger->get_stop();
+	EXPECT_TRUE(stop.write);
+	EXPECT_EQ(stop.address, 0xC003);
+	EXPECT_EQ(stop.value, 4);
+
+	// Stops after the instruction that wrote
+	EXPECT_EQ(stop.pc, 0x0155);
+	EXPECT_EQ(get_registers().hl, 0xC004);
+
+	EXPECT_TRUE(debugger->remove_watchpoint(0xC003));
+	EXPECT_FALSE(debugger->remove_watchpoint(0xC003));
+
+	// LD B, (HL) reads the byte after each one written
+	ASSERT_TRUE(debugger->add_watchpoint(0xC010, 0xC01F, WATCH_READ));
+	EXPECT_EQ(debugger->run(1000), StopReason::WATCHPOINT);
+	EXPECT_FALSE(debugger->get_stop().write);
+	EXPECT_EQ(debugger->get_stop().address, 0xC010);
+}
+
+TEST_F(DebuggerTest, StepTest) {
+	EXPECT_EQ(debugger->step(), StopReason::STEP);
+	EXPECT_EQ(debugger->get_stop().pc, 0x0153);
+	EXPECT_EQ(debugger->step(), StopReason::STEP);
+	EXPECT_EQ(debugger->get_stop().pc, 0x0154);
+}
+
+TEST_F(DebuggerTest, InterruptVectorTest) {
+	auto memory = debugger->get_gameboy()->memory.get();
+	memory->write(0xFFFF, 0x01);
+	memory->write(0xFF40, 0x91);
+
+	// Stops on the VBLANK vector before the handler runs
+	ASSERT_TRUE(debugger->add_breakpoint(0x0040));
+	EXPECT_EQ(debugger->run(100000), StopReason::BREAKPOINT);
+	EXPECT_EQ(debugger->get_stop().pc, 0x0040);
+	EXPECT_EQ(get_registers().pc, 0x0040);
+	EXPECT_FALSE(get_registers().interrupt_enabled);
+}
@@ -0,0 +1,31 @@
+#include "debugger/disassembly_loader.h"
+#include "utils/rom.h"
+
+#include <gtest/gtest.h>
+
+using namespace testing;
+using namespace debugger;
+using namespace std;
+using namespace test_utils;
+
+TEST(DisassemblyLoaderTest, FindTest) {
+	auto rom = make_rom({0x21, 0x00, 0xC0, 0x18, 0xFB});
+	rom.resize(0xC000, 0x00);
+	rom[0x8000] = 0xC9; // RET, in bank 2
+
+	auto loader = DisassemblyLoader();
+	loader.disassemble(rom);
+	EXPECT_EQ(loader.get_banks().size(), 3);
+
+	auto inst = loader.find(1, 0x0153);
+	ASSERT_NE(inst, nullptr);
+	EXPECT_STREQ(inst->text, "JR $0150");
+
+	// In the middle of LD HL, d16
+	EXPECT_EQ(loader.find(1, 0x0151), nullptr);
+
+	EXPECT_STREQ(loader.find(1, 0x4000)->text, "NOP");
+	EXPECT_STREQ(loader.find(2, 0x4000)->text, "RET");
+	EXPECT_EQ(loader.find(3, 0x4000), nullptr);
+	EXPECT_EQ(loader.find(1, 0xC000), nullptr);
+}
@@ -0,0 +1,61 @@
+#include "gameboy/batch.h"
+#include "utils/rom.h"
+
+#include <gtest/gtest.h>
+
+#include <mutex>
+
+using namespace testing;
+using namespace gameboy;
+using namespace std;
+using namespace test_utils;
+
+TEST(BatchTest, RunTest) {
+	Log::set_level(LogLevel::ERROR);
+
+	// clang-format off
+	auto rom = make_shared<vector<uint8_t>>(make_rom({
+	    0x21, 0x00, 0xC0, // $0150: LD HL, $C000
+	    0x3C,             // $0153: INC A
+	    0x22,             //        LD (HL+), A
+	    0x18, 0xFC,       //        JR $0153
+	}));
+	// clang-format on
+
+	auto mutex = std::mutex();
+	auto states = vector<RegisterState>(16);
+	auto finished = vector<bool>(16, false);
+
+	auto batch = Batch(rom);
+	auto result = batch.run(16, 5, 4, [&](uint64_t index, Gameboy &gb) {
+		auto lock = unique_lock<std::mutex>(mutex);
+		states[index] = gb.cpu->get_register_state();
+		finished[index] = gb.gpu->get_frame_count() == 5;
+	});
+
+	EXPECT_EQ(result.instances, 16u);
+	EXPECT_EQ(result.frames, 16u * 5);
+	EXPECT_EQ(result.threads, 4u);
+
+	// Every instance runs the same ROM from power on, so all of them end in
+	// the same state
+	for (auto i = 0; i < 16; ++i) {
+		EXPECT_TRUE(finished[i]) << "instance " << i;
+		EXPECT_EQ(states[i], states[0]) << "instance " << i;
+	}
+}
+
+TEST(BatchTest, SharedRomTest) {
+	auto rom = make_shared<vector<uint8_t>>(make_rom({0x18, 0xFE}));
+
+	auto first = Cartridge(rom);
+	auto second = Cartridge(rom);
+	EXPECT_EQ(rom.use_count(), 3);
+
+	// A write only changes the cartridge that was written to
+	first.write(0x0150, 0x00);
+	EXPECT_EQ(first.read(0x0150), 0x00);
+	EXPECT_EQ(second.read(0x0150), 0x18);
+	EXPECT_EQ((*rom)[0x0150], 0x18);
+	EXPECT_EQ(rom.use_count(), 2);
+}
@@ -0,0 +1,107 @@
+#include "gameboy/gameboy.h"
+#include "utils/rom.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+
+using namespace testing;
+using namespace gameboy;
+using namespace std;
+using namespace test_utils;
+
+class CloneTest : public Test {
+  protected:
+	unique_ptr<Gameboy> parent;
+
+	void SetUp() override {
+		Log::set_level(LogLevel::ERROR);
+
+		// clang-format off
+		parent = make_unique<Gameboy>(make_unique<Cartridge>(make_rom({
+		    0x21, 0x00, 0xC0, // $0150: LD HL, $C000
+		    0x3C,             // $0153: INC A
+		    0x22,             //        LD (HL+), A
+		    0x18, 0xFC,       //        JR $0153
+		})), true);
+		// clang-format on
+	}
+
+	void run_frames(Gameboy &gb, uint64_t frames) {
+		auto target = gb.gpu->get_frame_count() + frames;
+		while (gb.gpu->get_frame_count() < target) {
+			gb.tick();
+		}
+	}
+};
+
+TEST_F(CloneTest, SameRunTest) {
+	run_frames(*parent, 2);
+	auto child = parent->clone();
+
+	run_frames(*parent, 3);
+	run_frames(*child, 3);
+
+	EXPECT_EQ(parent->cpu->get_register_state(),
+	          child->cpu->get_register_state());
+	EXPECT_EQ(parent->gpu->get_frame_count(), child->gpu->get_frame_count());
+	EXPECT_EQ(parent->gpu->get_video_buffer(), child->gpu->get_video_buffer());
+
+	auto parent_memory = parent->memory->get_state();
+	auto child_memory = child->memory->get_state();
+	for (uint32_t addr = 0; addr <= 0xFFFF; ++addr) {
+		ASSERT_EQ(parent_memory.get_byte(addr), child_memory.get_byte(addr))
+		    << "address " << addr;
+	}
+}
+
+TEST_F(CloneTest, CopyOnWriteTest) {
+	run_frames(*parent, 1);
+	auto child = parent->clone();
+
+	// Untouched pages are shared until either side writes to them
+	EXPECT_EQ(parent->memory->get_state().pages[0xC0],
+	          child->memory->get_state().pages[0xC0]);
+
+	auto before = parent->memory->read(0xC010);
+	child->memory->write(0xC010, before + 1);
+	EXPECT_EQ(parent->memory->read(0xC010), before);
+	EXPECT_EQ(child->memory->read(0xC010), before + 1);
+	EXPECT_NE(parent->memory->get_state().pages[0xC0],
+	          child->memory->get_state().pages[0xC0]);
+	EXPECT_EQ(parent->memory->get_state().pages[0xD0],
+	          child->memory->get_state().pages[0xD0]);
+}
+
+TEST_F(CloneTest, CostTest) {
+	run_frames(*parent, 1);
+	parent->cpu->set_execution_mode(ExecutionMode::BLOCK_CACHE);
+	run_frames(*parent, 1);
+
+	// Take the fastest of a few runs, to leave out the odd page fault or
+	// context switch
+	auto fastest = [](auto function) {
+		auto best = chrono::nanoseconds::max();
+		for (auto i = 0; i < 20; ++i) {
+			auto start = chrono::steady_clock::now();
+			function();
+			best = min(best, chrono::duration_cast<chrono::nanoseconds>(
+			                     chrono::steady_clock::now() - start));
+		}
+		return best;
+	};
+
+	auto child = parent->clone();
+	auto snapshot = make_unique<GameboyState>();
+	auto fork = fastest([&] {
+		parent->save_state(snapshot.get());
+		child->load_state(*snapshot);
+	});
+	auto clone = fastest([&] { child = parent->clone(); });
+
+	// Building a new instance only costs a few times more than forking into
+	// an existing one. Allocating a table for every ROM address made it
+	// more than a hundred times slower.
+	EXPECT_LT(clone.count(), fork.count() * 25);
+}
@@ -0,0 +1,144 @@
+#include "gameboy/environment.h"
+#include "gameboy/tvp_env.h"
+#include "utils/rom.h"
+
+#include <gtest/gtest.h>
+
+using namespace testing;
+using namespace gameboy;
+using namespace std;
+using namespace test_utils;
+
+/**
+ * Frames until the boot ROM has handed over to the cartridge
+ */
+const uint64_t BOOT_FRAMES = 100;
+
+/**
+ * ROM that keeps copying the joypad buttons to $C000, and counting loops at
+ * $C001
+ */
+// clang-format off
+const vector<uint8_t> JOYPAD_PROGRAM = {
+    0x3E, 0x10,       // $0150: LD A, $10
+    0xE0, 0x00,       //        LDH ($00), A
+    0xF0, 0x00,       // $0154: LDH A, ($00)
+    0xEA, 0x00, 0xC0, //        LD ($C000), A
+    0x21, 0x01, 0xC0, //        LD HL, $C001
+    0x34,             //        INC (HL)
+    0x18, 0xF5,       //        JR $0154
+};
+// clang-format on
+
+/**
+ * Get the state after the boot ROM, which is only run once for all tests
+ */
+const GameboyState &get_boot_state() {
+	static auto state = []() {
+		auto env = gameboy::Environment(
+		    make_shared<vector<uint8_t>>(make_rom(JOYPAD_PROGRAM)), {},
+		    BOOT_FRAMES);
+		auto boot_state = make_unique<GameboyState>();
+		env.save_state(boot_state.get());
+		return boot_state;
+	}();
+	return *state;
+}
+
+class EnvironmentTest : public Test {
+  protected:
+	unique_ptr<gameboy::Environment> env;
+
+	void SetUp() override {
+		Log::set_level(LogLevel::ERROR);
+		env = make_unique<gameboy::Environment>(
+		    make_shared<vector<uint8_t>>(make_rom(JOYPAD_PROGRAM)),
+		    vector<Address>{0xC000, 0xC001});
+		env->set_reset_state(get_boot_state());
+		env->reset();
+	}
+};
+
+TEST_F(EnvironmentTest, StepTest) {
+	auto &obs = env->observe();
+	EXPECT_EQ(obs.frame, BOOT_FRAMES);
+	EXPECT_EQ(obs.ram_size, 2u);
+
+	// Buttons are active low, A is bit 0 of the button nibble
+	env->step(0x00);
+	EXPECT_EQ(obs.ram[0], 0x1F);
+	env->step(1 << static_cast<int>(Button::A));
+	EXPECT_EQ(obs.ram[0], 0x1E);
+	env->step(1 << static_cast<int>(Button::START), 3);
+	EXPECT_EQ(obs.ram[0], 0x17);
+	EXPECT_EQ(obs.frame, BOOT_FRAMES + 5);
+}
+
+TEST_F(EnvironmentTest, ResetTest) {
+	auto &obs = env->observe();
+	auto run = [&]() {
+		auto values = vector<uint8_t>();
+		for (auto i = 0; i < 10; ++i) {
+			env->step(static_cast<uint8_t>(i * 0x11), 2);
+			values.push_back(obs.ram[0]);
+			values.push_back(obs.ram[1]);
+		}
+		return make_pair(values, *obs.screen);
+	};
+
+	auto first = run();
+	env->reset();
+	EXPECT_EQ(obs.frame, BOOT_FRAMES);
+
+	// The same buttons after a reset give the same run
+	auto second = run();
+	EXPECT_EQ(first.first, second.first);
+	EXPECT_EQ(first.second, second.second);
+}
+
+TEST_F(EnvironmentTest, SaveStateTest) {
+	env->step(0x10, 3);
+	auto state = make_unique<GameboyState>();
+	env->save_state(state.get());
+	auto saved = vector<uint8_t>(env->observe().ram, env->observe().ram + 2);
+
+	env->step(0x00, 7);
+	env->load_state(*state);
+	EXPECT_EQ(env->observe().ram[0], saved[0]);
+	EXPECT_EQ(env->observe().ram[1], saved[1]);
+	EXPECT_EQ(env->observe().frame, BOOT_FRAMES + 3);
+
+	// A restored state counts as the new reset point once it is set
+	env->set_reset_state(*state);
+	env->step(0x00, 2);
+	env->reset();
+	EXPECT_EQ(env->observe().frame, BOOT_FRAMES + 3);
+}
+
+TEST(EnvironmentCTest, CInterfaceTest) {
+	Log::set_level(LogLevel::ERROR);
+
+	auto rom = make_rom(JOYPAD_PROGRAM);
+	auto addresses = vector<uint16_t>{0xC000};
+	auto env = tvp_env_create(rom.data(), rom.size(), addresses.data(),
+	                          addresses.size(), BOOT_FRAMES);
+	ASSERT_NE(env, nullptr);
+
+	tvp_env_step(env, 0x20, 1);
+	EXPECT_EQ(tvp_env_ram(env)[0], 0x1D);
+	EXPECT_EQ(tvp_env_frame(env), BOOT_FRAMES + 1);
+
+	// The screen is the GPU video buffer itself, so it never moves
+	auto screen = tvp_env_screen(env);
+	auto state = tvp_env_save(env);
+	tvp_env_step(env, 0x00, 1);
+	EXPECT_EQ(tvp_env_screen(env), screen);
+	EXPECT_EQ(tvp_env_ram(env)[0], 0x1F);
+	tvp_env_load(env, state);
+	EXPECT_EQ(tvp_env_ram(env)[0], 0x1D);
+
+	tvp_state_destroy(state);
+	tvp_env_destroy(env);
+
+	EXPECT_EQ(tvp_env_create(rom.data(), 0x100, nullptr, 0, 0), nullptr);
+}
@@ -0,0 +1,125 @@
+#include "gameboy/movie.h"
+#include "utils/rom.h"
+
+#include <gtest/gtest.h>
+
+using namespace testing;
+using namespace gameboy;
+using namespace std;
+using namespace test_utils;
+
+/**
+ * Number of frames to record
+ */
+const uint64_t MOVIE_FRAMES = 20;
+
+class MovieTest : public Test {
+  protected:
+	string path;
+
+	void SetUp() override {
+		Log::set_level(LogLevel::ERROR);
+		path = TempDir() + "tvp_movie_test.txt";
+	}
+
+	void TearDown() override { remove(path.c_str()); }
+
+	unique_ptr<Gameboy> make_gameboy() {
+		// clang-format off
+		return make_unique<Gameboy>(make_unique<Cartridge>(make_rom({
+		    0x3E, 0x10,       // $0150: LD A, $10
+		    0xE0, 0x00,       //        LDH ($00), A
+		    0xF0, 0x00,       // $0154: LDH A, ($00)
+		    0xEA, 0x00, 0xC0, //        LD ($C000), A
+		    0x18, 0xF9,       //        JR $0154
+		})), true);
+		// clang-format on
+	}
+
+	/**
+	 * Record a run with the buttons changing every frame, like Video would
+	 */
+	RegisterState record() {
+		auto gb = make_gameboy();
+		auto recorder = MovieRecorder(gb.get(), path);
+		EXPECT_TRUE(recorder.is_open());
+
+		uint64_t frames = 0;
+		while (gb->gpu->get_frame_count() < MOVIE_FRAMES) {
+			gb->tick();
+			if (gb->gpu->get_frame_count() != frames) {
+				frames = gb->gpu->get_frame_count();
+				gb->controller->set_buttons(static_cast<uint8_t>(frames * 7));
+			}
+			recorder.update();
+		}
+		return gb->cpu->get_register_state();
+	}
+};
+
+TEST_F(MovieTest, ReplayTest) {
+	auto recorded_state = record();
+
+	auto movie = Movie();
+	ASSERT_TRUE(movie.load(path));
+	ASSERT_EQ(movie.get_frames().size(), MOVIE_FRAMES);
+	EXPECT_EQ(movie.get_frames()[3].buttons, 4 * 7);
+
+	auto gb = make_gameboy();
+	auto rom_data = gb->cartridge->get_state().data;
+	EXPECT_EQ(movie.get_rom_hash(), Movie::hash_rom(*rom_data));
+
+	auto player = MoviePlayer(gb.get(), &movie);
+	while (!player.is_finished()) {
+		gb->tick();
+		player.update();
+	}
+
+	EXPECT_FALSE(player.get_desync_frame());
+	EXPECT_EQ(gb->cpu->get_register_state(), recorded_state);
+	EXPECT_EQ(gb->controller->get_buttons(),
+	          static_cast<uint8_t>(MOVIE_FRAMES * 7));
+}
+
+TEST_F(MovieTest, DesyncTest) {
+	record();
+
+	auto recorded = Movie();
+	ASSERT_TRUE(recorded.load(path));
+
+	// Change the hash of one frame
+	auto movie = Movie(recorded.get_rom_hash());
+	for (auto frame : recorded.get_frames()) {
+		if (movie.get_frames().size() == 12) {
+			frame.hash ^= 1;
+		}
+		movie.add_frame(frame);
+	}
+
+	auto gb = make_gameboy();
+	auto player = MoviePlayer(gb.get(), &movie);
+	while (!player.is_finished()) {
+		gb->tick();
+		player.update();
+	}
+
+	ASSERT_TRUE(player.get_desync_frame());
+	EXPECT_EQ(*player.get_desync_frame(), 12u);
+}
+
+TEST_F(MovieTest, SaveLoadTest) {
+	auto movie = Movie(0x0123456789ABCDEF);
+	movie.add_frame({0x00, 0xFFFFFFFFFFFFFFFF});
+	movie.add_frame({0x81, 0x42});
+	ASSERT_TRUE(movie.save(path));
+
+	auto loaded = Movie();
+	ASSERT_TRUE(loaded.load(path));
+	EXPECT_EQ(loaded.get_rom_hash(), 0x0123456789ABCDEFu);
+	ASSERT_EQ(loaded.get_frames().size(), 2u);
+	EXPECT_EQ(loaded.get_frames()[0].hash, 0xFFFFFFFFFFFFFFFFu);
+	EXPECT_EQ(loaded.get_frames()[1].buttons, 0x81);
+	EXPECT_EQ(loaded.get_frames()[1].hash, 0x42u);
+
+	EXPECT_FALSE(loaded.load(path + ".missing"));
+}
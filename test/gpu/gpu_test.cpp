@@ -0,0 +1,408 @@
+#include "gameboy/gameboy.h"
+#include "utils/rom.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+
+using namespace testing;
+using namespace gpu;
+using namespace std;
+using namespace test_utils;
+
+class GPUTest : public Test {
+  protected:
+	unique_ptr<gameboy::Gameboy> gb;
+	memory::IORegisters *io;
+
+	void SetUp() override {
+		Log::set_level(LogLevel::ERROR);
+		gb = make_gameboy();
+		io = gb->memory->get_io();
+	}
+
+	/**
+	 * Make a headless Gameboy that runs JR -2 forever, past the boot ROM
+	 */
+	unique_ptr<gameboy::Gameboy> make_gameboy() {
+		auto gameboy = make_unique<gameboy::Gameboy>(
+		    make_unique<cartridge::Cartridge>(make_rom({0x18, 0xFE})), true);
+		gameboy->memory->write(0xFF50, 1);
+		return gameboy;
+	}
+
+	void run_frame() {
+		auto target = gb->gpu->get_frame_count() + 1;
+		while (gb->gpu->get_frame_count() < target) {
+			gb->tick();
+		}
+	}
+
+	uint8_t mode() { return io->get(memory::io::STAT) & 0x03; }
+
+	/**
+	 * Fill the tile data and the first tile map with a pattern, and turn the
+	 * LCD on
+	 */
+	void fill_vram(gameboy::Gameboy &gb) {
+		for (uint32_t addr = 0x8000; addr < 0x9C00; ++addr) {
+			gb.memory->write(static_cast<Address>(addr),
+			                 static_cast<uint8_t>(addr * 7 + addr / 256));
+		}
+		gb.memory->write(0xFF40, 0x91);
+		gb.memory->write(0xFF47, 0xE4);
+	}
+
+	/**
+	 * Run a frame that scrolls halfway down the screen, and changes a tile
+	 * there if the scroll isn't 0 and change_tile is set
+	 */
+	void run_split_frame(gameboy::Gameboy &gb, uint8_t scroll,
+	                     bool change_tile = true) {
+		auto target = gb.gpu->get_frame_count() + 1;
+		auto io = gb.memory->get_io();
+		while (io->get(memory::io::LY) != 72) {
+			gb.tick();
+		}
+		gb.memory->write(0xFF43, scroll);
+		if (scroll && change_tile) {
+			gb.memory->write(0x8000, scroll);
+		}
+		while (gb.gpu->get_frame_count() < target) {
+			gb.tick();
+		}
+	}
+};
+
+TEST_F(GPUTest, LcdOffTest) {
+	// The LCD starts out off, and frames still pass without it
+	EXPECT_FALSE(gb->gpu->is_display_enabled());
+	run_frame();
+	run_frame();
+	EXPECT_EQ(gb->gpu->get_frame_count(), 2u);
+	EXPECT_EQ(io->get(memory::io::LY), 0);
+	EXPECT_EQ(mode(), 0);
+	EXPECT_EQ(gb->cpu->get_interrupts()->get_flag(), 0x00);
+
+	// Turning it on starts a frame from the top
+	gb->memory->write(0xFF40, 0x91);
+	EXPECT_TRUE(gb->gpu->is_display_enabled());
+	EXPECT_EQ(mode(), 2);
+	run_frame();
+	EXPECT_EQ(gb->cpu->get_interrupts()->get_flag() & 0x01, 0x01);
+}
+
+TEST_F(GPUTest, LcdOffMidFrameTest) {
+	gb->memory->write(0xFF40, 0x91);
+	while (io->get(memory::io::LY) < 10) {
+		gb->tick();
+	}
+
+	// LY is held at 0 in HBLANK, and the screen is blank
+	gb->memory->write(0xFF40, 0x11);
+	EXPECT_EQ(io->get(memory::io::LY), 0);
+	EXPECT_EQ(mode(), 0);
+	gb->cpu->get_interrupts()->set_flag(0x00);
+
+	for (auto i = 0; i < 1000; ++i) {
+		gb->tick();
+	}
+	EXPECT_EQ(io->get(memory::io::LY), 0);
+	EXPECT_EQ(gb->cpu->get_interrupts()->get_flag(), 0x00);
+	for (auto pixel : gb->gpu->get_video_buffer()) {
+		ASSERT_EQ(pixel, Pixel::ZERO);
+	}
+}
+
+TEST_F(GPUTest, UnchangedFrameTest) {
+	fill_vram(*gb);
+	run_frame();
+	run_frame();
+	auto &stats = gb->gpu->get_render_stats();
+	EXPECT_EQ(stats.lines_drawn, 144u);
+	EXPECT_EQ(stats.frames_reused, 1u);
+	auto frame = gb->gpu->get_video_buffer();
+
+	// Writes to the tile map only redraw the lines of the rows on the same
+	// page, which are the top 64 lines here
+	gb->memory->write(0x9800, 0x42);
+	run_frame();
+	EXPECT_EQ(stats.lines_drawn, 144u + 64u);
+	EXPECT_EQ(stats.frames_painted, 2u);
+	EXPECT_NE(gb->gpu->get_video_buffer(), frame);
+
+	// Frames are compared with the one before
+	run_frame();
+	EXPECT_EQ(stats.frames_reused, 2u);
+}
+
+TEST_F(GPUTest, ReusedLinesMatchTest) {
+	fill_vram(*gb);
+	run_split_frame(*gb, 0);
+	run_split_frame(*gb, 0);
+
+	// A copy loaded from a snapshot has nothing cached, so draws every line
+	auto state = make_unique<gameboy::GameboyState>();
+	gb->save_state(state.get());
+	auto copy = make_gameboy();
+	copy->load_state(*state);
+
+	for (uint8_t scroll : {0, 0, 5, 5, 0}) {
+		run_split_frame(*gb, scroll);
+		run_split_frame(*copy, scroll);
+		ASSERT_EQ(gb->gpu->get_video_buffer(),
+		          copy->gpu->get_video_buffer());
+	}
+	EXPECT_GT(gb->gpu->get_render_stats().lines_reused, 0u);
+}
+
+TEST_F(GPUTest, DeferredRenderTest) {
+	auto deferred = make_gameboy();
+	deferred->gpu->set_render_threads(2);
+	fill_vram(*gb);
+	fill_vram(*deferred);
+
+	// Lines drawn at VBLANK see the scroll and tiles of their own line
+	for (uint8_t scroll : {0, 5, 5, 0, 3}) {
+		run_split_frame(*gb, scroll);
+		run_split_frame(*deferred, scroll);
+		ASSERT_EQ(gb->gpu->get_video_buffer(),
+		          deferred->gpu->get_video_buffer());
+	}
+}
+
+TEST_F(GPUTest, TileSelectTest) {
+	// Tiles 0 and 1 of each tile set, each with a different color
+	for (uint16_t i = 0; i < 16; i += 2) {
+		gb->memory->write(static_cast<Address>(0x8000 + i), 0xFF);
+		gb->memory->write(static_cast<Address>(0x8001 + i), 0xFF);
+		gb->memory->write(static_cast<Address>(0x8010 + i), 0xFF);
+		gb->memory->write(static_cast<Address>(0x9011 + i), 0xFF);
+	}
+
+	// The low tile map uses tile 1 everywhere, and the high one tile 0
+	for (uint16_t i = 0; i < 0x400; ++i) {
+		gb->memory->write(static_cast<Address>(0x9800 + i), 0x01);
+	}
+	gb->memory->write(0xFF47, 0xE4);
+
+	auto expected = map<uint8_t, Pixel>{
+	    {0x91, Pixel::TWO},
+	    {0x81, Pixel::ONE},
+	    {0x99, Pixel::THREE},
+	    {0x89, Pixel::ZERO},
+	};
+	for (auto &config : expected) {
+		gb->memory->write(0xFF40, config.first);
+		run_frame();
+		for (auto pixel : gb->gpu->get_video_buffer()) {
+			ASSERT_EQ(pixel, config.second) << "LCDC " << int(config.first);
+		}
+		gb->memory->write(0xFF40, 0x00);
+	}
+}
+
+TEST_F(GPUTest, SpriteSizeTest) {
+	// Tile 0 is solid, and the BG uses the blank tile 2
+	for (uint16_t i = 0; i < 32; ++i) {
+		gb->memory->write(static_cast<Address>(0x8000 + i), 0xFF);
+	}
+	for (uint16_t i = 0; i < 0x400; ++i) {
+		gb->memory->write(static_cast<Address>(0x9800 + i), 0x02);
+	}
+	gb->memory->write(0xFF47, 0xE4);
+	gb->memory->write(0xFF48, 0xE4);
+
+	// One sprite in the top left corner
+	gb->memory->write(0xFE00, 16);
+	gb->memory->write(0xFE01, 8);
+
+	for (auto tall : {false, true}) {
+		gb->memory->write(0xFF40, tall ? 0x97 : 0x93);
+		run_frame();
+		auto &frame = gb->gpu->get_video_buffer();
+		EXPECT_EQ(frame[7 * SCREEN_WIDTH + 7], Pixel::THREE);
+		EXPECT_EQ(frame[15 * SCREEN_WIDTH + 7],
+		          tall ? Pixel::THREE : Pixel::ZERO);
+		EXPECT_EQ(frame[16 * SCREEN_WIDTH], Pixel::ZERO);
+		EXPECT_EQ(frame[8], Pixel::ZERO);
+		gb->memory->write(0xFF40, 0x00);
+	}
+}
+
+/**
+ * Runs the GPU on its own, a dot at a time, with the pixel FIFO drawing
+ */
+class PixelFifoTest : public GPUTest {
+  protected:
+	void SetUp() override {
+		GPUTest::SetUp();
+		gb->gpu->set_render_mode(RenderMode::PIXEL_FIFO);
+
+		// Tile 0 is solid color 1, and tile 1 solid color 2
+		for (uint16_t i = 0; i < 16; i += 2) {
+			gb->memory->write(static_cast<Address>(0x8000 + i), 0xFF);
+			gb->memory->write(static_cast<Address>(0x8011 + i), 0xFF);
+		}
+		for (uint16_t i = 0; i < 0x400; ++i) {
+			gb->memory->write(static_cast<Address>(0x9C00 + i), 0x01);
+		}
+		gb->memory->write(0xFF47, 0xE4);
+		gb->memory->write(0xFF48, 0xE4);
+	}
+
+	void run_until_mode(uint8_t target) {
+		while (mode() != target) {
+			gb->gpu->tick(1);
+		}
+	}
+
+	/**
+	 * Run to the start of the pixel transfer of the given line
+	 */
+	void run_to_transfer(uint8_t line) {
+		while (io->get(memory::io::LY) != line || mode() != 3) {
+			gb->gpu->tick(1);
+		}
+	}
+
+	/**
+	 * Run through the pixel transfer of the given line, and count its dots
+	 */
+	cpu::ClockCycles measure_transfer(uint8_t line) {
+		run_to_transfer(line);
+		cpu::ClockCycles dots = 0;
+		while (mode() == 3) {
+			gb->gpu->tick(1);
+			++dots;
+		}
+		return dots;
+	}
+
+	Pixel pixel(int x, int y) {
+		return gb->gpu->get_video_buffer()[y * SCREEN_WIDTH + x];
+	}
+};
+
+TEST_F(PixelFifoTest, TransferLengthTest) {
+	gb->memory->write(0xFF40, 0x93);
+	EXPECT_EQ(measure_transfer(1), 172u);
+
+	// Fine scroll pixels are dropped a dot each
+	gb->memory->write(0xFF43, 3);
+	EXPECT_EQ(measure_transfer(3), 175u);
+	gb->memory->write(0xFF43, 0);
+
+	// A sprite at the start of a tile waits for the whole BG fetch
+	gb->memory->write(0xFE00, 16 + 5);
+	gb->memory->write(0xFE01, 8 + 40);
+	EXPECT_EQ(measure_transfer(5), 172u + 11u);
+
+	// Starting the window fetches a tile again
+	gb->memory->write(0xFE00, 0);
+	gb->memory->write(0xFF4A, 7);
+	gb->memory->write(0xFF4B, 7 + 80);
+	gb->memory->write(0xFF40, 0xB3);
+	EXPECT_EQ(measure_transfer(7), 172u + 6u);
+}
+
+TEST_F(PixelFifoTest, MidLinePaletteTest) {
+	gb->memory->write(0xFF40, 0x91);
+
+	// The first pixel leaves the FIFO on the 13th dot, and writes take
+	// effect from the next pixel
+	run_to_transfer(12);
+	gb->gpu->tick(12 + 80);
+	gb->memory->write(0xFF47, 0x00);
+	run_until_mode(0);
+	EXPECT_EQ(pixel(79, 12), Pixel::ONE);
+	EXPECT_EQ(pixel(80, 12), Pixel::ZERO);
+	EXPECT_EQ(pixel(159, 12), Pixel::ZERO);
+	EXPECT_EQ(pixel(159, 11), Pixel::ONE);
+}
+
+TEST_F(PixelFifoTest, MidLineSpriteEnableTest) {
+	// A sprite of tile 1 at (8, 8), drawn on the lines before 12
+	gb->memory->write(0xFE00, 16 + 8);
+	gb->memory->write(0xFE01, 8 + 8);
+	gb->memory->write(0xFE02, 0x01);
+	gb->memory->write(0xFF40, 0x93);
+
+	// Sprites turned on mid-line only show from there on, and the ones
+	// already passed are not fetched
+	run_to_transfer(12);
+	gb->memory->write(0xFF40, 0x91);
+	gb->gpu->tick(12 + 80);
+	gb->memory->write(0xFF40, 0x93);
+	run_until_mode(0);
+	EXPECT_EQ(pixel(8, 11), Pixel::TWO);
+	for (auto x = 0; x < SCREEN_WIDTH; ++x) {
+		ASSERT_EQ(pixel(x, 12), Pixel::ONE) << "x " << x;
+	}
+}
+
+TEST_F(PixelFifoTest, WindowAndSpriteTest) {
+	// A tall sprite from tile 0 and 1, flipped, at (20, 30). Its palette
+	// tells it apart from the BG.
+	gb->memory->write(0xFF48, 0x2C);
+	gb->memory->write(0xFE00, 16 + 30);
+	gb->memory->write(0xFE01, 8 + 20);
+	gb->memory->write(0xFE02, 0x01);
+	gb->memory->write(0xFE03, 0x40);
+
+	// The window from the high tile map, from (40, 20)
+	gb->memory->write(0xFF4A, 20);
+	gb->memory->write(0xFF4B, 7 + 40);
+	gb->memory->write(0xFF40, 0xF7);
+	run_frame();
+
+	EXPECT_EQ(pixel(39, 20), Pixel::ONE);
+	EXPECT_EQ(pixel(40, 20), Pixel::TWO);
+	EXPECT_EQ(pixel(40, 19), Pixel::ONE);
+	EXPECT_EQ(pixel(159, 143), Pixel::TWO);
+
+	// Flipped in Y, the top half is tile 1
+	EXPECT_EQ(pixel(20, 30), Pixel::TWO);
+	EXPECT_EQ(pixel(27, 37), Pixel::TWO);
+	EXPECT_EQ(pixel(27, 38), Pixel::THREE);
+	EXPECT_EQ(pixel(27, 45), Pixel::THREE);
+	EXPECT_EQ(pixel(27, 46), Pixel::ONE);
+	EXPECT_EQ(pixel(28, 30), Pixel::ONE);
+}
+
+TEST_F(PixelFifoTest, MatchesScanlineTest) {
+	// The renderers only agree where the scanline renderer's addressing
+	// matches the hardware (see RenderMode): on lines without sprites, when
+	// both bytes of every tile line are the same, and tile numbers are below
+	// 128
+	auto scanline = make_gameboy();
+	for (auto gameboy : {gb.get(), scanline.get()}) {
+		for (uint32_t addr = 0x8000; addr < 0x9800; ++addr) {
+			gameboy->memory->write(static_cast<Address>(addr),
+			                       static_cast<uint8_t>((addr / 2) * 13));
+		}
+		for (uint32_t addr = 0x9800; addr < 0x9C00; ++addr) {
+			gameboy->memory->write(static_cast<Address>(addr),
+			                       static_cast<uint8_t>(addr * 7 % 128));
+		}
+		gameboy->memory->write(0xFF47, 0xE4);
+		gameboy->memory->write(0xFF42, 3);
+		gameboy->memory->write(0xFF40, 0x91);
+	}
+
+	// Changing a tile would break the equal bytes, so only scroll
+	for (uint8_t scroll : {0, 5, 13}) {
+		run_split_frame(*gb, scroll, false);
+		run_split_frame(*scanline, scroll, false);
+		ASSERT_EQ(gb->gpu->get_video_buffer(),
+		          scanline->gpu->get_video_buffer());
+	}
+
+	// The same, with the tile data from $8800
+	for (auto gameboy : {gb.get(), scanline.get()}) {
+		gameboy->memory->write(0xFF40, 0x81);
+	}
+	run_split_frame(*gb, 9, false);
+	run_split_frame(*scanline, 9, false);
+	EXPECT_EQ(gb->gpu->get_video_buffer(), scanline->gpu->get_video_buffer());
+}
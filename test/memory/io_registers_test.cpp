@@ -0,0 +1,59 @@
+#include "memory/io_registers.h"
+
+#include <gtest/gtest.h>
+
+using namespace testing;
+using namespace memory;
+
+TEST(IORegistersTest, PlainRegisterTest) {
+	auto io = IORegisters{};
+	EXPECT_EQ(io.read(io::SCX), 0x00);
+
+	// Registers without hooks are the stored byte, from either side
+	io.write(io::SCX, 0x42);
+	EXPECT_EQ(io.get(io::SCX), 0x42);
+
+	io.set(io::SCY, 0x17);
+	EXPECT_EQ(io.read(io::SCY), 0x17);
+
+	io.set_bit(io::STAT, 3, true);
+	EXPECT_TRUE(io.get_bit(io::STAT, 3));
+	EXPECT_EQ(io.get(io::STAT), 0x08);
+	io.set_bit(io::STAT, 3, false);
+	EXPECT_EQ(io.get(io::STAT), 0x00);
+}
+
+TEST(IORegistersTest, HookTest) {
+	auto io = IORegisters{};
+	auto written = uint8_t{0};
+	io.set_read_hook(io::P1, [] { return static_cast<uint8_t>(0xCF); });
+	io.set_write_hook(io::P1, [&written](uint8_t data) { written = data; });
+
+	// Hooks only run for bus accesses, and replace the stored byte
+	io.set(io::P1, 0x01);
+	EXPECT_EQ(io.read(io::P1), 0xCF);
+	EXPECT_EQ(io.get(io::P1), 0x01);
+
+	io.write(io::P1, 0x20);
+	EXPECT_EQ(written, 0x20);
+	EXPECT_EQ(io.get(io::P1), 0x01);
+
+	// Removing the hooks makes the register plain again
+	io.set_read_hook(io::P1, nullptr);
+	io.set_write_hook(io::P1, nullptr);
+	io.write(io::P1, 0x30);
+	EXPECT_EQ(io.read(io::P1), 0x30);
+	EXPECT_EQ(written, 0x20);
+}
+
+TEST(IORegistersTest, ValuesTest) {
+	auto io = IORegisters{};
+	io.set(io::LCDC, 0x91);
+	io.set(io::BGP, 0xFC);
+
+	auto copy = IORegisters{};
+	copy.set_values(io.get_values());
+	EXPECT_EQ(copy.get(io::LCDC), 0x91);
+	EXPECT_EQ(copy.get(io::BGP), 0xFC);
+	EXPECT_EQ(copy.get_values(), io.get_values());
+}
@@ -0,0 +1,146 @@
+#include "gameboy/gameboy.h"
+#include "utils/rom.h"
+
+#include <gtest/gtest.h>
+
+using namespace testing;
+using namespace memory;
+using namespace std;
+using namespace test_utils;
+
+class MemoryTest : public Test {
+  protected:
+	unique_ptr<gameboy::Gameboy> gb;
+	Memory *memory;
+
+	void SetUp() override {
+		Log::set_level(LogLevel::ERROR);
+
+		auto rom = make_rom({});
+		rom[0x1234] = 0xCD;
+		rom[0x1235] = 0xAB;
+		gb = make_unique<gameboy::Gameboy>(
+		    make_unique<cartridge::Cartridge>(rom), true);
+		gb->memory->write(0xFF50, 1);
+		memory = gb->memory.get();
+	}
+};
+
+TEST_F(MemoryTest, Read16Test) {
+	// Work RAM and high RAM are read straight from their pages
+	memory->write(0xC010, 0x34);
+	memory->write(0xC011, 0x12);
+	EXPECT_EQ(memory->read16(0xC010), 0x1234);
+
+	memory->write(0xFF90, 0x78);
+	memory->write(0xFF91, 0x56);
+	EXPECT_EQ(memory->read16(0xFF90), 0x5678);
+
+	// ROM, and values split between two pages
+	EXPECT_EQ(memory->read16(0x1234), 0xABCD);
+
+	memory->write(0xC0FF, 0x01);
+	memory->write(0xC100, 0x02);
+	EXPECT_EQ(memory->read16(0xC0FF), 0x0201);
+
+	// The high byte of $FFFE is the Interrupt Enable register
+	memory->write(0xFFFE, 0x11);
+	memory->write(0xFFFF, 0x1F);
+	EXPECT_EQ(memory->read16(0xFFFE), 0x1F11);
+}
+
+TEST_F(MemoryTest, Write16Test) {
+	memory->write16(0xC020, 0xBEEF);
+	EXPECT_EQ(memory->read(0xC020), 0xEF);
+	EXPECT_EQ(memory->read(0xC021), 0xBE);
+
+	// The high byte lands in Echo RAM, which mirrors $C000
+	memory->write16(0xDFFF, 0x4321);
+	EXPECT_EQ(memory->read(0xDFFF), 0x21);
+	EXPECT_EQ(memory->read(0xC000), 0x43);
+
+	memory->write16(0xFFFE, 0x0A0B);
+	EXPECT_EQ(memory->read(0xFFFE), 0x0B);
+	EXPECT_EQ(gb->cpu->get_interrupts()->get_enable(), 0x0A);
+}
+
+TEST_F(MemoryTest, CopyOnWriteTest) {
+	memory->write(0xC000, 0x11);
+	auto state = memory->get_state();
+
+	// Writes after a snapshot, wide or not, must not change it
+	memory->write16(0xC000, 0x2222);
+	memory->copy(0xC001, 0xC000, 1);
+	EXPECT_EQ(state.get_byte(0xC000), 0x11);
+	EXPECT_EQ(state.get_byte(0xC001), 0x00);
+	EXPECT_EQ(memory->read(0xC001), 0x22);
+}
+
+TEST_F(MemoryTest, DmaTest) {
+	for (auto i = 0; i < 0xA0; ++i) {
+		memory->write(static_cast<Address>(0xC100 + i),
+		              static_cast<uint8_t>(i + 1));
+	}
+
+	memory->write(0xFF46, 0xC1);
+	for (auto i = 0; i < 0xA0; ++i) {
+		EXPECT_EQ(memory->peek(static_cast<Address>(0xFE00 + i)), i + 1);
+	}
+
+	// The CPU only reaches the high page until the transfer is done
+	memory->write(0xC000, 0x55);
+	memory->write(0xFF90, 0x66);
+	EXPECT_EQ(memory->read(0xC100), 0xFF);
+	EXPECT_EQ(memory->read(0xFF90), 0x66);
+
+	memory->run_dma(DMA_CYCLES - 1);
+	EXPECT_EQ(memory->read(0xFE00), 0xFF);
+	memory->run_dma(1);
+	EXPECT_EQ(memory->get_dma_cycles(), 0u);
+	EXPECT_EQ(memory->read(0xFE00), 0x01);
+	EXPECT_EQ(memory->read(0xC000), 0x00);
+}
+
+TEST_F(MemoryTest, DmaLockTest) {
+	// clang-format off
+	auto rom = make_rom({
+	    0x31, 0xFE, 0xFF, // $0150: LD SP, $FFFE
+	    0x3E, 0xC1,       //        LD A, $C1
+	    0xE0, 0x46,       //        LDH ($46), A
+	    0x04,             // $0157: INC B
+	    0x04,             //        INC B
+	    0x18, 0xFC,       //        JR $0157
+	});
+	// clang-format on
+	rom[0x0038] = 0x76; // HALT
+
+	// The CPU fetches $FF, RST $38, until the DMA is done, and then halts at
+	// $0038. Each RST pushes to high RAM, which stays reachable. Cached
+	// blocks and fused sequences must not run the ROM code behind the lock.
+	auto modes = {cpu::ExecutionMode::INTERPRETER,
+	              cpu::ExecutionMode::BLOCK_CACHE, cpu::ExecutionMode::JIT};
+	for (auto mode : modes) {
+		auto gb_mode =
+		    gameboy::Gameboy(make_unique<cartridge::Cartridge>(rom), true);
+		gb_mode.memory->write(0xFF50, 1);
+		gb_mode.cpu->set_execution_mode(mode);
+		for (auto i = 0; i < 200; ++i) {
+			gb_mode.tick();
+		}
+
+		auto registers = gb_mode.cpu->get_register_state();
+		EXPECT_EQ(registers.bc & 0xFF00, 0x0000) << static_cast<int>(mode);
+		EXPECT_EQ(registers.sp, 0xFFFE - DMA_CYCLES / 4 * 2)
+		    << static_cast<int>(mode);
+		EXPECT_EQ(registers.pc, 0x0039) << static_cast<int>(mode);
+		EXPECT_TRUE(registers.halted) << static_cast<int>(mode);
+	}
+}
+
+TEST_F(MemoryTest, RomDmaTest) {
+	// ROM sources are read from the cartridge, not the pages behind it
+	memory->write(0xFF46, 0x12);
+	memory->run_dma(DMA_CYCLES);
+	EXPECT_EQ(memory->read(0xFE34), 0xCD);
+	EXPECT_EQ(memory->read(0xFE35), 0xAB);
+}
@@ -0,0 +1,12 @@
+/**
+ * @file memory_mock.cpp
+ * Instantiates the CPU and GPU over the mock memory, so that tests can drive
+ * them without a real bus
+ */
+
+#include "memory/mocks/memory_mock.h"
+#include "cpu/cpu_impl.h"
+#include "gpu/gpu_impl.h"
+
+template class cpu::CPU<MemoryMock>;
+template class gpu::GPU<MemoryMock, cpu::CPU<MemoryMock>>;
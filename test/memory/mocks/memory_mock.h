@@ -11,8 +11,10 @@ using namespace std;
 using namespace memory;
 
 class MemoryMock : public MemoryInterface {
+  public:
 	MOCK_CONST_METHOD1(read, uint8_t(Address));
 	MOCK_METHOD2(write, void(Address, uint8_t));
+	MOCK_CONST_METHOD2(get_write_count, uint32_t(Address, Address));
 	MOCK_METHOD1(set_cpu, void(cpu::CPUInterface *_cpu));
 	MOCK_METHOD1(set_gpu, void(gpu::GPUInterface *_gpu));
 };
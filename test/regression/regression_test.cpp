@@ -0,0 +1,386 @@
+#include "gameboy/gameboy.h"
+#include "util/helpers.h"
+#include "utils/rom.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+using namespace testing;
+using namespace gameboy;
+using namespace std;
+using namespace test_utils;
+
+/**
+ * Runs a set of ROMs headless, hashes the screen and the main RAM areas at
+ * the end of every frame, and compares the hashes against the golden file.
+ *
+ * The screen must be the same in every execution mode, so there is one set of
+ * screen hashes, taken from the interpreter, that all modes are checked
+ * against. RAM hashes are kept per mode: cached blocks run to their end
+ * before the GPU catches up, so a frame can end at a different point in the
+ * program than with the interpreter, even though the same code runs. That
+ * shows up in the RAM of ROMs that never wait for the frame, like alu.
+ *
+ * After an intended change in behaviour, regenerate the golden file by
+ * running one of the tests with TVP_UPDATE_GOLDEN=1 set, and review the diff.
+ */
+
+/**
+ * Number of frames each ROM runs for
+ */
+const uint64_t REGRESSION_FRAMES = 30;
+
+/**
+ * Execution modes to check, and their names in the golden file. The first is
+ * the reference for the screen hashes.
+ */
+const vector<pair<ExecutionMode, string>> REGRESSION_MODES = {
+    {ExecutionMode::INTERPRETER, "interpreter"},
+    {ExecutionMode::BLOCK_CACHE, "block"},
+    {ExecutionMode::JIT, "jit"},
+};
+
+/**
+ * Hashes taken at the end of one frame
+ */
+struct FrameHashes {
+	uint64_t screen;
+	uint64_t ram;
+};
+
+/**
+ * Build the regression ROMs, by name
+ */
+map<string, vector<uint8_t>> make_regression_roms() {
+	auto roms = map<string, vector<uint8_t>>();
+
+	// Arithmetic, CB ops and calls, writing results over all of WRAM
+	// clang-format off
+	auto alu = vector<uint8_t>{
+	    0x31, 0xFE, 0xFF, // $0150: LD SP, $FFFE
+	    0x21, 0x00, 0xC0, //        LD HL, $C000
+	    0x06, 0x00,       //        LD B, $00
+	    0x78,             // $0158: LD A, B
+	    0x87,             //        ADD A, A
+	    0x88,             //        ADC A, B
+	    0xEE, 0x3C,       //        XOR $3C
+	    0xCB, 0x37,       //        SWAP A
+	    0x22,             //        LD (HL+), A
+	    0xCD, 0x80, 0x01, //        CALL $0180
+	    0x04,             //        INC B
+	    0x7C,             //        LD A, H
+	    0xFE, 0xD0,       //        CP $D0
+	    0x20, 0xEF,       //        JR NZ, $0158
+	    0x21, 0x00, 0xC0, //        LD HL, $C000
+	    0x18, 0xEA,       //        JR $0158
+	};
+	alu.resize(0x30, 0x00);
+	alu.insert(alu.end(), {
+	    0xC5,             // $0180: PUSH BC
+	    0x7A,             //        LD A, D
+	    0x80,             //        ADD A, B
+	    0x57,             //        LD D, A
+	    0xCB, 0x12,       //        RL D
+	    0x3F,             //        CCF
+	    0x1F,             //        RRA
+	    0xEA, 0x00, 0xD0, //        LD ($D000), A
+	    0x0E, 0x55,       //        LD C, $55
+	    0xA9,             //        XOR C
+	    0x5F,             //        LD E, A
+	    0xC1,             //        POP BC
+	    0xC9,             //        RET
+	});
+	roms["alu"] = make_rom(alu);
+
+	// Waits in HALT, and redraws tiles and scrolls from the VBLANK handler
+	auto tiles = vector<uint8_t>{
+	    0x31, 0xFE, 0xFF, // $0150: LD SP, $FFFE
+	    0x3E, 0x01,       //        LD A, $01
+	    0xE0, 0xFF,       //        LDH ($FF), A
+	    0x21, 0x00, 0x80, //        LD HL, $8000
+	    0x0E, 0x00,       //        LD C, $00
+	    0xFB,             //        EI
+	    0x76,             // $015D: HALT
+	    0x00,             //        NOP
+	    0x18, 0xFC,       //        JR $015D
+	};
+	tiles.resize(0xB0, 0x00);
+	tiles.insert(tiles.end(), {
+	    0x0C,             // $0200: INC C
+	    0x79,             //        LD A, C
+	    0xE0, 0x42,       //        LDH ($42), A
+	    0x06, 0x10,       //        LD B, $10
+	    0x79,             // $0206: LD A, C
+	    0xA8,             //        XOR B
+	    0x22,             //        LD (HL+), A
+	    0x05,             //        DEC B
+	    0x20, 0xFA,       //        JR NZ, $0206
+	    0x7C,             //        LD A, H
+	    0xFE, 0x88,       //        CP $88
+	    0x20, 0x03,       //        JR NZ, $0214
+	    0x21, 0x00, 0x80, //        LD HL, $8000
+	    0x11, 0x00, 0x98, // $0214: LD DE, $9800
+	    0x79,             //        LD A, C
+	    0x83,             //        ADD A, E
+	    0x5F,             //        LD E, A
+	    0x79,             //        LD A, C
+	    0xE6, 0x7F,       //        AND $7F
+	    0x12,             //        LD (DE), A
+	    0xD9,             //        RETI
+	});
+	roms["tiles"] = make_rom(tiles);
+
+	// VBLANK vector jumps to the handler
+	auto &tiles_rom = roms["tiles"];
+	tiles_rom[0x40] = 0xC3; // JP $0200
+	tiles_rom[0x41] = 0x00;
+	tiles_rom[0x42] = 0x02;
+
+	// Moves sprites every frame, through OAM DMA from WRAM, started by a
+	// routine that it copies into high RAM
+	roms["sprites"] = make_rom({
+	    0x31, 0xFE, 0xFF, // $0150: LD SP, $FFFE
+	    0x3E, 0x93,       //        LD A, $93
+	    0xE0, 0x40,       //        LDH ($40), A
+	    0x3E, 0xE4,       //        LD A, $E4
+	    0xE0, 0x48,       //        LDH ($48), A
+	    0x21, 0x10, 0x80, //        LD HL, $8010
+	    0x3E, 0xFF,       //        LD A, $FF
+	    0x06, 0x10,       //        LD B, $10
+	    0x22,             // $0162: LD (HL+), A
+	    0x05,             //        DEC B
+	    0x20, 0xFC,       //        JR NZ, $0162
+	    0x21, 0x80, 0xFF, //        LD HL, $FF80
+	    0x11, 0xA1, 0x01, //        LD DE, $01A1
+	    0x06, 0x08,       //        LD B, $08
+	    0x1A,             // $016E: LD A, (DE)
+	    0x13,             //        INC DE
+	    0x22,             //        LD (HL+), A
+	    0x05,             //        DEC B
+	    0x20, 0xFA,       //        JR NZ, $016E
+	    0x21, 0x00, 0xC1, // $0174: LD HL, $C100
+	    0x06, 0x0A,       //        LD B, $0A
+	    0x78,             // $0179: LD A, B
+	    0x87,             //        ADD A, A
+	    0x87,             //        ADD A, A
+	    0x87,             //        ADD A, A
+	    0x82,             //        ADD A, D
+	    0x22,             //        LD (HL+), A
+	    0x2F,             //        CPL
+	    0x22,             //        LD (HL+), A
+	    0x3E, 0x01,       //        LD A, $01
+	    0x22,             //        LD (HL+), A
+	    0x78,             //        LD A, B
+	    0xE6, 0x01,       //        AND $01
+	    0x0F,             //        RRCA
+	    0x0F,             //        RRCA
+	    0x22,             //        LD (HL+), A
+	    0x05,             //        DEC B
+	    0x20, 0xEC,       //        JR NZ, $0179
+	    0x3E, 0xC1,       //        LD A, $C1
+	    0xCD, 0x80, 0xFF, //        CALL $FF80
+	    0x14,             //        INC D
+	    0xF0, 0x44,       // $0193: LDH A, ($44)
+	    0xFE, 0x90,       //        CP $90
+	    0x20, 0xFA,       //        JR NZ, $0193
+	    0xF0, 0x44,       // $0199: LDH A, ($44)
+	    0xFE, 0x90,       //        CP $90
+	    0x28, 0xFA,       //        JR Z, $0199
+	    0x18, 0xD3,       //        JR $0174
+	    0xE0, 0x46,       // $01A1: LDH ($46), A
+	    0x3E, 0x28,       //        LD A, $28
+	    0x3D,             // $01A5: DEC A
+	    0x20, 0xFD,       //        JR NZ, $01A5
+	    0xC9,             //        RET
+	});
+	// clang-format on
+
+	return roms;
+}
+
+/**
+ * Put the Gameboy into the state the boot ROM leaves behind, so that the
+ * ROMs start running straight away
+ */
+void skip_boot(Gameboy &gb) {
+	gb.memory->write(0xFF50, 0x01);
+	gb.memory->write(0xFF40, 0x91);
+	gb.memory->write(0xFF47, 0xFC);
+
+	auto registers = RegisterState{};
+	registers.af = 0x01B0;
+	registers.bc = 0x0013;
+	registers.de = 0x00D8;
+	registers.hl = 0x014D;
+	registers.sp = 0xFFFE;
+	registers.pc = 0x0100;
+	gb.cpu->set_register_state(registers);
+}
+
+/**
+ * Hash the screen, and VRAM, OAM, WRAM and high RAM
+ */
+FrameHashes hash_frame(const Gameboy &gb) {
+	auto hashes = FrameHashes{};
+	auto &v_buffer = gb.gpu->get_video_buffer();
+	hashes.screen = hash_bytes(
+	    reinterpret_cast<const uint8_t *>(v_buffer.data()), v_buffer.size());
+
+	auto memory = gb.memory->get_state();
+	auto ram = vector<uint8_t>();
+	auto add_range = [&](Address start, Address end) {
+		for (uint32_t addr = start; addr <= end; ++addr) {
+			ram.push_back(memory.get_byte(static_cast<Address>(addr)));
+		}
+	};
+	add_range(0x8000, 0x9FFF);
+	add_range(0xC000, 0xDFFF);
+	add_range(0xFE00, 0xFE9F);
+	add_range(0xFF80, 0xFFFE);
+	hashes.ram = hash_bytes(ram.data(), ram.size());
+	return hashes;
+}
+
+/**
+ * Run a ROM and hash every frame
+ */
+vector<FrameHashes> run_rom(const vector<uint8_t> &rom, ExecutionMode mode,
+                            size_t render_threads = 0) {
+	auto gb = Gameboy(make_unique<Cartridge>(rom), true);
+	gb.cpu->set_execution_mode(mode);
+	gb.gpu->set_render_threads(render_threads);
+	skip_boot(gb);
+
+	auto frames = vector<FrameHashes>();
+	while (frames.size() < REGRESSION_FRAMES) {
+		gb.tick();
+		if (gb.gpu->get_frame_count() > frames.size()) {
+			frames.push_back(hash_frame(gb));
+		}
+	}
+	return frames;
+}
+
+class RegressionTest : public Test {
+  protected:
+	map<string, vector<uint8_t>> roms;
+
+	/**
+	 * Golden screen hashes of every frame, by ROM name
+	 */
+	map<string, vector<uint64_t>> golden_screens;
+
+	/**
+	 * Golden RAM hashes of every frame, by ROM and mode name
+	 */
+	map<string, vector<uint64_t>> golden_ram;
+
+	void SetUp() override {
+		Log::set_level(LogLevel::ERROR);
+		roms = make_regression_roms();
+
+		if (getenv("TVP_UPDATE_GOLDEN")) {
+			write_golden();
+		}
+		read_golden();
+	}
+
+	/**
+	 * Regenerate the golden file. Fails without writing anything if a mode
+	 * draws a different screen than the interpreter.
+	 */
+	void write_golden() {
+		auto screen_lines = ostringstream();
+		auto ram_lines = ostringstream();
+		for (auto &rom : roms) {
+			auto screens = vector<uint64_t>();
+			for (auto &mode : REGRESSION_MODES) {
+				auto frames = run_rom(rom.second, mode.first);
+				for (size_t i = 0; i < frames.size(); ++i) {
+					if (screens.size() == i) {
+						screens.push_back(frames[i].screen);
+						screen_lines << "screen " << rom.first << " " << i
+						             << hex << " " << frames[i].screen << dec
+						             << "\n";
+					}
+					ASSERT_EQ(frames[i].screen, screens[i])
+					    << rom.first << " " << mode.second
+					    << " screen differs from the interpreter at frame "
+					    << i;
+
+					ram_lines << "ram " << rom.first << " " << mode.second
+					          << " " << i << hex << " " << frames[i].ram << dec
+					          << "\n";
+				}
+			}
+		}
+
+		auto file = ofstream(TVP_REGRESSION_GOLDEN);
+		file << "# screen rom frame hash\n"
+		     << screen_lines.str() << "# ram rom mode frame hash\n"
+		     << ram_lines.str();
+	}
+
+	void read_golden() {
+		auto file = ifstream(TVP_REGRESSION_GOLDEN);
+		ASSERT_TRUE(file) << "Missing golden file " << TVP_REGRESSION_GOLDEN;
+
+		auto line = string();
+		while (getline(file, line)) {
+			if (line.empty() || line[0] == '#') {
+				continue;
+			}
+
+			auto in = istringstream(line);
+			auto kind = string();
+			auto name = string();
+			auto mode = string();
+			size_t frame = 0;
+			uint64_t hash = 0;
+			in >> kind >> name;
+			if (kind == "screen") {
+				in >> frame >> hex >> hash;
+				golden_screens[name].push_back(hash);
+			} else {
+				in >> mode >> frame >> hex >> hash;
+				golden_ram[name + " " + mode].push_back(hash);
+			}
+		}
+	}
+
+	void check_mode(size_t mode_index, size_t render_threads = 0) {
+		auto &mode = REGRESSION_MODES[mode_index];
+		for (auto &rom : roms) {
+			auto &screens = golden_screens[rom.first];
+			auto &ram = golden_ram[rom.first + " " + mode.second];
+			ASSERT_EQ(screens.size(), REGRESSION_FRAMES)
+			    << "No golden screen hashes for " << rom.first;
+			ASSERT_EQ(ram.size(), REGRESSION_FRAMES)
+			    << "No golden RAM hashes for " << rom.first << " "
+			    << mode.second;
+
+			auto frames = run_rom(rom.second, mode.first, render_threads);
+			for (size_t i = 0; i < frames.size(); ++i) {
+				EXPECT_EQ(frames[i].screen, screens[i])
+				    << rom.first << " screen differs at frame " << i;
+				ASSERT_EQ(frames[i].ram, ram[i])
+				    << rom.first << " RAM differs at frame " << i;
+				if (HasFailure()) {
+					return;
+				}
+			}
+		}
+	}
+};
+
+TEST_F(RegressionTest, InterpreterTest) { check_mode(0); }
+
+TEST_F(RegressionTest, BlockCacheTest) { check_mode(1); }
+
+TEST_F(RegressionTest, JitTest) { check_mode(2); }
+
+TEST_F(RegressionTest, DeferredRenderTest) { check_mode(0, 2); }
@@ -0,0 +1,112 @@
+#include "cpu/utils.h"
+#include "util/disassembler.h"
+#include "utils/rom.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+using namespace testing;
+using namespace std;
+using namespace test_utils;
+
+/**
+ * Disassemble the given bytes at the given address
+ */
+DisassembledInstruction decode(vector<uint8_t> bytes,
+                               uint16_t address = 0x0150) {
+	return disassemble_instruction(bytes.data(), bytes.size(), address);
+}
+
+TEST(DisassemblerTest, MnemonicTest) {
+	EXPECT_EQ(get_mnemonic(0x00), "NOP");
+	EXPECT_EQ(get_mnemonic(0x20), "JR NZ, r8");
+	EXPECT_EQ(get_mnemonic(0xE0), "LDH (a8), A");
+	EXPECT_EQ(get_mnemonic(0xCB), "PREFIX CB");
+	EXPECT_EQ(get_mnemonic(0xD3), "DB");
+
+	EXPECT_EQ(get_cb_mnemonic(0x11), "RL C");
+	EXPECT_EQ(get_cb_mnemonic(0x36), "SWAP (HL)");
+	EXPECT_EQ(get_cb_mnemonic(0x7C), "BIT 7, H");
+	EXPECT_EQ(get_cb_mnemonic(0x87), "RES 0, A");
+	EXPECT_EQ(get_cb_mnemonic(0xFF), "SET 7, A");
+}
+
+TEST(DisassemblerTest, LengthTest) {
+	// STOP is two bytes, even though the CPU only steps over one
+	for (auto opcode = 0; opcode < 0x100; ++opcode) {
+		auto inst = decode({static_cast<uint8_t>(opcode), 0x00, 0x00});
+		auto expected = opcode == 0x10 ? 2 : cpu::instruction_length[opcode];
+		EXPECT_EQ(inst.length, expected) << "opcode " << opcode;
+	}
+}
+
+TEST(DisassemblerTest, OperandTest) {
+	EXPECT_STREQ(decode({0x01, 0x34, 0x12}).text, "LD BC, $1234");
+	EXPECT_STREQ(decode({0x3E, 0x7F}).text, "LD A, $7F");
+	EXPECT_STREQ(decode({0xE0, 0x44}).text, "LDH ($FF44), A");
+	EXPECT_STREQ(decode({0xEA, 0x00, 0xC0}).text, "LD ($C000), A");
+	EXPECT_STREQ(decode({0xE8, 0x05}).text, "ADD SP, $05");
+	EXPECT_STREQ(decode({0xF8, 0xFE}).text, "LD HL, SP-$02");
+	EXPECT_STREQ(decode({0xCB, 0x7C}).text, "BIT 7, H");
+	EXPECT_STREQ(decode({0xD3}).text, "DB $D3");
+
+	// Cut off by the end of the data
+	auto cut = decode({0xC3, 0x50});
+	EXPECT_STREQ(cut.text, "DB $C3");
+	EXPECT_EQ(cut.length, 1);
+}
+
+TEST(DisassemblerTest, TargetTest) {
+	auto jr = decode({0x20, 0xFE}, 0x0150);
+	EXPECT_STREQ(jr.text, "JR NZ, $0150");
+	EXPECT_TRUE(jr.has_target);
+	EXPECT_EQ(jr.target, 0x0150);
+
+	auto call = decode({0xCD, 0x00, 0x40});
+	EXPECT_STREQ(call.text, "CALL $4000");
+	EXPECT_TRUE(call.has_target);
+	EXPECT_EQ(call.target, 0x4000);
+
+	auto rst = decode({0xEF});
+	EXPECT_TRUE(rst.has_target);
+	EXPECT_EQ(rst.target, 0x0028);
+
+	EXPECT_FALSE(decode({0xE9}).has_target); // JP (HL)
+	EXPECT_FALSE(decode({0xEA, 0x00, 0xC0}).has_target);
+}
+
+TEST(DisassemblerTest, RomTest) {
+	auto rom = make_rom({0x3E, 0x01, 0xCB, 0x11, 0x18, 0xFA});
+	rom.resize(0x10000, 0x00);
+	rom[0x4000] = 0xCD; // CALL $0150
+	rom[0x4001] = 0x50;
+	rom[0x4002] = 0x01;
+
+	auto banks = disassemble_rom(rom, 4);
+	ASSERT_EQ(banks.size(), 4);
+
+	for (auto &bank : banks) {
+		// Every byte of the bank is covered, in order
+		uint32_t next = bank.bank == 0 ? 0x0000 : 0x4000;
+		for (auto &inst : bank.instructions) {
+			ASSERT_EQ(inst.address, next);
+			next += inst.length;
+		}
+		EXPECT_EQ(next, bank.bank == 0 ? 0x4000 : 0x8000);
+	}
+	EXPECT_STREQ(banks[1].instructions[0].text, "CALL $0150");
+
+	// The same result on a single thread
+	auto single = disassemble_rom(rom, 1);
+	auto parallel_text = stringstream();
+	auto single_text = stringstream();
+	write_disassembly(parallel_text, banks);
+	write_disassembly(single_text, single);
+	EXPECT_EQ(parallel_text.str(), single_text.str());
+	EXPECT_NE(parallel_text.str().find("00:0150  LD A, $01\n00:0152  RL C\n"
+	                                   "00:0154  JR $0150\n"),
+	          string::npos);
+	EXPECT_NE(parallel_text.str().find("01:4000  CALL $0150\n"),
+	          string::npos);
+}
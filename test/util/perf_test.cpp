@@ -0,0 +1,36 @@
+#include "util/perf.h"
+
+#include <gtest/gtest.h>
+
+using namespace testing;
+
+TEST(HistogramTest, PercentileTest) {
+	auto histogram = Histogram();
+	for (uint64_t i = 1; i <= 1000; ++i) {
+		histogram.record(i * 1000);
+	}
+
+	EXPECT_EQ(histogram.get_count(), 1000u);
+	EXPECT_EQ(histogram.get_max(), 1000000u);
+	EXPECT_EQ(histogram.get_mean(), 500500u);
+
+	// Buckets are within ~6% of the values that fall into them
+	EXPECT_NEAR(histogram.get_percentile(0.50), 500000, 500000 * 0.07);
+	EXPECT_NEAR(histogram.get_percentile(0.99), 990000, 990000 * 0.07);
+	EXPECT_LE(histogram.get_percentile(1.0), histogram.get_max());
+}
+
+TEST(HistogramTest, SmallValueTest) {
+	auto histogram = Histogram();
+	for (uint64_t i = 0; i < 16; ++i) {
+		histogram.record(i);
+	}
+
+	// Values below the sub-bucket count are exact
+	EXPECT_EQ(histogram.get_percentile(0.0), 0u);
+	EXPECT_EQ(histogram.get_percentile(0.5), 8u);
+
+	histogram.reset();
+	EXPECT_EQ(histogram.get_count(), 0u);
+	EXPECT_EQ(histogram.get_percentile(0.5), 0u);
+}
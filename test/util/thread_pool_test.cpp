@@ -0,0 +1,37 @@
+#include "util/thread_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+
+using namespace testing;
+
+TEST(ThreadPoolTest, RunsAllTasksTest) {
+	auto pool = ThreadPool(4);
+	auto count = std::atomic<int>(0);
+
+	for (auto i = 0; i < 1000; ++i) {
+		pool.submit([&count]() { ++count; });
+	}
+	pool.wait();
+
+	EXPECT_EQ(count, 1000);
+	EXPECT_EQ(pool.get_thread_count(), 4u);
+}
+
+TEST(ThreadPoolTest, NestedSubmitTest) {
+	auto pool = ThreadPool(3);
+	auto count = std::atomic<int>(0);
+
+	// Tasks submitted from inside the pool are waited on as well
+	for (auto i = 0; i < 10; ++i) {
+		pool.submit([&pool, &count]() {
+			for (auto j = 0; j < 10; ++j) {
+				pool.submit([&count]() { ++count; });
+			}
+		});
+	}
+	pool.wait();
+
+	EXPECT_EQ(count, 100);
+}
@@ -0,0 +1,42 @@
+/**
+ * @file rom.h
+ * Helpers to build small test ROMs in memory
+ */
+
+#pragma once
+
+#include "cartridge/utils.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace test_utils {
+
+/**
+ * Build a 32KB ROM with a valid header and the given program at $0150. Both
+ * $0000 (for when the boot ROM is skipped) and $0100 (the regular entry point)
+ * jump to the program.
+ */
+inline std::vector<uint8_t> make_rom(const std::vector<uint8_t> &program) {
+	auto rom = std::vector<uint8_t>(0x8000, 0x00);
+
+	auto jump = std::vector<uint8_t>{0xC3, 0x50, 0x01}; // JP $0150
+	std::copy(jump.begin(), jump.end(), rom.begin() + 0x0000);
+	std::copy(jump.begin(), jump.end(), rom.begin() + 0x0100);
+
+	std::copy(nintendo_logo.begin(), nintendo_logo.end(),
+	          rom.begin() + nintendo_logo_start_address);
+
+	// Header checksum, verified by the boot ROM
+	uint8_t checksum = 0;
+	for (auto i = 0x0134; i <= 0x014C; ++i) {
+		checksum = checksum - rom[i] - 1;
+	}
+	rom[0x014D] = checksum;
+
+	std::copy(program.begin(), program.end(), rom.begin() + 0x0150);
+	return rom;
+}
+
+} // namespace test_utils